@@ -137,90 +137,108 @@ void offload_bassboost_set_strength(struct bass_boost_params *bassboost,
 #endif
 }
 
-static int send_kv_payload(pal_stream_handle_t *pal_stream_handle,
-                            uint32_t tag, pal_key_vector_t *kvp)
-{
-   int ret = 0;
-   pal_param_payload *pal_payload;
-   effect_pal_payload_t *effect_payload = NULL;
-   uint8_t *payload = NULL;
-   pal_key_vector_t *pal_key_vector = NULL;
-   uint32_t payload_size = 0;
-   payload_size = sizeof(pal_param_payload) + sizeof(effect_pal_payload_t) +
-                  sizeof(pal_key_vector_t) +
-                  kvp->num_tkvs * sizeof(pal_key_value_pair_t);
-
-   payload = (uint8_t *) calloc (1, payload_size);
-   if (!payload) {
-       ALOGE("%s:%d calloc failed for size %d", __func__, __LINE__, payload_size);
-       ret = -ENOMEM;
-       goto done;
-   }
-   pal_payload = (pal_param_payload *) payload;
-   pal_payload->payload_size = sizeof(effect_pal_payload_t) +
-                                  sizeof(pal_key_vector_t) +
-                                  kvp->num_tkvs * sizeof(pal_key_value_pair_t);
-
-    effect_payload = (effect_pal_payload_t *)(payload + sizeof(pal_param_payload));
-    effect_payload->isTKV = PARAM_TKV;
+/*
+ * UI effect params are built in an arena on the caller's stack, so a param change
+ * does not allocate. Each param is still one pal_stream_set_param() call: a
+ * PAL_PARAM_ID_UIEFFECT payload carries a single tag, and a single param id when it
+ * is not a TKV, so the switch and the custom params of an effect cannot share a call.
+ */
+/* largest custom param: an EQ config with MAX_EQ_BANDS bands */
+#define EFFECT_PAYLOAD_MAX_DATA_WORDS \
+        (EQ_CONFIG_PARAM_LEN + MAX_EQ_BANDS * EQ_CONFIG_PER_BAND_PARAM_LEN)
+#define EFFECT_PAYLOAD_ARENA_SIZE \
+        (sizeof(pal_param_payload) + sizeof(effect_pal_payload_t) + \
+         sizeof(pal_effect_custom_payload_t) + EFFECT_PAYLOAD_MAX_DATA_WORDS * sizeof(uint32_t))
+
+typedef struct effect_payload_buf_s {
+    uint64_t arena[(EFFECT_PAYLOAD_ARENA_SIZE + sizeof(uint64_t) - 1) / sizeof(uint64_t)];
+} effect_payload_buf_t;
+
+/* fills in the payload headers and returns the zeroed data area of size bytes */
+static uint8_t *payload_header(effect_payload_buf_t *buf, uint32_t tag,
+                               uint32_t is_tkv, uint32_t size)
+{
+    uint8_t *payload = (uint8_t *)buf->arena;
+    pal_param_payload *pal_payload = (pal_param_payload *)payload;
+    effect_pal_payload_t *effect_payload =
+            (effect_pal_payload_t *)(payload + sizeof(pal_param_payload));
+
+    memset(payload, 0, sizeof(pal_param_payload) + sizeof(effect_pal_payload_t) + size);
+    pal_payload->payload_size = sizeof(effect_pal_payload_t) + size;
+    effect_payload->isTKV = is_tkv;
     effect_payload->tag = tag;
-    effect_payload->payloadSize = sizeof(pal_key_vector_t) +
-                                  kvp->num_tkvs * sizeof(pal_key_value_pair_t);
-    pal_key_vector = (pal_key_vector_t *)(payload +
-                                              sizeof(pal_param_payload) +
-                                              sizeof(effect_pal_payload_t));
-
-    pal_key_vector->num_tkvs = kvp->num_tkvs;
-    memcpy(pal_key_vector->kvp, kvp->kvp,
-                        (kvp->num_tkvs * sizeof(pal_key_value_pair_t)));
+    effect_payload->payloadSize = size;
+    return payload + sizeof(pal_param_payload) + sizeof(effect_pal_payload_t);
+}
+
+static int payload_send(pal_stream_handle_t *pal_stream_handle, uint32_t tag,
+                        uint32_t param_id, effect_payload_buf_t *buf)
+{
+    int ret;
+
     ret = pal_stream_set_param(pal_stream_handle, PAL_PARAM_ID_UIEFFECT,
-                               pal_payload);
-    free(pal_payload);
-done:
+                               (pal_param_payload *)buf->arena);
+    if (ret)
+        ALOGE("%s: pal_stream_set_param failed for tag 0x%x param 0x%x. ret = %d",
+              __func__, tag, param_id, ret);
     return ret;
 }
 
-static int send_custom_payload(pal_stream_handle_t *pal_stream_handle,
-                              uint32_t tag, pal_effect_custom_payload_t *data,
-                              uint32_t custom_data_sz)
+static int send_kv_payload(pal_stream_handle_t *pal_stream_handle, uint32_t tag,
+                           uint32_t key, uint32_t value, effect_payload_buf_t *buf)
 {
-    int ret = 0;
-    pal_param_payload *pal_payload;
-    effect_pal_payload_t *effect_payload = NULL;
-    uint8_t *payload = NULL;
-    pal_effect_custom_payload_t *custom_payload = NULL;
-    uint32_t payload_size = 0;
-    payload_size = sizeof(pal_param_payload) + sizeof(effect_pal_payload_t) +
-                   sizeof(pal_effect_custom_payload_t) + custom_data_sz;
-
-    payload = (uint8_t *) calloc (1, payload_size);
-    if (!payload) {
-        ALOGE("%s:%d calloc failed for size %d", __func__, __LINE__, payload_size);
-        ret = -ENOMEM;
-        goto done;
+    pal_key_vector_t *pal_key_vector;
+
+    pal_key_vector = (pal_key_vector_t *)payload_header(buf, tag, PARAM_TKV,
+            sizeof(pal_key_vector_t) + sizeof(pal_key_value_pair_t));
+    pal_key_vector->num_tkvs = 1;
+    pal_key_vector->kvp[0].key = key;
+    pal_key_vector->kvp[0].value = value;
+    return payload_send(pal_stream_handle, tag, key, buf);
+}
+
+/* headers of a custom param of num_words zeroed words, NULL if too large */
+static pal_effect_custom_payload_t *custom_payload_header(effect_payload_buf_t *buf,
+        uint32_t tag, uint32_t param_id, uint32_t num_words)
+{
+    pal_effect_custom_payload_t *custom_payload;
+
+    if (num_words > EFFECT_PAYLOAD_MAX_DATA_WORDS) {
+        ALOGE("%s: param 0x%x too large, %u words", __func__, param_id, num_words);
+        return NULL;
     }
+    custom_payload = (pal_effect_custom_payload_t *)payload_header(buf, tag, PARAM_NONTKV,
+            sizeof(pal_effect_custom_payload_t) + num_words * sizeof(uint32_t));
+    custom_payload->paramId = param_id;
+    return custom_payload;
+}
 
-    pal_payload = (pal_param_payload *) payload;
-    pal_payload->payload_size = sizeof(effect_pal_payload_t) +
-                                  sizeof(pal_effect_custom_payload_t) +
-                                  custom_data_sz;
+static int send_custom_payload(pal_stream_handle_t *pal_stream_handle, uint32_t tag,
+                               uint32_t param_id, const uint32_t *data, uint32_t num_words,
+                               effect_payload_buf_t *buf)
+{
+    pal_effect_custom_payload_t *custom_payload;
 
-    effect_payload = (effect_pal_payload_t *)(payload + sizeof(pal_param_payload));
-    effect_payload->isTKV = PARAM_NONTKV;
-    effect_payload->tag = tag;
-    effect_payload->payloadSize = sizeof(pal_effect_custom_payload_t) +
-                                  custom_data_sz;
-    custom_payload = (pal_effect_custom_payload_t *)(payload +
-                                                   sizeof(pal_param_payload) +
-                                                   sizeof(effect_pal_payload_t));
-
-    custom_payload->paramId = data->paramId;
-    memcpy(custom_payload->data, data->data, custom_data_sz);
-    ret = pal_stream_set_param(pal_stream_handle, PAL_PARAM_ID_UIEFFECT,
-                              pal_payload);
-    free(pal_payload);
-done:
-    return ret;
+    custom_payload = custom_payload_header(buf, tag, param_id, num_words);
+    if (!custom_payload)
+        return -EINVAL;
+    memcpy(custom_payload->data, data, num_words * sizeof(uint32_t));
+    return payload_send(pal_stream_handle, tag, param_id, buf);
+}
+
+/* single value custom param of len words, the remaining words are zero */
+static int send_value_payload(pal_stream_handle_t *pal_stream_handle, uint32_t tag,
+                              uint32_t param_id, uint32_t value, uint32_t len,
+                              effect_payload_buf_t *buf)
+{
+    pal_effect_custom_payload_t *custom_payload;
+
+    custom_payload = custom_payload_header(buf, tag, param_id, len);
+    if (!custom_payload)
+        return -EINVAL;
+    if (len)
+        custom_payload->data[0] = value;
+    return payload_send(pal_stream_handle, tag, param_id, buf);
 }
 
 void offload_bassboost_set_mode(struct bass_boost_params *bassboost,
@@ -234,82 +252,32 @@ static int bassboost_send_params_pal(eff_mode_t mode, pal_stream_handle_t *pal_s
                                   struct bass_boost_params *bassboost,
                                  unsigned param_send_flags)
 {
+    effect_payload_buf_t buf;
     int ret = 0;
-    pal_effect_custom_payload_t *custom_payload = NULL;
 
     if (!pal_stream_handle) {
         ALOGE("%s: pal stream handle is null.\n", __func__);
         return -EINVAL;
     }
     if (param_send_flags & OFFLOAD_SEND_BASSBOOST_ENABLE_FLAG) {
-        uint32_t num_kvs = 1;
-        pal_key_vector_t *pal_key_vector = NULL;
-        pal_key_vector = (pal_key_vector_t *) calloc(1, sizeof(pal_key_vector_t) +
-                                            num_kvs * sizeof(pal_key_value_pair_t));
-        if (!pal_key_vector) {
-            ALOGE("%s:%d calloc failed for size %zu", __func__, __LINE__,
-                 sizeof(pal_key_vector_t) + num_kvs * sizeof(pal_key_value_pair_t));
-            ret = -ENOMEM;
+        ret = send_kv_payload(pal_stream_handle, TAG_STREAM_BASS_BOOST,
+                              BASS_BOOST_SWITCH, bassboost->enable_flag, &buf);
+        if (ret)
             goto done;
-        }
-        pal_key_vector->num_tkvs = num_kvs;
-        pal_key_vector->kvp[0].key= BASS_BOOST_SWITCH;
-        pal_key_vector->kvp[0].value = bassboost->enable_flag;
-
-        ret = send_kv_payload(pal_stream_handle, TAG_STREAM_BASS_BOOST, pal_key_vector);
-        free(pal_key_vector);
-        if (ret) {
-            ALOGE("%s: pal_stream_set_param failed. ret = %d", __func__, ret);
-            goto done;
-        }
     }
 
     if (param_send_flags & OFFLOAD_SEND_BASSBOOST_STRENGTH) {
-        uint32_t custom_data_sz = BASS_BOOST_STRENGTH_PARAM_LEN * sizeof(uint32_t);
-        custom_payload = (pal_effect_custom_payload_t *) calloc (1,
-                                           sizeof(pal_effect_custom_payload_t) +
-                                           custom_data_sz);
-        if (!custom_payload) {
-            ALOGE("%s:%d calloc failed for size %d", __func__, __LINE__,
-                   custom_data_sz);
-            ret = -ENOMEM;
-            goto done;
-        }
-        custom_payload->paramId = PARAM_ID_BASS_BOOST_STRENGTH;
-        custom_payload->data[0] = bassboost->strength;
-        ret = send_custom_payload(pal_stream_handle, TAG_STREAM_BASS_BOOST,
-                              custom_payload, custom_data_sz);
-        free(custom_payload);
-        custom_payload = NULL;
-        if (ret) {
-            ALOGE("%s: pal_stream_set_param failed. ret = %d", __func__, ret);
+        ret = send_value_payload(pal_stream_handle, TAG_STREAM_BASS_BOOST,
+                                 PARAM_ID_BASS_BOOST_STRENGTH, bassboost->strength,
+                                 BASS_BOOST_STRENGTH_PARAM_LEN, &buf);
+        if (ret)
             goto done;
-        }
     }
 
-    if (param_send_flags & OFFLOAD_SEND_BASSBOOST_MODE) {
-        uint32_t custom_data_sz = BASS_BOOST_STRENGTH_PARAM_LEN * sizeof(uint32_t);
-        custom_payload = (pal_effect_custom_payload_t *) calloc (1,
-                                           sizeof(pal_effect_custom_payload_t) +
-                                           custom_data_sz);
-        if (!custom_payload) {
-            ALOGE("%s:%d calloc failed for size %d", __func__, __LINE__,
-                   custom_data_sz);
-            ret = -ENOMEM;
-            goto done;
-        }
-        custom_payload->paramId = PARAM_ID_BASS_BOOST_MODE;
-        custom_payload->data[0] = bassboost->strength;
-
-        ret = send_custom_payload(pal_stream_handle, TAG_STREAM_BASS_BOOST,
-                              custom_payload, custom_data_sz);
-        free(custom_payload);
-        custom_payload = NULL;
-        if (ret) {
-            ALOGE("%s: pal_stream_set_param failed. ret = %d", __func__, ret);
-            goto done;
-        }
-    }
+    if (param_send_flags & OFFLOAD_SEND_BASSBOOST_MODE)
+        ret = send_value_payload(pal_stream_handle, TAG_STREAM_BASS_BOOST,
+                                 PARAM_ID_BASS_BOOST_MODE, bassboost->strength,
+                                 BASS_BOOST_STRENGTH_PARAM_LEN, &buf);
 
 done:
     return ret;
@@ -347,6 +315,7 @@ static int pbe_send_params_pal(eff_mode_t mode, pal_stream_handle_t *pal_stream_
                             struct pbe_params *pbe,
                             unsigned param_send_flags)
 {
+    effect_payload_buf_t buf;
     int ret = 0;
 
     if (!pal_stream_handle) {
@@ -355,32 +324,10 @@ static int pbe_send_params_pal(eff_mode_t mode, pal_stream_handle_t *pal_stream_
     }
 
     ALOGV("%s: enabled=%d", __func__, pbe->enable_flag);
-    if (param_send_flags & OFFLOAD_SEND_PBE_ENABLE_FLAG) {
-        uint32_t num_kvs = 1;
-        pal_key_vector_t *pal_key_vector = NULL;
-
-        pal_key_vector = (pal_key_vector_t *) calloc (1, sizeof(pal_key_vector_t) +
-                                         num_kvs * sizeof(pal_key_value_pair_t));
-        if (!pal_key_vector) {
-            ALOGE("%s:%d calloc failed for size %zu", __func__, __LINE__,
-                 sizeof(pal_key_vector_t) + num_kvs * sizeof(pal_key_value_pair_t));
-            ret = -ENOMEM;
-            goto done;
-        }
+    if (param_send_flags & OFFLOAD_SEND_PBE_ENABLE_FLAG)
+        ret = send_kv_payload(pal_stream_handle, TAG_STREAM_PBE, PBE_SWITCH,
+                              pbe->enable_flag, &buf);
 
-        pal_key_vector->num_tkvs = num_kvs;
-        pal_key_vector->kvp[0].key= PBE_SWITCH;
-        pal_key_vector->kvp[0].value = pbe->enable_flag;
-
-        ret = send_kv_payload(pal_stream_handle, TAG_STREAM_PBE,
-                              pal_key_vector);
-        free(pal_key_vector);
-        if (ret) {
-            ALOGE("%s: pal_stream_set_param failed. ret = %d", __func__, ret);
-            goto done;
-        }
-    }
-done:
     return ret;
 }
 
@@ -445,103 +392,38 @@ static int virtualizer_send_params_pal(eff_mode_t mode, pal_stream_handle_t *pal
                                     struct virtualizer_params *virtualizer,
                                    unsigned param_send_flags)
 {
+    effect_payload_buf_t buf;
     int ret = 0;
-    pal_effect_custom_payload_t *custom_payload = NULL;
 
     ALOGV("%s: flags 0x%x", __func__, param_send_flags);
     if (param_send_flags & OFFLOAD_SEND_VIRTUALIZER_ENABLE_FLAG) {
-        uint32_t num_kvs = 1;
-        pal_key_vector_t *pal_key_vector = NULL;
-        pal_key_vector = (pal_key_vector_t *) calloc (1, sizeof(pal_key_vector_t) +
-                                         num_kvs * sizeof(pal_key_value_pair_t));
-        if (!pal_key_vector) {
-            ALOGE("%s:%d calloc failed for size %zu", __func__, __LINE__,
-                 sizeof(pal_key_vector_t) + num_kvs * sizeof(pal_key_value_pair_t));
-            ret = -ENOMEM;
-            goto done;
-        }
-
-        pal_key_vector->num_tkvs = num_kvs;
-        pal_key_vector->kvp[0].key= VIRTUALIZER_SWITCH;
-        pal_key_vector->kvp[0].value =  virtualizer->enable_flag;
-
         ret = send_kv_payload(pal_stream_handle, TAG_STREAM_VIRTUALIZER,
-                              pal_key_vector);
-        free(pal_key_vector);
-        if (ret) {
-            ALOGE("%s: pal_stream_set_param failed. ret = %d", __func__, ret);
+                              VIRTUALIZER_SWITCH, virtualizer->enable_flag, &buf);
+        if (ret)
             goto done;
-        }
     }
+
     if (param_send_flags & OFFLOAD_SEND_VIRTUALIZER_STRENGTH) {
-        uint32_t custom_data_sz = VIRTUALIZER_STRENGTH_PARAM_LEN * sizeof(uint32_t);
-        custom_payload = (pal_effect_custom_payload_t *) calloc (1,
-                                          sizeof(pal_effect_custom_payload_t) +
-                                          custom_data_sz);
-        if (!custom_payload) {
-             ALOGE("%s:%d calloc failed for size %d", __func__, __LINE__,
-                    custom_data_sz);
-             ret = -ENOMEM;
-             goto done;
-        }
-        custom_payload->paramId = PARAM_ID_VIRTUALIZER_STRENGTH;
-        custom_payload->data[0] = virtualizer->strength;
-
-        ret = send_custom_payload(pal_stream_handle, TAG_STREAM_VIRTUALIZER,
-                              custom_payload, custom_data_sz);
-        free(custom_payload);
-        custom_payload = NULL;
-        if (ret) {
-            ALOGE("%s: pal_stream_set_param failed. ret = %d", __func__, ret);
+        ret = send_value_payload(pal_stream_handle, TAG_STREAM_VIRTUALIZER,
+                                 PARAM_ID_VIRTUALIZER_STRENGTH, virtualizer->strength,
+                                 VIRTUALIZER_STRENGTH_PARAM_LEN, &buf);
+        if (ret)
             goto done;
-        }
     }
+
     if (param_send_flags & OFFLOAD_SEND_VIRTUALIZER_OUT_TYPE) {
-        uint32_t custom_data_sz = VIRTUALIZER_STRENGTH_PARAM_LEN * sizeof(uint32_t);
-        custom_payload = (pal_effect_custom_payload_t *) calloc (1,
-                                         sizeof(pal_effect_custom_payload_t) +
-                                         custom_data_sz);
-        if (!custom_payload) {
-             ALOGE("%s:%d calloc failed for size %d", __func__, __LINE__,
-                    custom_data_sz);
-             ret = -ENOMEM;
-             goto done;
-        }
-        custom_payload->paramId = PARAM_ID_VIRTUALIZER_OUT_TYPE;
-        custom_payload->data[0] = virtualizer->out_type;
-        ret = send_custom_payload(pal_stream_handle, TAG_STREAM_VIRTUALIZER,
-                              custom_payload, custom_data_sz);
-        free(custom_payload);
-        custom_payload = NULL;
-
-        if (ret) {
-            ALOGE("%s: pal_stream_set_param failed. ret = %d", __func__, ret);
-            goto done;
-        }
-    }
-    if (param_send_flags & OFFLOAD_SEND_VIRTUALIZER_GAIN_ADJUST) {
-        uint32_t custom_data_sz = VIRTUALIZER_STRENGTH_PARAM_LEN * sizeof(uint32_t);
-        custom_payload = (pal_effect_custom_payload_t *) calloc (1,
-                                                sizeof(pal_effect_custom_payload_t) +
-                                                custom_data_sz);
-        if (!custom_payload) {
-             ALOGE("%s:%d calloc failed for size %d", __func__, __LINE__,
-                    custom_data_sz);
-             ret = -ENOMEM;
-             goto done;
-        }
-        custom_payload->paramId = PARAM_ID_VIRTUALIZER_GAIN_ADJUST;
-        custom_payload->data[0] = virtualizer->gain_adjust;
-
-        ret = send_custom_payload(pal_stream_handle, TAG_STREAM_VIRTUALIZER,
-                              custom_payload, custom_data_sz);
-        free(custom_payload);
-        custom_payload = NULL;
-        if (ret) {
-            ALOGE("%s: pal_stream_set_param failed. ret = %d", __func__, ret);
+        ret = send_value_payload(pal_stream_handle, TAG_STREAM_VIRTUALIZER,
+                                 PARAM_ID_VIRTUALIZER_OUT_TYPE, virtualizer->out_type,
+                                 VIRTUALIZER_STRENGTH_PARAM_LEN, &buf);
+        if (ret)
             goto done;
-        }
     }
+
+    if (param_send_flags & OFFLOAD_SEND_VIRTUALIZER_GAIN_ADJUST)
+        ret = send_value_payload(pal_stream_handle, TAG_STREAM_VIRTUALIZER,
+                                 PARAM_ID_VIRTUALIZER_GAIN_ADJUST, virtualizer->gain_adjust,
+                                 VIRTUALIZER_STRENGTH_PARAM_LEN, &buf);
+
 done:
     return ret;
 }
@@ -607,8 +489,9 @@ static int eq_send_params_pal(eff_mode_t mode, pal_stream_handle_t *pal_stream_h
                           unsigned param_send_flags)
 {
     uint32_t i = 0, index = 0;
+    uint32_t data[EFFECT_PAYLOAD_MAX_DATA_WORDS];
+    effect_payload_buf_t buf;
     int ret = 0;
-    pal_effect_custom_payload_t *custom_payload = NULL;
 
     if (!pal_stream_handle) {
         ALOGE("%s: pal stream handle is null.\n", __func__);
@@ -622,90 +505,44 @@ static int eq_send_params_pal(eff_mode_t mode, pal_stream_handle_t *pal_stream_h
     }
 
     if (param_send_flags & OFFLOAD_SEND_EQ_ENABLE_FLAG) {
-        uint32_t num_kvs = 1;
-        pal_key_vector_t *pal_key_vector = NULL;
-        pal_key_vector = (pal_key_vector_t *) calloc (1, sizeof(pal_key_vector_t) +
-                                           num_kvs * sizeof(pal_key_value_pair_t));
-        if (!pal_key_vector) {
-            ALOGE("%s:%d calloc failed for size %zu", __func__, __LINE__,
-                 sizeof(pal_key_vector_t) + num_kvs * sizeof(pal_key_value_pair_t));
-            ret = -ENOMEM;
-            goto done;
-        }
-
-        pal_key_vector->num_tkvs = num_kvs;
-        pal_key_vector->kvp[0].key= EQUALIZER_SWITCH;
-        pal_key_vector->kvp[0].value = eq->enable_flag;
         ret = send_kv_payload(pal_stream_handle, TAG_STREAM_EQUALIZER,
-                              pal_key_vector);
-        free(pal_key_vector);
-        if (ret) {
-            ALOGE("%s: pal_stream_set_param failed. ret = %d", __func__, ret);
+                              EQUALIZER_SWITCH, eq->enable_flag, &buf);
+        if (ret)
             goto done;
-        }
     }
 
     if (param_send_flags & OFFLOAD_SEND_EQ_PRESET) {
-        uint32_t custom_data_sz = EQ_CONFIG_PARAM_LEN * sizeof(uint32_t);
-        custom_payload = (pal_effect_custom_payload_t *) calloc (1,
-                                           sizeof(pal_effect_custom_payload_t) +
-                                           custom_data_sz);
-        if (!custom_payload) {
-             ALOGE("%s:%d calloc failed for size %d", __func__, __LINE__,
-                    custom_data_sz);
-             ret = -ENOMEM;
-             goto done;
-        }
-        custom_payload->paramId = PARAM_ID_EQ_CONFIG;
-        custom_payload->data[0] = eq->config.eq_pregain;
-        custom_payload->data[1] =
-            map_eq_opensl_preset_2_offload_preset[eq->config.preset_id];
-        custom_payload->data[2] = 0;    // num_of_band must be 0 for preset
-
+        data[0] = eq->config.eq_pregain;
+        data[1] = map_eq_opensl_preset_2_offload_preset[eq->config.preset_id];
+        data[2] = 0;    // num_of_band must be 0 for preset
         ret = send_custom_payload(pal_stream_handle, TAG_STREAM_EQUALIZER,
-                              custom_payload, custom_data_sz);
-        free(custom_payload);
-        custom_payload = NULL;
-        if (ret) {
-            ALOGE("%s: pal_stream_set_param failed. ret = %d", __func__, ret);
+                                  PARAM_ID_EQ_CONFIG, data, EQ_CONFIG_PARAM_LEN, &buf);
+        if (ret)
             goto done;
-        }
     }
 
     if (param_send_flags & OFFLOAD_SEND_EQ_BANDS_LEVEL) {
-        uint32_t custom_data_sz = (EQ_CONFIG_PARAM_LEN +
-         (eq->config.num_bands * EQ_CONFIG_PER_BAND_PARAM_LEN)) * sizeof(uint32_t);
-
-        custom_payload = (pal_effect_custom_payload_t *) calloc (1,
-                                           sizeof(pal_effect_custom_payload_t) +
-                                           custom_data_sz);
-        if (!custom_payload) {
-             ALOGE("%s:%d calloc failed for size %d", __func__, __LINE__,
-                    custom_data_sz);
-             ret = -ENOMEM;
-             goto done;
+        if (eq->config.num_bands > MAX_EQ_BANDS) {
+            ALOGE("%s: %d bands, at most %d supported", __func__,
+                  eq->config.num_bands, MAX_EQ_BANDS);
+            ret = -EINVAL;
+            goto done;
         }
-        custom_payload->paramId = PARAM_ID_EQ_CONFIG;
         index = 0;
-        custom_payload->data[index++] = eq->config.eq_pregain;
-        custom_payload->data[index++] = CUSTOM_OPENSL_PRESET;
-        custom_payload->data[index++] = eq->config.num_bands;
+        data[index++] = eq->config.eq_pregain;
+        data[index++] = CUSTOM_OPENSL_PRESET;
+        data[index++] = eq->config.num_bands;
         for (i = 0; i < eq->config.num_bands; i++) {
-            custom_payload->data[index++] = eq->per_band_cfg[i].filter_type;
-            custom_payload->data[index++] = eq->per_band_cfg[i].freq_millihertz;
-            custom_payload->data[index++] = eq->per_band_cfg[i].gain_millibels;
-            custom_payload->data[index++] = eq->per_band_cfg[i].quality_factor;
-            custom_payload->data[index++] = eq->per_band_cfg[i].band_idx;
+            data[index++] = eq->per_band_cfg[i].filter_type;
+            data[index++] = eq->per_band_cfg[i].freq_millihertz;
+            data[index++] = eq->per_band_cfg[i].gain_millibels;
+            data[index++] = eq->per_band_cfg[i].quality_factor;
+            data[index++] = eq->per_band_cfg[i].band_idx;
         }
         ret = send_custom_payload(pal_stream_handle, TAG_STREAM_EQUALIZER,
-                              custom_payload, custom_data_sz);
-        free(custom_payload);
-        custom_payload = NULL;
-        if (ret) {
-            ALOGE("%s: pal_stream_set_param failed. ret = %d", __func__, ret);
-            goto done;
-        }
+                                  PARAM_ID_EQ_CONFIG, data, index, &buf);
     }
+
 done:
     return ret;
 }
@@ -830,361 +667,64 @@ static int reverb_send_params_pal(eff_mode_t mode, pal_stream_handle_t *pal_stre
                                struct reverb_params *reverb,
                               unsigned param_send_flags)
 {
+    const struct {
+        unsigned flag;
+        uint32_t param_id;
+        int value;
+        uint32_t len;
+    } reverb_params[] = {
+        {OFFLOAD_SEND_REVERB_MODE, PARAM_ID_REVERB_MODE,
+            reverb->mode, REVERB_MODE_PARAM_LEN},
+        {OFFLOAD_SEND_REVERB_PRESET, PARAM_ID_REVERB_PRESET,
+            reverb->preset, REVERB_PRESET_PARAM_LEN},
+        {OFFLOAD_SEND_REVERB_WET_MIX, PARAM_ID_REVERB_WET_MIX,
+            reverb->wet_mix, REVERB_WET_MIX_PARAM_LEN},
+        {OFFLOAD_SEND_REVERB_GAIN_ADJUST, PARAM_ID_REVERB_GAIN_ADJUST,
+            reverb->gain_adjust, REVERB_GAIN_ADJUST_PARAM_LEN},
+        {OFFLOAD_SEND_REVERB_ROOM_LEVEL, PARAM_ID_REVERB_ROOM_LEVEL,
+            reverb->room_level, REVERB_ROOM_LEVEL_PARAM_LEN},
+        {OFFLOAD_SEND_REVERB_ROOM_HF_LEVEL, PARAM_ID_REVERB_ROOM_HF_LEVEL,
+            reverb->room_hf_level, REVERB_ROOM_HF_LEVEL_PARAM_LEN},
+        {OFFLOAD_SEND_REVERB_DECAY_TIME, PARAM_ID_REVERB_DECAY_TIME,
+            reverb->decay_time, REVERB_DECAY_TIME_PARAM_LEN},
+        {OFFLOAD_SEND_REVERB_DECAY_HF_RATIO, PARAM_ID_REVERB_DECAY_HF_RATIO,
+            reverb->decay_hf_ratio, REVERB_DECAY_HF_RATIO_PARAM_LEN},
+        {OFFLOAD_SEND_REVERB_REFLECTIONS_LEVEL, PARAM_ID_REVERB_REFLECTIONS_LEVEL,
+            reverb->reflections_level, REVERB_REFLECTIONS_LEVEL_PARAM_LEN},
+        {OFFLOAD_SEND_REVERB_REFLECTIONS_DELAY, PARAM_ID_REVERB_REFLECTIONS_DELAY,
+            reverb->reflections_delay, REVERB_REFLECTIONS_DELAY_PARAM_LEN},
+        {OFFLOAD_SEND_REVERB_LEVEL, PARAM_ID_REVERB_LEVEL,
+            reverb->level, REVERB_LEVEL_PARAM_LEN},
+        {OFFLOAD_SEND_REVERB_DELAY, PARAM_ID_REVERB_DELAY,
+            reverb->delay, REVERB_DELAY_PARAM_LEN},
+        {OFFLOAD_SEND_REVERB_DIFFUSION, PARAM_ID_REVERB_DIFFUSION,
+            reverb->diffusion, REVERB_DIFFUSION_PARAM_LEN},
+        {OFFLOAD_SEND_REVERB_DENSITY, PARAM_ID_REVERB_DENSITY,
+            reverb->density, REVERB_DENSITY_PARAM_LEN},
+    };
+    effect_payload_buf_t buf;
+    uint32_t i;
     int ret = 0;
-    pal_effect_custom_payload_t *custom_payload = NULL;
 
     ALOGV("%s: flags 0x%x", __func__, param_send_flags);
 
     if (param_send_flags & OFFLOAD_SEND_REVERB_ENABLE_FLAG) {
-        uint32_t num_kvs = 1;
-        pal_key_vector_t *pal_key_vector = NULL;
-        pal_key_vector = (pal_key_vector_t *) calloc (1, sizeof(pal_key_vector_t) +
-                                         num_kvs * sizeof(pal_key_value_pair_t));
-        if (!pal_key_vector) {
-            ALOGE("%s:%d calloc failed for size %zu", __func__, __LINE__,
-                 sizeof(pal_key_vector_t) + num_kvs * sizeof(pal_key_value_pair_t));
-            ret = -ENOMEM;
-            goto done;
-        }
-        pal_key_vector->num_tkvs = num_kvs;
-        pal_key_vector->kvp[0].key= REVERB_SWITCH;
-        pal_key_vector->kvp[0].value = reverb->enable_flag;
         ret = send_kv_payload(pal_stream_handle, TAG_STREAM_REVERB,
-                              pal_key_vector);
-        free(pal_key_vector);
-        if (ret) {
-            ALOGE("%s: pal_stream_set_param failed. ret = %d", __func__, ret);
+                              REVERB_SWITCH, reverb->enable_flag, &buf);
+        if (ret)
             goto done;
-        }
     }
-    if (param_send_flags & OFFLOAD_SEND_REVERB_MODE) {
-        uint32_t custom_data_sz = REVERB_MODE_PARAM_LEN * sizeof(uint32_t);
-
-        custom_payload = (pal_effect_custom_payload_t *) calloc (1,
-                                           sizeof(pal_effect_custom_payload_t) +
-                                           custom_data_sz);
-        if (!custom_payload) {
-             ALOGE("%s:%d calloc failed for size %d", __func__, __LINE__,
-                    custom_data_sz);
-             ret = -ENOMEM;
-             goto done;
-        }
-        custom_payload->paramId = PARAM_ID_REVERB_MODE;
-        custom_payload->data[0] = reverb->mode;;
-
-        ret = send_custom_payload(pal_stream_handle, TAG_STREAM_REVERB,
-                              custom_payload, custom_data_sz);
-        free(custom_payload);
-        custom_payload = NULL;
-        if (ret) {
-            ALOGE("%s: pal_stream_set_param failed. ret = %d", __func__, ret);
-            goto done;
-        }
-    }
-    if (param_send_flags & OFFLOAD_SEND_REVERB_PRESET) {
-        uint32_t custom_data_sz = REVERB_PRESET_PARAM_LEN * sizeof(uint32_t);
-
-        custom_payload = (pal_effect_custom_payload_t *) calloc (1,
-                                           sizeof(pal_effect_custom_payload_t) +
-                                           custom_data_sz);
-        if (!custom_payload) {
-             ALOGE("%s:%d calloc failed for size %d", __func__, __LINE__,
-                    custom_data_sz);
-             ret = -ENOMEM;
-             goto done;
-        }
-        custom_payload->paramId = PARAM_ID_REVERB_PRESET;
-        custom_payload->data[0] = reverb->preset;
-
-        ret = send_custom_payload(pal_stream_handle, TAG_STREAM_REVERB,
-                              custom_payload, custom_data_sz);
-        free(custom_payload);
-        custom_payload = NULL;
-        if (ret) {
-            ALOGE("%s: pal_stream_set_param failed. ret = %d", __func__, ret);
-            goto done;
-        }
-    }
-    if (param_send_flags & OFFLOAD_SEND_REVERB_WET_MIX) {
-        // param_id + actual payload
-        uint32_t custom_data_sz = REVERB_WET_MIX_PARAM_LEN * sizeof(uint32_t);
-
-        custom_payload = (pal_effect_custom_payload_t *) calloc (1,
-                                            sizeof(pal_effect_custom_payload_t) +
-                                            custom_data_sz);
-        if (!custom_payload) {
-             ALOGE("%s:%d calloc failed for size %d", __func__, __LINE__,
-                    custom_data_sz);
-             ret = -ENOMEM;
-             goto done;
-        }
 
-        custom_payload->paramId = PARAM_ID_REVERB_WET_MIX;
-        custom_payload->data[0] = reverb->wet_mix;
-
-        ret = send_custom_payload(pal_stream_handle, TAG_STREAM_REVERB,
-                              custom_payload, custom_data_sz);
-        free(custom_payload);
-        custom_payload = NULL;
-        if (ret) {
-            ALOGE("%s: pal_stream_set_param failed. ret = %d", __func__, ret);
+    for (i = 0; i < ARRAY_SIZE(reverb_params); i++) {
+        if (!(param_send_flags & reverb_params[i].flag))
+            continue;
+        ret = send_value_payload(pal_stream_handle, TAG_STREAM_REVERB,
+                                 reverb_params[i].param_id, reverb_params[i].value,
+                                 reverb_params[i].len, &buf);
+        if (ret)
             goto done;
-        }
     }
-    if (param_send_flags & OFFLOAD_SEND_REVERB_GAIN_ADJUST) {
-        uint32_t custom_data_sz = REVERB_GAIN_ADJUST_PARAM_LEN * sizeof(uint32_t);
-
-        custom_payload = (pal_effect_custom_payload_t *) calloc (1,
-                                            sizeof(pal_effect_custom_payload_t) +
-                                            custom_data_sz);
-        if (!custom_payload) {
-             ALOGE("%s:%d calloc failed for size %d", __func__, __LINE__,
-                    custom_data_sz);
-             ret = -ENOMEM;
-             goto done;
-        }
 
-        custom_payload->paramId = PARAM_ID_REVERB_GAIN_ADJUST;
-        custom_payload->data[0] = reverb->gain_adjust;
-
-        ret = send_custom_payload(pal_stream_handle, TAG_STREAM_REVERB,
-                              custom_payload, custom_data_sz);
-        free(custom_payload);
-        custom_payload = NULL;
-        if (ret) {
-            ALOGE("%s: pal_stream_set_param failed. ret = %d", __func__, ret);
-            goto done;
-        }
-    }
-    if (param_send_flags & OFFLOAD_SEND_REVERB_ROOM_LEVEL) {
-        uint32_t custom_data_sz = REVERB_ROOM_LEVEL_PARAM_LEN * sizeof(uint32_t);
-        custom_payload = (pal_effect_custom_payload_t *) calloc (1,
-                                            sizeof(pal_effect_custom_payload_t) +
-                                            custom_data_sz);
-        if (!custom_payload) {
-             ALOGE("%s:%d calloc failed for size %d", __func__, __LINE__,
-                    custom_data_sz);
-             ret = -ENOMEM;
-             goto done;
-        }
-        custom_payload->paramId = PARAM_ID_REVERB_ROOM_LEVEL;
-        custom_payload->data[0] = reverb->room_level;
-
-        ret = send_custom_payload(pal_stream_handle, TAG_STREAM_REVERB,
-                              custom_payload, custom_data_sz);
-        free(custom_payload);
-        custom_payload = NULL;
-        if (ret) {
-            ALOGE("%s: pal_stream_set_param failed. ret = %d", __func__, ret);
-            goto done;
-        }
-    }
-    if (param_send_flags & OFFLOAD_SEND_REVERB_ROOM_HF_LEVEL) {
-        uint32_t custom_data_sz = REVERB_ROOM_HF_LEVEL_PARAM_LEN * sizeof(uint32_t);
-        custom_payload = (pal_effect_custom_payload_t *) calloc (1,
-                                            sizeof(pal_effect_custom_payload_t) +
-                                            custom_data_sz);
-        if (!custom_payload) {
-             ALOGE("%s:%d calloc failed for size %d", __func__, __LINE__,
-                    custom_data_sz);
-             ret = -ENOMEM;
-             goto done;
-        }
-        custom_payload->paramId = PARAM_ID_REVERB_ROOM_HF_LEVEL;
-        custom_payload->data[0] = reverb->room_hf_level;
-
-        ret = send_custom_payload(pal_stream_handle, TAG_STREAM_REVERB,
-                              custom_payload, custom_data_sz);
-        free(custom_payload);
-        custom_payload = NULL;
-        if (ret) {
-            ALOGE("%s: pal_stream_set_param failed. ret = %d", __func__, ret);
-            goto done;
-        }
-    }
-    if (param_send_flags & OFFLOAD_SEND_REVERB_DECAY_TIME) {
-        uint32_t custom_data_sz = REVERB_DECAY_TIME_PARAM_LEN * sizeof(uint32_t);
-        custom_payload = (pal_effect_custom_payload_t *) calloc (1,
-                                              sizeof(pal_effect_custom_payload_t) +
-                                              custom_data_sz);
-        if (!custom_payload) {
-             ALOGE("%s:%d calloc failed for size %d", __func__, __LINE__,
-                    custom_data_sz);
-             ret = -ENOMEM;
-             goto done;
-        }
-        custom_payload->paramId = PARAM_ID_REVERB_DECAY_TIME;
-        custom_payload->data[0] = reverb->decay_time;
-
-        ret = send_custom_payload(pal_stream_handle, TAG_STREAM_REVERB,
-                              custom_payload, custom_data_sz);
-        free(custom_payload);
-        custom_payload = NULL;
-        if (ret) {
-            ALOGE("%s: pal_stream_set_param failed. ret = %d", __func__, ret);
-            goto done;
-        }
-    }
-    if (param_send_flags & OFFLOAD_SEND_REVERB_DECAY_HF_RATIO) {
-        uint32_t custom_data_sz = REVERB_DECAY_HF_RATIO_PARAM_LEN * sizeof(uint32_t);
-        custom_payload = (pal_effect_custom_payload_t *) calloc (1,
-                                              sizeof(pal_effect_custom_payload_t) +
-                                              custom_data_sz);
-        if (!custom_payload) {
-             ALOGE("%s:%d calloc failed for size %d", __func__, __LINE__,
-                    custom_data_sz);
-             ret = -ENOMEM;
-             goto done;
-        }
-        custom_payload->paramId = PARAM_ID_REVERB_DECAY_HF_RATIO;
-        custom_payload->data[0] = reverb->decay_hf_ratio;
-
-        ret = send_custom_payload(pal_stream_handle, TAG_STREAM_REVERB,
-                              custom_payload, custom_data_sz);
-        free(custom_payload);
-        custom_payload = NULL;
-        if (ret) {
-            ALOGE("%s: pal_stream_set_param failed. ret = %d", __func__, ret);
-            goto done;
-        }
-    }
-    if (param_send_flags & OFFLOAD_SEND_REVERB_REFLECTIONS_LEVEL) {
-        uint32_t custom_data_sz = REVERB_REFLECTIONS_LEVEL_PARAM_LEN * sizeof(uint32_t);
-        custom_payload = (pal_effect_custom_payload_t *) calloc (1,
-                                            sizeof(pal_effect_custom_payload_t) +
-                                            custom_data_sz);
-        if (!custom_payload) {
-             ALOGE("%s:%d calloc failed for size %d", __func__, __LINE__,
-                    custom_data_sz);
-             ret = -ENOMEM;
-             goto done;
-        }
-
-        custom_payload->paramId = PARAM_ID_REVERB_REFLECTIONS_LEVEL;
-        custom_payload->data[0] = reverb->reflections_level;
-        ret = send_custom_payload(pal_stream_handle, TAG_STREAM_REVERB,
-                              custom_payload, custom_data_sz);
-        free(custom_payload);
-        custom_payload = NULL;
-        if (ret) {
-            ALOGE("%s: pal_stream_set_param failed. ret = %d", __func__, ret);
-            goto done;
-        }
-    }
-    if (param_send_flags & OFFLOAD_SEND_REVERB_REFLECTIONS_DELAY) {
-        uint32_t custom_data_sz = REVERB_REFLECTIONS_DELAY_PARAM_LEN * sizeof(uint32_t);
-        custom_payload = (pal_effect_custom_payload_t *) calloc (1,
-                                             sizeof(pal_effect_custom_payload_t) +
-                                             custom_data_sz);
-        if (!custom_payload) {
-             ALOGE("%s:%d calloc failed for size %d", __func__, __LINE__,
-                    custom_data_sz);
-             ret = -ENOMEM;
-             goto done;
-        }
-
-        custom_payload->paramId = PARAM_ID_REVERB_REFLECTIONS_DELAY;
-        custom_payload->data[0] = reverb->reflections_delay;
-
-        ret = send_custom_payload(pal_stream_handle, TAG_STREAM_REVERB,
-                              custom_payload, custom_data_sz);
-        free(custom_payload);
-        custom_payload = NULL;
-        if (ret) {
-            ALOGE("%s: pal_stream_set_param failed. ret = %d", __func__, ret);
-            goto done;
-        }
-    }
-    if (param_send_flags & OFFLOAD_SEND_REVERB_LEVEL) {
-        uint32_t custom_data_sz = REVERB_LEVEL_PARAM_LEN * sizeof(uint32_t);
-        custom_payload = (pal_effect_custom_payload_t *) calloc (1,
-                                              sizeof(pal_effect_custom_payload_t) +
-                                              custom_data_sz);
-        if (!custom_payload) {
-             ALOGE("%s:%d calloc failed for size %d", __func__, __LINE__,
-                    custom_data_sz);
-             ret = -ENOMEM;
-             goto done;
-        }
-        custom_payload->paramId = PARAM_ID_REVERB_LEVEL;
-        custom_payload->data[0] = reverb->level;
-        ret = send_custom_payload(pal_stream_handle, TAG_STREAM_REVERB,
-                              custom_payload, custom_data_sz);
-        free(custom_payload);
-        custom_payload = NULL;
-        if (ret) {
-            ALOGE("%s: pal_stream_set_param failed. ret = %d", __func__, ret);
-            goto done;
-        }
-
-    }
-    if (param_send_flags & OFFLOAD_SEND_REVERB_DELAY) {
-        uint32_t custom_data_sz = REVERB_DELAY_PARAM_LEN * sizeof(uint32_t);
-        custom_payload = (pal_effect_custom_payload_t *) calloc (1,
-                                             sizeof(pal_effect_custom_payload_t) +
-                                             custom_data_sz);
-        if (!custom_payload) {
-             ALOGE("%s:%d calloc failed for size %d", __func__, __LINE__,
-                    custom_data_sz);
-             ret = -ENOMEM;
-             goto done;
-        }
-        custom_payload->paramId = PARAM_ID_REVERB_DELAY;
-        custom_payload->data[0] = reverb->delay;
-        ret = send_custom_payload(pal_stream_handle, TAG_STREAM_REVERB,
-                              custom_payload, custom_data_sz);
-        free(custom_payload);
-        custom_payload = NULL;
-        if (ret) {
-            ALOGE("%s: pal_stream_set_param failed. ret = %d", __func__, ret);
-            goto done;
-        }
-    }
-    if (param_send_flags & OFFLOAD_SEND_REVERB_DIFFUSION) {
-        uint32_t custom_data_sz = REVERB_DIFFUSION_PARAM_LEN * sizeof(uint32_t);
-        custom_payload = (pal_effect_custom_payload_t *) calloc (1,
-                                           sizeof(pal_effect_custom_payload_t) +
-                                           custom_data_sz);
-        if (!custom_payload) {
-             ALOGE("%s:%d calloc failed for size %d", __func__, __LINE__,
-                    custom_data_sz);
-             ret = -ENOMEM;
-             goto done;
-        }
-        custom_payload->paramId = PARAM_ID_REVERB_DIFFUSION;
-        custom_payload->data[0] = reverb->diffusion;
-
-        ret = send_custom_payload(pal_stream_handle, TAG_STREAM_REVERB,
-                              custom_payload, custom_data_sz);
-        free(custom_payload);
-        custom_payload = NULL;
-        if (ret) {
-            ALOGE("%s: pal_stream_set_param failed. ret = %d", __func__, ret);
-            goto done;
-        }
-    }
-    if (param_send_flags & OFFLOAD_SEND_REVERB_DENSITY) {
-        uint32_t custom_data_sz = REVERB_DENSITY_PARAM_LEN * sizeof(uint32_t);
-        custom_payload = (pal_effect_custom_payload_t *) calloc (1,
-                                           sizeof(pal_effect_custom_payload_t) +
-                                           custom_data_sz);
-        if (!custom_payload) {
-             ALOGE("%s:%d calloc failed for size %d", __func__, __LINE__,
-                    custom_data_sz);
-             ret = -ENOMEM;
-             goto done;
-        }
-        custom_payload->paramId = PARAM_ID_REVERB_DENSITY;
-        custom_payload->data[0] = reverb->density;
-        ret = send_custom_payload(pal_stream_handle, TAG_STREAM_REVERB,
-                              custom_payload, custom_data_sz);
-        free(custom_payload);
-        custom_payload = NULL;
-        if (ret) {
-            ALOGE("%s: pal_stream_set_param failed. ret = %d", __func__, ret);
-            return ret;
-        }
-    }
 done:
     return ret;
 }
@@ -19,6 +19,7 @@
 /*#define LOG_NDEBUG 0*/
 #include <assert.h>
 #include <math.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -28,10 +29,12 @@
 #include <unistd.h>
 
 #include <cutils/list.h>
+#include <cutils/properties.h>
 #include <log/log.h>
 #include <system/thread_defs.h>
 #include <audio_effects/effect_visualizer.h>
 #include "PalApi.h"
+#include "visualizer_kernel.h"
 
 #ifdef AUDIO_FEATURE_ENABLED_GCOV
 extern void  __gcov_flush();
@@ -88,12 +91,19 @@ struct effect_context_s {
     bool offload_enabled;  /* when offload is enabled we process VISUALIZER_CMD_CAPTURE command.
                               Otherwise non offloaded visualizer has already processed the command
                               and we must not overwrite the reply. */
+    pthread_mutex_t lock;  /* protects the effect state below and everything process() and
+                              command() touch. Locking order: lock -> context lock */
+    uint64_t capture_seq;  /* next capture ring period to be consumed by this effect */
+    uint32_t capture_profile;  /* cheapest capture_profile that serves this effect */
+    struct timespec capture_time;  /* capture time of the period being processed */
+    int16_t *capture_scratch;  /* copy of the ring slot handed to process() */
     effect_ops_t ops;
 };
 
 typedef struct output_context_s {
     struct listnode outputs_list_node;  /* node in active_outputs_list */
     audio_io_handle_t handle; /* io handle */
+    bool paused; /* effects of a paused output do not need capture */
     struct listnode effects_list; /* list of effects attached to this output */
 } output_context_t;
 
@@ -106,13 +116,20 @@ typedef struct output_context_s {
 
 #define DISCARD_MEASUREMENTS_TIME_MS 2000 /* discard measurements older than this number of ms */
 
-/* maximum number of buffers for which we keep track of the measurements */
-#define MEASUREMENT_WINDOW_MAX_SIZE_IN_BUFFERS 25 /* note: buffer index is stored in uint8_t */
+/* default duration covered by the peak and RMS measurements, the EBU R 128 momentary
+ * window. vendor.audio.visualizer.meas_window_ms selects another one, up to the 3s
+ * short-term window */
+#define MEASUREMENT_WINDOW_MS 400
+#define MEASUREMENT_WINDOW_MAX_MS 3000
+
+/* maximum number of buffers for which we keep track of the measurements, i.e. the
+ * longest measurement window at the shortest capture period */
+#define MEASUREMENT_WINDOW_MAX_SIZE_IN_BUFFERS 600 /* 3s of 5ms periods */
 
 typedef struct buffer_stats_s {
     bool is_valid;
     uint16_t peak_u16; /* the positive peak of the absolute value of the samples in a buffer */
-    float rms_squared; /* the average square of the samples in a buffer */
+    uint32_t rms_squared; /* the average square of the samples in a buffer */
 } buffer_stats_t;
 
 typedef struct visualizer_context_s {
@@ -123,13 +140,14 @@ typedef struct visualizer_context_s {
     uint32_t scaling_mode;
     uint32_t last_capture_idx;
     uint32_t latency;
+    bool capture_polled; /* VISUALIZER_CMD_CAPTURE received since the effect was enabled */
     struct timespec buffer_update_time;
     uint8_t capture_buf[CAPTURE_BUF_SIZE];
     /* for measurements */
     uint8_t channel_count; /* to avoid recomputing it every time a buffer is processed */
     uint32_t meas_mode;
-    uint8_t meas_wndw_size_in_buffers;
-    uint8_t meas_buffer_idx;
+    uint16_t meas_wndw_size_in_buffers;
+    uint16_t meas_buffer_idx;
     buffer_stats_t past_meas[MEASUREMENT_WINDOW_MAX_SIZE_IN_BUFFERS];
 } visualizer_context_t;
 
@@ -179,6 +197,10 @@ pthread_cond_t cond;
 bool exit_thread;
 /* 0 if the capture thread was created successfully */
 int thread_status;
+/* use short capture periods for waveform capture, for devices that need tight visual sync */
+bool capture_low_latency;
+/* duration covered by the peak and RMS measurements */
+uint32_t meas_window_ms;
 
 
 #define DSP_OUTPUT_LATENCY_MS 0 /* Fudge factor for latency after capture point in audio DSP */
@@ -202,6 +224,45 @@ int thread_status;
 
 #define AUDIO_CAPTURE_BIT_WIDTH (16)
 
+#define AUDIO_CAPTURE_MAX_PERIOD_SIZE (1536)
+#define AUDIO_CAPTURE_LOW_LATENCY_PERIOD_SIZE (240)
+
+/* Capture needed by an effect, in increasing order of cost. The proxy port rate is fixed
+ * so a cheaper capture means a longer period, i.e. fewer wakeups of the capture thread. */
+enum capture_profile {
+    CAPTURE_PROFILE_MEASURE,      /* peak and RMS measurement only */
+    CAPTURE_PROFILE_DEFAULT,      /* waveform capture */
+    CAPTURE_PROFILE_LOW_LATENCY,  /* waveform capture with tight visual sync */
+    CAPTURE_PROFILE_COUNT,
+};
+
+static const uint32_t capture_period_size[CAPTURE_PROFILE_COUNT] = {
+    [CAPTURE_PROFILE_MEASURE] = AUDIO_CAPTURE_MAX_PERIOD_SIZE,             /* 32ms */
+    [CAPTURE_PROFILE_DEFAULT] = AUDIO_CAPTURE_PERIOD_SIZE,                 /* 16ms */
+    [CAPTURE_PROFILE_LOW_LATENCY] = AUDIO_CAPTURE_LOW_LATENCY_PERIOD_SIZE, /* 5ms */
+};
+
+/* number of proxy periods kept in the capture ring */
+#define CAPTURE_RING_SLOTS 32
+
+/* One proxy period. seq is 2 * period + 1 while the capture thread writes the slot
+ * and 2 * period + 2 once it is published, so that readers can detect overwrites. */
+typedef struct capture_slot_s {
+    atomic_uint_fast64_t seq;
+    uint32_t frame_count;
+    struct timespec time;
+    int16_t data[AUDIO_CAPTURE_MAX_PERIOD_SIZE * AUDIO_CAPTURE_CHANNEL_COUNT];
+} capture_slot_t;
+
+/* Written only by the capture thread. Each effect consumes it at its own pace from
+ * effect_consume_capture(), so the capture thread never runs effect code. */
+static capture_slot_t capture_ring[CAPTURE_RING_SLOTS];
+/* number of periods published to capture_ring */
+static atomic_uint_fast64_t capture_ring_head;
+/* largest period a ring slot can hold, in frames */
+#define CAPTURE_MAX_FRAMES (sizeof(capture_ring[0].data) / \
+                            (AUDIO_CAPTURE_CHANNEL_COUNT * sizeof(int16_t)))
+
 /*
  *  Local functions
  */
@@ -215,6 +276,15 @@ static void init_once() {
     pthread_cond_init(&cond, NULL);
     exit_thread = false;
     thread_status = -1;
+    capture_low_latency = property_get_bool("vendor.audio.visualizer.low_latency", false);
+    int32_t window_ms = property_get_int32("vendor.audio.visualizer.meas_window_ms",
+                                           MEASUREMENT_WINDOW_MS);
+    if (window_ms <= 0 || window_ms > MEASUREMENT_WINDOW_MAX_MS) {
+        ALOGW("%s ignoring measurement window of %d ms, max is %d ms", __func__,
+              window_ms, MEASUREMENT_WINDOW_MAX_MS);
+        window_ms = MEASUREMENT_WINDOW_MS;
+    }
+    meas_window_ms = window_ms;
 
     init_status = 0;
 }
@@ -253,6 +323,52 @@ output_context_t *get_output(audio_io_handle_t output) {
     return NULL;
 }
 
+/* skip the capture periods published before this point. Called with context lock held */
+void effect_sync_capture(effect_context_t *context) {
+    context->capture_seq = atomic_load_explicit(&capture_ring_head, memory_order_acquire);
+}
+
+/* Run the process function of the effect on every capture period published since the
+ * last call. Called with the context lock held and lock released, so that a slow
+ * process() only delays this effect. Periods overwritten by the capture thread before
+ * they could be copied are dropped. */
+void effect_consume_capture(effect_context_t *context) {
+    uint64_t head = atomic_load_explicit(&capture_ring_head, memory_order_acquire);
+    uint64_t seq = context->capture_seq;
+    uint64_t slot_seq;
+    uint32_t frame_count;
+    capture_slot_t *slot;
+    audio_buffer_t buf;
+
+    context->capture_seq = head;
+    if (context->ops.process == NULL)
+        return;
+
+    /* the slot after the last published one may already be under write */
+    if (head - seq > CAPTURE_RING_SLOTS - 1)
+        seq = head - (CAPTURE_RING_SLOTS - 1);
+
+    for (; seq < head; seq++) {
+        slot = &capture_ring[seq % CAPTURE_RING_SLOTS];
+        slot_seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (slot_seq != 2 * seq + 2)
+            continue;
+
+        frame_count = slot->frame_count;
+        context->capture_time = slot->time;
+        memcpy(context->capture_scratch, slot->data,
+               frame_count * AUDIO_CAPTURE_CHANNEL_COUNT * sizeof(int16_t));
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->seq, memory_order_relaxed) != slot_seq)
+            continue;
+
+        buf.frameCount = frame_count;
+        buf.s16 = context->capture_scratch;
+        context->ops.process(context, &buf, &buf);
+    }
+}
+
+/* Called with lock and context lock held */
 void add_effect_to_output(output_context_t * output, effect_context_t *context) {
     struct listnode *fx_node;
 
@@ -264,6 +380,7 @@ void add_effect_to_output(output_context_t * output, effect_context_t *context)
             return;
     }
     list_add_tail(&output->effects_list, &context->output_node);
+    effect_sync_capture(context);
     if (context->ops.start)
         context->ops.start(context, output);
 }
@@ -292,6 +409,8 @@ bool effects_enabled() {
         output_context_t *out_ctxt = node_to_item(out_node,
                                                   output_context_t,
                                                   outputs_list_node);
+        if (out_ctxt->paused)
+            continue;
 
         list_for_each(fx_node, &out_ctxt->effects_list) {
             effect_context_t *fx_ctxt = node_to_item(fx_node,
@@ -304,20 +423,58 @@ bool effects_enabled() {
     return false;
 }
 
+/* most demanding capture profile among the enabled effects of running outputs */
+uint32_t get_capture_profile() {
+    struct listnode *out_node;
+    uint32_t profile = CAPTURE_PROFILE_MEASURE;
+
+    list_for_each(out_node, &active_outputs_list) {
+        struct listnode *fx_node;
+        output_context_t *out_ctxt = node_to_item(out_node,
+                                                  output_context_t,
+                                                  outputs_list_node);
+        if (out_ctxt->paused)
+            continue;
+
+        list_for_each(fx_node, &out_ctxt->effects_list) {
+            effect_context_t *fx_ctxt = node_to_item(fx_node,
+                                                         effect_context_t,
+                                                         output_node);
+            if (fx_ctxt->state == EFFECT_STATE_ACTIVE && fx_ctxt->ops.process != NULL &&
+                    fx_ctxt->capture_profile > profile)
+                profile = fx_ctxt->capture_profile;
+        }
+    }
+    return profile;
+}
+
+void capture_stream_close(pal_stream_handle_t *in_stream_handle) {
+    int ret;
+
+    ret = pal_stream_stop(in_stream_handle);
+    if(ret != 0) {
+        ALOGW("%s: pal_stream_stop failed with err=%d", __func__, ret);
+    }
+    ret = pal_stream_close(in_stream_handle);
+    if(ret != 0) {
+        ALOGW("%s: pal_stream_close failed with err=%d", __func__, ret);
+    }
+}
+
 void *capture_thread_loop(void *arg)
 {
-    int16_t data[AUDIO_CAPTURE_PERIOD_SIZE * AUDIO_CAPTURE_CHANNEL_COUNT * sizeof(int16_t)];
-    audio_buffer_t buf;
-    buf.frameCount = AUDIO_CAPTURE_PERIOD_SIZE;
-    buf.s16 = data;
+    capture_slot_t *slot;
+    uint64_t write_seq;
     bool capture_enabled = false;
+    uint32_t profile;
+    uint32_t capture_profile = CAPTURE_PROFILE_DEFAULT;
     int ret;
     pal_stream_handle_t *in_stream_handle = NULL;
     uint32_t no_of_devices = 1;
     struct pal_stream_attributes stream_attr;
     struct pal_device devices;
     struct pal_channel_info ch_info;
-    uint32_t in_buff_size = AUDIO_CAPTURE_PERIOD_SIZE * AUDIO_CAPTURE_CHANNEL_COUNT * sizeof(int16_t);
+    uint32_t in_buff_size = 0;
     struct pal_buffer_config in_buffer_cfg = {0, 0, 0};
     uint32_t in_buff_count = 1;
     struct pal_buffer in_buffer;
@@ -348,6 +505,8 @@ void *capture_thread_loop(void *arg)
 
     prctl(PR_SET_NAME, (unsigned long)"visualizer capture", 0, 0, 0);
 
+    write_seq = atomic_load_explicit(&capture_ring_head, memory_order_relaxed);
+
     pthread_mutex_lock(&lock);
 
     for (;;) {
@@ -355,8 +514,19 @@ void *capture_thread_loop(void *arg)
             break;
         }
         if (effects_enabled()) {
+            profile = get_capture_profile();
+            if (capture_enabled && profile != capture_profile) {
+                ALOGD("%s: capture period %u -> %u frames", __func__,
+                      capture_period_size[capture_profile], capture_period_size[profile]);
+                if (in_stream_handle != NULL) {
+                    capture_stream_close(in_stream_handle);
+                    in_stream_handle = NULL;
+                }
+                capture_enabled = false;
+            }
             if (!capture_enabled) {
-
+                in_buff_size = capture_period_size[profile] * AUDIO_CAPTURE_CHANNEL_COUNT *
+                               sizeof(int16_t);
                 ret = pal_stream_open(&stream_attr,
                     no_of_devices, &devices,
                     0,
@@ -371,6 +541,8 @@ void *capture_thread_loop(void *arg)
                         &in_buffer_cfg,
                         NULL);
                     in_buff_size = in_buffer_cfg.buf_size;
+                    if (in_buff_size > sizeof(capture_ring[0].data))
+                        in_buff_size = sizeof(capture_ring[0].data);
                     if(ret != 0)
                     {
                         ALOGW("%s: pal_stream_set_buffer_size failed with err=%d", __func__, ret);
@@ -385,7 +557,9 @@ void *capture_thread_loop(void *arg)
                             pthread_cond_wait(&cond, &lock);
                         }  else {
                             capture_enabled = true;
-                            ALOGD("%s: capture ENABLED", __func__);
+                            capture_profile = profile;
+                            ALOGD("%s: capture ENABLED, period %u bytes", __func__,
+                                  in_buff_size);
                         }
                     }
                 } else {
@@ -396,14 +570,7 @@ void *capture_thread_loop(void *arg)
         } else {
             if (capture_enabled) {
                 if (in_stream_handle != NULL) {
-                    ret = pal_stream_stop(in_stream_handle);
-                    if(ret != 0) {
-                        ALOGW("%s: pal_stream_stop failed with err=%d", __func__, ret);
-                    }
-                    ret = pal_stream_close(in_stream_handle);
-                    if(ret != 0) {
-                        ALOGW("%s: pal_stream_close failed with err=%d", __func__, ret);
-                    }
+                    capture_stream_close(in_stream_handle);
                     in_stream_handle = NULL;
                 }
                 ALOGD("%s: capture DISABLED", __func__);
@@ -415,51 +582,41 @@ void *capture_thread_loop(void *arg)
             continue;
 
         pthread_mutex_unlock(&lock);
+
+        /* read straight into the next ring slot, readers skip it until it is published */
+        slot = &capture_ring[write_seq % CAPTURE_RING_SLOTS];
+        atomic_store_explicit(&slot->seq, 2 * write_seq + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        read_status = 0;
         if(in_stream_handle)
         {
             memset(&in_buffer, 0, sizeof(struct pal_buffer));
-            in_buffer.buffer = (void*)&data[0];
+            in_buffer.buffer = (void*)&slot->data[0];
             in_buffer.size = in_buff_size;
             read_status = pal_stream_read(in_stream_handle, &in_buffer);
         }
-        pthread_mutex_lock(&lock);
 
         if (read_status > 0) {
             ALOGD("%s: pal_stream_read success no_of_bytes_read = %zd",
                     __func__, read_status );
 
-            struct listnode *out_node;
-
-            list_for_each(out_node, &active_outputs_list) {
-                output_context_t *out_ctxt = node_to_item(out_node,
-                                                          output_context_t,
-                                                          outputs_list_node);
-                struct listnode *fx_node;
-
-                list_for_each(fx_node, &out_ctxt->effects_list) {
-                    effect_context_t *fx_ctxt = node_to_item(fx_node,
-                                                                effect_context_t,
-                                                                output_node);
-                    if (fx_ctxt->ops.process != NULL)
-                        fx_ctxt->ops.process(fx_ctxt, &buf, &buf);
-                }
-            }
+            slot->frame_count = read_status / (AUDIO_CAPTURE_CHANNEL_COUNT * sizeof(int16_t));
+            if (clock_gettime(CLOCK_MONOTONIC, &slot->time) < 0)
+                slot->time.tv_sec = 0;
+            atomic_store_explicit(&slot->seq, 2 * write_seq + 2, memory_order_release);
+            write_seq++;
+            atomic_store_explicit(&capture_ring_head, write_seq, memory_order_release);
         } else {
             ALOGW("%s: pal_stream_read failed with read status %zd",
                 __func__, read_status);
         }
+
+        pthread_mutex_lock(&lock);
     }
 
     if (capture_enabled) {
         if (in_stream_handle != NULL) {
-            ret = pal_stream_stop(in_stream_handle);
-            if(ret != 0) {
-                ALOGW("%s: pal_stream_stop failed with err=%d", __func__, ret);
-            }
-            ret = pal_stream_close(in_stream_handle);
-            if(ret != 0) {
-                ALOGW("%s: pal_stream_close failed with err=%d", __func__, ret);
-                }
+            capture_stream_close(in_stream_handle);
             in_stream_handle = NULL;
         }
     }
@@ -500,6 +657,7 @@ int visualizer_hal_start_output(audio_io_handle_t output,
         goto exit;
     }
     out_ctxt->handle = output;
+    out_ctxt->paused = false;
     list_init(&out_ctxt->effects_list);
 
     list_for_each(node, &created_effects_list) {
@@ -507,9 +665,12 @@ int visualizer_hal_start_output(audio_io_handle_t output,
                                                      effect_context_t,
                                                      effects_list_node);
         if (fx_ctxt->out_handle == output) {
+            pthread_mutex_lock(&fx_ctxt->lock);
+            effect_sync_capture(fx_ctxt);
             if (fx_ctxt->ops.start)
                 fx_ctxt->ops.start(fx_ctxt, out_ctxt);
             list_add_tail(&out_ctxt->effects_list, &fx_ctxt->output_node);
+            pthread_mutex_unlock(&fx_ctxt->lock);
         }
     }
     if (list_empty(&active_outputs_list)) {
@@ -552,8 +713,10 @@ int visualizer_hal_stop_output(audio_io_handle_t output,
         effect_context_t *fx_ctxt = node_to_item(fx_node,
                                                  effect_context_t,
                                                  output_node);
+        pthread_mutex_lock(&fx_ctxt->lock);
         if (fx_ctxt->ops.stop)
             fx_ctxt->ops.stop(fx_ctxt, out_ctxt);
+        pthread_mutex_unlock(&fx_ctxt->lock);
     }
     list_remove(&out_ctxt->outputs_list_node);
     pthread_cond_signal(&cond);
@@ -577,6 +740,43 @@ exit:
     return ret;
 }
 
+static int visualizer_hal_set_output_paused(audio_io_handle_t output, bool paused) {
+    int ret = 0;
+    output_context_t *out_ctxt;
+
+    ALOGV("%s output %d paused %d", __func__, output, paused);
+
+    if (lib_init() != 0)
+        return init_status;
+
+    pthread_mutex_lock(&lock);
+    out_ctxt = get_output(output);
+    if (out_ctxt == NULL) {
+        ALOGW("%s output not started", __func__);
+        ret = -ENOSYS;
+        goto exit;
+    }
+    out_ctxt->paused = paused;
+    /* the capture thread closes the proxy stream once every output is paused */
+    pthread_cond_signal(&cond);
+
+exit:
+    pthread_mutex_unlock(&lock);
+    return ret;
+}
+
+__attribute__ ((visibility ("default")))
+int visualizer_hal_pause_output(audio_io_handle_t output,
+                                    pal_stream_handle_t* pal_stream_handle) {
+    return visualizer_hal_set_output_paused(output, true);
+}
+
+__attribute__ ((visibility ("default")))
+int visualizer_hal_resume_output(audio_io_handle_t output,
+                                    pal_stream_handle_t* pal_stream_handle) {
+    return visualizer_hal_set_output_paused(output, false);
+}
+
 
 /*
  * Effect operations
@@ -626,6 +826,46 @@ uint32_t visualizer_get_delta_time_ms_from_updated_time(visualizer_context_t* vi
     return delta_ms;
 }
 
+/* pick the cheapest capture that serves this visualizer. Called with lock held */
+void visualizer_update_capture_profile(visualizer_context_t *visu_ctxt)
+{
+    uint32_t profile = capture_low_latency ? CAPTURE_PROFILE_LOW_LATENCY :
+                                             CAPTURE_PROFILE_DEFAULT;
+
+    if ((visu_ctxt->meas_mode & MEASUREMENT_MODE_PEAK_RMS) && !visu_ctxt->capture_polled)
+        profile = CAPTURE_PROFILE_MEASURE;
+
+    if (visu_ctxt->common.capture_profile != profile) {
+        visu_ctxt->common.capture_profile = profile;
+        pthread_cond_signal(&cond);
+    }
+}
+
+/* Size the measurement window in buffers of frame_count frames, so that it keeps covering
+ * meas_window_ms when the capture period changes. Called with context lock held */
+void visualizer_update_meas_window(visualizer_context_t *visu_ctxt, uint32_t frame_count)
+{
+    uint32_t size;
+    uint32_t i;
+
+    size = visualizer_meas_window_size(meas_window_ms, AUDIO_CAPTURE_SMP_RATE, frame_count,
+                                       MEASUREMENT_WINDOW_MAX_SIZE_IN_BUFFERS);
+    if (size == visu_ctxt->meas_wndw_size_in_buffers)
+        return;
+
+    ALOGV("%s measurement window %u -> %u buffers", __func__,
+          visu_ctxt->meas_wndw_size_in_buffers, size);
+    /* slots beyond the old window may hold measurements from an earlier period */
+    for (i = visu_ctxt->meas_wndw_size_in_buffers; i < size; i++) {
+        visu_ctxt->past_meas[i].is_valid = false;
+        visu_ctxt->past_meas[i].peak_u16 = 0;
+        visu_ctxt->past_meas[i].rms_squared = 0;
+    }
+    visu_ctxt->meas_wndw_size_in_buffers = size;
+    if (visu_ctxt->meas_buffer_idx >= size)
+        visu_ctxt->meas_buffer_idx = 0;
+}
+
 int visualizer_reset(effect_context_t *context)
 {
     visualizer_context_t * visu_ctxt = (visualizer_context_t *)context;
@@ -647,7 +887,7 @@ int visualizer_init(effect_context_t *context)
     context->config.inputCfg.accessMode = EFFECT_BUFFER_ACCESS_READ;
     context->config.inputCfg.channels = AUDIO_CHANNEL_OUT_STEREO;
     context->config.inputCfg.format = AUDIO_FORMAT_PCM_16_BIT;
-    context->config.inputCfg.samplingRate = 44100;
+    context->config.inputCfg.samplingRate = AUDIO_CAPTURE_SMP_RATE;
     context->config.inputCfg.bufferProvider.getBuffer = NULL;
     context->config.inputCfg.bufferProvider.releaseBuffer = NULL;
     context->config.inputCfg.bufferProvider.cookie = NULL;
@@ -655,7 +895,7 @@ int visualizer_init(effect_context_t *context)
     context->config.outputCfg.accessMode = EFFECT_BUFFER_ACCESS_ACCUMULATE;
     context->config.outputCfg.channels = AUDIO_CHANNEL_OUT_STEREO;
     context->config.outputCfg.format = AUDIO_FORMAT_PCM_16_BIT;
-    context->config.outputCfg.samplingRate = 44100;
+    context->config.outputCfg.samplingRate = AUDIO_CAPTURE_SMP_RATE;
     context->config.outputCfg.bufferProvider.getBuffer = NULL;
     context->config.outputCfg.bufferProvider.releaseBuffer = NULL;
     context->config.outputCfg.bufferProvider.cookie = NULL;
@@ -667,13 +907,16 @@ int visualizer_init(effect_context_t *context)
     // measurement initialization
     visu_ctxt->channel_count = popcount(context->config.inputCfg.channels);
     visu_ctxt->meas_mode = MEASUREMENT_MODE_NONE;
-    visu_ctxt->meas_wndw_size_in_buffers = MEASUREMENT_WINDOW_MAX_SIZE_IN_BUFFERS;
+    visu_ctxt->meas_wndw_size_in_buffers = 0;
+    visualizer_update_meas_window(visu_ctxt, AUDIO_CAPTURE_PERIOD_SIZE);
     visu_ctxt->meas_buffer_idx = 0;
-    for (i=0 ; i<visu_ctxt->meas_wndw_size_in_buffers ; i++) {
+    for (i=0 ; i<MEASUREMENT_WINDOW_MAX_SIZE_IN_BUFFERS ; i++) {
         visu_ctxt->past_meas[i].is_valid = false;
         visu_ctxt->past_meas[i].peak_u16 = 0;
         visu_ctxt->past_meas[i].rms_squared = 0;
     }
+    visu_ctxt->capture_polled = false;
+    visualizer_update_capture_profile(visu_ctxt);
 
     set_config(context, &context->config);
 
@@ -739,6 +982,7 @@ int visualizer_set_parameter(effect_context_t *context, effect_param_t *p, uint3
     case VISUALIZER_PARAM_MEASUREMENT_MODE:
         visu_ctxt->meas_mode = *((uint32_t *)p->data + 1);
         ALOGV("%s set meas_mode = %d", __func__, visu_ctxt->meas_mode);
+        visualizer_update_capture_profile(visu_ctxt);
         break;
     default:
         return -EINVAL;
@@ -746,16 +990,14 @@ int visualizer_set_parameter(effect_context_t *context, effect_param_t *p, uint3
     return 0;
 }
 
-/* Real process function called from capture thread. Called with lock held */
+/* Real process function, called on each capture period from effect_consume_capture().
+ * Called with context lock held */
 int visualizer_process(effect_context_t *context,
                        audio_buffer_t *inBuffer,
                        audio_buffer_t *outBuffer)
 {
     visualizer_context_t *visu_ctxt = (visualizer_context_t *)context;
 
-    if (!effect_exists(context))
-        return -EINVAL;
-
     if (inBuffer == NULL || inBuffer->raw == NULL ||
         outBuffer == NULL || outBuffer->raw == NULL ||
         inBuffer->frameCount != outBuffer->frameCount ||
@@ -763,82 +1005,43 @@ int visualizer_process(effect_context_t *context,
         return -EINVAL;
     }
 
+    if (inBuffer->frameCount > CAPTURE_MAX_FRAMES)
+        return -EINVAL;
+
+    /* all code below assumes stereo 16 bit PCM output and input. The input is the
+     * private copy made by effect_consume_capture() so it is downmixed in place. */
+    uint32_t frame_count = inBuffer->frameCount;
+    visualizer_scan_t scan;
+
+    visualizer_scan_period(inBuffer->s16, inBuffer->s16, frame_count, &scan);
+
     // perform measurements if needed
     if (visu_ctxt->meas_mode & MEASUREMENT_MODE_PEAK_RMS) {
-        // find the peak and RMS squared for the new buffer
-        uint32_t inIdx;
-        int16_t max_sample = 0;
-        float rms_squared_acc = 0;
-        for (inIdx = 0 ; inIdx < inBuffer->frameCount * visu_ctxt->channel_count ; inIdx++) {
-            if (inBuffer->s16[inIdx] > max_sample) {
-                max_sample = inBuffer->s16[inIdx];
-            } else if (-inBuffer->s16[inIdx] > max_sample) {
-                max_sample = -inBuffer->s16[inIdx];
-            }
-            rms_squared_acc += (inBuffer->s16[inIdx] * inBuffer->s16[inIdx]);
-        }
-        // store the measurement
-        visu_ctxt->past_meas[visu_ctxt->meas_buffer_idx].peak_u16 = (uint16_t)max_sample;
+        visualizer_update_meas_window(visu_ctxt, frame_count);
+        // store the peak and RMS squared for the new buffer
+        visu_ctxt->past_meas[visu_ctxt->meas_buffer_idx].peak_u16 = (uint16_t)scan.peak;
         visu_ctxt->past_meas[visu_ctxt->meas_buffer_idx].rms_squared =
-                rms_squared_acc / (inBuffer->frameCount * visu_ctxt->channel_count);
+                visualizer_rms_squared(&scan, frame_count);
         visu_ctxt->past_meas[visu_ctxt->meas_buffer_idx].is_valid = true;
         if (++visu_ctxt->meas_buffer_idx >= visu_ctxt->meas_wndw_size_in_buffers) {
             visu_ctxt->meas_buffer_idx = 0;
         }
     }
 
-    /* all code below assumes stereo 16 bit PCM output and input */
-    int32_t shift;
-
-    if (visu_ctxt->scaling_mode == VISUALIZER_SCALING_MODE_NORMALIZED) {
-        /* derive capture scaling factor from peak value in current buffer
-         * this gives more interesting captures for display. */
-        shift = 32;
-        int len = inBuffer->frameCount * 2;
-        int i;
-        for (i = 0; i < len; i++) {
-            int32_t smp = inBuffer->s16[i];
-            if (smp < 0) smp = -smp - 1; /* take care to keep the max negative in range */
-            int32_t clz = __builtin_clz(smp);
-            if (shift > clz) shift = clz;
-        }
-        /* A maximum amplitude signal will have 17 leading zeros, which we want to
-         * translate to a shift of 8 (for converting 16 bit to 8 bit) */
-        shift = 25 - shift;
-        /* Never scale by less than 8 to avoid returning unaltered PCM signal. */
-        if (shift < 3) {
-            shift = 3;
-        }
-        /* add one to combine the division by 2 needed after summing
-         * left and right channels below */
-        shift++;
-    } else {
-        assert(visu_ctxt->scaling_mode == VISUALIZER_SCALING_MODE_AS_PLAYED);
-        shift = 9;
-    }
+    assert(visu_ctxt->scaling_mode == VISUALIZER_SCALING_MODE_NORMALIZED ||
+           visu_ctxt->scaling_mode == VISUALIZER_SCALING_MODE_AS_PLAYED);
+    int32_t shift = visualizer_capture_shift(scan.norm_bits,
+            visu_ctxt->scaling_mode == VISUALIZER_SCALING_MODE_NORMALIZED);
 
-    uint32_t capt_idx;
-    uint32_t in_idx;
-    uint8_t *buf = visu_ctxt->capture_buf;
-    for (in_idx = 0, capt_idx = visu_ctxt->capture_idx;
-         in_idx < inBuffer->frameCount;
-         in_idx++, capt_idx++) {
-        if (capt_idx >= CAPTURE_BUF_SIZE) {
-            /* wrap around */
-            capt_idx = 0;
-        }
-        int32_t smp = inBuffer->s16[2 * in_idx] + inBuffer->s16[2 * in_idx + 1];
-        smp = smp >> shift;
-        buf[capt_idx] = ((uint8_t)smp)^0x80;
-    }
+    uint32_t capt_idx = visualizer_store_capture(visu_ctxt->capture_buf, CAPTURE_BUF_SIZE,
+                                                 visu_ctxt->capture_idx, inBuffer->s16,
+                                                 frame_count, shift);
 
-    /* XXX the following two should really be atomic, though it probably doesn't
-     * matter much for visualization purposes */
+    /* capture_buf, capture_idx and buffer_update_time are only accessed with context lock
+     * held */
     visu_ctxt->capture_idx = capt_idx;
     /* update last buffer update time stamp */
-    if (clock_gettime(CLOCK_MONOTONIC, &visu_ctxt->buffer_update_time) < 0) {
-        visu_ctxt->buffer_update_time.tv_sec = 0;
-    }
+    visu_ctxt->buffer_update_time = context->capture_time;
 
     if (context->state != EFFECT_STATE_ACTIVE) {
         ALOGV("%s DONE inactive", __func__);
@@ -848,6 +1051,29 @@ int visualizer_process(effect_context_t *context,
     return 0;
 }
 
+int visualizer_enable(effect_context_t *context)
+{
+    visualizer_context_t *visu_ctxt = (visualizer_context_t *)context;
+
+    /* wait for the first capture request before paying for waveform capture */
+    visu_ctxt->capture_polled = false;
+    visualizer_update_capture_profile(visu_ctxt);
+    return 0;
+}
+
+/* first VISUALIZER_CMD_CAPTURE since the effect was enabled. Called with lock held */
+void visualizer_set_capture_polled(effect_context_t *context)
+{
+    visualizer_context_t *visu_ctxt = (visualizer_context_t *)context;
+
+    if (!visu_ctxt->capture_polled) {
+        visu_ctxt->capture_polled = true;
+        visualizer_update_capture_profile(visu_ctxt);
+    }
+}
+
+/* Called with context lock held. lock is released for VISUALIZER_CMD_CAPTURE and
+ * VISUALIZER_CMD_MEASURE, see effect_command() */
 int visualizer_command(effect_context_t * context, uint32_t cmdCode, uint32_t cmdSize,
         void *pCmdData, uint32_t *replySize, void *pReplyData)
 {
@@ -871,7 +1097,8 @@ int visualizer_command(effect_context_t * context, uint32_t cmdCode, uint32_t cm
             if (latency_ms < 0) {
                 latency_ms = 0;
             }
-            const uint32_t delta_smp = context->config.inputCfg.samplingRate * latency_ms / 1000;
+            /* capture_buf is filled at the proxy port rate */
+            const uint32_t delta_smp = AUDIO_CAPTURE_SMP_RATE * latency_ms / 1000;
 
             int64_t capture_point = visu_ctxt->capture_idx;
             capture_point -= visu_ctxt->capture_size;
@@ -924,8 +1151,8 @@ int visualizer_command(effect_context_t * context, uint32_t cmdCode, uint32_t cm
             return -EINVAL;
         }
         uint16_t peak_u16 = 0;
-        float sum_rms_squared = 0.0f;
-        uint8_t nb_valid_meas = 0;
+        uint64_t sum_rms_squared = 0;
+        uint32_t nb_valid_meas = 0;
         /* reset measurements if last measurement was too long ago (which implies stored
          * measurements aren't relevant anymore and shouldn't bias the new one) */
         const int32_t delay_ms = visualizer_get_delta_time_ms_from_updated_time(visu_ctxt);
@@ -940,7 +1167,7 @@ int visualizer_command(effect_context_t * context, uint32_t cmdCode, uint32_t cm
             visu_ctxt->meas_buffer_idx = 0;
         } else {
             /* only use actual measurements, otherwise the first RMS measure happening before
-             * MEASUREMENT_WINDOW_MAX_SIZE_IN_BUFFERS have been played will always be artificially
+             * a full measurement window has been played will always be artificially
              * low */
             uint32_t i;
             for (i=0 ; i < visu_ctxt->meas_wndw_size_in_buffers ; i++) {
@@ -953,7 +1180,8 @@ int visualizer_command(effect_context_t * context, uint32_t cmdCode, uint32_t cm
                 }
             }
         }
-        float rms = nb_valid_meas == 0 ? 0.0f : sqrtf(sum_rms_squared / nb_valid_meas);
+        float rms = nb_valid_meas == 0 ? 0.0f :
+                sqrtf((float)(sum_rms_squared / nb_valid_meas));
         int32_t* p_int_reply_data = (int32_t*)pReplyData;
         /* convert from I16 sample values to mB and write results */
         if (rms < 0.000016f) {
@@ -1014,8 +1242,15 @@ int effect_lib_create(const effect_uuid_t *uuid,
             return -ENOMEM;
         }
         context = (effect_context_t *)visu_ctxt;
+        context->capture_scratch = (int16_t *)malloc(sizeof(capture_ring[0].data));
+        if (context->capture_scratch == NULL) {
+            ALOGE("%s fail to allocate memory", __func__);
+            free(context);
+            return -ENOMEM;
+        }
         context->ops.init = visualizer_init;
         context->ops.reset = visualizer_reset;
+        context->ops.enable = visualizer_enable;
         context->ops.process = visualizer_process;
         context->ops.set_parameter = visualizer_set_parameter;
         context->ops.get_parameter = visualizer_get_parameter;
@@ -1028,10 +1263,13 @@ int effect_lib_create(const effect_uuid_t *uuid,
     context->itfe = &effect_interface;
     context->state = EFFECT_STATE_UNINITIALIZED;
     context->out_handle = (audio_io_handle_t)ioId;
+    pthread_mutex_init(&context->lock, NULL);
 
     ret = context->ops.init(context);
     if (ret < 0) {
         ALOGW("%s init failed", __func__);
+        pthread_mutex_destroy(&context->lock);
+        free(context->capture_scratch);
         free(context);
         return ret;
     }
@@ -1039,10 +1277,12 @@ int effect_lib_create(const effect_uuid_t *uuid,
     context->state = EFFECT_STATE_INITIALIZED;
 
     pthread_mutex_lock(&lock);
+    pthread_mutex_lock(&context->lock);
     list_add_tail(&created_effects_list, &context->effects_list_node);
     output_context_t *out_ctxt = get_output(ioId);
     if (out_ctxt != NULL)
         add_effect_to_output(out_ctxt, context);
+    pthread_mutex_unlock(&context->lock);
     pthread_mutex_unlock(&lock);
 
     *pHandle = (effect_handle_t)context;
@@ -1064,12 +1304,17 @@ int effect_lib_release(effect_handle_t handle) {
     pthread_mutex_lock(&lock);
     status = -EINVAL;
     if (effect_exists(context)) {
+        /* waits for a capture or measure command running without lock */
+        pthread_mutex_lock(&context->lock);
         output_context_t *out_ctxt = get_output(context->out_handle);
         if (out_ctxt != NULL)
             remove_effect_from_output(out_ctxt, context);
         list_remove(&context->effects_list_node);
         if (context->ops.release)
             context->ops.release(context);
+        pthread_mutex_unlock(&context->lock);
+        pthread_mutex_destroy(&context->lock);
+        free(context->capture_scratch);
         free(context);
         status = 0;
     }
@@ -1142,12 +1387,34 @@ int effect_command(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize,
 
     if (!effect_exists(context)) {
         status = -EINVAL;
-        goto exit;
+        goto done;
     }
 
     if (context == NULL || context->state == EFFECT_STATE_UNINITIALIZED) {
         status = -EINVAL;
-        goto exit;
+        goto done;
+    }
+
+    pthread_mutex_lock(&context->lock);
+
+    /* Catch up with the capture thread and reply holding only the context lock, so that
+     * process() never holds back the capture thread or the other effects. */
+    if ((cmdCode == VISUALIZER_CMD_CAPTURE || cmdCode == VISUALIZER_CMD_MEASURE) &&
+            context->ops.command) {
+        bool output_active = get_output(context->out_handle) != NULL;
+
+        if (cmdCode == VISUALIZER_CMD_CAPTURE && context->offload_enabled)
+            visualizer_set_capture_polled(context);
+        pthread_mutex_unlock(&lock);
+
+        if (output_active)
+            effect_consume_capture(context);
+        else
+            effect_sync_capture(context);
+        status = context->ops.command(context, cmdCode, cmdSize,
+                                      pCmdData, replySize, pReplyData);
+        pthread_mutex_unlock(&context->lock);
+        return status;
     }
 
 //    ALOGV_IF(cmdCode != VISUALIZER_CMD_CAPTURE,
@@ -1199,6 +1466,7 @@ int effect_command(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize,
             goto exit;
         }
         context->state = EFFECT_STATE_ACTIVE;
+        effect_sync_capture(context);
         if (context->ops.enable)
             context->ops.enable(context);
         pthread_cond_signal(&cond);
@@ -1304,6 +1572,8 @@ int effect_command(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize,
     }
 
 exit:
+    pthread_mutex_unlock(&context->lock);
+done:
     pthread_mutex_unlock(&lock);
 
 //    ALOGV_IF(cmdCode != VISUALIZER_CMD_CAPTURE,"%s DONE", __func__);
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef VISUALIZER_KERNEL_H
+#define VISUALIZER_KERNEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Per period results of visualizer_scan_period() */
+typedef struct visualizer_scan_s {
+    uint32_t peak;      /* largest absolute sample value, 32768 for the max negative */
+    uint64_t energy;    /* sum of the squared samples */
+    uint32_t norm_bits; /* OR of all samples folded to positive, for the capture shift */
+} visualizer_scan_t;
+
+/* Single pass over frame_count stereo 16 bit frames: peak and energy for the
+ * measurements, the bits used by the normalization shift, and the downmix.
+ * The downmix keeps the division by 2 so that it fits in 16 bits. mix may be
+ * the same buffer as in: frame i is written after samples 2 * i and 2 * i + 1
+ * have been read. */
+static inline void visualizer_scan_period(const int16_t *in, int16_t *mix,
+                                          uint32_t frame_count,
+                                          visualizer_scan_t *scan)
+{
+    uint32_t peak = 0;
+    uint32_t norm_bits = 0;
+    uint64_t energy = 0;
+    uint32_t i;
+
+    for (i = 0; i < frame_count; i++) {
+        int32_t l = in[2 * i];
+        int32_t r = in[2 * i + 1];
+        uint32_t abs_l = l < 0 ? -l : l;
+        uint32_t abs_r = r < 0 ? -r : r;
+
+        if (abs_l > peak)
+            peak = abs_l;
+        if (abs_r > peak)
+            peak = abs_r;
+        /* x ^ (x >> 31) is -x - 1 for negative samples, which keeps the max negative
+         * in range. The highest bit set across all samples gives the same leading
+         * zero count as the largest sample. */
+        norm_bits |= (uint32_t)(l ^ (l >> 31)) | (uint32_t)(r ^ (r >> 31));
+        energy += (uint32_t)(l * l) + (uint32_t)(r * r);
+        mix[i] = (int16_t)((l + r) >> 1);
+    }
+    scan->peak = peak;
+    scan->energy = energy;
+    scan->norm_bits = norm_bits;
+}
+
+/* Mean of the squared samples of a stereo period, rounded down */
+static inline uint32_t visualizer_rms_squared(const visualizer_scan_t *scan,
+                                              uint32_t frame_count)
+{
+    return (uint32_t)(scan->energy / ((uint64_t)frame_count * 2));
+}
+
+/* Right shift applied to the halved downmix to get 8 bit capture samples */
+static inline int32_t visualizer_capture_shift(uint32_t norm_bits, bool normalized)
+{
+    int32_t shift;
+
+    if (!normalized)
+        return 8;
+    /* derive capture scaling factor from peak value in current buffer
+     * this gives more interesting captures for display. */
+    shift = norm_bits != 0 ? __builtin_clz(norm_bits) : 32;
+    /* A maximum amplitude signal will have 17 leading zeros, which we want to
+     * translate to a shift of 8 (for converting 16 bit to 8 bit) */
+    shift = 25 - shift;
+    /* Never scale by less than 8 to avoid returning unaltered PCM signal. */
+    if (shift < 3)
+        shift = 3;
+    return shift;
+}
+
+/* Stores frame_count 8 bit capture samples from mix into the circular buffer
+ * buf of buf_size bytes starting at capt_idx, and returns the new write index.
+ * As for the capture index kept by the effect, the returned index may be equal
+ * to buf_size and wraps on the next store. */
+static inline uint32_t visualizer_store_capture(uint8_t *buf, uint32_t buf_size,
+                                                uint32_t capt_idx, const int16_t *mix,
+                                                uint32_t frame_count, int32_t shift)
+{
+    uint32_t done = 0;
+    uint32_t run;
+    uint32_t i;
+
+    /* copy in at most two contiguous runs instead of checking for wrap around on
+     * every sample */
+    while (done < frame_count) {
+        if (capt_idx >= buf_size) {
+            /* wrap around */
+            capt_idx = 0;
+        }
+        run = frame_count - done;
+        if (run > buf_size - capt_idx)
+            run = buf_size - capt_idx;
+        for (i = 0; i < run; i++)
+            buf[capt_idx + i] = ((uint8_t)(mix[done + i] >> shift)) ^ 0x80;
+        done += run;
+        capt_idx += run;
+    }
+    return capt_idx;
+}
+
+/* Number of periods of frame_count frames at rate covering window_ms, rounded up
+ * and clamped to [1, max_size] */
+static inline uint32_t visualizer_meas_window_size(uint32_t window_ms, uint32_t rate,
+                                                   uint32_t frame_count, uint32_t max_size)
+{
+    uint32_t size = ((uint64_t)window_ms * rate / 1000 + frame_count - 1) / frame_count;
+
+    if (size < 1)
+        size = 1;
+    if (size > max_size)
+        size = max_size;
+    return size;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VISUALIZER_KERNEL_H */
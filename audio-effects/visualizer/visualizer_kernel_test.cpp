@@ -0,0 +1,318 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "visualizer_kernel.h"
+
+namespace {
+
+constexpr uint32_t kCaptureBufSize = 65536;
+
+/* Reference: the per period code of visualizer_process() before the measurement,
+ * normalization and downmix loops were fused, kept verbatim except for the context
+ * fields, which are passed in. */
+struct Reference {
+    uint16_t peak_u16;
+    uint32_t rms_squared;
+    uint32_t capture_idx;
+};
+
+/* __builtin_clz(0) is undefined; the old code relied on the ARM CLZ result. */
+int ReferenceClz(int32_t smp) { return smp == 0 ? 32 : __builtin_clz(smp); }
+
+Reference ReferenceProcess(const int16_t *s16, uint32_t frameCount, bool normalized,
+                           uint8_t *buf, uint32_t capture_idx) {
+    const uint32_t channel_count = 2;
+    Reference ref;
+
+    uint32_t inIdx;
+    int16_t max_sample = 0;
+    float rms_squared_acc = 0;
+    for (inIdx = 0 ; inIdx < frameCount * channel_count ; inIdx++) {
+        if (s16[inIdx] > max_sample) {
+            max_sample = s16[inIdx];
+        } else if (-s16[inIdx] > max_sample) {
+            max_sample = -s16[inIdx];
+        }
+        rms_squared_acc += (s16[inIdx] * s16[inIdx]);
+    }
+    ref.peak_u16 = (uint16_t)max_sample;
+    ref.rms_squared = rms_squared_acc / (frameCount * channel_count);
+
+    int32_t shift;
+    if (normalized) {
+        shift = 32;
+        int len = frameCount * 2;
+        int i;
+        for (i = 0; i < len; i++) {
+            int32_t smp = s16[i];
+            if (smp < 0) smp = -smp - 1; /* take care to keep the max negative in range */
+            int32_t clz = ReferenceClz(smp);
+            if (shift > clz) shift = clz;
+        }
+        shift = 25 - shift;
+        if (shift < 3) {
+            shift = 3;
+        }
+        shift++;
+    } else {
+        shift = 9;
+    }
+
+    uint32_t capt_idx;
+    uint32_t in_idx;
+    for (in_idx = 0, capt_idx = capture_idx;
+         in_idx < frameCount;
+         in_idx++, capt_idx++) {
+        if (capt_idx >= kCaptureBufSize) {
+            capt_idx = 0;
+        }
+        int32_t smp = s16[2 * in_idx] + s16[2 * in_idx + 1];
+        smp = smp >> shift;
+        buf[capt_idx] = ((uint8_t)smp)^0x80;
+    }
+    ref.capture_idx = capt_idx;
+    return ref;
+}
+
+/* What visualizer_process() now does with a period, on a private copy as
+ * effect_consume_capture() provides. */
+struct Fused {
+    visualizer_scan_t scan;
+    uint32_t rms_squared;
+    uint32_t capture_idx;
+};
+
+Fused FusedProcess(const int16_t *s16, uint32_t frameCount, bool normalized,
+                   uint8_t *buf, uint32_t capture_idx) {
+    std::vector<int16_t> copy(s16, s16 + frameCount * 2);
+    Fused fused;
+
+    visualizer_scan_period(copy.data(), copy.data(), frameCount, &fused.scan);
+    fused.rms_squared = visualizer_rms_squared(&fused.scan, frameCount);
+    int32_t shift = visualizer_capture_shift(fused.scan.norm_bits, normalized);
+    fused.capture_idx = visualizer_store_capture(buf, kCaptureBufSize, capture_idx,
+                                                 copy.data(), frameCount, shift);
+    return fused;
+}
+
+uint32_t ExactPeak(const std::vector<int16_t> &s16) {
+    uint32_t peak = 0;
+    for (int16_t s : s16) {
+        uint32_t a = s < 0 ? -(int32_t)s : s;
+        if (a > peak)
+            peak = a;
+    }
+    return peak;
+}
+
+uint64_t ExactEnergy(const std::vector<int16_t> &s16) {
+    uint64_t energy = 0;
+    for (int16_t s : s16)
+        energy += (uint64_t)((int32_t)s * s);
+    return energy;
+}
+
+/* Runs both versions on the same period and capture position, for both scaling
+ * modes, and checks the capture bytes and index are identical and the
+ * measurements exact. */
+void ExpectGolden(const std::vector<int16_t> &s16, uint32_t capture_idx) {
+    const uint32_t frameCount = s16.size() / 2;
+    const uint64_t energy = ExactEnergy(s16);
+
+    for (bool normalized : {true, false}) {
+        SCOPED_TRACE(normalized ? "normalized" : "as played");
+        std::vector<uint8_t> ref_buf(kCaptureBufSize, 0x5a);
+        std::vector<uint8_t> new_buf(kCaptureBufSize, 0x5a);
+
+        Reference ref = ReferenceProcess(s16.data(), frameCount, normalized,
+                                         ref_buf.data(), capture_idx);
+        Fused fused = FusedProcess(s16.data(), frameCount, normalized,
+                                   new_buf.data(), capture_idx);
+
+        EXPECT_EQ(ref.capture_idx, fused.capture_idx);
+        EXPECT_EQ(0, memcmp(ref_buf.data(), new_buf.data(), kCaptureBufSize));
+
+        EXPECT_EQ(ExactPeak(s16), fused.scan.peak);
+        /* the old peak only went wrong on the max negative, see below */
+        if (std::find(s16.begin(), s16.end(), INT16_MIN) == s16.end()) {
+            EXPECT_EQ(ref.peak_u16, fused.scan.peak);
+        }
+        EXPECT_EQ(energy, fused.scan.energy);
+        EXPECT_EQ(energy / s16.size(), fused.rms_squared);
+        /* the float accumulation of the old code drifts on long loud periods, but
+         * stays within its 24 bit mantissa of the exact mean */
+        EXPECT_NEAR((double)ref.rms_squared, (double)fused.rms_squared,
+                    (double)fused.rms_squared * 1e-4 + 1);
+    }
+}
+
+/* deterministic full range noise */
+std::vector<int16_t> Noise(uint32_t frames, uint32_t seed) {
+    std::vector<int16_t> s16(frames * 2);
+    for (int16_t &s : s16) {
+        seed = seed * 1664525u + 1013904223u;
+        s = (int16_t)(seed >> 16);
+    }
+    return s16;
+}
+
+std::vector<int16_t> Sine(uint32_t frames, double amplitude, double freq_hz) {
+    std::vector<int16_t> s16(frames * 2);
+    for (uint32_t i = 0; i < frames; i++) {
+        double v = amplitude * sin(2 * M_PI * freq_hz * i / 48000.0);
+        s16[2 * i] = (int16_t)lrint(v);
+        s16[2 * i + 1] = (int16_t)lrint(-v / 2);
+    }
+    return s16;
+}
+
+TEST(VisualizerKernelTest, Silence) {
+    std::vector<int16_t> s16(768 * 2, 0);
+    ExpectGolden(s16, 0);
+
+    visualizer_scan_t scan;
+    visualizer_scan_period(s16.data(), s16.data(), 768, &scan);
+    EXPECT_EQ(0u, scan.peak);
+    EXPECT_EQ(0u, scan.norm_bits);
+    /* no samples set: the smallest shift, as the old code got from CLZ of 0 */
+    EXPECT_EQ(3, visualizer_capture_shift(scan.norm_bits, true));
+}
+
+TEST(VisualizerKernelTest, FullScale) {
+    std::vector<int16_t> s16(768 * 2);
+    for (size_t i = 0; i < s16.size(); i++)
+        s16[i] = (i / 2) % 2 ? 32767 : -32767;
+    ExpectGolden(s16, 100);
+}
+
+TEST(VisualizerKernelTest, MaxNegativeLast) {
+    std::vector<int16_t> s16 = Sine(480, 20000, 1000);
+    s16.back() = -32768;
+    ExpectGolden(s16, 0);
+}
+
+TEST(VisualizerKernelTest, MaxNegativeFirstIsNotLostToLaterSamples) {
+    /* The old code kept the peak in an int16_t: -(-32768) stored back as -32768,
+     * so every later sample replaced it and it reported 5 here. */
+    std::vector<int16_t> s16 = {-32768, 0, 5, -3};
+    Reference ref;
+    uint8_t buf[kCaptureBufSize];
+    ref = ReferenceProcess(s16.data(), 2, true, buf, 0);
+    EXPECT_EQ(5u, ref.peak_u16);
+
+    visualizer_scan_t scan;
+    visualizer_scan_period(s16.data(), s16.data(), 2, &scan);
+    EXPECT_EQ(32768u, scan.peak);
+    EXPECT_EQ(32768u, (uint16_t)scan.peak);
+}
+
+TEST(VisualizerKernelTest, MaxNegativeEverywhere) {
+    std::vector<int16_t> s16(256 * 2, -32768);
+    std::vector<uint8_t> ref_buf(kCaptureBufSize), new_buf(kCaptureBufSize);
+    for (bool normalized : {true, false}) {
+        ReferenceProcess(s16.data(), 256, normalized, ref_buf.data(), 0);
+        Fused fused = FusedProcess(s16.data(), 256, normalized, new_buf.data(), 0);
+        EXPECT_EQ(0, memcmp(ref_buf.data(), new_buf.data(), 256));
+        EXPECT_EQ(32768u, fused.scan.peak);
+        EXPECT_EQ(32768ull * 32768 * 512, fused.scan.energy);
+        EXPECT_EQ(32768u * 32768, fused.rms_squared);
+    }
+}
+
+TEST(VisualizerKernelTest, LowLevel) {
+    for (int16_t amplitude : {1, 2, 3, 15, 16, 255, 256, 4095}) {
+        SCOPED_TRACE(amplitude);
+        ExpectGolden(Sine(960, amplitude, 440), 0);
+    }
+    std::vector<int16_t> s16 = {-1, -1, 0, 1, -1, 0, 1, 1};
+    ExpectGolden(s16, 0);
+}
+
+TEST(VisualizerKernelTest, Noise) {
+    for (uint32_t seed : {1u, 7u, 12345u}) {
+        SCOPED_TRACE(seed);
+        ExpectGolden(Noise(1024, seed), 0);
+    }
+}
+
+TEST(VisualizerKernelTest, OddFrameCounts) {
+    for (uint32_t frames : {1u, 3u, 7u, 191u, 767u, 769u, 4096u}) {
+        SCOPED_TRACE(frames);
+        ExpectGolden(Noise(frames, frames), 0);
+    }
+}
+
+TEST(VisualizerKernelTest, WrapAround) {
+    std::vector<int16_t> s16 = Noise(768, 42);
+    /* the write straddles the end of the buffer, starts exactly at its end, and
+     * ends exactly at it */
+    for (uint32_t idx : {kCaptureBufSize - 100, kCaptureBufSize, kCaptureBufSize - 768,
+                         kCaptureBufSize - 1}) {
+        SCOPED_TRACE(idx);
+        ExpectGolden(s16, idx);
+    }
+}
+
+TEST(VisualizerKernelTest, InPlaceMatchesSeparateMix) {
+    std::vector<int16_t> s16 = Noise(768, 3);
+    std::vector<int16_t> mix(768);
+    std::vector<int16_t> copy = s16;
+    visualizer_scan_t scan, scan_in_place;
+
+    visualizer_scan_period(s16.data(), mix.data(), 768, &scan);
+    visualizer_scan_period(copy.data(), copy.data(), 768, &scan_in_place);
+    EXPECT_EQ(scan.peak, scan_in_place.peak);
+    EXPECT_EQ(scan.energy, scan_in_place.energy);
+    EXPECT_EQ(scan.norm_bits, scan_in_place.norm_bits);
+    EXPECT_EQ(0, memcmp(mix.data(), copy.data(), 768 * sizeof(int16_t)));
+}
+
+TEST(VisualizerKernelTest, MeasurementWindowSize) {
+    /* momentary window over the default, measure only and low latency periods */
+    EXPECT_EQ(25u, visualizer_meas_window_size(400, 48000, 768, 600));
+    EXPECT_EQ(13u, visualizer_meas_window_size(400, 48000, 1536, 600));
+    EXPECT_EQ(80u, visualizer_meas_window_size(400, 48000, 240, 600));
+    /* short-term window: the longest window at the shortest period fills the history */
+    EXPECT_EQ(94u, visualizer_meas_window_size(3000, 48000, 1536, 600));
+    EXPECT_EQ(600u, visualizer_meas_window_size(3000, 48000, 240, 600));
+    /* never empty, never more than the history */
+    EXPECT_EQ(1u, visualizer_meas_window_size(1, 48000, 1536, 600));
+    EXPECT_EQ(600u, visualizer_meas_window_size(10000, 48000, 240, 600));
+}
+
+}  // namespace
@@ -66,9 +66,18 @@ LOCAL_SRC_FILES := \
     AudioStream.cpp \
     AudioDevice.cpp \
     AudioVoice.cpp \
+    FormatConverter.cpp \
+    AudioHalConfig.cpp \
+    StreamStats.cpp \
+    PositionTracker.cpp \
+    PerfLockManager.cpp \
+    StandbyPolicy.cpp \
+    ControlWorker.cpp \
+    CapturePosition.cpp \
     audio_extn/soundtrigger.cpp \
     audio_extn/Gain.cpp \
-    audio_extn/AudioExtn.cpp
+    audio_extn/AudioExtn.cpp \
+    audio_extn/AdtsScan.cpp
 
 LOCAL_HEADER_LIBRARIES := libhardware_headers qti_audio_kernel_uapi libagm_headers
 
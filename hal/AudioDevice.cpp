@@ -74,6 +74,9 @@ card_status_t AudioDevice::sndCardState = CARD_STATUS_ONLINE;
 
 btsco_lc3_cfg_t AudioDevice::btsco_lc3_cfg = {};
 
+/* boost options used around stream open/start */
+static const int perf_lock_opts[] = {0x40400000, 0x1, 0x40C00000, 0x1};
+
 struct audio_string_to_enum {
     const char* name;
     unsigned int value;
@@ -376,6 +379,20 @@ std::shared_ptr<AudioDevice> AudioDevice::GetInstance(audio_hw_device_t* device)
         return NULL;
 }
 
+AutoPerfLock::AutoPerfLock() : manager_(nullptr) {
+    std::shared_ptr<AudioDevice> adevice = AudioDevice::GetInstance();
+
+    if (adevice) {
+        manager_ = &adevice->perfLockManager;
+        manager_->Acquire();
+    }
+}
+
+AutoPerfLock::~AutoPerfLock() {
+    if (manager_)
+        manager_->Release();
+}
+
 std::shared_ptr<StreamOutPrimary> AudioDevice::CreateStreamOut(
                         audio_io_handle_t handle,
                         const std::set<audio_devices_t>& devices,
@@ -391,13 +408,16 @@ std::shared_ptr<StreamOutPrimary> AudioDevice::CreateStreamOut(
                                        fnp_offload_effect_start_output_,
                                        fnp_offload_effect_stop_output_,
                                        fnp_visualizer_start_output_,
-                                       fnp_visualizer_stop_output_));
+                                       fnp_visualizer_stop_output_,
+                                       fnp_visualizer_pause_output_,
+                                       fnp_visualizer_resume_output_));
     } catch (const std::exception& e) {
         AHAL_ERR("Failed to create StreamOutPrimary");
         return nullptr;
     }
     astream->GetStreamHandle(stream_out);
     out_list_mutex.lock();
+    reinterpret_cast<hal_stream_out *>(astream->stream_.get())->ref = astream;
     stream_out_list_.push_back(astream);
     AHAL_DBG("output stream %d %p",(int)stream_out_list_.size(), stream_out);
     if (flags & AUDIO_OUTPUT_FLAG_PRIMARY) {
@@ -424,6 +444,7 @@ int AudioDevice::CreateAudioPatch(audio_patch_handle_t *handle,
                                   const std::vector<struct audio_port_config>& sources,
                                   const std::vector<struct audio_port_config>& sinks) {
     int ret = 0;
+    int route_ret = 0;
     bool new_patch = false;
     AudioPatch *patch = NULL;
     std::shared_ptr<StreamPrimary> stream = nullptr;
@@ -516,7 +537,16 @@ int AudioDevice::CreateAudioPatch(audio_patch_handle_t *handle,
 
     if (voice_ && patch_type == AudioPatch::PATCH_PLAYBACK)
         ret = voice_->RouteStream(device_types);
-    ret |= stream->RouteStream(device_types);
+    route_ret = stream->RouteStreamAsync(device_types);
+    /*
+     * -EINPROGRESS: the patch is kept, the device switch completes in the
+     * background and a late failure is only logged by the stream
+     */
+    if (route_ret == -EINPROGRESS) {
+        AHAL_INFO("Stream routing still running for io_handle %d", io_handle);
+        route_ret = 0;
+    }
+    ret |= route_ret;
 
     if (ret) {
         if (new_patch)
@@ -583,19 +613,31 @@ int AudioDevice::ReleaseAudioPatch(audio_patch_handle_t handle) {
         return -EINVAL;
     }
 
-    ret = stream->RouteStream({AUDIO_DEVICE_NONE});
+    ret = stream->RouteStreamAsync({AUDIO_DEVICE_NONE});
 
-    if (ret)
+    /* -EINPROGRESS: the patch is released but the device switch has not finished */
+    if (ret == -EINPROGRESS)
+        AHAL_INFO("Stream routing still running for io_handle %d", io_handle);
+    else if (ret)
         AHAL_ERR("Stream routing failed for io_handle %d", io_handle);
 
-    std::lock_guard lock(patch_map_mutex);
-    patch_map_.erase(handle);
-    delete patch;
+    RemoveAudioPatch(handle);
 
-    AHAL_DBG("Successfully released patch %d", handle);
+    AHAL_DBG("Released patch %d, ret %d", handle, ret);
     return ret;
 }
 
+bool AudioDevice::RemoveAudioPatch(audio_patch_handle_t handle) {
+    std::lock_guard<std::mutex> lock(patch_map_mutex);
+    auto it = patch_map_.find(handle);
+
+    if (it == patch_map_.end())
+        return false;
+    delete it->second;
+    patch_map_.erase(it);
+    return true;
+}
+
 std::shared_ptr<StreamInPrimary> AudioDevice::CreateStreamIn(
                                         audio_io_handle_t handle,
                                         const std::set<audio_devices_t>& devices,
@@ -609,6 +651,7 @@ std::shared_ptr<StreamInPrimary> AudioDevice::CreateStreamIn(
                                               address, source));
     astream->GetStreamHandle(stream_in);
     in_list_mutex.lock();
+    reinterpret_cast<hal_stream_in *>(astream->stream_.get())->ref = astream;
     stream_in_list_.push_back(astream);
     in_list_mutex.unlock();
     AHAL_DBG("input stream %d %p",(int)stream_in_list_.size(), stream_in);
@@ -726,6 +769,7 @@ static int adev_open_output_stream(struct audio_hw_device *dev,
             ret = -ENOMEM;
             goto exit;
         }
+        astream->PreOpenAsync();
     }
 exit:
     AHAL_DBG("Exit ret: %d", ret);
@@ -1080,10 +1124,17 @@ static int adev_dump(const audio_hw_device_t *device, int fd)
     dprintf(fd, "Device API Version: %d.%d \n", major, minor);
 
 #ifdef PAL_HIDL_ENABLED
-    dprintf(fd, "PAL HIDL enabled");
+    dprintf(fd, "PAL HIDL enabled\n");
 #else
-    dprintf(fd, "PAL HIDL disabled");
+    dprintf(fd, "PAL HIDL disabled\n");
 #endif
+    dprintf(fd, "BT encoder latency queries served from cache: %" PRIu64 "\n",
+            StreamOutPrimary::btLatencyQueriesSaved.load());
+    AudioHalConfig::Dump(fd);
+
+    std::shared_ptr<AudioDevice> adevice = AudioDevice::GetInstance();
+    if (adevice)
+        adevice->Dump(fd);
 
     return 0;
 }
@@ -1115,6 +1166,8 @@ int AudioDevice::Init(hw_device_t **device, const hw_module_t *module) {
         return -EINVAL;
     }
 
+    AudioHalConfig::Load();
+
     ret = pal_register_global_callback(&adev_pal_global_callback, (uint64_t)this);
     if (ret) {
         AHAL_ERR("pal register callback failed ret=(%d)", ret);
@@ -1164,6 +1217,12 @@ int AudioDevice::Init(hw_device_t **device, const hw_module_t *module) {
             fnp_visualizer_stop_output_ =
                         (int (*)(audio_io_handle_t, pal_stream_handle_t*))dlsym(visualizer_lib_,
                                                         "visualizer_hal_stop_output");
+            fnp_visualizer_pause_output_ =
+                        (int (*)(audio_io_handle_t, pal_stream_handle_t*))dlsym(visualizer_lib_,
+                                                        "visualizer_hal_pause_output");
+            fnp_visualizer_resume_output_ =
+                        (int (*)(audio_io_handle_t, pal_stream_handle_t*))dlsym(visualizer_lib_,
+                                                        "visualizer_hal_resume_output");
         }
     }
 
@@ -1200,11 +1259,9 @@ int AudioDevice::Init(hw_device_t **device, const hw_module_t *module) {
     is_charging = AudioExtn::battery_properties_is_charging();
     SetChargingMode(is_charging);
     AudioExtn::audio_extn_perf_lock_init();
-    adev_->perf_lock_opts[0] = 0x40400000;
-    adev_->perf_lock_opts[1] = 0x1;
-    adev_->perf_lock_opts[2] = 0x40C00000;
-    adev_->perf_lock_opts[3] = 0x1;
-    adev_->perf_lock_opts_size = 4;
+    adev_->perfLockManager.Init(perf_lock_opts, sizeof(perf_lock_opts) / sizeof(perf_lock_opts[0]),
+                                AudioExtn::audio_extn_perf_lock_acquire,
+                                AudioExtn::audio_extn_perf_lock_release);
 
     voice_ = VoiceInit();
     mute_ = false;
@@ -1238,6 +1295,86 @@ int AudioDevice::GetGEFParam(void *data, int *length) {
     return pal_get_param(PAL_PARAM_ID_UIEFFECT, nullptr, (size_t *)length, data);
 }
 
+/*
+ * Serves the capability query from the cache, the PAL query is made
+ * outside of the lock and only cached if no connection event raced it.
+ */
+int AudioDevice::GetDeviceCapability(pal_device_id_t id, int card, int device,
+                                     bool isPlayback, dynamic_media_config_t *config) {
+    pal_param_device_capability_t device_cap_query;
+    pal_param_device_capability_t *device_cap_query_ptr = &device_cap_query;
+    struct device_capability_entry entry;
+    size_t payload_size = 0;
+    uint32_t gen = 0;
+    int ret = 0;
+
+    device_cap_mutex_.lock();
+    for (auto &cached : device_cap_cache_) {
+        if (cached.id == id && cached.card == card && cached.device == device &&
+            cached.is_playback == isPlayback) {
+            memcpy(config, &cached.config, sizeof(dynamic_media_config_t));
+            device_cap_mutex_.unlock();
+            return 0;
+        }
+    }
+    gen = device_cap_gen_;
+    device_cap_mutex_.unlock();
+
+    memset(config, 0, sizeof(dynamic_media_config_t));
+    device_cap_query.id = id;
+    device_cap_query.addr.card_id = card;
+    device_cap_query.addr.device_num = device;
+    device_cap_query.config = config;
+    device_cap_query.is_playback = isPlayback;
+    ret = pal_get_param(PAL_PARAM_ID_DEVICE_CAPABILITY, (void **)&device_cap_query_ptr,
+                        &payload_size, nullptr);
+    if (ret < 0) {
+        AHAL_DBG("capability query failed for device %d, ret %d", id, ret);
+        return ret;
+    }
+
+    entry.id = id;
+    entry.card = card;
+    entry.device = device;
+    entry.is_playback = isPlayback;
+    memcpy(&entry.config, config, sizeof(dynamic_media_config_t));
+
+    device_cap_mutex_.lock();
+    if (gen == device_cap_gen_)
+        device_cap_cache_.push_back(entry);
+    device_cap_mutex_.unlock();
+    return ret;
+}
+
+void AudioDevice::InvalidateDeviceCapabilities() {
+    device_cap_mutex_.lock();
+    device_cap_cache_.clear();
+    device_cap_gen_++;
+    device_cap_mutex_.unlock();
+}
+
+/* per stream timing is reported by the stream dump, list open streams here */
+void AudioDevice::Dump(int fd) {
+    out_list_mutex.lock();
+    dprintf(fd, "Open output streams: %zu\n", stream_out_list_.size());
+    for (int i = 0; i < stream_out_list_.size(); i++)
+        dprintf(fd, "  handle %d usecase %s\n", stream_out_list_[i]->GetHandle(),
+                use_case_table[stream_out_list_[i]->GetUseCase()]);
+    out_list_mutex.unlock();
+
+    in_list_mutex.lock();
+    dprintf(fd, "Open input streams: %zu\n", stream_in_list_.size());
+    for (int i = 0; i < stream_in_list_.size(); i++)
+        dprintf(fd, "  handle %d usecase %s\n", stream_in_list_[i]->GetHandle(),
+                use_case_table[stream_in_list_[i]->GetUseCase()]);
+    in_list_mutex.unlock();
+
+    perfLockManager.Dump(fd);
+    standbyPolicy.Dump(fd);
+    controlWorker.Dump(fd);
+    StreamOutPrimary::DumpFirstWriteStats(fd);
+}
+
 std::shared_ptr<StreamOutPrimary> AudioDevice::OutGetStream(audio_io_handle_t handle) {
     std::shared_ptr<StreamOutPrimary> astream_out = NULL;
     out_list_mutex.lock();
@@ -1279,17 +1416,12 @@ std::shared_ptr<StreamOutPrimary> AudioDevice::OutGetStream(audio_stream_t* stre
 
     std::shared_ptr<StreamOutPrimary> astream_out = NULL;
     AHAL_VERBOSE("stream_out(%p)", stream_out);
-    out_list_mutex.lock();
-    for (int i = 0; i < stream_out_list_.size(); i++) {
-        if (stream_out_list_[i]->stream_.get() ==
-                                        (audio_stream_out*) stream_out) {
-            AHAL_VERBOSE("Found stream associated with stream_out");
-            astream_out = stream_out_list_[i];
-            AHAL_VERBOSE("astream_out(%p)", astream_out->stream_.get());
-            break;
-        }
-    }
-    out_list_mutex.unlock();
+    if (!stream_out)
+        return astream_out;
+
+    /* resolved through the back-reference set in CreateStreamOut, no list walk */
+    astream_out = reinterpret_cast<hal_stream_out *>(stream_out)->ref.lock();
+    AHAL_VERBOSE("astream_out(%p)", astream_out ? astream_out->stream_.get() : NULL);
     return astream_out;
 }
 
@@ -1312,16 +1444,12 @@ std::shared_ptr<StreamInPrimary> AudioDevice::InGetStream (audio_stream_t* strea
     std::shared_ptr<StreamInPrimary> astream_in = NULL;
 
     AHAL_VERBOSE("stream_in(%p)", stream_in);
-    in_list_mutex.lock();
-    for (int i = 0; i < stream_in_list_.size(); i++) {
-        if (stream_in_list_[i]->stream_.get() == (audio_stream_in*) stream_in) {
-            AHAL_VERBOSE("Found existing stream associated with astream_in");
-            astream_in = stream_in_list_[i];
-            AHAL_VERBOSE("astream_in(%p)", astream_in->stream_.get());
-            break;
-        }
-    }
-    in_list_mutex.unlock();
+    if (!stream_in)
+        return astream_in;
+
+    /* resolved through the back-reference set in CreateStreamIn, no list walk */
+    astream_in = reinterpret_cast<hal_stream_in *>(stream_in)->ref.lock();
+    AHAL_VERBOSE("astream_in(%p)", astream_in ? astream_in->stream_.get() : NULL);
     return astream_in;
 }
 
@@ -1433,20 +1561,28 @@ int AudioDevice::SetParameters(const char *kvpairs) {
     std::set<audio_devices_t> new_devices;
 
     AHAL_DBG("enter: %s", kvpairs);
-    ret = voice_->VoiceSetParameters(kvpairs);
-    if (ret)
-        AHAL_ERR("Error in VoiceSetParameters %d", ret);
-
+    /* parsed once here, voice and the extensions probe the same parms */
     parms = str_parms_create_str(kvpairs);
     if (!parms) {
         AHAL_ERR("Error in str_parms_create_str");
         ret = 0;
         return ret;
     }
+
+    ret = voice_->VoiceSetParameters(parms);
+    if (ret)
+        AHAL_ERR("Error in VoiceSetParameters %d", ret);
+
     AudioExtn::audio_extn_set_parameters(adev_, parms);
 
-    if ( (property_get_bool("vendor.audio.hdr.record.enable", false)) ||
-         (property_get_bool("vendor.audio.hdr.spf.record.enable", false))) {
+    ret = str_parms_get_str(parms, AUDIO_PARAMETER_KEY_RELOAD_HAL_CONFIG, value, sizeof(value));
+    if (ret >= 0) {
+        AHAL_INFO("reloading HAL config");
+        AudioHalConfig::Load();
+    }
+
+    if (AudioHalConfig::GetBool(HAL_CONFIG_HDR_RECORD_ENABLE) ||
+        AudioHalConfig::GetBool(HAL_CONFIG_HDR_SPF_RECORD_ENABLE)) {
         changes_done = hdr_set_parameters(adev_, parms);
         if (changes_done) {
             for (int i = 0; i < stream_in_list_.size(); i++) {
@@ -1464,7 +1600,7 @@ int AudioDevice::SetParameters(const char *kvpairs) {
                         }
                     }
                     break;
-                } else if (property_get_bool("vendor.audio.hdr.spf.record.enable", false)) {
+                } else if (AudioHalConfig::GetBool(HAL_CONFIG_HDR_SPF_RECORD_ENABLE)) {
                     new_devices = astream_in->mAndroidInDevices;
                     astream_in->RouteStream(new_devices, true);
                 }
@@ -1525,6 +1661,8 @@ int AudioDevice::SetParameters(const char *kvpairs) {
         pal_param_device_connection_t param_device_connection;
         val = atoi(value);
         audio_devices_t device = (audio_devices_t)val;
+        if (audio_is_a2dp_out_device(device) || audio_is_ble_out_device(device))
+            bt_encoder_latency_gen_++;
 
         if (audio_is_usb_out_device(device) || audio_is_usb_in_device(device)) {
             ret = str_parms_get_str(parms, "card", value, sizeof(value));
@@ -1581,30 +1719,18 @@ int AudioDevice::SetParameters(const char *kvpairs) {
                 }
             }
             AHAL_INFO("pal set param success  for device connection");
+            InvalidateDeviceCapabilities();
             /* check if capture profile is supported or not */
            if (audio_is_usb_out_device(device) || audio_is_usb_in_device(device)) {
-                pal_param_device_capability_t *device_cap_query = (pal_param_device_capability_t *)
-                                                          malloc(sizeof(pal_param_device_capability_t));
-                if (device_cap_query) {
-                    dynamic_media_config_t dynamic_media_config;
-                    size_t payload_size = 0;
-                    device_cap_query->id = PAL_DEVICE_IN_USB_HEADSET;
-                    device_cap_query->addr.card_id = usb_card_id_;
-                    device_cap_query->addr.device_num = usb_dev_num_;
-                    device_cap_query->config = &dynamic_media_config;
-                    device_cap_query->is_playback = false;
-                    ret = pal_get_param(PAL_PARAM_ID_DEVICE_CAPABILITY,
-                            (void **)&device_cap_query,
-                            &payload_size, nullptr);
-                    if ((dynamic_media_config.sample_rate[0] == 0 && dynamic_media_config.format[0] == 0 &&
-                            dynamic_media_config.mask[0] == 0) || (dynamic_media_config.jack_status == false))
-                        usb_input_dev_enabled = false;
-                    else
-                        usb_input_dev_enabled = true;
-                    free(device_cap_query);
-                } else {
-                    AHAL_ERR("Failed to allocate mem for device_cap_query");
-                }
+                dynamic_media_config_t dynamic_media_config;
+
+                ret = GetDeviceCapability(PAL_DEVICE_IN_USB_HEADSET, usb_card_id_, usb_dev_num_,
+                                          false, &dynamic_media_config);
+                if ((dynamic_media_config.sample_rate[0] == 0 && dynamic_media_config.format[0] == 0 &&
+                        dynamic_media_config.mask[0] == 0) || (dynamic_media_config.jack_status == false))
+                    usb_input_dev_enabled = false;
+                else
+                    usb_input_dev_enabled = true;
             }
 
             if (pal_device_ids) {
@@ -1734,6 +1860,8 @@ int AudioDevice::SetParameters(const char *kvpairs) {
         pal_param_device_connection_t param_device_connection;
         val = atoi(value);
         audio_devices_t device = (audio_devices_t)val;
+        if (audio_is_a2dp_out_device(device) || audio_is_ble_out_device(device))
+            bt_encoder_latency_gen_++;
         if (audio_is_usb_out_device(device) || audio_is_usb_in_device(device)) {
             ret = str_parms_get_str(parms, "card", value, sizeof(value));
             if (ret >= 0)
@@ -1777,6 +1905,7 @@ int AudioDevice::SetParameters(const char *kvpairs) {
                 }
                 AHAL_INFO("pal set param sucess for device disconnect");
             }
+            InvalidateDeviceCapabilities();
         }
     }
 
@@ -1794,6 +1923,7 @@ int AudioDevice::SetParameters(const char *kvpairs) {
         AHAL_INFO("BT A2DP Reconfig command received");
         ret = pal_set_param(PAL_PARAM_ID_BT_A2DP_RECONFIG, (void *)&param_bt_a2dp,
                             sizeof(pal_param_bta2dp_t));
+        bt_encoder_latency_gen_++;
     }
 
     ret = str_parms_get_str(parms, "A2dpSuspended" , value, sizeof(value));
@@ -1815,6 +1945,7 @@ int AudioDevice::SetParameters(const char *kvpairs) {
         AHAL_INFO("BT A2DP Suspended = %s, command received", value);
         ret = pal_set_param(PAL_PARAM_ID_BT_A2DP_SUSPENDED, (void *)&param_bt_a2dp,
                             sizeof(pal_param_bta2dp_t));
+        bt_encoder_latency_gen_++;
     }
 
     ret = str_parms_get_str(parms, "TwsChannelConfig", value, sizeof(value));
@@ -2138,7 +2269,7 @@ char* AudioDevice::GetParameters(const char *keys) {
     if (voice_)
         voice_->VoiceGetParameters(query, reply);
 
-    if (property_get_bool("vendor.audio.hdr.record.enable", false))
+    if (AudioHalConfig::GetBool(HAL_CONFIG_HDR_RECORD_ENABLE))
         hdr_get_parameters(adev_, query, reply);
 
 exit:
@@ -2156,74 +2287,88 @@ void AudioDevice::FillAndroidDeviceMap() {
     android_device_map_.clear();
     /* go through all devices and pushback */
 
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_NONE, PAL_DEVICE_NONE));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_EARPIECE, PAL_DEVICE_OUT_HANDSET));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_SPEAKER, PAL_DEVICE_OUT_SPEAKER));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_WIRED_HEADSET, PAL_DEVICE_OUT_WIRED_HEADSET));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_WIRED_HEADPHONE, PAL_DEVICE_OUT_WIRED_HEADPHONE));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_BLUETOOTH_SCO, PAL_DEVICE_OUT_BLUETOOTH_SCO));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_BLUETOOTH_SCO_HEADSET, PAL_DEVICE_OUT_BLUETOOTH_SCO));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_BLUETOOTH_SCO_CARKIT, PAL_DEVICE_OUT_BLUETOOTH_SCO));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_BLUETOOTH_A2DP, PAL_DEVICE_OUT_BLUETOOTH_A2DP));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_BLE_HEADSET, PAL_DEVICE_OUT_BLUETOOTH_BLE));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_BLE_SPEAKER, PAL_DEVICE_OUT_BLUETOOTH_BLE));
-    //android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_BLUETOOTH_A2DP_HEADPHONES, PAL_DEVICE_OUT_BLUETOOTH_A2DP_HEADPHONES));
-    //android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_BLUETOOTH_A2DP_SPEAKER, PAL_DEVICE_OUT_BLUETOOTH_A2DP_SPEAKER));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_AUX_DIGITAL, PAL_DEVICE_OUT_AUX_DIGITAL));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_HDMI, PAL_DEVICE_OUT_HDMI));
-    //android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_ANLG_DOCK_HEADSET, PAL_DEVICE_OUT_ANLG_DOCK_HEADSET));
-    //android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_DGTL_DOCK_HEADSET, PAL_DEVICE_OUT_DGTL_DOCK_HEADSET));
-    //android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_USB_ACCESSORY, PAL_DEVICE_OUT_USB_ACCESSORY));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_USB_DEVICE, PAL_DEVICE_OUT_USB_DEVICE));
-    //android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_REMOTE_SUBMIX, PAL_DEVICE_OUT_REMOTE_SUBMIX));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_TELEPHONY_TX, PAL_DEVICE_NONE));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_LINE, PAL_DEVICE_OUT_WIRED_HEADPHONE));
-    //android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_HDMI_ARC, PAL_DEVICE_OUT_HDMI_ARC));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_SPDIF, PAL_DEVICE_OUT_SPDIF));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_FM, PAL_DEVICE_OUT_FM));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_AUX_LINE, PAL_DEVICE_OUT_AUX_LINE));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_SPEAKER_SAFE, PAL_DEVICE_OUT_SPEAKER));
-    //android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_IP, PAL_DEVICE_OUT_IP));
-    //android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_BUS, PAL_DEVICE_OUT_BUS));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_PROXY, PAL_DEVICE_OUT_PROXY));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_USB_HEADSET, PAL_DEVICE_OUT_USB_HEADSET));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_DEFAULT, PAL_DEVICE_OUT_SPEAKER));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_HEARING_AID, PAL_DEVICE_OUT_HEARING_AID));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_NONE, PAL_DEVICE_NONE));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_EARPIECE, PAL_DEVICE_OUT_HANDSET));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_SPEAKER, PAL_DEVICE_OUT_SPEAKER));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_WIRED_HEADSET, PAL_DEVICE_OUT_WIRED_HEADSET));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_WIRED_HEADPHONE, PAL_DEVICE_OUT_WIRED_HEADPHONE));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_BLUETOOTH_SCO, PAL_DEVICE_OUT_BLUETOOTH_SCO));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_BLUETOOTH_SCO_HEADSET, PAL_DEVICE_OUT_BLUETOOTH_SCO));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_BLUETOOTH_SCO_CARKIT, PAL_DEVICE_OUT_BLUETOOTH_SCO));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_BLUETOOTH_A2DP, PAL_DEVICE_OUT_BLUETOOTH_A2DP));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_BLE_HEADSET, PAL_DEVICE_OUT_BLUETOOTH_BLE));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_BLE_SPEAKER, PAL_DEVICE_OUT_BLUETOOTH_BLE));
+    //android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_BLUETOOTH_A2DP_HEADPHONES, PAL_DEVICE_OUT_BLUETOOTH_A2DP_HEADPHONES));
+    //android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_BLUETOOTH_A2DP_SPEAKER, PAL_DEVICE_OUT_BLUETOOTH_A2DP_SPEAKER));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_AUX_DIGITAL, PAL_DEVICE_OUT_AUX_DIGITAL));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_HDMI, PAL_DEVICE_OUT_HDMI));
+    //android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_ANLG_DOCK_HEADSET, PAL_DEVICE_OUT_ANLG_DOCK_HEADSET));
+    //android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_DGTL_DOCK_HEADSET, PAL_DEVICE_OUT_DGTL_DOCK_HEADSET));
+    //android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_USB_ACCESSORY, PAL_DEVICE_OUT_USB_ACCESSORY));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_USB_DEVICE, PAL_DEVICE_OUT_USB_DEVICE));
+    //android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_REMOTE_SUBMIX, PAL_DEVICE_OUT_REMOTE_SUBMIX));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_TELEPHONY_TX, PAL_DEVICE_NONE));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_LINE, PAL_DEVICE_OUT_WIRED_HEADPHONE));
+    //android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_HDMI_ARC, PAL_DEVICE_OUT_HDMI_ARC));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_SPDIF, PAL_DEVICE_OUT_SPDIF));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_FM, PAL_DEVICE_OUT_FM));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_AUX_LINE, PAL_DEVICE_OUT_AUX_LINE));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_SPEAKER_SAFE, PAL_DEVICE_OUT_SPEAKER));
+    //android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_IP, PAL_DEVICE_OUT_IP));
+    //android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_BUS, PAL_DEVICE_OUT_BUS));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_PROXY, PAL_DEVICE_OUT_PROXY));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_USB_HEADSET, PAL_DEVICE_OUT_USB_HEADSET));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_DEFAULT, PAL_DEVICE_OUT_SPEAKER));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_HEARING_AID, PAL_DEVICE_OUT_HEARING_AID));
 #ifdef USEHIDL7_1
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_OUT_BLE_BROADCAST, PAL_DEVICE_OUT_BLUETOOTH_BLE_BROADCAST));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_OUT_BLE_BROADCAST, PAL_DEVICE_OUT_BLUETOOTH_BLE_BROADCAST));
 #endif
     /* go through all in devices and pushback */
 
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_IN_BUILTIN_MIC, PAL_DEVICE_IN_HANDSET_MIC));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_IN_BACK_MIC, PAL_DEVICE_IN_SPEAKER_MIC));
-    //android_device_map_.insert(std::make_pair(AUDIO_DEVICE_IN_COMMUNICATION, PAL_DEVICE_IN_COMMUNICATION));
-    //android_device_map_.insert(std::make_pair(AUDIO_DEVICE_IN_AMBIENT, PAL_DEVICE_IN_AMBIENT);
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_IN_BLUETOOTH_SCO_HEADSET, PAL_DEVICE_IN_BLUETOOTH_SCO_HEADSET));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_IN_WIRED_HEADSET, PAL_DEVICE_IN_WIRED_HEADSET));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_IN_AUX_DIGITAL, PAL_DEVICE_IN_AUX_DIGITAL));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_IN_HDMI, PAL_DEVICE_IN_HDMI));
-    //android_device_map_.insert(std::make_pair(AUDIO_DEVICE_IN_VOICE_CALL, PAL_DEVICE_IN_HANDSET_MIC));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_IN_TELEPHONY_RX, PAL_DEVICE_IN_TELEPHONY_RX));
-    //android_device_map_.insert(std::make_pair(AUDIO_DEVICE_IN_REMOTE_SUBMIX, PAL_DEVICE_IN_REMOTE_SUBMIX);
-    //android_device_map_.insert(std::make_pair(AUDIO_DEVICE_IN_ANLG_DOCK_HEADSET, PAL_DEVICE_IN_ANLG_DOCK_HEADSET);
-    //android_device_map_.insert(std::make_pair(AUDIO_DEVICE_IN_DGTL_DOCK_HEADSET, PAL_DEVICE_IN_DGTL_DOCK_HEADSET);
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_IN_USB_ACCESSORY, PAL_DEVICE_IN_USB_ACCESSORY));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_IN_USB_DEVICE, PAL_DEVICE_IN_USB_HEADSET));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_IN_FM_TUNER, PAL_DEVICE_IN_FM_TUNER));
-    //android_device_map_.insert(std::make_pair(AUDIO_DEVICE_IN_TV_TUNER, PAL_DEVICE_IN_TV_TUNER);
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_IN_LINE, PAL_DEVICE_IN_LINE));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_IN_SPDIF, PAL_DEVICE_IN_SPDIF));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_IN_BLUETOOTH_A2DP, PAL_DEVICE_IN_BLUETOOTH_A2DP));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_IN_BLE_HEADSET, PAL_DEVICE_IN_BLUETOOTH_BLE));
-    //android_device_map_.insert(std::make_pair(AUDIO_DEVICE_IN_LOOPBACK, PAL_DEVICE_IN_LOOPBACK);
-    //android_device_map_.insert(std::make_pair(AUDIO_DEVICE_IN_IP, PAL_DEVICE_IN_IP);
-    //android_device_map_.insert(std::make_pair(AUDIO_DEVICE_IN_BUS, PAL_DEVICE_IN_BUS);
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_IN_PROXY, PAL_DEVICE_IN_PROXY));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_IN_USB_HEADSET, PAL_DEVICE_IN_USB_HEADSET));
-    //android_device_map_.insert(std::make_pair(AUDIO_DEVICE_IN_HDMI_ARC, PAL_DEVICE_IN_HDMI_ARC);
-    //android_device_map_.insert(std::make_pair(AUDIO_DEVICE_IN_BLUETOOTH_BLE, PAL_DEVICE_IN_BLUETOOTH_BLE);
-    //android_device_map_.insert(std::make_pair(AUDIO_DEVICE_IN_DEFAULT, PAL_DEVICE_IN_DEFAULT));
-    android_device_map_.insert(std::make_pair(AUDIO_DEVICE_IN_ECHO_REFERENCE, PAL_DEVICE_IN_ECHO_REF));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_IN_BUILTIN_MIC, PAL_DEVICE_IN_HANDSET_MIC));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_IN_BACK_MIC, PAL_DEVICE_IN_SPEAKER_MIC));
+    //android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_IN_COMMUNICATION, PAL_DEVICE_IN_COMMUNICATION));
+    //android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_IN_AMBIENT, PAL_DEVICE_IN_AMBIENT);
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_IN_BLUETOOTH_SCO_HEADSET, PAL_DEVICE_IN_BLUETOOTH_SCO_HEADSET));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_IN_WIRED_HEADSET, PAL_DEVICE_IN_WIRED_HEADSET));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_IN_AUX_DIGITAL, PAL_DEVICE_IN_AUX_DIGITAL));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_IN_HDMI, PAL_DEVICE_IN_HDMI));
+    //android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_IN_VOICE_CALL, PAL_DEVICE_IN_HANDSET_MIC));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_IN_TELEPHONY_RX, PAL_DEVICE_IN_TELEPHONY_RX));
+    //android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_IN_REMOTE_SUBMIX, PAL_DEVICE_IN_REMOTE_SUBMIX);
+    //android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_IN_ANLG_DOCK_HEADSET, PAL_DEVICE_IN_ANLG_DOCK_HEADSET);
+    //android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_IN_DGTL_DOCK_HEADSET, PAL_DEVICE_IN_DGTL_DOCK_HEADSET);
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_IN_USB_ACCESSORY, PAL_DEVICE_IN_USB_ACCESSORY));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_IN_USB_DEVICE, PAL_DEVICE_IN_USB_HEADSET));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_IN_FM_TUNER, PAL_DEVICE_IN_FM_TUNER));
+    //android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_IN_TV_TUNER, PAL_DEVICE_IN_TV_TUNER);
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_IN_LINE, PAL_DEVICE_IN_LINE));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_IN_SPDIF, PAL_DEVICE_IN_SPDIF));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_IN_BLUETOOTH_A2DP, PAL_DEVICE_IN_BLUETOOTH_A2DP));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_IN_BLE_HEADSET, PAL_DEVICE_IN_BLUETOOTH_BLE));
+    //android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_IN_LOOPBACK, PAL_DEVICE_IN_LOOPBACK);
+    //android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_IN_IP, PAL_DEVICE_IN_IP);
+    //android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_IN_BUS, PAL_DEVICE_IN_BUS);
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_IN_PROXY, PAL_DEVICE_IN_PROXY));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_IN_USB_HEADSET, PAL_DEVICE_IN_USB_HEADSET));
+    //android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_IN_HDMI_ARC, PAL_DEVICE_IN_HDMI_ARC);
+    //android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_IN_BLUETOOTH_BLE, PAL_DEVICE_IN_BLUETOOTH_BLE);
+    //android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_IN_DEFAULT, PAL_DEVICE_IN_DEFAULT));
+    android_device_map_.push_back(std::make_pair(AUDIO_DEVICE_IN_ECHO_REFERENCE, PAL_DEVICE_IN_ECHO_REF));
+
+    /*
+     * Keep the table sorted so routing looks devices up with a binary search.
+     * Aliased Android devices keep the first entry added above.
+     */
+    std::stable_sort(android_device_map_.begin(), android_device_map_.end(),
+            [](const android_device_map_entry& a, const android_device_map_entry& b) {
+                return a.first < b.first;
+            });
+    android_device_map_.erase(std::unique(android_device_map_.begin(), android_device_map_.end(),
+            [](const android_device_map_entry& a, const android_device_map_entry& b) {
+                return a.first == b.first;
+            }), android_device_map_.end());
+    android_device_map_.shrink_to_fit();
 }
 
 int AudioDevice::GetPalDeviceIds(const std::set<audio_devices_t>& hal_device_ids,
@@ -2238,8 +2383,11 @@ int AudioDevice::GetPalDeviceIds(const std::set<audio_devices_t>& hal_device_ids
     AHAL_DBG("haldeviceIds: %zu", hal_device_ids.size());
 
     for(auto hal_device_id : hal_device_ids) {
-        auto it = android_device_map_.find(hal_device_id);
-        if (it != android_device_map_.end() &&
+        auto it = std::lower_bound(android_device_map_.begin(), android_device_map_.end(),
+                hal_device_id, [](const android_device_map_entry& e, audio_devices_t id) {
+                    return e.first < id;
+                });
+        if (it != android_device_map_.end() && it->first == hal_device_id &&
                 audio_is_input_device(it->first) == audio_is_input_device(hal_device_id)) {
             AHAL_DBG("Found haldeviceId: %x and PAL Device ID %d",
                     it->first, it->second);
@@ -49,9 +49,11 @@
 
 #include "AudioStream.h"
 #include "AudioVoice.h"
+#include "ControlWorker.h"
+#include "PerfLockManager.h"
+#include "StandbyPolicy.h"
 #include "PalDefs.h"
 
-#define MAX_PERF_LOCK_OPTS 20
 
 /* HDR Audio use case parameters */
 #define AUDIO_PARAMETER_KEY_HDR "hdr_record_on"
@@ -152,6 +154,9 @@ public:
     int ReleaseAudioPatch(audio_patch_handle_t handle);
     int SetGEFParam(void *data, int length);
     int GetGEFParam(void *data, int *length);
+    int GetDeviceCapability(pal_device_id_t id, int card, int device,
+                            bool isPlayback, dynamic_media_config_t *config);
+    void InvalidateDeviceCapabilities();
     std::shared_ptr<StreamOutPrimary> OutGetStream(audio_io_handle_t handle);
     std::vector<std::shared_ptr<StreamOutPrimary>> OutGetBLEStreamOutputs();
     std::vector<std::shared_ptr<StreamInPrimary>> InGetBLEStreamInputs();
@@ -172,6 +177,7 @@ public:
     bool mute_;
     int GetMicMute(bool *state);
     int SetParameters(const char *kvpairs);
+    void Dump(int fd);
     char* GetParameters(const char *keys);
     int SetMode(const audio_mode_t mode);
     int SetVoiceVolume(float volume);
@@ -188,13 +194,11 @@ public:
     pal_speaker_rotation_type current_rotation;
     static card_status_t sndCardState;
     std::mutex adev_init_mutex;
-    std::mutex adev_perf_mutex;
     uint32_t adev_init_ref_count = 0;
-    int32_t perf_lock_acquire_cnt = 0;
     hw_device_t *GetAudioDeviceCommon();
-    int perf_lock_handle;
-    int perf_lock_opts[MAX_PERF_LOCK_OPTS];
-    int perf_lock_opts_size;
+    PerfLockManager perfLockManager;
+    StandbyPolicy standbyPolicy{use_case_table, AUDIO_USECASE_MAX};
+    ControlWorker controlWorker;
     bool hdr_record_enabled = false;
     bool wnr_enabled = false;
     bool ans_enabled = false;
@@ -238,6 +242,21 @@ protected:
     std::mutex out_list_mutex;
     std::mutex in_list_mutex;
     std::mutex patch_map_mutex;
+    /*
+     * PAL_PARAM_ID_DEVICE_CAPABILITY results for external sinks and
+     * sources, dropped on every device connect/disconnect. The query only
+     * carries card and device, so that is all the key holds.
+     */
+    struct device_capability_entry {
+        pal_device_id_t id;
+        int card;
+        int device;
+        bool is_playback;
+        dynamic_media_config_t config;
+    };
+    std::vector<struct device_capability_entry> device_cap_cache_;
+    uint32_t device_cap_gen_ = 0;
+    std::mutex device_cap_mutex_;
     static btsco_lc3_cfg_t btsco_lc3_cfg;
     bool bt_lc3_speech_enabled;
     void *offload_effects_lib_;
@@ -247,9 +266,14 @@ protected:
     void *visualizer_lib_;
     visualizer_hal_start_output fnp_visualizer_start_output_ = nullptr;
     visualizer_hal_stop_output fnp_visualizer_stop_output_ = nullptr;
-    std::map<audio_devices_t, pal_device_id_t> android_device_map_;
+    visualizer_hal_pause_output fnp_visualizer_pause_output_ = nullptr;
+    visualizer_hal_resume_output fnp_visualizer_resume_output_ = nullptr;
+    typedef std::pair<audio_devices_t, pal_device_id_t> android_device_map_entry;
+    /* sorted by Android device, filled once by FillAndroidDeviceMap() */
+    std::vector<android_device_map_entry> android_device_map_;
     std::map<audio_patch_handle_t, AudioPatch*> patch_map_;
     int add_input_headset_if_usb_out_headset(int *device_count,  pal_device_id_t** pal_device_ids, bool conn_state);
+    bool RemoveAudioPatch(audio_patch_handle_t handle);
 };
 
 static inline uint32_t lcm(uint32_t num1, uint32_t num2)
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_TAG "AHAL: AudioHalConfig"
+#include "AudioCommon.h"
+#include "AudioHalConfig.h"
+
+#include <stdio.h>
+
+#include <cutils/properties.h>
+#include <log/log.h>
+
+typedef enum {
+    HAL_CONFIG_TYPE_BOOL,
+    HAL_CONFIG_TYPE_INT,
+} hal_config_type_t;
+
+struct hal_config_entry {
+    hal_config_key_t key;
+    const char *property;
+    hal_config_type_t type;
+    int32_t default_value;
+};
+
+static const struct hal_config_entry hal_config_table[HAL_CONFIG_MAX] = {
+    {HAL_CONFIG_HDR_RECORD_ENABLE, "vendor.audio.hdr.record.enable",
+        HAL_CONFIG_TYPE_BOOL, 0},
+    {HAL_CONFIG_HDR_SPF_RECORD_ENABLE, "vendor.audio.hdr.spf.record.enable",
+        HAL_CONFIG_TYPE_BOOL, 0},
+    {HAL_CONFIG_MSPP_ENABLE, "vendor.audio.mspp.enable",
+        HAL_CONFIG_TYPE_BOOL, 0},
+    {HAL_CONFIG_HANDSET_PROFILE_DISABLE, "vendor.audio.feature.handset.profile.disable",
+        HAL_CONFIG_TYPE_BOOL, 0},
+    {HAL_CONFIG_OUTPUT_DITHER_ENABLE, "vendor.audio.hal.output.dither.enable",
+        HAL_CONFIG_TYPE_BOOL, 0},
+    {HAL_CONFIG_LOW_LATENCY_PERIOD_SIZE, "vendor.audio_hal.period_size",
+        HAL_CONFIG_TYPE_INT, 0},
+    {HAL_CONFIG_OFFLOAD_BUFFER_SIZE_KB, "vendor.audio.offload.buffer.size.kb",
+        HAL_CONFIG_TYPE_INT, 0},
+    {HAL_CONFIG_ULL_RECORD_PERIOD_MULTIPLIER, "vendor.audio.ull_record_period_multiplier",
+        HAL_CONFIG_TYPE_INT, 0},
+    {HAL_CONFIG_OUTPUT_WARM_IDLE_MS, "vendor.audio.hal.output.warm_idle_ms",
+        HAL_CONFIG_TYPE_INT, 0},
+    {HAL_CONFIG_STANDBY_PARK_MS, "vendor.audio.hal.standby.park_ms",
+        HAL_CONFIG_TYPE_INT, 0},
+    {HAL_CONFIG_STANDBY_PARK_BUDGET_KB, "vendor.audio.hal.standby.park_budget_kb",
+        HAL_CONFIG_TYPE_INT, 256},
+    {HAL_CONFIG_VOLUME_RAMP_MS, "vendor.audio.hal.volume.ramp_ms",
+        HAL_CONFIG_TYPE_INT, 0},
+    {HAL_CONFIG_ROUTE_WAIT_MS, "vendor.audio.hal.route.wait_ms",
+        HAL_CONFIG_TYPE_INT, 0},
+    {HAL_CONFIG_ROUTE_DROP_IO_ENABLE, "vendor.audio.hal.route.drop_io",
+        HAL_CONFIG_TYPE_BOOL, 0},
+    {HAL_CONFIG_CAPTURE_LATENCY_LOW_LATENCY_US, "vendor.audio.hal.capture.latency_us.low_latency",
+        HAL_CONFIG_TYPE_INT, 0},
+    {HAL_CONFIG_CAPTURE_LATENCY_DEEP_BUFFER_US, "vendor.audio.hal.capture.latency_us.deep_buffer",
+        HAL_CONFIG_TYPE_INT, 0},
+    {HAL_CONFIG_CAPTURE_LATENCY_VOIP_TX_US, "vendor.audio.hal.capture.latency_us.voip_tx",
+        HAL_CONFIG_TYPE_INT, 0},
+    {HAL_CONFIG_CAPTURE_LATENCY_RAW_US, "vendor.audio.hal.capture.latency_us.raw",
+        HAL_CONFIG_TYPE_INT, 0},
+    {HAL_CONFIG_CAPTURE_LATENCY_COMPRESS_US, "vendor.audio.hal.capture.latency_us.compress",
+        HAL_CONFIG_TYPE_INT, 0},
+    {HAL_CONFIG_OFFLOAD_WAKEUP_INTERVAL_MS, "vendor.audio.hal.offload.wakeup_interval_ms",
+        HAL_CONFIG_TYPE_INT, 0},
+};
+
+std::atomic<int32_t> AudioHalConfig::sValues[HAL_CONFIG_MAX];
+
+void AudioHalConfig::Load()
+{
+    const struct hal_config_entry *entry = NULL;
+    int32_t value = 0;
+
+    for (int i = 0; i < HAL_CONFIG_MAX; i++) {
+        entry = &hal_config_table[i];
+        if (entry->type == HAL_CONFIG_TYPE_BOOL)
+            value = property_get_bool(entry->property, entry->default_value) ? 1 : 0;
+        else
+            value = property_get_int32(entry->property, entry->default_value);
+        sValues[entry->key].store(value, std::memory_order_relaxed);
+        AHAL_VERBOSE("%s = %d", entry->property, value);
+    }
+}
+
+bool AudioHalConfig::GetBool(hal_config_key_t key)
+{
+    return sValues[key].load(std::memory_order_relaxed) != 0;
+}
+
+int32_t AudioHalConfig::GetInt(hal_config_key_t key)
+{
+    return sValues[key].load(std::memory_order_relaxed);
+}
+
+void AudioHalConfig::Set(hal_config_key_t key, int32_t value)
+{
+    sValues[key].store(value, std::memory_order_relaxed);
+}
+
+void AudioHalConfig::Dump(int fd)
+{
+    dprintf(fd, "HAL config:\n");
+    for (int i = 0; i < HAL_CONFIG_MAX; i++)
+        dprintf(fd, "  %s = %d\n", hal_config_table[i].property,
+                sValues[hal_config_table[i].key].load(std::memory_order_relaxed));
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ANDROID_HARDWARE_AHAL_HAL_CONFIG_H_
+#define ANDROID_HARDWARE_AHAL_HAL_CONFIG_H_
+
+#include <stdint.h>
+
+#include <atomic>
+
+/* set_parameters key that re-reads all the properties below */
+#define AUDIO_PARAMETER_KEY_RELOAD_HAL_CONFIG "reload_hal_config"
+
+/* vendor properties consumed after AudioDevice::Init */
+typedef enum {
+    HAL_CONFIG_HDR_RECORD_ENABLE = 0,
+    HAL_CONFIG_HDR_SPF_RECORD_ENABLE,
+    HAL_CONFIG_MSPP_ENABLE,
+    HAL_CONFIG_HANDSET_PROFILE_DISABLE,
+    HAL_CONFIG_OUTPUT_DITHER_ENABLE,
+    HAL_CONFIG_LOW_LATENCY_PERIOD_SIZE,
+    HAL_CONFIG_OFFLOAD_BUFFER_SIZE_KB,
+    HAL_CONFIG_ULL_RECORD_PERIOD_MULTIPLIER,
+    HAL_CONFIG_OUTPUT_WARM_IDLE_MS,
+    HAL_CONFIG_STANDBY_PARK_MS,
+    HAL_CONFIG_STANDBY_PARK_BUDGET_KB,
+    HAL_CONFIG_VOLUME_RAMP_MS,
+    HAL_CONFIG_ROUTE_WAIT_MS,
+    HAL_CONFIG_ROUTE_DROP_IO_ENABLE,
+    HAL_CONFIG_CAPTURE_LATENCY_LOW_LATENCY_US,
+    HAL_CONFIG_CAPTURE_LATENCY_DEEP_BUFFER_US,
+    HAL_CONFIG_CAPTURE_LATENCY_VOIP_TX_US,
+    HAL_CONFIG_CAPTURE_LATENCY_RAW_US,
+    HAL_CONFIG_CAPTURE_LATENCY_COMPRESS_US,
+    HAL_CONFIG_OFFLOAD_WAKEUP_INTERVAL_MS,
+    HAL_CONFIG_MAX,
+} hal_config_key_t;
+
+/*
+ * Snapshot of the HAL tunables. Properties are read once by Load() and
+ * served from atomics afterwards, so stream hot paths never go through a
+ * property lookup. Load() may be called again to pick up new values.
+ */
+class AudioHalConfig {
+public:
+    static void Load();
+    static bool GetBool(hal_config_key_t key);
+    static int32_t GetInt(hal_config_key_t key);
+    /* overrides one value until the next Load() */
+    static void Set(hal_config_key_t key, int32_t value);
+    static void Dump(int fd);
+private:
+    static std::atomic<int32_t> sValues[HAL_CONFIG_MAX];
+};
+
+#endif  // ANDROID_HARDWARE_AHAL_HAL_CONFIG_H_
@@ -70,6 +70,7 @@
 
 #include "AudioDevice.h"
 #include "AudioStream.h"
+#include "HapticsDeinterleave.h"
 
 #include <log/log.h>
 #include <utils/Trace.h>
@@ -87,6 +88,10 @@
 
 #define COMPRESS_OFFLOAD_FRAGMENT_SIZE (32 * 1024)
 #define FLAC_COMPRESS_OFFLOAD_FRAGMENT_SIZE (256 * 1024)
+/* bounds of a fragment sized from the stream bitrate */
+#define COMPRESS_OFFLOAD_FRAGMENT_SIZE_MIN (4 * 1024)
+#define COMPRESS_OFFLOAD_FRAGMENT_SIZE_MAX FLAC_COMPRESS_OFFLOAD_FRAGMENT_SIZE
+#define COMPRESS_OFFLOAD_FRAGMENT_ALIGN 1024
 
 
 #define MAX_READ_RETRY_COUNT 25
@@ -111,10 +116,10 @@ static bool is_pcm_format(audio_format_t format)
 
 static int get_hdr_mode() {
     std::shared_ptr<AudioDevice> adevice = AudioDevice::GetInstance();
-    if (property_get_bool("vendor.audio.hdr.spf.record.enable", false)) {
+    if (AudioHalConfig::GetBool(HAL_CONFIG_HDR_SPF_RECORD_ENABLE)) {
         AHAL_INFO("HDR SPF feature is enabled");
         return AUDIO_RECORD_SPF_HDR;
-    } else if (property_get_bool("vendor.audio.hdr.record.enable", false) && adevice->hdr_record_enabled) {
+    } else if (AudioHalConfig::GetBool(HAL_CONFIG_HDR_RECORD_ENABLE) && adevice->hdr_record_enabled) {
         AHAL_INFO("HDR ARM feature is enabled");
         return AUDIO_RECORD_ARM_HDR;
     } else {
@@ -148,42 +153,6 @@ static void setup_hdr_usecase(struct pal_device* palInDevice) {
         palInDevice->custom_config.custom_key);
 }
 
-/*
-* Scope based implementation of acquiring/releasing PerfLock.
-*/
-class AutoPerfLock {
-public :
-    AutoPerfLock() {
-        std::shared_ptr<AudioDevice> adevice = AudioDevice::GetInstance();
-        if (adevice) {
-            adevice->adev_perf_mutex.lock();
-            ++adevice->perf_lock_acquire_cnt;
-            if (adevice->perf_lock_acquire_cnt == 1)
-                AudioExtn::audio_extn_perf_lock_acquire(&adevice->perf_lock_handle, 0,
-                        adevice->perf_lock_opts, adevice->perf_lock_opts_size);
-            AHAL_DBG("(Acquired) perf_lock_handle: 0x%x, count: %d",
-                    adevice->perf_lock_handle, adevice->perf_lock_acquire_cnt);
-            adevice->adev_perf_mutex.unlock();
-        }
-    }
-
-    ~AutoPerfLock() {
-        std::shared_ptr<AudioDevice> adevice = AudioDevice::GetInstance();
-        if (adevice) {
-            adevice->adev_perf_mutex.lock();
-            AHAL_DBG("(release) perf_lock_handle: 0x%x, count: %d",
-                    adevice->perf_lock_handle, adevice->perf_lock_acquire_cnt);
-            if (adevice->perf_lock_acquire_cnt > 0)
-                --adevice->perf_lock_acquire_cnt;
-            if (adevice->perf_lock_acquire_cnt == 0) {
-                AHAL_DBG("Releasing perf_lock_handle: 0x%x", adevice->perf_lock_handle);
-                AudioExtn::audio_extn_perf_lock_release(&adevice->perf_lock_handle);
-            }
-            adevice->adev_perf_mutex.unlock();
-        }
-    }
-};
-
 void StreamOutPrimary::GetStreamHandle(audio_stream_out** stream) {
   *stream = (audio_stream_out*)stream_.get();
 }
@@ -334,6 +303,17 @@ static pal_stream_type_t GetPalStreamType(audio_output_flags_t flags) {
 std::shared_ptr<AudioDevice> AudioDevice::adev_ = nullptr;
 std::shared_ptr<audio_hw_device_t> AudioDevice::device_ = nullptr;
 
+/* data path lookups, valid until the framework closes the stream */
+static inline StreamOutPrimary *OutStreamOwner(const struct audio_stream_out *stream)
+{
+    return stream ? reinterpret_cast<const hal_stream_out *>(stream)->owner : nullptr;
+}
+
+static inline StreamInPrimary *InStreamOwner(const struct audio_stream_in *stream)
+{
+    return stream ? reinterpret_cast<const hal_stream_in *>(stream)->owner : nullptr;
+}
+
 static int32_t pal_callback(pal_stream_handle_t *stream_handle,
                             uint32_t event_id, uint32_t *event_data,
                             uint32_t event_size, uint64_t cookie)
@@ -349,10 +329,10 @@ static int32_t pal_callback(pal_stream_handle_t *stream_handle,
     {
         case PAL_STREAM_CBK_EVENT_WRITE_READY:
         {
-            std::lock_guard<std::mutex> write_guard (astream_out->write_wait_mutex_);
-            astream_out->write_ready_ = true;
             AHAL_VERBOSE("received WRITE_READY event");
-            (astream_out->write_condition_).notify_all();
+            /* nobody waits for room, do not wake the framework up */
+            if (!astream_out->OnWriteReady())
+                return 0;
             event = STREAM_CBK_EVENT_WRITE_READY;
         }
         break;
@@ -379,6 +359,7 @@ static int32_t pal_callback(pal_stream_handle_t *stream_handle,
         break;
     case PAL_STREAM_CBK_EVENT_ERROR:
         AHAL_DBG("received PAL_STREAM_CBK_EVENT_ERROR event");
+        astream_out->AbortOffloadWaits();
         event = STREAM_CBK_EVENT_ERROR;
         break;
     default:
@@ -703,11 +684,40 @@ static int astream_out_standby(struct audio_stream *stream) {
     return ret;
 }
 
-static int astream_dump(const struct audio_stream *stream, int fd) {
-    std::ignore = stream;
-    std::ignore = fd;
-    AHAL_DBG("dump function not implemented");
-    return 0;
+static int astream_out_dump(const struct audio_stream *stream, int fd) {
+    std::shared_ptr<AudioDevice> adevice = AudioDevice::GetInstance();
+    std::shared_ptr<StreamOutPrimary> astream_out;
+
+    if (!adevice) {
+        AHAL_ERR("unable to get audio device");
+        return -EINVAL;
+    }
+
+    astream_out = adevice->OutGetStream((audio_stream_t*)stream);
+    if (!astream_out) {
+        AHAL_ERR("unable to get audio OutStream");
+        return -EINVAL;
+    }
+
+    return astream_out->Dump(fd);
+}
+
+static int astream_in_dump(const struct audio_stream *stream, int fd) {
+    std::shared_ptr<AudioDevice> adevice = AudioDevice::GetInstance();
+    std::shared_ptr<StreamInPrimary> astream_in;
+
+    if (!adevice) {
+        AHAL_ERR("unable to get audio device");
+        return -EINVAL;
+    }
+
+    astream_in = adevice->InGetStream((audio_stream_t*)stream);
+    if (!astream_in) {
+        AHAL_ERR("unable to get audio InStream");
+        return -EINVAL;
+    }
+
+    return astream_in->Dump(fd);
 }
 #ifdef USEHIDL7_1
 static int astream_set_latency_mode(struct audio_stream_out *stream, audio_latency_mode_t mode) {
@@ -738,7 +748,6 @@ static uint32_t astream_get_latency(const struct audio_stream_out *stream) {
     std::shared_ptr<StreamOutPrimary> astream_out;
     uint32_t period_ms, latency = 0;
     int trial = 0;
-    char value[PROPERTY_VALUE_MAX] = {0};
     int low_latency_period_size = LOW_LATENCY_PLAYBACK_PERIOD_SIZE;
 
     if (adevice) {
@@ -769,11 +778,9 @@ static uint32_t astream_get_latency(const struct audio_stream_out *stream) {
         latency += StreamOutPrimary::GetRenderLatency(astream_out->flags_) / 1000;
         break;
     case USECASE_AUDIO_PLAYBACK_LOW_LATENCY:
-        if (property_get("vendor.audio_hal.period_size", value, NULL) > 0) {
-            trial = atoi(value);
-            if (astream_out->period_size_is_plausible_for_low_latency(trial))
-                low_latency_period_size = trial;
-        }
+        trial = AudioHalConfig::GetInt(HAL_CONFIG_LOW_LATENCY_PERIOD_SIZE);
+        if (astream_out->period_size_is_plausible_for_low_latency(trial))
+            low_latency_period_size = trial;
         latency = (LOW_LATENCY_PLAYBACK_PERIOD_COUNT * low_latency_period_size * 1000)/ (astream_out->GetSampleRate());
         latency += StreamOutPrimary::GetRenderLatency(astream_out->flags_) / 1000;
         break;
@@ -794,26 +801,7 @@ static uint32_t astream_get_latency(const struct audio_stream_out *stream) {
     }
 
     // accounts for A2DP encoding and sink latency
-    pal_param_bta2dp_t *param_bt_a2dp_ptr, param_bt_a2dp;
-    param_bt_a2dp_ptr = &param_bt_a2dp;
-    size_t size = 0;
-    int32_t ret;
-
-    if (astream_out->isDeviceAvailable(PAL_DEVICE_OUT_BLUETOOTH_A2DP)) {
-        param_bt_a2dp_ptr->dev_id = PAL_DEVICE_OUT_BLUETOOTH_A2DP;
-    } else if (astream_out->isDeviceAvailable(PAL_DEVICE_OUT_BLUETOOTH_BLE)) {
-        param_bt_a2dp_ptr->dev_id = PAL_DEVICE_OUT_BLUETOOTH_BLE;
-    } else if (astream_out->isDeviceAvailable(PAL_DEVICE_OUT_BLUETOOTH_BLE_BROADCAST)) {
-        param_bt_a2dp_ptr->dev_id = PAL_DEVICE_OUT_BLUETOOTH_BLE_BROADCAST;
-    } else {
-        goto exit;
-    }
-    ret = pal_get_param(PAL_PARAM_ID_BT_A2DP_ENCODER_LATENCY,
-        (void**)&param_bt_a2dp_ptr, &size, nullptr);
-    if (!ret && size && param_bt_a2dp_ptr && param_bt_a2dp_ptr->latency) {
-        latency += param_bt_a2dp_ptr->latency;
-    }
-exit:
+    latency += astream_out->GetBtEncoderLatency();
     AHAL_VERBOSE("Latency %d", latency);
     return latency;
 }
@@ -821,16 +809,9 @@ exit:
 static int astream_out_get_presentation_position(
                                const struct audio_stream_out *stream,
                                uint64_t *frames, struct timespec *timestamp) {
-    std::ignore = stream;
-    std::shared_ptr<AudioDevice> adevice = AudioDevice::GetInstance();
-    std::shared_ptr<StreamOutPrimary> astream_out;
+    StreamOutPrimary *astream_out = OutStreamOwner(stream);
     int ret = 0;
-    if (adevice) {
-        astream_out = adevice->OutGetStream((audio_stream_t*)stream);
-    } else {
-        AHAL_ERR("unable to get audio device");
-        return -EINVAL;
-    }
+
     if (!timestamp) {
        AHAL_ERR("error: timestamp NULL");
        return -EINVAL;
@@ -846,12 +827,11 @@ static int astream_out_get_presentation_position(
            [[fallthrough]];
             /* fall through if the card is online for PCM OFFLOAD stream */
        case PAL_STREAM_COMPRESSED:
-           ret = astream_out->GetFrames(frames);
+           ret = astream_out->GetPresentationFrames(frames, timestamp);
            if (ret) {
                AHAL_ERR("GetTimestamp failed %d", ret);
                return ret;
            }
-           clock_gettime(CLOCK_MONOTONIC, timestamp);
            break;
        default:
           *frames = astream_out->GetFramesWritten(timestamp);
@@ -868,19 +848,11 @@ static int astream_out_get_presentation_position(
 
 static int out_get_render_position(const struct audio_stream_out *stream,
                                    uint32_t *dsp_frames) {
-    std::ignore = stream;
     std::ignore = dsp_frames;
-    std::shared_ptr<AudioDevice> adevice = AudioDevice::GetInstance();
-    std::shared_ptr<StreamOutPrimary> astream_out;
+    StreamOutPrimary *astream_out = OutStreamOwner(stream);
     int ret = 0;
     uint64_t frames = 0;
 
-    if (adevice) {
-        astream_out = adevice->OutGetStream((audio_stream_t*)stream);
-    } else {
-        AHAL_ERR("unable to get audio device");
-        return -EINVAL;
-    }
     if (astream_out) {
         switch (astream_out->GetPalStreamType(astream_out->flags_)) {
         case PAL_STREAM_PCM_OFFLOAD:
@@ -1144,15 +1116,7 @@ static int astream_out_remove_audio_effect(
 static ssize_t in_read(struct audio_stream_in *stream, void *buffer,
                        size_t bytes) {
 
-    std::shared_ptr<AudioDevice> adevice = AudioDevice::GetInstance();
-    std::shared_ptr<StreamInPrimary> astream_in;
-
-    if (adevice) {
-        astream_in = adevice->InGetStream((audio_stream_t*)stream);
-    } else {
-        AHAL_ERR("unable to get audio device");
-        return -EINVAL;
-    }
+    StreamInPrimary *astream_in = InStreamOwner(stream);
 
     if (astream_in) {
         return astream_in->read(buffer, bytes);
@@ -1167,15 +1131,7 @@ static ssize_t in_read(struct audio_stream_in *stream, void *buffer,
 static ssize_t out_write(struct audio_stream_out *stream, const void *buffer,
                          size_t bytes) {
 
-    std::shared_ptr<AudioDevice> adevice = AudioDevice::GetInstance();
-    std::shared_ptr<StreamOutPrimary> astream_out;
-
-    if (adevice) {
-        astream_out = adevice->OutGetStream((audio_stream_t*)stream);
-    } else {
-        AHAL_ERR("unable to get audio device");
-        return -EINVAL;
-    }
+    StreamOutPrimary *astream_out = OutStreamOwner(stream);
 
     if (astream_out) {
         return astream_out->write(buffer, bytes);
@@ -1354,57 +1310,27 @@ exit:
 
 int64_t StreamInPrimary::GetSourceLatency(audio_input_flags_t halStreamFlags)
 {
-    // check how to get dsp_latency value from platform info xml instead of hardcoding
-    return 0;
-    /*struct pal_stream_attributes streamAttributes_;
-    streamAttributes_.type = StreamInPrimary::GetPalStreamType(halStreamFlags,
-        config_.sample_rate);
-    AHAL_VERBOSE(" type %d", streamAttributes_.type);
-    switch (streamAttributes_.type) {
+    if (usecase_ == USECASE_AUDIO_RECORD_COMPRESS)
+        return AudioHalConfig::GetInt(HAL_CONFIG_CAPTURE_LATENCY_COMPRESS_US);
+
+    switch (StreamInPrimary::GetPalStreamType(halStreamFlags, config_.sample_rate)) {
     case PAL_STREAM_DEEP_BUFFER:
-        return DEEP_BUFFER_PLATFORM_CAPTURE_DELAY;
+        return AudioHalConfig::GetInt(HAL_CONFIG_CAPTURE_LATENCY_DEEP_BUFFER_US);
     case PAL_STREAM_LOW_LATENCY:
-        return LOW_LATENCY_PLATFORM_CAPTURE_DELAY;
-    case  PAL_STREAM_VOIP_TX:
-        return VOIP_TX_PLATFORM_CAPTURE_DELAY;
-    case  PAL_STREAM_RAW:
-        return RAW_STREAM_PLATFORM_CAPTURE_DELAY;
-        //TODO: Add more streamtypes if available in pal
+        return AudioHalConfig::GetInt(HAL_CONFIG_CAPTURE_LATENCY_LOW_LATENCY_US);
+    case PAL_STREAM_VOIP_TX:
+        return AudioHalConfig::GetInt(HAL_CONFIG_CAPTURE_LATENCY_VOIP_TX_US);
+    case PAL_STREAM_RAW:
+        return AudioHalConfig::GetInt(HAL_CONFIG_CAPTURE_LATENCY_RAW_US);
     default:
         return 0;
-    }*/
+    }
 }
 
-uint64_t StreamInPrimary::GetFramesRead(int64_t* time)
+/* called with stream_mutex_ held, keeps PAL queries out of get_capture_position */
+void StreamInPrimary::UpdateCaptureLatency()
 {
-    uint64_t signed_frames = 0;
-    uint64_t kernel_frames = 0;
-    size_t kernel_buffer_size = 0;
-    int64_t dsp_latency = 0;
-
-    if (!time) {
-        AHAL_ERR("timestamp NULL");
-        return 0;
-    }
-
-    //TODO: need to get this latency from xml instead of hardcoding
-    stream_mutex_.lock();
-    dsp_latency = StreamInPrimary::GetSourceLatency(flags_);
-
-    if (usecase_ == USECASE_AUDIO_RECORD_COMPRESS) {
-        /**
-         * TODO get num of pcm frames from below layers
-         **/
-        signed_frames =
-            mCompressReadCalls * COMPRESS_CAPTURE_AAC_PCM_SAMPLES_IN_FRAME;
-    } else {
-        signed_frames = mBytesRead / audio_bytes_per_frame(
-        audio_channel_count_from_in_mask(config_.channel_mask),
-        config_.format);
-    }
-
-    *time = (readAt.tv_sec * 1000000000LL) + readAt.tv_nsec - (dsp_latency * 1000LL);
-
+    int64_t latencyUs = GetSourceLatency(flags_);
     // Adjustment accounts for A2dp decoder latency
     // Note: Decoder latency is returned in ms, while platform_source_latency in us.
     pal_param_bta2dp_t* param_bt_a2dp_ptr, param_bt_a2dp;
@@ -1422,11 +1348,27 @@ uint64_t StreamInPrimary::GetFramesRead(int64_t* time)
     ret = pal_get_param(PAL_PARAM_ID_BT_A2DP_DECODER_LATENCY,
         (void**)&param_bt_a2dp_ptr, &size, nullptr);
     if (!ret && size && param_bt_a2dp_ptr && param_bt_a2dp_ptr->latency) {
-        *time -= param_bt_a2dp_ptr->latency * 1000000LL;
+        latencyUs += param_bt_a2dp_ptr->latency * 1000LL;
     }
 
 exit:
-    stream_mutex_.unlock();
+    captureLatencyUs_.store(latencyUs, std::memory_order_relaxed);
+    AHAL_DBG("capture latency %" PRId64 "us", latencyUs);
+}
+
+uint64_t StreamInPrimary::GetFramesRead(int64_t* time)
+{
+    uint64_t signed_frames = 0;
+    int64_t timeNs = 0;
+
+    if (!time) {
+        AHAL_ERR("timestamp NULL");
+        return 0;
+    }
+
+    /* lockless, a read blocked in PAL must not delay the position query */
+    capturePosition_.Get(&signed_frames, &timeNs);
+    *time = timeNs - captureLatencyUs_.load(std::memory_order_relaxed) * 1000LL;
 
     AHAL_VERBOSE("signed frames %lld", (long long)signed_frames);
 
@@ -1435,25 +1377,18 @@ exit:
 
 static int astream_in_get_capture_position(const struct audio_stream_in* stream,
     int64_t* frames, int64_t* time) {
-    std::shared_ptr<AudioDevice> adevice = AudioDevice::GetInstance();
-    std::shared_ptr<StreamInPrimary> astream_in;
+    StreamInPrimary *astream_in = InStreamOwner(stream);
 
     if (stream == NULL || frames == NULL || time == NULL) {
         return -EINVAL;
     }
 
-    if (adevice) {
-        astream_in = adevice->InGetStream((audio_stream_t*)stream);
-    } else {
-        AHAL_ERR("unable to get audio device");
-        return -ENOSYS;
-    }
     if(astream_in)
         *frames = astream_in->GetFramesRead(time);
     else
         return -ENOSYS;
     AHAL_VERBOSE("audio stream(%p) frames %lld played at %lld ",
-                 astream_in.get(), ((long long)*frames), ((long long)*time));
+                 astream_in, ((long long)*frames), ((long long)*time));
 
     return 0;
 }
@@ -1806,6 +1741,81 @@ int StreamPrimary::getPalDeviceIds(const std::set<audio_devices_t>& halDeviceIds
     return adevice->GetPalDeviceIds(halDeviceIds, qualIds);
 }
 
+/*
+ * Runs RouteStream() on the control worker and waits for it at most
+ * vendor.audio.hal.route.wait_ms, 0 waits until it is done. A switch still
+ * running after that completes in the background: -EINPROGRESS is returned
+ * and a failure of the switch is only logged once it is done. A request that
+ * has not started yet is replaced by a later one, whose result is returned.
+ *
+ * The request lives in the route members and the posted task captures only
+ * this, so the caller side does not allocate once the device sets have grown
+ * to the size of the routes in use.
+ */
+int StreamPrimary::RouteStreamAsync(const std::set<audio_devices_t>& new_devices) {
+    std::shared_ptr<AudioDevice> adevice = AudioDevice::GetInstance();
+    int32_t waitMs = AudioHalConfig::GetInt(HAL_CONFIG_ROUTE_WAIT_MS);
+    uint64_t routeSeq = 0, seq = 0;
+
+    route_mutex_.lock();
+    routeDevices_ = new_devices;
+    routeSeq = ++routeSeq_;
+    route_mutex_.unlock();
+
+    seq = adevice->controlWorker.Post(this, CONTROL_TASK_ROUTE, [this]() { RunRoute(); });
+    if (!adevice->controlWorker.Wait(seq, waitMs * 1000LL)) {
+        std::lock_guard<std::mutex> guard(route_mutex_);
+        if (routeDoneSeq_ < routeSeq) {
+            AHAL_INFO("usecase(%d: %s) device switch still running after %dms",
+                      usecase_, use_case_table[usecase_], waitMs);
+            routeLateSeq_ = routeSeq;
+            return -EINPROGRESS;
+        }
+    }
+
+    std::lock_guard<std::mutex> guard(route_mutex_);
+    return routeDoneSeq_ >= routeSeq ? routeRet_ : 0;
+}
+
+/* control worker side of RouteStreamAsync(), runs the latest request */
+void StreamPrimary::RunRoute() {
+    uint64_t routeSeq = 0;
+    int ret = 0;
+
+    route_mutex_.lock();
+    routingDevices_ = routeDevices_;
+    routeSeq = routeSeq_;
+    route_mutex_.unlock();
+
+    ret = RouteStream(routingDevices_);
+
+    std::lock_guard<std::mutex> guard(route_mutex_);
+    routeDoneSeq_ = routeSeq;
+    routeRet_ = ret;
+    if (routeLateSeq_ >= routeSeq && ret)
+        AHAL_ERR("usecase(%d: %s) late device switch failed, ret %d",
+                 usecase_, use_case_table[usecase_], ret);
+}
+
+/*
+ * Takes stream_mutex_ for a read or write carrying budgetUs of audio. When
+ * vendor.audio.hal.route.drop_io is set and a device switch holds it longer
+ * than that, returns false so the caller can drop the buffer rather than
+ * stall the audio thread behind PAL. Otherwise this blocks until locked.
+ */
+bool StreamPrimary::LockForIo(int64_t budgetUs) {
+    if (budgetUs <= 0 || !AudioHalConfig::GetBool(HAL_CONFIG_ROUTE_DROP_IO_ENABLE)) {
+        stream_mutex_.lock();
+        return true;
+    }
+
+    while (!stream_mutex_.try_lock_for(std::chrono::microseconds(budgetUs))) {
+        if (routesInFlight_.load() > 0)
+            return false;
+    }
+    return true;
+}
+
 int StreamPrimary::GetDeviceAddress(struct str_parms *parms, int *card_id,
                                       int *device_num) {
     int ret = -EINVAL;
@@ -1983,7 +1993,7 @@ int StreamOutPrimary::FillHalFnPtrs() {
     stream_.get()->common.get_format = astream_out_get_format;
     stream_.get()->common.set_format = astream_set_format;
     stream_.get()->common.standby = astream_out_standby;
-    stream_.get()->common.dump = astream_dump;
+    stream_.get()->common.dump = astream_out_dump;
     stream_.get()->common.set_parameters = astream_out_set_parameters;
     stream_.get()->common.get_parameters = astream_out_get_parameters;
     stream_.get()->common.add_audio_effect = astream_out_add_audio_effect;
@@ -2046,6 +2056,33 @@ int StreamOutPrimary::GetMmapPosition(struct audio_mmap_position *position)
     return 0;
 }
 
+int StreamOutPrimary::Dump(int fd)
+{
+    dprintf(fd, "  Output stream handle %d usecase %s\n", handle_,
+            use_case_table[GetUseCase()]);
+    dprintf(fd, "    format %#x sample rate %u channel mask %#x flags %#x\n",
+            config_.format, config_.sample_rate, config_.channel_mask, flags_);
+    dprintf(fd, "    state %s, fragment %u x %u, bytes written %" PRIu64 "\n",
+            pal_stream_handle_ ? (stream_started_ ? "started" : "opened") : "standby",
+            fragment_size_, fragments_, mBytesWritten);
+    stats_.Dump(fd);
+    if (streamAttributes_.type == PAL_STREAM_COMPRESSED) {
+        dprintf(fd, "    offload: short writes %" PRIu64 ", write ready forwarded %" PRIu64
+                " suppressed %" PRIu64 "\n",
+                offloadShortWrites_.load(), writeReadyForwarded_.load(),
+                writeReadySuppressed_.load());
+        /* one wakeup per fragment consumed at the nominal bitrate */
+        if (fragment_size_)
+            dprintf(fd, "    offload: bit rate %u, expected %" PRIu64 " wakeups/min\n",
+                    GetCompressBitRate(),
+                    (uint64_t)GetCompressBitRate() / 8 * 60 / fragment_size_);
+    }
+    if (streamAttributes_.type == PAL_STREAM_COMPRESSED ||
+        streamAttributes_.type == PAL_STREAM_PCM_OFFLOAD)
+        positionTracker_.Dump(fd);
+    return 0;
+}
+
 bool StreamOutPrimary::isDeviceAvailable(pal_device_id_t deviceId)
 {
     for (int i = 0; i < mAndroidOutDevices.size(); i++) {
@@ -2056,6 +2093,75 @@ bool StreamOutPrimary::isDeviceAvailable(pal_device_id_t deviceId)
     return false;
 }
 
+std::atomic<uint64_t> StreamOutPrimary::btLatencyQueriesSaved = 0;
+LatencyHistogram StreamOutPrimary::sFirstWriteUs[AUDIO_USECASE_MAX];
+
+/*
+ * Called with stream_mutex_ held whenever the route may have changed. Takes
+ * the BT device of the route for GetBtEncoderLatency(), which runs without
+ * the lock, and retires any latency cached for the previous route.
+ */
+void StreamOutPrimary::InvalidateBtEncoderLatency()
+{
+    pal_device_id_t device = PAL_DEVICE_NONE;
+
+    if (isDeviceAvailable(PAL_DEVICE_OUT_BLUETOOTH_A2DP))
+        device = PAL_DEVICE_OUT_BLUETOOTH_A2DP;
+    else if (isDeviceAvailable(PAL_DEVICE_OUT_BLUETOOTH_BLE))
+        device = PAL_DEVICE_OUT_BLUETOOTH_BLE;
+    else if (isDeviceAvailable(PAL_DEVICE_OUT_BLUETOOTH_BLE_BROADCAST))
+        device = PAL_DEVICE_OUT_BLUETOOTH_BLE_BROADCAST;
+
+    btRouteDevice.store(device, std::memory_order_relaxed);
+    btRouteGen.fetch_add(1, std::memory_order_release);
+}
+
+/*
+ * Encoder latency in ms of the BT device this stream is routed to, 0 for
+ * non BT routes. PAL is only queried after a route change, stream start or
+ * BT reconfiguration invalidated the cached value.
+ */
+int32_t StreamOutPrimary::GetBtEncoderLatency()
+{
+    uint32_t routeGen = btRouteGen.load(std::memory_order_acquire);
+    uint64_t key = BT_LATENCY_KEY(routeGen,
+            bt_encoder_latency_gen_.load(std::memory_order_acquire));
+    uint64_t cached = btLatencyCache.load(std::memory_order_acquire);
+    pal_device_id_t device = (pal_device_id_t)btRouteDevice.load(std::memory_order_relaxed);
+    pal_param_bta2dp_t *param_bt_a2dp_ptr, param_bt_a2dp;
+    size_t size = 0;
+    int32_t latency = 0;
+    int ret = 0;
+
+    if ((cached & ~BT_LATENCY_MASK) == key) {
+        btLatencyQueriesSaved.fetch_add(1, std::memory_order_relaxed);
+        return (int32_t)(cached & BT_LATENCY_MASK);
+    }
+
+    if (device != PAL_DEVICE_NONE) {
+        param_bt_a2dp_ptr = &param_bt_a2dp;
+        param_bt_a2dp_ptr->dev_id = device;
+        ret = pal_get_param(PAL_PARAM_ID_BT_A2DP_ENCODER_LATENCY,
+            (void**)&param_bt_a2dp_ptr, &size, nullptr);
+        if (ret) {
+            /* keep the cache invalid so that the next query retries */
+            AHAL_VERBOSE("BT encoder latency query failed %d", ret);
+            return 0;
+        }
+        if (size && param_bt_a2dp_ptr)
+            latency = param_bt_a2dp_ptr->latency;
+    }
+
+    /*
+     * Tagged with the generations read before the query, so a route change
+     * or BT event meanwhile leaves it stale; never replaces a newer entry.
+     */
+    if (latency >= 0 && (uint64_t)latency <= BT_LATENCY_MASK)
+        btLatencyCache.compare_exchange_strong(cached, key | (uint64_t)latency,
+                                               std::memory_order_acq_rel);
+    return latency;
+}
+
 int StreamOutPrimary::CreateMmapBuffer(int32_t min_size_frames,
         struct audio_mmap_buffer_info *info)
 {
@@ -2160,6 +2266,9 @@ int StreamOutPrimary::Pause() {
         ret = -EINVAL;
     else {
         stream_paused_ = true;
+        positionTracker_.SetRunning(false);
+        if (CheckOffloadEffectsType(streamAttributes_.type))
+            PauseOffloadVisualizer(handle_, pal_stream_handle_);
     }
 
 exit:
@@ -2187,6 +2296,9 @@ int StreamOutPrimary::Resume() {
         ret = -EINVAL;
     else {
         stream_paused_ = false;
+        positionTracker_.SetRunning(true);
+        if (CheckOffloadEffectsType(streamAttributes_.type))
+            ResumeOffloadVisualizer(handle_, pal_stream_handle_);
     }
 
 exit:
@@ -2205,17 +2317,25 @@ int StreamOutPrimary::Flush() {
         {
             ret = pal_stream_flush(pal_stream_handle_);
             if (!ret) {
+                /* dsp position restarts from zero after flush */
+                positionTracker_.Reset();
                 ret = pal_stream_resume(pal_stream_handle_);
-                if (!ret)
+                if (!ret) {
                     stream_paused_ = false;
+                    positionTracker_.SetRunning(true);
+                    if (CheckOffloadEffectsType(streamAttributes_.type))
+                        ResumeOffloadVisualizer(handle_, pal_stream_handle_);
+                }
             }
         } else {
             AHAL_INFO("called in invalid state (stream not paused)" );
         }
         mBytesWritten = 0;
+        ioDroppedBytes_ = 0;
     }
     sendGaplessMetadata = true;
     stream_mutex_.unlock();
+    AbortOffloadWaits();
 
     if (ret)
         ret = -EINVAL;
@@ -2227,6 +2347,10 @@ int StreamOutPrimary::Flush() {
 int StreamOutPrimary::Drain(audio_drain_type_t type) {
     int ret = 0;
     pal_drain_type_t palDrainType;
+    bool draining = false;
+    uint64_t bufferedBytes = 0;
+    uint32_t bitRate = 0;
+    int64_t timeoutMs = 0;
 
     AHAL_INFO("Enter: usecase(%d: %s)", GetUseCase(), use_case_table[GetUseCase()]);
     switch (type) {
@@ -2241,28 +2365,146 @@ int StreamOutPrimary::Drain(audio_drain_type_t type) {
            return -EINVAL;
     }
 
+    /* DRAIN_READY may arrive before pal_stream_drain returns */
+    drain_wait_mutex_.lock();
+    drain_ready_ = false;
+    drain_wait_mutex_.unlock();
+
     stream_mutex_.lock();
-    if (pal_stream_handle_)
+    if (pal_stream_handle_) {
         ret = pal_stream_drain(pal_stream_handle_, palDrainType);
+        draining = !ret;
+    }
+    bufferedBytes = (uint64_t)fragment_size_ * fragments_;
+    bitRate = GetCompressBitRate();
     stream_mutex_.unlock();
 
     if (ret) {
         AHAL_ERR("Invalid drain type:%d", type);
+        return ret;
+    }
+
+    /*
+     * without a callback drain blocks, flush and standby cut it short. It
+     * cannot take longer than playing what the buffers hold.
+     */
+    if (draining && !client_callback && streamAttributes_.type == PAL_STREAM_COMPRESSED) {
+        if (bitRate < OFFLOAD_DRAIN_MIN_BIT_RATE)
+            bitRate = OFFLOAD_DRAIN_MIN_BIT_RATE;
+        timeoutMs = bufferedBytes * 8 * 1000 / bitRate + OFFLOAD_DRAIN_TIMEOUT_MARGIN_MS;
+        std::unique_lock<std::mutex> guard(drain_wait_mutex_);
+        if (!drain_condition_.wait_for(guard, std::chrono::milliseconds(timeoutMs),
+                                       [this]() { return drain_ready_; })) {
+            AHAL_ERR("no DRAIN_READY within %" PRId64 "ms", timeoutMs);
+            return -ETIMEDOUT;
+        }
+        AHAL_DBG("drain done");
     }
 
     return ret;
 }
 
+bool StreamOutPrimary::OnWriteReady()
+{
+    bool waiting = false;
+
+    write_wait_mutex_.lock();
+    write_ready_ = true;
+    waiting = offloadWriteBlocked_;
+    offloadWriteBlocked_ = false;
+    write_condition_.notify_all();
+    write_wait_mutex_.unlock();
+
+    if (waiting)
+        writeReadyForwarded_++;
+    else
+        writeReadySuppressed_++;
+    return waiting;
+}
+
+void StreamOutPrimary::AbortOffloadWaits()
+{
+    write_wait_mutex_.lock();
+    write_ready_ = true;
+    write_condition_.notify_all();
+    write_wait_mutex_.unlock();
+
+    drain_wait_mutex_.lock();
+    drain_ready_ = true;
+    drain_condition_.notify_all();
+    drain_wait_mutex_.unlock();
+}
+
+/*
+ * Called with stream_mutex_ held. The kernel compress buffer of fragments_
+ * x fragment_size_ bytes is the only buffering, a write that does not fit
+ * returns the bytes taken. With a client callback the framework sleeps until
+ * WRITE_READY, otherwise the write waits here for room, at most for
+ * OFFLOAD_WRITE_READY_TIMEOUT_MS per wait.
+ */
+ssize_t StreamOutPrimary::WriteOffload(struct pal_buffer *palBuffer)
+{
+    size_t bytes = palBuffer->size;
+    size_t written = 0;
+    ssize_t ret = 0;
+    bool ready = false;
+
+    while (written < bytes) {
+        /* a WRITE_READY from here on is for this write */
+        write_wait_mutex_.lock();
+        write_ready_ = false;
+        offloadWriteBlocked_ = true;
+        write_wait_mutex_.unlock();
+
+        ret = pal_stream_write(pal_stream_handle_, palBuffer);
+        if (ret < 0)
+            return written ? (ssize_t)written : ret;
+        written += ret;
+        if (written == bytes)
+            break;
+
+        offloadShortWrites_++;
+        AHAL_VERBOSE("short write %zd of %zu bytes", ret, palBuffer->size);
+        if (client_callback)
+            return written;
+
+        std::unique_lock<std::mutex> guard(write_wait_mutex_);
+        ready = write_condition_.wait_for(guard,
+                std::chrono::milliseconds(OFFLOAD_WRITE_READY_TIMEOUT_MS),
+                [this]() { return write_ready_; });
+        guard.unlock();
+        if (!ready) {
+            AHAL_ERR("no WRITE_READY within %dms, wrote %zu of %zu bytes",
+                     OFFLOAD_WRITE_READY_TIMEOUT_MS, written, bytes);
+            return written;
+        }
+        palBuffer->buffer += ret;
+        palBuffer->size -= ret;
+    }
+
+    write_wait_mutex_.lock();
+    offloadWriteBlocked_ = false;
+    write_wait_mutex_.unlock();
+    return written;
+}
+
 void StreamOutPrimary::UpdatemCachedPosition(uint64_t val)
 {
     mCachedPosition = val;
 }
 
-int StreamOutPrimary::Standby() {
+int StreamOutPrimary::Standby(bool forceClose) {
     int ret = 0;
+    int64_t idleUs = 0;
+    std::shared_ptr<AudioDevice> adevice = AudioDevice::GetInstance();
 
     AHAL_DBG("Enter");
     stream_mutex_.lock();
+    stats_.ResetInterval();
+    if (pal_stream_handle_ && !stream_started_ && warmBytes_ && !forceClose) {
+        AHAL_DBG("pal stream already kept warm");
+        goto exit;
+    }
     if (pal_stream_handle_) {
         if (streamAttributes_.type == PAL_STREAM_PCM_OFFLOAD) {
             /*
@@ -2295,15 +2537,29 @@ int StreamOutPrimary::Standby() {
 
     stream_started_ = false;
     stream_paused_ = false;
+    positionTracker_.SetRunning(false);
+    positionTracker_.Reset();
     sendGaplessMetadata = true;
+    AbortOffloadWaits();
     if (CheckOffloadEffectsType(streamAttributes_.type)) {
         ret = StopOffloadEffects(handle_, pal_stream_handle_);
         ret = StopOffloadVisualizer(handle_, pal_stream_handle_);
     }
 
+    /* keep the handle opened but stopped, the warm thread closes it if it stays idle */
+    if (pal_stream_handle_ && !ret && !forceClose &&
+        adevice->standbyPolicy.OnStandby(usecase_, CanKeepPalStreamWarm(),
+                (size_t)fragment_size_ * fragments_, &idleUs) != STANDBY_ACTION_CLOSE) {
+        AHAL_DBG("keeping pal stream opened in standby for %" PRId64 "us", idleUs);
+        warmBytes_ = (size_t)fragment_size_ * fragments_;
+        ArmWarmIdleClose(idleUs);
+        goto exit;
+    }
+
+    if (warmBytes_)
+        ReleaseWarmHandle(false);
     if (pal_stream_handle_) {
-        ret = pal_stream_close(pal_stream_handle_);
-        pal_stream_handle_ = NULL;
+        ret = ClosePalStream();
         if (usecase_ == USECASE_AUDIO_PLAYBACK_WITH_HAPTICS && pal_haptics_stream_handle) {
             ret = pal_stream_close(pal_haptics_stream_handle);
             pal_haptics_stream_handle = NULL;
@@ -2349,10 +2605,6 @@ exit:
 int StreamOutPrimary::RouteStream(const std::set<audio_devices_t>& new_devices, bool force_device_switch __unused) {
     int ret = 0, noPalDevices = 0;
     bool skipDeviceSet = false;
-    pal_device_id_t * deviceId = nullptr;
-    struct pal_device* deviceIdConfigs = nullptr;
-    pal_param_device_capability_t *device_cap_query = nullptr;
-    size_t payload_size = 0;
     dynamic_media_config_t dynamic_media_config;
     std::shared_ptr<AudioDevice> adevice = AudioDevice::GetInstance();
 
@@ -2363,6 +2615,8 @@ int StreamOutPrimary::RouteStream(const std::set<audio_devices_t>& new_devices,
     pal_param_bta2dp_t *param_bt_a2dp_ptr = nullptr;
     size_t bt_param_size = 0;
 
+    /* lets write() give up on the stream instead of stalling behind the switch */
+    routesInFlight_++;
     stream_mutex_.lock();
     if (!mInitialized) {
         AHAL_ERR("Not initialized, returning error");
@@ -2378,28 +2632,14 @@ int StreamOutPrimary::RouteStream(const std::set<audio_devices_t>& new_devices,
              mAndroidOutDevices.size());
 
     if (!AudioExtn::audio_devices_empty(new_devices)) {
-        // re-allocate mPalOutDevice and mPalOutDeviceIds
+        if (new_devices.size() > MAX_STREAM_DEVICES) {
+            AHAL_ERR("too many devices %zu, max %d", new_devices.size(), MAX_STREAM_DEVICES);
+            ret = -EINVAL;
+            goto done;
+        }
         if (new_devices.size() != mAndroidOutDevices.size()) {
-            deviceId = (pal_device_id_t*) realloc(mPalOutDeviceIds,
-                    new_devices.size() * sizeof(pal_device_id_t));
-            deviceIdConfigs = (struct pal_device*) realloc(mPalOutDevice,
-                    new_devices.size() * sizeof(struct pal_device));
-            if (!deviceId || !deviceIdConfigs) {
-                AHAL_ERR("Failed to allocate PalOutDeviceIds or deviceIdConfigs!");
-                if (deviceId)
-                    mPalOutDeviceIds = deviceId;
-                if (deviceIdConfigs)
-                    mPalOutDevice = deviceIdConfigs;
-                ret = -ENOMEM;
-                goto done;
-            }
-
-            // init deviceId and deviceIdConfigs
-            memset(deviceId, 0, new_devices.size() * sizeof(pal_device_id_t));
-            memset(deviceIdConfigs, 0, new_devices.size() * sizeof(struct pal_device));
-
-            mPalOutDeviceIds = deviceId;
-            mPalOutDevice = deviceIdConfigs;
+            memset(mPalOutDeviceIds, 0, sizeof(mPalOutDeviceIds));
+            memset(mPalOutDevice, 0, sizeof(mPalOutDevice));
         }
 
         noPalDevices = getPalDeviceIds(new_devices, mPalOutDeviceIds);
@@ -2414,18 +2654,11 @@ int StreamOutPrimary::RouteStream(const std::set<audio_devices_t>& new_devices,
             goto done;
         }
 
-        device_cap_query = (pal_param_device_capability_t *)
-                malloc(sizeof(pal_param_device_capability_t));
-        if (!device_cap_query) {
-                AHAL_ERR("Failed to allocate device_cap_query!");
-                ret = -ENOMEM;
-                goto done;
-        }
-
         ret = pal_get_param(PAL_PARAM_ID_HIFI_PCM_FILTER,
                             (void **)&payload_hifiFilter, &param_size, nullptr);
 
-        mAndroidOutDevices = new_devices;
+        if (mAndroidOutDevices != new_devices)
+            mAndroidOutDevices = new_devices;
 
         for (int i = 0; i < noPalDevices; i++) {
             /*Skip device set for Handset profile for targets that do not support Handset profile for VoIP call*/
@@ -2442,17 +2675,12 @@ int StreamOutPrimary::RouteStream(const std::set<audio_devices_t>& new_devices,
             mPalOutDevice[i].config.ch_info = {0, {0}};
             mPalOutDevice[i].config.aud_fmt_id = PAL_AUDIO_FMT_PCM_S16_LE;
             if (((mPalOutDeviceIds[i] == PAL_DEVICE_OUT_USB_DEVICE) ||
-               (mPalOutDeviceIds[i] == PAL_DEVICE_OUT_USB_HEADSET)) && device_cap_query) {
+               (mPalOutDeviceIds[i] == PAL_DEVICE_OUT_USB_HEADSET))) {
 
                 mPalOutDevice[i].address.card_id = adevice->usb_card_id_;
                 mPalOutDevice[i].address.device_num = adevice->usb_dev_num_;
-                device_cap_query->id = mPalOutDeviceIds[i];
-                device_cap_query->addr.card_id = adevice->usb_card_id_;
-                device_cap_query->addr.device_num = adevice->usb_dev_num_;
-                device_cap_query->config = &dynamic_media_config;
-                device_cap_query->is_playback = true;
-                ret = pal_get_param(PAL_PARAM_ID_DEVICE_CAPABILITY,(void **)&device_cap_query,
-                        &payload_size, nullptr);
+                ret = adevice->GetDeviceCapability(mPalOutDeviceIds[i], adevice->usb_card_id_,
+                        adevice->usb_dev_num_, true, &dynamic_media_config);
 
                 if (ret<0){
                     AHAL_ERR("Error usb device is not connected");
@@ -2474,7 +2702,7 @@ int StreamOutPrimary::RouteStream(const std::set<audio_devices_t>& new_devices,
 
             if (((AudioExtn::audio_devices_cmp(mAndroidOutDevices, AUDIO_DEVICE_OUT_SPEAKER)) &&
                                    (mPalOutDeviceIds[i] == PAL_DEVICE_OUT_SPEAKER)) &&
-                                    property_get_bool("vendor.audio.mspp.enable", false)) {
+                                    AudioHalConfig::GetBool(HAL_CONFIG_MSPP_ENABLE)) {
                 strlcpy(mPalOutDevice[i].custom_config.custom_key, "mspp",
                         sizeof(mPalOutDevice[i].custom_config.custom_key));
                 AHAL_INFO("Setting custom key as %s", mPalOutDevice[i].custom_config.custom_key);
@@ -2541,11 +2769,9 @@ int StreamOutPrimary::RouteStream(const std::set<audio_devices_t>& new_devices,
     }
 
 done:
-    if (device_cap_query) {
-        free(device_cap_query);
-        device_cap_query = NULL;
-    }
+    InvalidateBtEncoderLatency();
     stream_mutex_.unlock();
+    routesInFlight_--;
     AHAL_DBG("exit %d", ret);
     return ret;
 }
@@ -2592,6 +2818,14 @@ int StreamOutPrimary::SetParameters(struct str_parms *parms) {
             gaplessMeta.encoderPadding = atoi(value);
             AHAL_DBG("padding %u", gaplessMeta.encoderPadding);
         }
+
+        /*
+         * A running compress session cannot be resized, a next track with
+         * another bitrate gets its fragment size when the session reopens.
+         */
+        if (fragment_size_ && get_compressed_buffer_size() != (int)fragment_size_)
+            AHAL_INFO("fragment size %u -> %d from the next open, bit rate %u",
+                      fragment_size_, get_compressed_buffer_size(), GetCompressBitRate());
     }
 
 error:
@@ -2599,61 +2833,143 @@ error:
     return ret;
 }
 
+void StreamOutPrimary::FillVolumePayload(float left, float right,
+                                         struct pal_volume_payload *volume) {
+    memset(volume, 0, sizeof(*volume));
+    if (audio_channel_count_from_out_mask(config_.channel_mask) == 1) {
+        volume->no_of_volpair = 1;
+        volume->volume_pair[0].channel_mask = 0x03;
+
+        if (config_.channel_mask == 0x1)
+            volume->volume_pair[0].vol = left;
+        else if (config_.channel_mask == 0x2)
+            volume->volume_pair[0].vol = right;
+        else
+            volume->volume_pair[0].vol = (left + right)/2.0;
+    } else {
+        volume->no_of_volpair = 2;
+        volume->volume_pair[0].channel_mask = 0x01;
+        volume->volume_pair[0].vol = left;
+        volume->volume_pair[1].channel_mask = 0x02;
+        volume->volume_pair[1].vol = right;
+    }
+}
+
+/*
+ * Only records the new volume, it is sent to PAL by the control worker so
+ * the caller never waits on stream_mutex_ behind a write. Requests coming
+ * faster than VOLUME_APPLY_PERIOD_US are coalesced into the latest one.
+ * A stream that is not opened only caches the volume, it is set on open, and
+ * this still returns 0. Errors are returned for NaN or out of range values
+ * and when the audio device is not available.
+ */
 int StreamOutPrimary::SetVolume(float left , float right) {
-    int ret = 0;
+    std::shared_ptr<AudioDevice> adevice = AudioDevice::GetInstance();
+    int32_t rampMs = AudioHalConfig::GetInt(HAL_CONFIG_VOLUME_RAMP_MS);
+    int64_t nowUs = StreamStats::NowUs();
+    int64_t delayUs = 0;
 
     AHAL_DBG("Enter: left %f, right %f for usecase(%d: %s)", left, right, GetUseCase(), use_case_table[GetUseCase()]);
 
-    stream_mutex_.lock();
-    /* free previously cached volume if any */
-    if (volume_) {
-        free(volume_);
-        volume_ = NULL;
+    /* also rejects NaN */
+    if (!(left >= 0.0f && left <= 1.0f && right >= 0.0f && right <= 1.0f)) {
+        AHAL_ERR("invalid volume left %f right %f", left, right);
+        return -EINVAL;
+    }
+    if (!adevice) {
+        AHAL_ERR("unable to get audio device");
+        return -EINVAL;
     }
 
-    if (audio_channel_count_from_out_mask(config_.channel_mask) == 1) {
-        volume_ = (struct pal_volume_data *)calloc(1, sizeof(struct pal_volume_data)
-                +sizeof(struct pal_channel_vol_kv));
-        if (!volume_) {
-            AHAL_ERR("Failed to allocate mem for volume_");
-            ret = -ENOMEM;
-            goto done;
-        }
-        volume_->no_of_volpair = 1;
-        volume_->volume_pair[0].channel_mask = 0x03;
-
-        if (config_.channel_mask == 0x1)
-            volume_->volume_pair[0].vol = left;
-        else if (config_.channel_mask == 0x2)
-            volume_->volume_pair[0].vol = right;
-        else
-            volume_->volume_pair[0].vol = (left + right)/2.0;
+    volume_mutex_.lock();
+    /* cached for the next open, a stream that is not playing does not ramp */
+    FillVolumePayload(left, right, &volume_);
+    if (rampMs > 0 && volumeLevelValid_) {
+        volumeRampFrom_[0] = volumeLevel_[0];
+        volumeRampFrom_[1] = volumeLevel_[1];
+        volumeRampStartUs_ = nowUs;
+        volumeRampEndUs_ = nowUs + rampMs * 1000LL;
     } else {
-        volume_ = (struct pal_volume_data *)calloc(1, sizeof(struct pal_volume_data)
-                    +sizeof(struct pal_channel_vol_kv) * 2);
-        if (!volume_) {
-            AHAL_ERR("Failed to allocate mem for volume_");
-            ret = -ENOMEM;
-            goto done;
-        }
-        volume_->no_of_volpair = 2;
-        volume_->volume_pair[0].channel_mask = 0x01;
-        volume_->volume_pair[0].vol = left;
-        volume_->volume_pair[1].channel_mask = 0x02;
-        volume_->volume_pair[1].vol = right;
+        volumeRampEndUs_ = 0;
     }
+    volumeTarget_[0] = left;
+    volumeTarget_[1] = right;
+    if (volumeAppliedUs_ + VOLUME_APPLY_PERIOD_US > nowUs)
+        delayUs = volumeAppliedUs_ + VOLUME_APPLY_PERIOD_US - nowUs;
+    volume_mutex_.unlock();
 
-    /* if stream is not opened already cache the volume and set on open */
-    if (pal_stream_handle_) {
-        ret = pal_stream_set_volume(pal_stream_handle_, volume_);
+    if (!palOpened_) {
+        AHAL_DBG("stream not opened, volume cached");
+        return 0;
+    }
+
+    adevice->controlWorker.Post(this, CONTROL_TASK_VOLUME, [this]() { ApplyVolume(); }, delayUs);
+    return 0;
+}
+
+/*
+ * Runs on the control worker. The handle is sampled under stream_mutex_ but
+ * used under handle_mutex_ only, so a write never waits for PAL to apply the
+ * volume, while standby and close wait for it before closing the handle.
+ */
+void StreamOutPrimary::ApplyVolume() {
+    std::shared_ptr<AudioDevice> adevice = AudioDevice::GetInstance();
+    struct pal_volume_payload volume;
+    pal_stream_handle_t *palHandle = nullptr;
+    bool started = false;
+    float left = 0, right = 0, frac = 0;
+    bool ramping = false;
+    int64_t nowUs = 0;
+    int ret = 0;
+
+    stream_mutex_.lock();
+    palHandle = pal_stream_handle_;
+    started = stream_started_;
+    handle_mutex_.lock();
+    stream_mutex_.unlock();
+
+    volume_mutex_.lock();
+    nowUs = StreamStats::NowUs();
+    if (palHandle && started && nowUs < volumeRampEndUs_) {
+        frac = (float)(nowUs - volumeRampStartUs_) / (volumeRampEndUs_ - volumeRampStartUs_);
+        left = volumeRampFrom_[0] + (volumeTarget_[0] - volumeRampFrom_[0]) * frac;
+        right = volumeRampFrom_[1] + (volumeTarget_[1] - volumeRampFrom_[1]) * frac;
+        ramping = true;
+    } else {
+        left = volumeTarget_[0];
+        right = volumeTarget_[1];
+        volumeRampEndUs_ = 0;
+    }
+    FillVolumePayload(left, right, &volume);
+    volumeLevel_[0] = left;
+    volumeLevel_[1] = right;
+    volumeLevelValid_ = true;
+    volumeAppliedUs_ = nowUs;
+    volume_mutex_.unlock();
+
+    /* if stream is not opened already the cached volume is set on open */
+    if (palHandle) {
+        ret = pal_stream_set_volume(palHandle, pal_volume(&volume));
         if (ret) {
             AHAL_ERR("Pal Stream volume Error (%x)", ret);
         }
     }
+    handle_mutex_.unlock();
 
-done:
-    stream_mutex_.unlock();
-    AHAL_DBG("Exit ret: %d", ret);
+    if (ramping)
+        adevice->controlWorker.Post(this, CONTROL_TASK_VOLUME, [this]() { ApplyVolume(); },
+                                    VOLUME_APPLY_PERIOD_US);
+}
+
+/* called with stream_mutex_ held, waits for ApplyVolume() to be done with the handle */
+int StreamOutPrimary::ClosePalStream() {
+    int ret = 0;
+
+    handle_mutex_.lock();
+    ret = pal_stream_close(pal_stream_handle_);
+    pal_stream_handle_ = NULL;
+    palOpened_ = false;
+    handle_mutex_.unlock();
     return ret;
 }
 
@@ -2689,10 +3005,12 @@ uint64_t StreamOutPrimary::GetFramesWritten(struct timespec *timestamp)
     uint64_t kernel_frames = 0;
     uint64_t dsp_frames = 0;
     uint64_t bt_extra_frames = 0;
-    size_t size = 0, kernel_buffer_size = 0;
+    size_t kernel_buffer_size = 0;
+    int32_t bt_latency = 0;
     int32_t ret;
 
     stream_mutex_.lock();
+    AccountDroppedWrites();
     /* This adjustment accounts for buffering after app processor
      * It is based on estimated DSP latency per use case, rather than exact.
      */
@@ -2720,26 +3038,12 @@ uint64_t StreamOutPrimary::GetFramesWritten(struct timespec *timestamp)
 
     // Adjustment accounts for A2dp encoder latency with non offload usecases
     // Note: Encoder latency is returned in ms, while platform_render_latency in us.
-    pal_param_bta2dp_t *param_bt_a2dp_ptr, param_bt_a2dp;
-    param_bt_a2dp_ptr = &param_bt_a2dp;
-
-    if (isDeviceAvailable(PAL_DEVICE_OUT_BLUETOOTH_A2DP)) {
-        param_bt_a2dp_ptr->dev_id = PAL_DEVICE_OUT_BLUETOOTH_A2DP;
-    } else if (isDeviceAvailable(PAL_DEVICE_OUT_BLUETOOTH_BLE)) {
-        param_bt_a2dp_ptr->dev_id = PAL_DEVICE_OUT_BLUETOOTH_BLE;
-    } else if (isDeviceAvailable(PAL_DEVICE_OUT_BLUETOOTH_BLE_BROADCAST)) {
-        param_bt_a2dp_ptr->dev_id = PAL_DEVICE_OUT_BLUETOOTH_BLE_BROADCAST;
-    } else {
-        goto exit;
-    }
-    ret = pal_get_param(PAL_PARAM_ID_BT_A2DP_ENCODER_LATENCY,
-        (void**)&param_bt_a2dp_ptr, &size, nullptr);
-    if (!ret && size && param_bt_a2dp_ptr && param_bt_a2dp_ptr->latency) {
-        bt_extra_frames = param_bt_a2dp_ptr->latency *
+    bt_latency = GetBtEncoderLatency();
+    if (bt_latency > 0) {
+        bt_extra_frames = bt_latency *
             (streamAttributes_.out_media_config.sample_rate) / 1000;
         if (signed_frames >= bt_extra_frames)
             signed_frames -= bt_extra_frames;
-
     }
 
 exit:
@@ -2784,14 +3088,43 @@ exit:
     return signed_frames;
 }
 
+/* bits per second of the compressed stream, 0 if unknown */
+uint32_t StreamOutPrimary::GetCompressBitRate()
+{
+    uint32_t channels = audio_channel_count_from_out_mask(config_.offload_info.channel_mask);
+    uint32_t bitWidth = config_.offload_info.bit_width ? config_.offload_info.bit_width : 16;
+
+    if (config_.offload_info.bit_rate)
+        return config_.offload_info.bit_rate;
+    if (config_.format == AUDIO_FORMAT_ALAC && palSndDec.alac_dec.avg_bit_rate)
+        return palSndDec.alac_dec.avg_bit_rate;
+    /* lossless streams are at most their PCM rate */
+    if (config_.format == AUDIO_FORMAT_FLAC || config_.format == AUDIO_FORMAT_ALAC ||
+        config_.format == AUDIO_FORMAT_APE)
+        return config_.offload_info.sample_rate * channels * bitWidth;
+
+    return 0;
+}
+
 int StreamOutPrimary::get_compressed_buffer_size()
 {
-    char value[PROPERTY_VALUE_MAX] = {0};
     int fragment_size = COMPRESS_OFFLOAD_FRAGMENT_SIZE;
     int fsize = 0;
+    int32_t wakeupMs = AudioHalConfig::GetInt(HAL_CONFIG_OFFLOAD_WAKEUP_INTERVAL_MS);
+    uint32_t bitRate = GetCompressBitRate();
 
     AHAL_DBG("config_ %x", config_.format);
-    if(config_.format ==  AUDIO_FORMAT_FLAC ) {
+    if (wakeupMs > 0 && bitRate) {
+        /* the AP is woken up about once per fragment the DSP consumes */
+        fragment_size = ALIGN((uint64_t)bitRate / 8 * wakeupMs / 1000,
+                              COMPRESS_OFFLOAD_FRAGMENT_ALIGN);
+        if (fragment_size < COMPRESS_OFFLOAD_FRAGMENT_SIZE_MIN)
+            fragment_size = COMPRESS_OFFLOAD_FRAGMENT_SIZE_MIN;
+        else if (fragment_size > COMPRESS_OFFLOAD_FRAGMENT_SIZE_MAX)
+            fragment_size = COMPRESS_OFFLOAD_FRAGMENT_SIZE_MAX;
+        AHAL_DBG("bit rate %u, wakeup interval %dms, buffer size:%d",
+            bitRate, wakeupMs, fragment_size);
+    } else if(config_.format ==  AUDIO_FORMAT_FLAC ) {
         fragment_size = FLAC_COMPRESS_OFFLOAD_FRAGMENT_SIZE;
         AHAL_DBG("aud_fmt_id: 0x%x  FLAC buffer size:%d",
             streamAttributes_.out_media_config.aud_fmt_id,
@@ -2800,10 +3133,7 @@ int StreamOutPrimary::get_compressed_buffer_size()
         fragment_size =  COMPRESS_OFFLOAD_FRAGMENT_SIZE;
     }
 
-    if((property_get("vendor.audio.offload.buffer.size.kb", value, "")) &&
-            atoi(value)) {
-        fsize = atoi(value) * 1024;
-    }
+    fsize = AudioHalConfig::GetInt(HAL_CONFIG_OFFLOAD_BUFFER_SIZE_KB) * 1024;
     if (fsize > fragment_size)
         fragment_size = fsize;
 
@@ -2864,14 +3194,11 @@ bool StreamOutPrimary:: period_size_is_plausible_for_low_latency(int period_size
 
 uint32_t StreamOutPrimary::GetBufferSizeForLowLatency() {
     int trial = 0;
-    char value[PROPERTY_VALUE_MAX] = {0};
     int configured_low_latency_period_size = LOW_LATENCY_PLAYBACK_PERIOD_SIZE;
 
-    if (property_get("vendor.audio_hal.period_size", value, NULL) > 0) {
-        trial = atoi(value);
-        if (period_size_is_plausible_for_low_latency(trial))
-            configured_low_latency_period_size = trial;
-    }
+    trial = AudioHalConfig::GetInt(HAL_CONFIG_LOW_LATENCY_PERIOD_SIZE);
+    if (period_size_is_plausible_for_low_latency(trial))
+        configured_low_latency_period_size = trial;
 
     return configured_low_latency_period_size *
            audio_bytes_per_frame(
@@ -2921,10 +3248,10 @@ int StreamOutPrimary::Open() {
     struct pal_channel_info ch_info = {0, {0}};
     uint32_t outBufSize = 0;
     uint32_t outBufCount = NO_OF_BUF;
+    uint32_t frameSize = 0;
     struct pal_buffer_config outBufCfg = {0, 0, 0};
+    struct pal_volume_payload volume;
 
-    pal_param_device_capability_t *device_cap_query = NULL;
-    size_t payload_size = 0;
     dynamic_media_config_t dynamic_media_config;
     std::shared_ptr<AudioDevice> adevice = AudioDevice::GetInstance();
 
@@ -3037,18 +3364,11 @@ int StreamOutPrimary::Open() {
                 sizeof(mPalOutDevice->custom_config.custom_key));
     }
 
-    device_cap_query = (pal_param_device_capability_t *)malloc(sizeof(pal_param_device_capability_t));
-
     if ((mPalOutDevice->id == PAL_DEVICE_OUT_USB_DEVICE || mPalOutDevice->id ==
-        PAL_DEVICE_OUT_USB_HEADSET) && device_cap_query && adevice) {
+        PAL_DEVICE_OUT_USB_HEADSET) && adevice) {
 
-        device_cap_query->id = mPalOutDevice->id;
-        device_cap_query->addr.card_id = adevice->usb_card_id_;
-        device_cap_query->addr.device_num = adevice->usb_dev_num_;
-        device_cap_query->config = &dynamic_media_config;
-        device_cap_query->is_playback = true;
-        ret = pal_get_param(PAL_PARAM_ID_DEVICE_CAPABILITY,(void **)&device_cap_query,
-                &payload_size, nullptr);
+        ret = adevice->GetDeviceCapability(mPalOutDevice->id, adevice->usb_card_id_,
+                adevice->usb_dev_num_, true, &dynamic_media_config);
 
         if (ret<0) {
             AHAL_DBG("Error usb device is not connected");
@@ -3108,11 +3428,15 @@ int StreamOutPrimary::Open() {
         ret = -EINVAL;
         goto error_open;
     }
+    palOpened_ = true;
 
     /* set cached volume if any, dont return failure back up */
-    if (volume_) {
-        AHAL_DBG("set cached volume (%f)", volume_->volume_pair[0].vol);
-        ret = pal_stream_set_volume(pal_stream_handle_, volume_);
+    volume_mutex_.lock();
+    volume = volume_;
+    volume_mutex_.unlock();
+    if (volume.no_of_volpair) {
+        AHAL_DBG("set cached volume (%f)", volume.volume_pair[0].vol);
+        ret = pal_stream_set_volume(pal_stream_handle_, pal_volume(&volume));
         if (ret) {
             AHAL_ERR("Pal Stream volume Error (%x)", ret);
         }
@@ -3227,17 +3551,25 @@ int StreamOutPrimary::Open() {
         outBufCount = SPATIAL_PLAYBACK_PERIOD_COUNT;
 
     if (halInputFormat != halOutputFormat) {
-        convertBuffer = realloc(convertBuffer, outBufSize);
-        if (!convertBuffer) {
-            ret = -ENOMEM;
-            AHAL_ERR("convert Buffer allocation failed. ret %d", ret);
+        /* converted chunks are at most one PAL buffer */
+        ret = formatConverter.Configure(halInputFormat, halOutputFormat,
+                    audio_channel_count_from_out_mask(config_.channel_mask),
+                    (outBufSize / audio_bytes_per_sample(halInputFormat)) *
+                        audio_bytes_per_sample(halOutputFormat),
+                    AudioHalConfig::GetBool(HAL_CONFIG_OUTPUT_DITHER_ENABLE) ?
+                        FORMAT_CONVERTER_DITHER_TPDF : FORMAT_CONVERTER_DITHER_NONE);
+        if (ret) {
+            AHAL_ERR("format converter configuration failed. ret %d", ret);
             goto error_open;
         }
-        AHAL_DBG("convert buffer allocated for size %d", convertBufSize);
     }
 
     fragment_size_ = outBufSize;
     fragments_ = outBufCount;
+    frameSize = audio_bytes_per_frame(audio_channel_count_from_out_mask(config_.channel_mask),
+                                      config_.format);
+    if (streamAttributes_.type != PAL_STREAM_COMPRESSED && frameSize && config_.sample_rate)
+        stats_.SetPeriodUs((int64_t)fragment_size_ * 1000000LL / frameSize / config_.sample_rate);
 
     AHAL_DBG("fragment_size_ %d fragments_ %d", fragment_size_, fragments_);
     outBufCfg.buf_size = fragment_size_;
@@ -3262,75 +3594,139 @@ int StreamOutPrimary::Open() {
         if (ret) {
             AHAL_ERR("Pal Stream set buffer size Error  (%x)", ret);
         }
+
+        /*
+         * outBufSize counts haptics channels only, so this is one period of
+         * the haptics share: period bytes * haptics channels / total channels.
+         * Reused by every write, larger writes are split into periods.
+         */
+        if (hapticsBufSize < outBufSize) {
+            if (hapticBuffer)
+                free(hapticBuffer);
+            hapticsBufSize = 0;
+            hapticBuffer = (uint8_t *)calloc(1, outBufSize);
+            if (!hapticBuffer) {
+                ret = -ENOMEM;
+                AHAL_ERR("Failed to allocate mem for haptic buffer");
+                goto error_open;
+            }
+            hapticsBufSize = outBufSize;
+        }
     }
 
 error_open:
-    if (device_cap_query) {
-        free(device_cap_query);
-        device_cap_query = NULL;
-    }
     AHAL_DBG("Exit ret: %d", ret);
     return ret;
 }
 
 
-int StreamOutPrimary::GetFrames(uint64_t *frames)
+/*
+ * Queries the DSP session time and feeds it to the position model. The
+ * sample is stamped with the midpoint of the call rather than the time
+ * after it returned.
+ */
+int StreamOutPrimary::ReadDspFrames(uint64_t *dspFrames, int64_t *sampleNs)
 {
     int ret = 0;
     pal_session_time tstamp;
     uint64_t timestamp = 0;
-    uint64_t dsp_frames = 0;
-    uint64_t offset = 0;
-    size_t size = 0;
-
-    if (!pal_stream_handle_) {
-        AHAL_VERBOSE("pal_stream_handle_ NULL");
-        *frames = 0;
-        return 0;
-    }
-    if (!stream_started_) {
-        AHAL_VERBOSE("stream not in started state");
-        *frames = 0;
-        return 0;
-    }
+    int64_t before = 0;
 
+    before = PositionTracker::NowNs();
     ret = pal_get_timestamp(pal_stream_handle_, &tstamp);
     if (ret != 0) {
        AHAL_ERR("pal_get_timestamp failed %d", ret);
-       goto exit;
+       return ret;
     }
+    *sampleNs = before + (PositionTracker::NowNs() - before) / 2;
+
     timestamp = (uint64_t)tstamp.session_time.value_msw;
     timestamp = timestamp  << 32 | tstamp.session_time.value_lsw;
     AHAL_VERBOSE("session msw %u", tstamp.session_time.value_msw);
     AHAL_VERBOSE("session lsw %u", tstamp.session_time.value_lsw);
     AHAL_VERBOSE("session timespec %lld", ((long long) timestamp));
-    dsp_frames = timestamp / 1000
+    *dspFrames = timestamp / 1000
                  * streamAttributes_.out_media_config.sample_rate / 1000;
+    positionTracker_.AddSample(*dspFrames, *sampleNs);
+    return 0;
+}
+
+uint64_t StreamOutPrimary::ToPresentedFrames(uint64_t dspFrames)
+{
+    uint64_t offset = 0;
+    int32_t bt_latency = 0;
 
     // Adjustment accounts for A2dp encoder latency with offload usecases
     // Note: Encoder latency is returned in ms.
-    pal_param_bta2dp_t* param_bt_a2dp_ptr, param_bt_a2dp;
-    param_bt_a2dp_ptr = &param_bt_a2dp;
+    bt_latency = GetBtEncoderLatency();
+    if (bt_latency > 0) {
+        offset = bt_latency *
+            (streamAttributes_.out_media_config.sample_rate) / 1000;
+        dspFrames = (dspFrames > offset) ? (dspFrames - offset) : 0;
+    }
 
-    if (isDeviceAvailable(PAL_DEVICE_OUT_BLUETOOTH_A2DP)) {
-        param_bt_a2dp_ptr->dev_id = PAL_DEVICE_OUT_BLUETOOTH_A2DP;
-    } else if (isDeviceAvailable(PAL_DEVICE_OUT_BLUETOOTH_BLE)) {
-        param_bt_a2dp_ptr->dev_id = PAL_DEVICE_OUT_BLUETOOTH_BLE;
-    } else if (isDeviceAvailable(PAL_DEVICE_OUT_BLUETOOTH_BLE_BROADCAST)) {
-        param_bt_a2dp_ptr->dev_id = PAL_DEVICE_OUT_BLUETOOTH_BLE_BROADCAST;
-    } else {
-        goto done;
+    return dspFrames + mCachedPosition;
+}
+
+int StreamOutPrimary::GetFrames(uint64_t *frames)
+{
+    int ret = 0;
+    uint64_t dsp_frames = 0;
+    int64_t sample_ns = 0;
+
+    if (!pal_stream_handle_) {
+        AHAL_VERBOSE("pal_stream_handle_ NULL");
+        *frames = 0;
+        return 0;
     }
-    ret = pal_get_param(PAL_PARAM_ID_BT_A2DP_ENCODER_LATENCY,
-        (void**)&param_bt_a2dp_ptr, &size, nullptr);
-    if (!ret && size && param_bt_a2dp_ptr && param_bt_a2dp_ptr->latency) {
-        offset = param_bt_a2dp_ptr->latency *
-            (streamAttributes_.out_media_config.sample_rate) / 1000;
-        dsp_frames = (dsp_frames > offset) ? (dsp_frames - offset) : 0;
+    if (!stream_started_) {
+        AHAL_VERBOSE("stream not in started state");
+        *frames = 0;
+        return 0;
     }
-done:
-    *frames = dsp_frames + mCachedPosition;
+
+    ret = ReadDspFrames(&dsp_frames, &sample_ns);
+    if (ret != 0)
+        goto exit;
+
+    *frames = ToPresentedFrames(dsp_frames);
+exit:
+    return ret;
+}
+
+/*
+ * Position for get_presentation_position. The DSP is queried at most once
+ * per POSITION_TRACKER_SAMPLE_INTERVAL_NS, other calls are answered from
+ * the position model at the current time.
+ */
+int StreamOutPrimary::GetPresentationFrames(uint64_t *frames, struct timespec *timestamp)
+{
+    int ret = 0;
+    uint64_t dsp_frames = 0;
+    int64_t now_ns = PositionTracker::NowNs();
+
+    if (!pal_stream_handle_ || !stream_started_) {
+        AHAL_VERBOSE("stream not in started state");
+        *frames = 0;
+        goto exit;
+    }
+
+    if (positionTracker_.NeedsSample(now_ns)) {
+        ret = ReadDspFrames(&dsp_frames, &now_ns);
+        if (ret != 0)
+            return ret;
+    }
+    if (!positionTracker_.GetPosition(now_ns, &dsp_frames)) {
+        /* model dropped by a concurrent state change, report the raw sample */
+        ret = ReadDspFrames(&dsp_frames, &now_ns);
+        if (ret != 0)
+            return ret;
+    }
+
+    *frames = ToPresentedFrames(dsp_frames);
 exit:
+    timestamp->tv_sec = now_ns / 1000000000LL;
+    timestamp->tv_nsec = now_ns % 1000000000LL;
     return ret;
 }
 
@@ -3366,70 +3762,62 @@ int StreamOutPrimary::GetOutputUseCase(audio_output_flags_t halStreamFlags)
 ssize_t StreamOutPrimary::splitAndWriteAudioHapticsStream(const void *buffer, size_t bytes)
 {
      ssize_t ret = 0;
-     bool allocHapticsBuffer = false;
      struct pal_buffer audioBuf;
      struct pal_buffer hapticBuf;
-     size_t srcIndex = 0, audIndex = 0, hapIndex = 0;
+     uint8_t *src = (uint8_t *)buffer;
      uint8_t channelCount = audio_channel_count_from_out_mask(config_.channel_mask);
      uint8_t bytesPerSample = audio_bytes_per_sample(config_.format);
      uint32_t frameSize = channelCount * bytesPerSample;
      uint32_t frameCount = bytes / frameSize;
+     uint32_t maxFrames = 0, chunkFrames = 0;
 
-     // Calculate Haptics Buffer size
      uint8_t hapticsChannelCount = hapticsStreamAttributes.out_media_config.ch_info.channels;
      uint32_t hapticsFrameSize = bytesPerSample * hapticsChannelCount;
      uint32_t audioFrameSize = frameSize - hapticsFrameSize;
-     uint32_t totalHapticsBufferSize = frameCount * hapticsFrameSize;
-
-     if (!hapticBuffer) {
-         allocHapticsBuffer = true;
-     } else if (hapticsBufSize < totalHapticsBufferSize) {
-         if (hapticBuffer)
-             free (hapticBuffer);
-         allocHapticsBuffer = true;
-         hapticsBufSize = 0;
-     }
 
-     if (allocHapticsBuffer) {
-         hapticBuffer = (uint8_t *)calloc(1, totalHapticsBufferSize);
-         if(!hapticBuffer) {
-             AHAL_ERR("Failed to allocate mem for haptic buffer");
-             return -ENOMEM;
-         }
-         hapticsBufSize = totalHapticsBufferSize;
+     /* haptic buffer is sized for one fragment at Open() */
+     if (!hapticBuffer || hapticsFrameSize == 0 || hapticsBufSize < hapticsFrameSize) {
+         AHAL_ERR("haptic buffer not allocated");
+         return -EINVAL;
      }
+     maxFrames = hapticsBufSize / hapticsFrameSize;
 
-     audioBuf.buffer = (uint8_t *)buffer;
-     audioBuf.size = frameCount * audioFrameSize;
      audioBuf.offset = 0;
-     hapticBuf.buffer  = hapticBuffer;
-     hapticBuf.size = frameCount * hapticsFrameSize;
      hapticBuf.offset = 0;
-
-     for (size_t i = 0; i < frameCount; i++) {
-         memcpy((uint8_t *)(audioBuf.buffer) + audIndex, (uint8_t *)(audioBuf.buffer) + srcIndex,
-                audioFrameSize);
-         audIndex += audioFrameSize;
-         srcIndex += audioFrameSize;
-
-         memcpy((uint8_t *)(hapticBuf.buffer) + hapIndex, (uint8_t *)(audioBuf.buffer) + srcIndex,
-                    hapticsFrameSize);
-         hapIndex += hapticsFrameSize;
-         srcIndex += hapticsFrameSize;
+     hapticBuf.buffer = hapticBuffer;
+
+     /* writes larger than a fragment are split instead of growing the buffer */
+     while (frameCount > 0) {
+         chunkFrames = frameCount < maxFrames ? frameCount : maxFrames;
+         deinterleave_audio_haptics(src, hapticBuffer, src, chunkFrames,
+                                    bytesPerSample, channelCount - hapticsChannelCount,
+                                    hapticsChannelCount);
+
+         // write audio data
+         audioBuf.buffer = src;
+         audioBuf.size = chunkFrames * audioFrameSize;
+         ret = pal_stream_write(pal_stream_handle_, &audioBuf);
+         if (ret < 0)
+             break;
+
+         // write haptics data
+         hapticBuf.size = chunkFrames * hapticsFrameSize;
+         ret = pal_stream_write(pal_haptics_stream_handle, &hapticBuf);
+         if (ret < 0)
+             break;
+
+         src += chunkFrames * frameSize;
+         frameCount -= chunkFrames;
      }
 
-     // write audio data
-     ret = pal_stream_write(pal_stream_handle_, &audioBuf);
-     // write haptics data
-     ret = pal_stream_write(pal_haptics_stream_handle, &hapticBuf);
-
      return (ret < 0 ? ret : bytes);
 }
 
 ssize_t StreamOutPrimary::onWriteError(size_t bytes, ssize_t ret) {
     // standby streams upon write failures and sleep for buffer duration.
     AHAL_ERR("write error %d usecase(%d: %s)", ret, GetUseCase(), use_case_table[GetUseCase()]);
-    Standby();
+    stats_.ioErrors++;
+    Standby(true);
 
     if (streamAttributes_.type != PAL_STREAM_COMPRESSED) {
         uint32_t byteWidth = streamAttributes_.out_media_config.bit_width / 8;
@@ -3451,26 +3839,34 @@ ssize_t StreamOutPrimary::onWriteError(size_t bytes, ssize_t ret) {
 
 ssize_t StreamOutPrimary::configurePalOutputStream() {
     ssize_t ret = 0;
+    bool warm = pal_stream_handle_ != NULL;
+    int64_t openStartUs = 0;
+    std::shared_ptr<AudioDevice> adevice = AudioDevice::GetInstance();
+
     if (!pal_stream_handle_) {
         AutoPerfLock perfLock;
         ATRACE_BEGIN("hal:open_output");
+        openStartUs = StreamStats::NowUs();
         ret = Open();
         ATRACE_END();
         if (ret) {
             AHAL_ERR("failed to open stream.");
             return -EINVAL;
         }
+        adevice->standbyPolicy.OnOpen(usecase_, StreamStats::NowUs() - openStartUs);
     }
 
     if (!stream_started_) {
         AutoPerfLock perfLock;
 
+        if (warmBytes_)
+            ReleaseWarmHandle(true);
+
         ATRACE_BEGIN("hal: pal_stream_start");
         ret = pal_stream_start(pal_stream_handle_);
         if (ret) {
             AHAL_ERR("failed to start stream. ret=%d", ret);
-            pal_stream_close(pal_stream_handle_);
-            pal_stream_handle_ = NULL;
+            ClosePalStream();
             ATRACE_END();
             if (usecase_ == USECASE_AUDIO_PLAYBACK_WITH_HAPTICS &&
                 pal_haptics_stream_handle) {
@@ -3506,6 +3902,11 @@ ssize_t StreamOutPrimary::configurePalOutputStream() {
             }
         }
         stream_started_ = true;
+        adevice->standbyPolicy.OnStart(usecase_, warm);
+        InvalidateBtEncoderLatency();
+        positionTracker_.Configure(streamAttributes_.out_media_config.sample_rate,
+                                   POSITION_TRACKER_SAMPLE_INTERVAL_NS);
+        positionTracker_.SetRunning(true);
 
         if (CheckOffloadEffectsType(streamAttributes_.type)) {
             ret = StartOffloadEffects(handle_, pal_stream_handle_);
@@ -3571,7 +3972,6 @@ ssize_t StreamOutPrimary::write(const void *buffer, size_t bytes)
 {
     ssize_t ret = 0;
     struct pal_buffer palBuffer;
-    uint32_t frames;
 
     palBuffer.buffer = (uint8_t*)buffer;
     palBuffer.size = bytes;
@@ -3584,10 +3984,31 @@ ssize_t StreamOutPrimary::write(const void *buffer, size_t bytes)
     uint32_t byteWidth = 0;
     uint32_t sampleRate = 0;
     uint32_t channelCount = 0;
+    int64_t entryUs = StreamStats::NowUs();
+    int64_t ioStartUs = 0;
+    int64_t budgetUs = 0;
+    bool firstWrite = false;
 
     AHAL_VERBOSE("handle_ %x bytes:(%zu)", handle_, bytes);
 
-    stream_mutex_.lock();
+    stats_.OnIoEntry(entryUs);
+    /* compressed data cannot be dropped, only PCM writes are bounded */
+    frameSize = audio_is_linear_pcm(config_.format) ?
+            audio_bytes_per_frame(audio_channel_count_from_out_mask(config_.channel_mask),
+                                  config_.format) : 0;
+    if (frameSize && config_.sample_rate)
+        budgetUs = (int64_t)bytes * 1000000LL / frameSize / config_.sample_rate;
+    if (!LockForIo(budgetUs)) {
+        AHAL_VERBOSE("device switch in progress, dropped %zu bytes", bytes);
+        stats_.ioDropped++;
+        /* reported as written, counted by the next holder of stream_mutex_ */
+        ioDroppedBytes_ += bytes;
+        return bytes;
+    }
+    ioStartUs = StreamStats::NowUs();
+    stats_.lockWait.Record(ioStartUs - entryUs);
+    AccountDroppedWrites();
+    firstWrite = !stream_started_;
     ret = configurePalOutputStream();
     if (ret < 0)
         goto exit;
@@ -3635,40 +4056,31 @@ ssize_t StreamOutPrimary::write(const void *buffer, size_t bytes)
         }
     }
     ATRACE_BEGIN("hal: pal_stream_write");
-    if (halInputFormat != halOutputFormat && convertBuffer != NULL) {
-        if (bytes > fragment_size_) {
-            AHAL_ERR("Error written bytes %zu > %d (fragment_size)", bytes, fragment_size_);
-            ATRACE_END();
-            stream_mutex_.unlock();
-            return -EINVAL;
-        }
-        /* prevent division-by-zero */
-        uint32_t inputBitWidth = format_to_bitwidth_table[halInputFormat];
-        uint32_t outputBitWidth = format_to_bitwidth_table[halOutputFormat];
-
-        if (inputBitWidth == 0 || outputBitWidth == 0) {
-            AHAL_ERR("Error inputBitWidth %u, outputBitWidth %u", inputBitWidth, outputBitWidth);
-            ATRACE_END();
-            stream_mutex_.unlock();
-            return -EINVAL;
-        }
-
-        frames = bytes / (inputBitWidth / 8);
-        memcpy_by_audio_format(convertBuffer, halOutputFormat, buffer, halInputFormat, frames);
-        palBuffer.buffer = (uint8_t *)convertBuffer;
-        palBuffer.size = frames * (outputBitWidth / 8);
-        ret = pal_stream_write(pal_stream_handle_, &palBuffer);
-        if (ret >= 0) {
-            ret = (ret * inputBitWidth) / outputBitWidth;
-        }
+    ioStartUs = StreamStats::NowUs();
+    if (halInputFormat != halOutputFormat && formatConverter.IsActive()) {
+        /* any write size streams through the converter one PAL buffer at a time */
+        ret = formatConverter.Process(buffer, bytes,
+                [&](const void *data, size_t size) -> ssize_t {
+                    palBuffer.buffer = (uint8_t *)data;
+                    palBuffer.size = size;
+                    return pal_stream_write(pal_stream_handle_, &palBuffer);
+                });
     } else if (usecase_ == USECASE_AUDIO_PLAYBACK_WITH_HAPTICS && pal_haptics_stream_handle) {
         ret = splitAndWriteAudioHapticsStream(buffer, bytes);
+    } else if (streamAttributes_.type == PAL_STREAM_COMPRESSED) {
+        ret = WriteOffload(&palBuffer);
     } else {
         ret = pal_stream_write(pal_stream_handle_, &palBuffer);
     }
+    stats_.palIo.Record(StreamStats::NowUs() - ioStartUs);
+    if (firstWrite && ret >= 0)
+        sFirstWriteUs[usecase_].Record(StreamStats::NowUs() - entryUs);
     ATRACE_END();
 
 exit:
+    /* a short write is retried by the framework with the rest, count what was taken */
+    if (ret >= 0 && (size_t)ret < bytes)
+        bytes = ret;
     if (mBytesWritten <= UINT64_MAX - bytes) {
         mBytesWritten += bytes;
     } else {
@@ -3680,6 +4092,143 @@ exit:
     return (ret < 0 ? onWriteError(bytes, ret) : ret);
 }
 
+/*
+ * Called with stream_mutex_ held. Counts the writes dropped while a device
+ * switch held the lock, as if written now.
+ */
+void StreamOutPrimary::AccountDroppedWrites()
+{
+    uint64_t dropped = ioDroppedBytes_.exchange(0);
+
+    if (!dropped)
+        return;
+    if (mBytesWritten <= UINT64_MAX - dropped)
+        mBytesWritten += dropped;
+    else
+        mBytesWritten = UINT64_MAX;
+    clock_gettime(CLOCK_MONOTONIC, &writeAt);
+}
+
+/* only plain PCM usecases whose standby is just stop + close can stay warm */
+bool StreamOutPrimary::CanKeepPalStreamWarm()
+{
+    if (AudioHalConfig::GetInt(HAL_CONFIG_OUTPUT_WARM_IDLE_MS) <= 0 || !mInitialized)
+        return false;
+    if (usecase_ != USECASE_AUDIO_PLAYBACK_LOW_LATENCY &&
+        usecase_ != USECASE_AUDIO_PLAYBACK_VOIP)
+        return false;
+
+    return !karaoke;
+}
+
+/* called with stream_mutex_ held */
+void StreamOutPrimary::ArmWarmIdleClose(int64_t idleUs)
+{
+    warm_mutex_.lock();
+    if (!warmThread_)
+        warmThread_ = std::make_unique<std::thread>([this]() { WarmThreadLoop(); });
+    warmCloseAtUs_ = StreamStats::NowUs() + idleUs;
+    warm_cond_.notify_one();
+    warm_mutex_.unlock();
+}
+
+/* called with stream_mutex_ held, returns the budget charged for the warm handle */
+void StreamOutPrimary::ReleaseWarmHandle(bool reused)
+{
+    std::shared_ptr<AudioDevice> adevice = AudioDevice::GetInstance();
+
+    if (adevice)
+        adevice->standbyPolicy.ReleaseWarm(usecase_, warmBytes_, reused);
+    warmBytes_ = 0;
+}
+
+/* opens the PAL stream in the background so that the first write only starts it */
+void StreamOutPrimary::PreOpenAsync()
+{
+    if (!CanKeepPalStreamWarm() ||
+        AudioHalConfig::GetInt(HAL_CONFIG_OUTPUT_WARM_IDLE_MS) <= 0)
+        return;
+
+    warm_mutex_.lock();
+    if (!warmThread_)
+        warmThread_ = std::make_unique<std::thread>([this]() { WarmThreadLoop(); });
+    warmOpenPending_ = true;
+    warm_cond_.notify_one();
+    warm_mutex_.unlock();
+}
+
+/*
+ * Never holds warm_mutex_ while taking stream_mutex_, a write waiting for
+ * the pre-open simply blocks on stream_mutex_ until Open() is done.
+ */
+void StreamOutPrimary::WarmThreadLoop()
+{
+    std::unique_lock<std::mutex> l(warm_mutex_);
+    std::shared_ptr<AudioDevice> adevice = AudioDevice::GetInstance();
+    size_t bytes = 0;
+    int64_t nowUs = 0;
+    int ret = 0;
+
+    while (!warmDone_) {
+        if (warmOpenPending_) {
+            warmOpenPending_ = false;
+            l.unlock();
+            stream_mutex_.lock();
+            if (!pal_stream_handle_) {
+                ATRACE_BEGIN("hal: preopen_output");
+                nowUs = StreamStats::NowUs();
+                ret = Open();
+                ATRACE_END();
+                bytes = (size_t)fragment_size_ * fragments_;
+                if (ret) {
+                    AHAL_ERR("pre-open failed %d, first write opens the stream", ret);
+                } else if (!adevice->standbyPolicy.ReserveWarm(bytes)) {
+                    AHAL_DBG("no budget to keep pre-opened stream");
+                    ClosePalStream();
+                } else {
+                    adevice->standbyPolicy.OnOpen(usecase_, StreamStats::NowUs() - nowUs);
+                    warmBytes_ = bytes;
+                    ArmWarmIdleClose(AudioHalConfig::GetInt(HAL_CONFIG_OUTPUT_WARM_IDLE_MS) * 1000LL);
+                }
+            }
+            stream_mutex_.unlock();
+            l.lock();
+            continue;
+        }
+
+        if (!warmCloseAtUs_) {
+            warm_cond_.wait(l);
+            continue;
+        }
+        nowUs = StreamStats::NowUs();
+        if (nowUs < warmCloseAtUs_) {
+            warm_cond_.wait_for(l, std::chrono::microseconds(warmCloseAtUs_ - nowUs));
+            continue;
+        }
+
+        warmCloseAtUs_ = 0;
+        l.unlock();
+        stream_mutex_.lock();
+        if (pal_stream_handle_ && !stream_started_) {
+            AHAL_DBG("closing idle pal stream, usecase %s", use_case_table[usecase_]);
+            ClosePalStream();
+            if (warmBytes_)
+                ReleaseWarmHandle(false);
+        }
+        stream_mutex_.unlock();
+        l.lock();
+    }
+}
+
+void StreamOutPrimary::DumpFirstWriteStats(int fd)
+{
+    dprintf(fd, "Output time to first write:\n");
+    for (int i = 0; i < AUDIO_USECASE_MAX; i++) {
+        if (sFirstWriteUs[i].Count())
+            sFirstWriteUs[i].Dump(fd, use_case_table[i]);
+    }
+}
+
 bool StreamOutPrimary::CheckOffloadEffectsType(pal_stream_type_t pal_stream_type) {
     if (pal_stream_type == PAL_STREAM_COMPRESSED  ||
         pal_stream_type == PAL_STREAM_PCM_OFFLOAD) {
@@ -3758,6 +4307,35 @@ int StreamOutPrimary::StopOffloadVisualizer(
     return ret;
 }
 
+int StreamOutPrimary::PauseOffloadVisualizer(
+                                    audio_io_handle_t ioHandle,
+                                    pal_stream_handle_t* pal_stream_handle) {
+    int ret  = 0;
+    /* older visualizer libraries do not export pause/resume */
+    if (fnp_visualizer_pause_output_) {
+        ret = fnp_visualizer_pause_output_(ioHandle, pal_stream_handle);
+        if (ret) {
+            AHAL_ERR("failed to visualizer_pause.");
+        }
+    }
+
+    return ret;
+}
+
+int StreamOutPrimary::ResumeOffloadVisualizer(
+                                    audio_io_handle_t ioHandle,
+                                    pal_stream_handle_t* pal_stream_handle) {
+    int ret  = 0;
+    if (fnp_visualizer_resume_output_) {
+        ret = fnp_visualizer_resume_output_(ioHandle, pal_stream_handle);
+        if (ret) {
+            AHAL_ERR("failed to visualizer_resume.");
+        }
+    }
+
+    return ret;
+}
+
 int StreamOutPrimary::SetAggregateSourceMetadata(bool voice_active) {
     ssize_t track_count_total = 0;
     std::vector<playback_track_metadata_t> total_tracks;
@@ -3816,20 +4394,23 @@ StreamOutPrimary::StreamOutPrimary(
                         offload_effects_start_output start_offload_effect,
                         offload_effects_stop_output stop_offload_effect,
                         visualizer_hal_start_output visualizer_start_output,
-                        visualizer_hal_stop_output visualizer_stop_output):
+                        visualizer_hal_stop_output visualizer_stop_output,
+                        visualizer_hal_pause_output visualizer_pause_output,
+                        visualizer_hal_resume_output visualizer_resume_output):
     StreamPrimary(handle, devices, config),
     mAndroidOutDevices(devices),
     flags_(flags),
     btSourceMetadata{0, nullptr}
 {
-    stream_ = std::shared_ptr<audio_stream_out> (new audio_stream_out());
+    std::shared_ptr<hal_stream_out> hal_stream = std::make_shared<hal_stream_out>();
+    hal_stream->owner = this;
+    stream_ = std::shared_ptr<audio_stream_out> (hal_stream, &hal_stream->stream);
     std::shared_ptr<AudioDevice> adevice = AudioDevice::GetInstance();
     mInitialized = false;
     pal_stream_handle_ = nullptr;
     pal_haptics_stream_handle = nullptr;
-    mPalOutDeviceIds = nullptr;
-    mPalOutDevice = nullptr;
-    convertBuffer = NULL;
+    memset(mPalOutDeviceIds, 0, sizeof(mPalOutDeviceIds));
+    memset(mPalOutDevice, 0, sizeof(mPalOutDevice));
     hapticsDevice = NULL;
     hapticBuffer = NULL;
     hapticsBufSize = 0;
@@ -3849,7 +4430,7 @@ StreamOutPrimary::StreamOutPrimary(
           address(%s)", handle, config->format, config->sample_rate, config->channel_mask,
           mAndroidOutDevices.size(), flags, address);
 
-    noHandsetSupport = property_get_bool("vendor.audio.feature.handset.profile.disable", false);
+    noHandsetSupport = AudioHalConfig::GetBool(HAL_CONFIG_HANDSET_PROFILE_DISABLE);
     //TODO: check if USB device is connected or not
     if (AudioExtn::audio_devices_cmp(mAndroidOutDevices, audio_is_usb_out_device)){
         // get capability from device of USB
@@ -3866,15 +4447,14 @@ StreamOutPrimary::StreamOutPrimary(
             AHAL_ERR("Failed to allocate mem for dynamic_media_config");
             goto error;
         }
-        size_t payload_size = 0;
         device_cap_query_->id = PAL_DEVICE_OUT_USB_DEVICE;
         device_cap_query_->addr.card_id = adevice->usb_card_id_;
         device_cap_query_->addr.device_num = adevice->usb_dev_num_;
         device_cap_query_->config = dynamic_media_config;
         device_cap_query_->is_playback = true;
-        ret = pal_get_param(PAL_PARAM_ID_DEVICE_CAPABILITY,
-                            (void **)&device_cap_query_,
-                            &payload_size, nullptr);
+        ret = adevice->GetDeviceCapability(PAL_DEVICE_OUT_USB_DEVICE, adevice->usb_card_id_,
+                                           adevice->usb_dev_num_, true,
+                                           dynamic_media_config);
         if (ret < 0) {
             AHAL_ERR("Error usb device is not connected");
             free(dynamic_media_config);
@@ -3930,14 +4510,16 @@ StreamOutPrimary::StreamOutPrimary(
 
     fnp_visualizer_start_output_ = visualizer_start_output;
     fnp_visualizer_stop_output_ = visualizer_stop_output;
+    fnp_visualizer_pause_output_ = visualizer_pause_output;
+    fnp_visualizer_resume_output_ = visualizer_resume_output;
 
     if (mAndroidOutDevices.empty())
         mAndroidOutDevices.insert(AUDIO_DEVICE_OUT_DEFAULT);
     AHAL_DBG("No of Android devices %zu", mAndroidOutDevices.size());
 
-    mPalOutDeviceIds = (pal_device_id_t*) calloc(mAndroidOutDevices.size(), sizeof(pal_device_id_t));
-    if (!mPalOutDeviceIds) {
-           goto error;
+    if (mAndroidOutDevices.size() > MAX_STREAM_DEVICES) {
+        AHAL_ERR("too many devices %zu, max %d", mAndroidOutDevices.size(), MAX_STREAM_DEVICES);
+        goto error;
     }
 
     noPalDevices = getPalDeviceIds(mAndroidOutDevices, mPalOutDeviceIds);
@@ -3946,11 +4528,6 @@ StreamOutPrimary::StreamOutPrimary(
         goto error;
     }
 
-    mPalOutDevice = (struct pal_device*) calloc(mAndroidOutDevices.size(), sizeof(struct pal_device));
-    if (!mPalOutDevice) {
-        goto error;
-    }
-
     /* TODO: how to update based on stream parameters and see if device is supported */
     for (int i = 0; i < mAndroidOutDevices.size(); i++) {
         mPalOutDevice[i].id = mPalOutDeviceIds[i];
@@ -3982,7 +4559,7 @@ StreamOutPrimary::StreamOutPrimary(
 
         if (((AudioExtn::audio_devices_cmp(mAndroidOutDevices, AUDIO_DEVICE_OUT_SPEAKER)) &&
                                (mPalOutDeviceIds[i] == PAL_DEVICE_OUT_SPEAKER)) &&
-                                property_get_bool("vendor.audio.mspp.enable", false)) {
+                                AudioHalConfig::GetBool(HAL_CONFIG_MSPP_ENABLE)) {
             strlcpy(mPalOutDevice[i].custom_config.custom_key, "mspp",
                     sizeof(mPalOutDevice[i].custom_config.custom_key));
             AHAL_INFO("Setting custom key as %s", mPalOutDevice[i].custom_config.custom_key);
@@ -4004,6 +4581,7 @@ StreamOutPrimary::StreamOutPrimary(
         flags_ = AUDIO_OUTPUT_FLAG_FAST;
     }
 
+    InvalidateBtEncoderLatency();
     mInitialized = true;
     for(auto dev : mAndroidOutDevices)
         audio_extn_gef_notify_device_config(dev, config_.channel_mask,
@@ -4016,9 +4594,24 @@ error:
 }
 
 StreamOutPrimary::~StreamOutPrimary() {
+    std::shared_ptr<AudioDevice> adevice = AudioDevice::GetInstance();
+
     AHAL_DBG("close stream, handle(%x), pal_stream_handle (%p)",
           handle_, pal_stream_handle_);
 
+    if (adevice)
+        adevice->controlWorker.Cancel(this);
+
+    if (warmThread_) {
+        warm_mutex_.lock();
+        warmDone_ = true;
+        warm_cond_.notify_one();
+        warm_mutex_.unlock();
+        warmThread_->join();
+    }
+    if (warmBytes_)
+        ReleaseWarmHandle(false);
+
     stream_mutex_.lock();
     if (pal_stream_handle_) {
         if (CheckOffloadEffectsType(streamAttributes_.type)) {
@@ -4026,8 +4619,7 @@ StreamOutPrimary::~StreamOutPrimary() {
             StopOffloadVisualizer(handle_, pal_stream_handle_);
         }
 
-        pal_stream_close(pal_stream_handle_);
-        pal_stream_handle_ = nullptr;
+        ClosePalStream();
     }
 
     if (pal_haptics_stream_handle) {
@@ -4040,16 +4632,7 @@ StreamOutPrimary::~StreamOutPrimary() {
         hapticsBufSize = 0;
     }
 
-    if (convertBuffer)
-        free(convertBuffer);
-    if (mPalOutDeviceIds) {
-        free(mPalOutDeviceIds);
-        mPalOutDeviceIds = NULL;
-    }
-    if (mPalOutDevice) {
-        free(mPalOutDevice);
-        mPalOutDevice = NULL;
-    }
+    formatConverter.Reset();
     if (hapticsDevice) {
         free(hapticsDevice);
         hapticsDevice = NULL;
@@ -4188,8 +4771,11 @@ int StreamInPrimary::Standby() {
 
     AHAL_DBG("Enter");
     stream_mutex_.lock();
+    stats_.ResetInterval();
     if (pal_stream_handle_) {
         if (!is_st_session) {
+            /* capture handles are always closed, only reopen stats are kept */
+            adevice->standbyPolicy.OnStandby(usecase_, false, 0, NULL);
             ret = pal_stream_stop(pal_stream_handle_);
         } else if (audio_extn_sound_trigger_check_session_activity(this)) {
             ret = pal_stream_set_param(pal_stream_handle_,
@@ -4201,6 +4787,8 @@ int StreamInPrimary::Standby() {
     }
     effects_applied_ = true;
     stream_started_ = false;
+    /* the restarted encoder begins on a frame boundary */
+    mAdtsScanState = AdtsScanState();
 
     if (pal_stream_handle_ && !is_st_session) {
         ret = pal_stream_close(pal_stream_handle_);
@@ -4320,31 +4908,22 @@ exit:
 
 
 int StreamInPrimary::SetGain(float gain) {
-    struct pal_volume_data* volume;
+    struct pal_volume_payload volume = {};
     int ret = 0;
 
     AHAL_DBG("Enter");
     stream_mutex_.lock();
-    volume = (struct pal_volume_data*)malloc(sizeof(uint32_t)
-                +sizeof(struct pal_channel_vol_kv));
-    if (!volume) {
-        AHAL_ERR("Failed to allocate mem for volume");
-        ret = -ENOMEM;
-        goto done;
-    }
-    volume->no_of_volpair = 1;
-    volume->volume_pair[0].channel_mask = 0x03;
-    volume->volume_pair[0].vol = gain;
+    volume.no_of_volpair = 1;
+    volume.volume_pair[0].channel_mask = 0x03;
+    volume.volume_pair[0].vol = gain;
     if (pal_stream_handle_) {
-        ret = pal_stream_set_volume(pal_stream_handle_, volume);
+        ret = pal_stream_set_volume(pal_stream_handle_, pal_volume(&volume));
     }
 
-    free(volume);
     if (ret) {
         AHAL_ERR("Pal Stream volume Error (%x)", ret);
     }
 
-done:
     stream_mutex_.unlock();
     AHAL_DBG("Exit ret: %d", ret);
     return ret;
@@ -4400,10 +4979,6 @@ int StreamInPrimary::RouteStream(const std::set<audio_devices_t>& new_devices, b
     bool is_empty, is_input;
     int ret = 0, noPalDevices = 0;
     bool skipDeviceSet = false;
-    pal_device_id_t * deviceId = nullptr;
-    struct pal_device* deviceIdConfigs = nullptr;
-    pal_param_device_capability_t *device_cap_query = nullptr;
-    size_t payload_size = 0;
     dynamic_media_config_t dynamic_media_config;
     struct pal_channel_info ch_info = {0, {0}};
     std::shared_ptr<AudioDevice> adevice = AudioDevice::GetInstance();
@@ -4413,6 +4988,8 @@ int StreamInPrimary::RouteStream(const std::set<audio_devices_t>& new_devices, b
 
     AHAL_INFO("Enter: InPrimary usecase(%d: %s)", GetUseCase(), use_case_table[GetUseCase()]);
 
+    /* lets read() give up on the stream instead of stalling behind the switch */
+    routesInFlight_++;
     stream_mutex_.lock();
     if (!mInitialized){
         AHAL_ERR("Not initialized, returning error");
@@ -4438,28 +5015,14 @@ int StreamInPrimary::RouteStream(const std::set<audio_devices_t>& new_devices, b
     /* If its the same device as what was already routed to, dont bother */
     if (!is_empty && is_input
             && ((mAndroidInDevices != new_devices) || force_device_switch)) {
-        //re-allocate mPalInDevice and mPalInDeviceIds
+        if (new_devices.size() > MAX_STREAM_DEVICES) {
+            AHAL_ERR("too many devices %zu, max %d", new_devices.size(), MAX_STREAM_DEVICES);
+            ret = -EINVAL;
+            goto done;
+        }
         if (new_devices.size() != mAndroidInDevices.size()) {
-            deviceId = (pal_device_id_t*) realloc(mPalInDeviceIds,
-                    new_devices.size() * sizeof(pal_device_id_t));
-            deviceIdConfigs = (struct pal_device*) realloc(mPalInDevice,
-                    new_devices.size() * sizeof(struct pal_device));
-            if (!deviceId || !deviceIdConfigs) {
-                AHAL_ERR("Failed to allocate PalOutDeviceIds or deviceIdConfigs!");
-                if (deviceId)
-                    mPalInDeviceIds = deviceId;
-                if (deviceIdConfigs)
-                    mPalInDevice = deviceIdConfigs;
-                ret = -ENOMEM;
-                goto done;
-            }
-
-            // init deviceId and deviceIdConfigs
-            memset(deviceId, 0, new_devices.size() * sizeof(pal_device_id_t));
-            memset(deviceIdConfigs, 0, new_devices.size() * sizeof(struct pal_device));
-
-            mPalInDeviceIds = deviceId;
-            mPalInDevice = deviceIdConfigs;
+            memset(mPalInDeviceIds, 0, sizeof(mPalInDeviceIds));
+            memset(mPalInDevice, 0, sizeof(mPalInDevice));
         }
         noPalDevices = getPalDeviceIds(new_devices, mPalInDeviceIds);
         AHAL_DBG("noPalDevices: %d , new_devices: %zu",
@@ -4471,14 +5034,6 @@ int StreamInPrimary::RouteStream(const std::set<audio_devices_t>& new_devices, b
             goto done;
         }
 
-        device_cap_query = (pal_param_device_capability_t *)
-                malloc(sizeof(pal_param_device_capability_t));
-        if (!device_cap_query) {
-                AHAL_ERR("Failed to allocate device_cap_query!");
-                ret = -ENOMEM;
-                goto done;
-        }
-
         for (int i = 0; i < noPalDevices; i++) {
             /*Skip device set for targets that do not support Handset profile for VoIP call*/
             if (noHandsetSupport && (mPalInDevice[i].id == PAL_DEVICE_IN_SPEAKER_MIC &&
@@ -4490,17 +5045,12 @@ int StreamInPrimary::RouteStream(const std::set<audio_devices_t>& new_devices, b
             }
             mPalInDevice[i].id = mPalInDeviceIds[i];
             if (((mPalInDeviceIds[i] == PAL_DEVICE_IN_USB_DEVICE) ||
-               (mPalInDeviceIds[i] == PAL_DEVICE_IN_USB_HEADSET)) && device_cap_query) {
+               (mPalInDeviceIds[i] == PAL_DEVICE_IN_USB_HEADSET))) {
 
                 mPalInDevice[i].address.card_id = adevice->usb_card_id_;
                 mPalInDevice[i].address.device_num = adevice->usb_dev_num_;
-                device_cap_query->id = mPalInDeviceIds[i];
-                device_cap_query->addr.card_id = adevice->usb_card_id_;
-                device_cap_query->addr.device_num = adevice->usb_dev_num_;
-                device_cap_query->config = &dynamic_media_config;
-                device_cap_query->is_playback = true;
-                ret = pal_get_param(PAL_PARAM_ID_DEVICE_CAPABILITY,(void **)&device_cap_query,
-                        &payload_size, nullptr);
+                ret = adevice->GetDeviceCapability(mPalInDeviceIds[i], adevice->usb_card_id_,
+                        adevice->usb_dev_num_, true, &dynamic_media_config);
 
                 if (ret<0) {
                     AHAL_ERR("Error usb device is not connected");
@@ -4561,14 +5111,13 @@ int StreamInPrimary::RouteStream(const std::set<audio_devices_t>& new_devices, b
 
         if (pal_stream_handle_ && !skipDeviceSet)
             ret = pal_stream_set_device(pal_stream_handle_, noPalDevices, mPalInDevice);
+        if (stream_started_)
+            UpdateCaptureLatency();
     }
 
 done:
-    if (device_cap_query) {
-        free(device_cap_query);
-        device_cap_query = NULL;
-    }
     stream_mutex_.unlock();
+    routesInFlight_--;
     AHAL_DBG("exit %d", ret);
     return ret;
 }
@@ -4633,10 +5182,9 @@ int StreamInPrimary::Open() {
     struct pal_channel_info ch_info = {0, {0}};
     uint32_t inBufSize = 0;
     uint32_t inBufCount = NO_OF_BUF;
+    uint32_t frameSize = 0;
     struct pal_buffer_config inBufCfg = {0, 0, 0};
     void *handle = nullptr;
-    pal_param_device_capability_t *device_cap_query = NULL;
-    size_t payload_size = 0;
     dynamic_media_config_t dynamic_media_config;
     std::shared_ptr<AudioDevice> adevice = AudioDevice::GetInstance();
 
@@ -4772,18 +5320,11 @@ int StreamInPrimary::Open() {
             streamAttributes_.info.opt_stream_info.tx_proxy_type = PAL_STREAM_PROXY_TX_TELEPHONY_RX;
     }
 
-    device_cap_query = (pal_param_device_capability_t *)malloc(sizeof(pal_param_device_capability_t));
-
     if ((mPalInDevice->id == PAL_DEVICE_IN_USB_DEVICE || mPalInDevice->id ==
-        PAL_DEVICE_IN_USB_HEADSET) && device_cap_query && adevice) {
+        PAL_DEVICE_IN_USB_HEADSET) && adevice) {
 
-        device_cap_query->id = mPalInDevice->id;
-        device_cap_query->addr.card_id = adevice->usb_card_id_;
-        device_cap_query->addr.device_num = adevice->usb_dev_num_;
-        device_cap_query->config = &dynamic_media_config;
-        device_cap_query->is_playback = true;
-        ret = pal_get_param(PAL_PARAM_ID_DEVICE_CAPABILITY,(void **)&device_cap_query,
-                &payload_size, nullptr);
+        ret = adevice->GetDeviceCapability(mPalInDevice->id, adevice->usb_card_id_,
+                adevice->usb_dev_num_, true, &dynamic_media_config);
 
          if (ret<0) {
              AHAL_DBG("Error usb device is not connected");
@@ -4921,26 +5462,23 @@ set_buff_size:
 
     fragments_ = inBufCount;
     fragment_size_ = inBufSize;
+    frameSize = audio_bytes_per_frame(audio_channel_count_from_in_mask(config_.channel_mask),
+                                      config_.format);
+    if (frameSize && config_.sample_rate)
+        stats_.SetPeriodUs((int64_t)fragment_size_ * 1000000LL / frameSize / config_.sample_rate);
 
 exit:
-    if (device_cap_query) {
-        free(device_cap_query);
-        device_cap_query = NULL;
-    }
     AHAL_DBG("Exit ret: %d", ret);
     return ret;
 }
 
 uint32_t StreamInPrimary::GetBufferSizeForLowLatencyRecord() {
      int trial = 0;
-     char value[PROPERTY_VALUE_MAX] = {0};
      int configured_low_latency_record_multiplier = ULL_PERIOD_MULTIPLIER;
 
-     if (property_get("vendor.audio.ull_record_period_multiplier", value, NULL) > 0) {
-         trial = atoi(value);
-         if(trial < ULL_PERIOD_MULTIPLIER && trial > 0)
-             configured_low_latency_record_multiplier = trial;
-     }
+     trial = AudioHalConfig::GetInt(HAL_CONFIG_ULL_RECORD_PERIOD_MULTIPLIER);
+     if(trial < ULL_PERIOD_MULTIPLIER && trial > 0)
+         configured_low_latency_record_multiplier = trial;
      return ULL_PERIOD_SIZE * configured_low_latency_record_multiplier *
             audio_bytes_per_frame(
                     audio_channel_count_from_in_mask(config_.channel_mask),
@@ -5044,9 +5582,24 @@ int StreamInPrimary::SetMicMute(bool mute) {
     return ret;
 }
 
+int StreamInPrimary::Dump(int fd)
+{
+    dprintf(fd, "  Input stream handle %d usecase %s source %d\n", handle_,
+            use_case_table[GetUseCase()], source_);
+    dprintf(fd, "    format %#x sample rate %u channel mask %#x flags %#x\n",
+            config_.format, config_.sample_rate, config_.channel_mask, flags_);
+    dprintf(fd, "    state %s, fragment %u x %u, bytes read %" PRIu64 "\n",
+            pal_stream_handle_ ? (stream_started_ ? "started" : "opened") : "standby",
+            fragment_size_, fragments_, mBytesRead);
+    stats_.Dump(fd);
+    capturePosition_.Dump(fd);
+    return 0;
+}
+
 ssize_t StreamInPrimary::onReadError(size_t bytes, size_t ret) {
     // standby streams upon read failures and sleep for buffer duration.
     AHAL_ERR("read failed %d usecase(%d: %s)", ret, GetUseCase(), use_case_table[GetUseCase()]);
+    stats_.ioErrors++;
     Standby();
     uint32_t byteWidth = streamAttributes_.in_media_config.bit_width / 8;
     uint32_t sampleRate = streamAttributes_.in_media_config.sample_rate;
@@ -5067,6 +5620,15 @@ ssize_t StreamInPrimary::read(const void *buffer, size_t bytes) {
     int retry_count = MAX_READ_RETRY_COUNT;
     ssize_t size = 0;
     struct pal_buffer palBuffer;
+    struct pal_volume_payload volume;
+    int64_t entryUs = StreamStats::NowUs();
+    int64_t ioStartUs = 0;
+    uint64_t adtsSamples = 0;
+    uint64_t framesRead = 0;
+    uint64_t dropped = 0;
+    int64_t timeNs = 0;
+    int64_t budgetUs = 0;
+    uint32_t frameSize = 0;
 
     palBuffer.buffer = (uint8_t *)buffer;
     palBuffer.size = bytes;
@@ -5074,19 +5636,44 @@ ssize_t StreamInPrimary::read(const void *buffer, size_t bytes) {
     std::shared_ptr<AudioDevice> adevice = AudioDevice::GetInstance();
     AHAL_VERBOSE("requested bytes: %zu", bytes);
 
-    stream_mutex_.lock();
+    stats_.OnIoEntry(entryUs);
+    /* compressed capture cannot be made up, only PCM reads are bounded */
+    frameSize = audio_is_linear_pcm(config_.format) ?
+            audio_bytes_per_frame(audio_channel_count_from_in_mask(config_.channel_mask),
+                                  config_.format) : 0;
+    if (frameSize && config_.sample_rate)
+        budgetUs = (int64_t)bytes * 1000000LL / frameSize / config_.sample_rate;
+    if (!LockForIo(budgetUs)) {
+        AHAL_VERBOSE("device switch in progress, returning %zu bytes of silence", bytes);
+        stats_.ioDropped++;
+        memset(palBuffer.buffer, 0, bytes);
+        /* the silence is part of the capture, mBytesRead catches up on the next read */
+        ioDroppedBytes_ += bytes;
+        if (capturePosition_.Get(&framesRead, &timeNs))
+            capturePosition_.Update(framesRead + bytes / frameSize, PositionTracker::NowNs(),
+                                    config_.sample_rate);
+        return bytes;
+    }
+    stats_.lockWait.Record(StreamStats::NowUs() - entryUs);
+    dropped = ioDroppedBytes_.exchange(0);
+    if (mBytesRead <= UINT64_MAX - dropped)
+        mBytesRead += dropped;
+    else
+        mBytesRead = UINT64_MAX;
     if (!pal_stream_handle_) {
         AutoPerfLock perfLock;
+        ioStartUs = StreamStats::NowUs();
         ret = Open();
         if (ret < 0)
             goto exit;
+        adevice->standbyPolicy.OnOpen(usecase_, StreamStats::NowUs() - ioStartUs);
     }
 
     if (is_st_session) {
         ATRACE_BEGIN("hal: lab read");
-        memset(palBuffer.buffer, 0, palBuffer.size);
         if (!audio_extn_sound_trigger_check_session_activity(this)) {
             AHAL_DBG("sound trigger session not available");
+            memset(palBuffer.buffer, 0, palBuffer.size);
             ATRACE_END();
             goto exit;
         }
@@ -5108,10 +5695,14 @@ ssize_t StreamInPrimary::read(const void *buffer, size_t bytes) {
                     palBuffer.buffer += ret;
                     palBuffer.size -= ret;
                 } else {
+                    palBuffer.size = 0;
                     break;
                 }
             }
         }
+        /* retries exhausted on short reads, the rest of the buffer is silence */
+        if (palBuffer.size)
+            memset(palBuffer.buffer, 0, palBuffer.size);
         ATRACE_END();
         goto exit;
     }
@@ -5126,9 +5717,14 @@ ssize_t StreamInPrimary::read(const void *buffer, size_t bytes) {
             goto exit;
         }
         stream_started_ = true;
+        adevice->standbyPolicy.OnStart(usecase_, false);
+        UpdateCaptureLatency();
         /* set cached volume if any, dont return failure back up */
-        if (volume_) {
-            ret = pal_stream_set_volume(pal_stream_handle_, volume_);
+        volume_mutex_.lock();
+        volume = volume_;
+        volume_mutex_.unlock();
+        if (volume.no_of_volpair) {
+            ret = pal_stream_set_volume(pal_stream_handle_, pal_volume(&volume));
             if (ret) {
                 AHAL_ERR("Pal Stream volume Error (%x)", ret);
             }
@@ -5152,13 +5748,26 @@ ssize_t StreamInPrimary::read(const void *buffer, size_t bytes) {
        effects_applied_ = true;
     }
 
+    ioStartUs = StreamStats::NowUs();
     ret = pal_stream_read(pal_stream_handle_, &palBuffer);
+    stats_.palIo.Record(StreamStats::NowUs() - ioStartUs);
     AHAL_VERBOSE("received size= %d",palBuffer.size);
     if (usecase_ == USECASE_AUDIO_RECORD_COMPRESS && ret > 0) {
         size = palBuffer.size;
-        mCompressReadCalls++;
+        if (CompressCapture::isAdtsFormat(config_.format) && !mAdtsScanState.lost &&
+            countAdtsSamples((const uint8_t *)palBuffer.buffer, size,
+                             config_.sample_rate, mAdtsScanState, adtsSamples)) {
+            mCompressFramesRead += adtsSamples;
+        } else {
+            if (CompressCapture::isAdtsFormat(config_.format) && !mAdtsScanState.lost) {
+                AHAL_ERR("lost ADTS sync, counting one AAC frame per read");
+                mAdtsScanState.lost = true;
+            }
+            mCompressFramesRead += COMPRESS_CAPTURE_AAC_PCM_SAMPLES_IN_FRAME;
+        }
     }
     // mute pcm data if sva client is reading lab data
+    // the property is read live, only while a VA session is active
     if (adevice->num_va_sessions_ > 0 &&
         source_ != AUDIO_SOURCE_VOICE_RECOGNITION &&
         property_get_bool("persist.vendor.audio.va_concurrency_mute_enabled",
@@ -5172,8 +5781,12 @@ exit:
     } else {
         mBytesRead = UINT64_MAX;
     }
+    if (usecase_ == USECASE_AUDIO_RECORD_COMPRESS)
+        framesRead = mCompressFramesRead;
+    else if (frameSize)
+        framesRead = mBytesRead / frameSize;
     stream_mutex_.unlock();
-    clock_gettime(CLOCK_MONOTONIC, &readAt);
+    capturePosition_.Update(framesRead, PositionTracker::NowNs(), config_.sample_rate);
     if (usecase_ == USECASE_AUDIO_RECORD_COMPRESS && ret <= 0) {
         AHAL_ERR("read failure for compress capture: %d", ret);
         return -ENODEV;
@@ -5192,7 +5805,7 @@ int StreamInPrimary::FillHalFnPtrs() {
     stream_.get()->common.get_format = astream_in_get_format;
     stream_.get()->common.set_format = astream_set_format;
     stream_.get()->common.standby = astream_in_standby;
-    stream_.get()->common.dump = astream_dump;
+    stream_.get()->common.dump = astream_in_dump;
     stream_.get()->common.set_parameters = astream_in_set_parameters;
     stream_.get()->common.get_parameters = astream_in_get_parameters;
     stream_.get()->common.add_audio_effect = astream_in_add_audio_effect;
@@ -5222,14 +5835,15 @@ StreamInPrimary::StreamInPrimary(audio_io_handle_t handle,
     flags_(flags),
     btSinkMetadata{0, nullptr}
 {
-    stream_ = std::shared_ptr<audio_stream_in> (new audio_stream_in());
+    std::shared_ptr<hal_stream_in> hal_stream = std::make_shared<hal_stream_in>();
+    hal_stream->owner = this;
+    stream_ = std::shared_ptr<audio_stream_in> (hal_stream, &hal_stream->stream);
     std::shared_ptr<AudioDevice> adevice = AudioDevice::GetInstance();
     pal_stream_handle_ = NULL;
     mInitialized = false;
     int noPalDevices = 0;
     int ret = 0;
-    readAt.tv_sec = 0;
-    readAt.tv_nsec = 0;
+    captureLatencyUs_ = 0;
     void *st_handle = nullptr;
     pal_param_payload *payload = nullptr;
 
@@ -5240,7 +5854,7 @@ StreamInPrimary::StreamInPrimary(audio_io_handle_t handle,
         AHAL_ERR("stream_ new allocation failed");
         goto error;
     }
-    noHandsetSupport = property_get_bool("vendor.audio.feature.handset.profile.disable", false);
+    noHandsetSupport = AudioHalConfig::GetBool(HAL_CONFIG_HANDSET_PROFILE_DISABLE);
 
     if (AudioExtn::audio_devices_cmp(mAndroidInDevices, audio_is_usb_in_device)) {
         // get capability from device of USB
@@ -5257,15 +5871,14 @@ StreamInPrimary::StreamInPrimary(audio_io_handle_t handle,
             AHAL_ERR("Failed to allocate mem for dynamic_media_config");
             goto error;
         }
-        size_t payload_size = 0;
         device_cap_query_->id = PAL_DEVICE_IN_USB_HEADSET;
         device_cap_query_->addr.card_id = adevice->usb_card_id_;
         device_cap_query_->addr.device_num = adevice->usb_dev_num_;
         device_cap_query_->config = dynamic_media_config;
         device_cap_query_->is_playback = false;
-        ret = pal_get_param(PAL_PARAM_ID_DEVICE_CAPABILITY,
-                            (void **)&device_cap_query_,
-                            &payload_size, nullptr);
+        ret = adevice->GetDeviceCapability(PAL_DEVICE_IN_USB_HEADSET, adevice->usb_card_id_,
+                                           adevice->usb_dev_num_, false,
+                                           dynamic_media_config);
         if (ret < 0) {
             AHAL_ERR("Error usb device is not connected");
             free(dynamic_media_config);
@@ -5347,20 +5960,18 @@ StreamInPrimary::StreamInPrimary(audio_io_handle_t handle,
         mAndroidInDevices.insert(AUDIO_DEVICE_IN_DEFAULT);
 
     AHAL_DBG("No of devices %zu", mAndroidInDevices.size());
-    mPalInDeviceIds = (pal_device_id_t*) calloc(mAndroidInDevices.size(), sizeof(pal_device_id_t));
-    if (!mPalInDeviceIds) {
+    if (mAndroidInDevices.size() > MAX_STREAM_DEVICES) {
+        AHAL_ERR("too many devices %zu, max %d", mAndroidInDevices.size(), MAX_STREAM_DEVICES);
         goto error;
     }
+    memset(mPalInDeviceIds, 0, sizeof(mPalInDeviceIds));
+    memset(mPalInDevice, 0, sizeof(mPalInDevice));
 
     noPalDevices = getPalDeviceIds(devices, mPalInDeviceIds);
     if (noPalDevices != mAndroidInDevices.size()) {
         AHAL_ERR("mismatched pal %d and hal devices %zu", noPalDevices, mAndroidInDevices.size());
         goto error;
     }
-    mPalInDevice = (struct pal_device*) calloc(mAndroidInDevices.size(), sizeof(struct pal_device));
-    if (!mPalInDevice) {
-        goto error;
-    }
 
     for (int i = 0; i < mAndroidInDevices.size(); i++) {
         mPalInDevice[i].id = mPalInDeviceIds[i];
@@ -5429,6 +6040,10 @@ error:
 }
 
 StreamInPrimary::~StreamInPrimary() {
+    std::shared_ptr<AudioDevice> adevice = AudioDevice::GetInstance();
+
+    if (adevice)
+        adevice->controlWorker.Cancel(this);
     stream_mutex_.lock();
     if (pal_stream_handle_ && !is_st_session) {
         AHAL_DBG("close stream, pal_stream_handle (%p)",
@@ -5436,14 +6051,6 @@ StreamInPrimary::~StreamInPrimary() {
         pal_stream_close(pal_stream_handle_);
         pal_stream_handle_ = NULL;
     }
-    if (mPalInDeviceIds) {
-        free(mPalInDeviceIds);
-        mPalInDeviceIds = NULL;
-    }
-    if (mPalInDevice) {
-        free(mPalInDevice);
-        mPalInDevice = NULL;
-    }
     stream_mutex_.unlock();
 }
 
@@ -5452,21 +6059,17 @@ StreamPrimary::StreamPrimary(audio_io_handle_t handle,
     pal_stream_handle_(NULL),
     handle_(handle),
     config_(*config),
-    volume_(NULL),
     mmap_shared_memory_fd(-1),
     device_cap_query_(NULL)
 {
     memset(&streamAttributes_, 0, sizeof(streamAttributes_));
+    memset(&volume_, 0, sizeof(volume_));
     memset(&address_, 0, sizeof(address_));
     AHAL_DBG("handle: %d channel_mask: %d ", handle_, config_.channel_mask);
 }
 
 StreamPrimary::~StreamPrimary(void)
 {
-    if (volume_) {
-        free(volume_);
-        volume_ = NULL;
-    }
     if (device_cap_query_) {
         if (device_cap_query_->config) {
             free(device_cap_query_->config);
@@ -75,8 +75,16 @@
 
 #include "PalDefs.h"
 #include <audio_extn/AudioExtn.h>
+#include "FormatConverter.h"
+#include "AudioHalConfig.h"
+#include "StreamStats.h"
+#include "PositionTracker.h"
+#include "CapturePosition.h"
 #include <mutex>
+#include <thread>
 #include <map>
+#include <memory>
+#include <atomic>
 #include <unordered_map>
 
 #define LOW_LATENCY_PLATFORM_DELAY (13*1000LL)
@@ -126,6 +134,20 @@
 #define MMAP_PERIOD_COUNT_DEFAULT (MMAP_PERIOD_COUNT_MAX)
 #define CODEC_BACKEND_DEFAULT_BIT_WIDTH 16
 #define AUDIO_CAPTURE_PERIOD_DURATION_MSEC 20
+/* most devices a single stream is routed to at a time */
+#define MAX_STREAM_DEVICES 8
+/* volume updates reach PAL at most once per period, a ramp is stepped at it */
+#define VOLUME_APPLY_PERIOD_US 10000LL
+/* cache key of a BT encoder latency: route and BT generations, low 16 bits hold the latency */
+#define BT_LATENCY_KEY(route, bt) \
+    ((((uint64_t)(route) & 0xFFFFFF) << 40) | (((uint64_t)(bt) & 0xFFFFFF) << 16))
+#define BT_LATENCY_MASK 0xFFFFULL
+/* longest a blocking offload write waits for WRITE_READY before returning short */
+#define OFFLOAD_WRITE_READY_TIMEOUT_MS 1000
+/* bound of a drain without callback: buffered audio at the stream bitrate plus this margin */
+#define OFFLOAD_DRAIN_TIMEOUT_MARGIN_MS 1000
+/* bitrate assumed for that bound when the stream has none, low so the bound errs long */
+#define OFFLOAD_DRAIN_MIN_BIT_RATE 32000
 
 #define LL_PERIOD_SIZE_FRAMES_160 160
 #define LL_PERIOD_SIZE_FRAMES_192 192
@@ -479,10 +501,53 @@ extern "C" typedef int (*visualizer_hal_start_output)(audio_io_handle_t,
                                                        pal_stream_handle_t*);
 extern "C" typedef int (*visualizer_hal_stop_output)(audio_io_handle_t,
                                                       pal_stream_handle_t*);
+extern "C" typedef int (*visualizer_hal_pause_output)(audio_io_handle_t,
+                                                       pal_stream_handle_t*);
+extern "C" typedef int (*visualizer_hal_resume_output)(audio_io_handle_t,
+                                                        pal_stream_handle_t*);
 
 int adev_open(audio_hw_device_t **device);
 
 class AudioDevice;
+class StreamOutPrimary;
+class StreamInPrimary;
+
+/*
+ * HAL stream structs handed out to the framework. The back-references let
+ * the astream_* trampolines resolve their stream object in O(1) without
+ * walking the device stream lists. Both are set before the stream is handed
+ * out and never change afterwards, so lookups need no lock. owner is valid
+ * for as long as the framework may call into the stream, i.e. until
+ * close_output_stream/close_input_stream, and is used on the data path to
+ * skip the reference count; ref gives a shared_ptr to everyone else. The
+ * audio_stream_* member must stay first so that the framework pointer can be
+ * cast back to the wrapper.
+ */
+struct hal_stream_out {
+    audio_stream_out stream;
+    StreamOutPrimary *owner;
+    std::weak_ptr<StreamOutPrimary> ref;
+};
+
+struct hal_stream_in {
+    audio_stream_in stream;
+    StreamInPrimary *owner;
+    std::weak_ptr<StreamInPrimary> ref;
+};
+
+/*
+ * pal_volume_data with room for a stereo pair inline, so that volume can be
+ * handed to PAL without allocating a payload per call.
+ */
+struct pal_volume_payload {
+    uint32_t no_of_volpair;
+    struct pal_channel_vol_kv volume_pair[2];
+};
+
+static inline struct pal_volume_data *pal_volume(struct pal_volume_payload *payload)
+{
+    return (struct pal_volume_data *)payload;
+}
 
 class StreamPrimary {
 public:
@@ -499,7 +564,8 @@ public:
     int             GetUseCase();
     std::mutex write_wait_mutex_;
     std::condition_variable write_condition_;
-    std::mutex stream_mutex_;
+    /* timed so that read/write can give up on it during a device switch */
+    std::timed_mutex stream_mutex_;
     bool write_ready_;
     std::mutex drain_wait_mutex_;
     std::condition_variable drain_condition_;
@@ -513,7 +579,23 @@ public:
     bool GetSupportedConfig(bool isOutStream,
                             struct str_parms *query, struct str_parms *reply);
     virtual int RouteStream(const std::set<audio_devices_t>&, bool force_device_switch = false) = 0;
+    int RouteStreamAsync(const std::set<audio_devices_t>& new_devices);
 protected:
+    void RunRoute();
+    bool LockForIo(int64_t budgetUs);
+    /* latest RouteStreamAsync() request and result, guarded by route_mutex_ */
+    std::mutex route_mutex_;
+    std::set<audio_devices_t> routeDevices_;
+    uint64_t routeSeq_ = 0;
+    uint64_t routeDoneSeq_ = 0;
+    uint64_t routeLateSeq_ = 0;
+    int routeRet_ = 0;
+    /* devices of the switch being run, control worker only */
+    std::set<audio_devices_t> routingDevices_;
+    /* device switches waiting for or holding stream_mutex_ */
+    std::atomic<int32_t> routesInFlight_ = 0;
+    /* bytes dropped by LockForIo() failures, not yet in mBytesWritten or mBytesRead */
+    std::atomic<uint64_t> ioDroppedBytes_ = 0;
     struct pal_stream_attributes streamAttributes_;
     pal_stream_handle_t*      pal_stream_handle_;
     audio_io_handle_t         handle_;
@@ -523,10 +605,11 @@ protected:
     bool                      stream_started_ = false;
     bool                      stream_paused_ = false;
     int usecase_;
-    struct pal_volume_data *volume_; /* used to cache volume */
-    std::map <audio_devices_t, pal_device_id_t> mAndroidDeviceMap;
+    struct pal_volume_payload volume_; /* used to cache volume, set if no_of_volpair != 0 */
+    std::mutex volume_mutex_; /* guards volume_, taken after stream_mutex_ */
     int mmap_shared_memory_fd;
     pal_param_device_capability_t *device_cap_query_;
+    StreamStats stats_;
 };
 
 class StreamOutPrimary : public StreamPrimary {
@@ -535,8 +618,8 @@ private:
     ssize_t configurePalOutputStream();
     //Helper method to standby streams upon write failures and sleep for buffer duration.
     ssize_t onWriteError(size_t bytes, ssize_t ret);
-    struct pal_device* mPalOutDevice;
-    pal_device_id_t* mPalOutDeviceIds;
+    struct pal_device mPalOutDevice[MAX_STREAM_DEVICES];
+    pal_device_id_t mPalOutDeviceIds[MAX_STREAM_DEVICES];
     std::set<audio_devices_t> mAndroidOutDevices;
     bool mInitialized;
 
@@ -549,13 +632,15 @@ public:
                      offload_effects_start_output fnp_start_offload_effect,
                      offload_effects_stop_output fnp_stop_offload_effect,
                      visualizer_hal_start_output fnp_visualizer_start_output_,
-                     visualizer_hal_stop_output fnp_visualizer_stop_output_);
+                     visualizer_hal_stop_output fnp_visualizer_stop_output_,
+                     visualizer_hal_pause_output fnp_visualizer_pause_output_,
+                     visualizer_hal_resume_output fnp_visualizer_resume_output_);
 
     ~StreamOutPrimary();
     bool sendGaplessMetadata = true;
     bool isCompressMetadataAvail = false;
     void UpdatemCachedPosition(uint64_t val);
-    int Standby();
+    int Standby(bool forceClose = false);
     int SetVolume(float left, float right);
     uint64_t GetFramesWritten(struct timespec *timestamp);
     int SetParameters(struct str_parms *parms);
@@ -571,6 +656,9 @@ public:
     uint32_t GetBufferSize();
     uint32_t GetBufferSizeForLowLatency();
     int GetFrames(uint64_t *frames);
+    void PreOpenAsync();
+    static void DumpFirstWriteStats(int fd);
+    int GetPresentationFrames(uint64_t *frames, struct timespec *timestamp);
     static pal_stream_type_t GetPalStreamType(audio_output_flags_t halStreamFlags);
     static int64_t GetRenderLatency(audio_output_flags_t halStreamFlags);
     int GetOutputUseCase(audio_output_flags_t halStreamFlags);
@@ -579,12 +667,22 @@ public:
     bool CheckOffloadEffectsType(pal_stream_type_t pal_stream_type);
     int StartOffloadVisualizer(audio_io_handle_t, pal_stream_handle_t*);
     int StopOffloadVisualizer(audio_io_handle_t, pal_stream_handle_t*);
+    int PauseOffloadVisualizer(audio_io_handle_t, pal_stream_handle_t*);
+    int ResumeOffloadVisualizer(audio_io_handle_t, pal_stream_handle_t*);
     audio_output_flags_t flags_;
     int CreateMmapBuffer(int32_t min_size_frames, struct audio_mmap_buffer_info *info);
     int GetMmapPosition(struct audio_mmap_position *position);
     bool isDeviceAvailable(pal_device_id_t deviceId);
+    int32_t GetBtEncoderLatency();
+    int Dump(int fd);
+    void InvalidateBtEncoderLatency();
+    static std::atomic<uint64_t> btLatencyQueriesSaved;
     int RouteStream(const std::set<audio_devices_t>&, bool force_device_switch = false);
     ssize_t splitAndWriteAudioHapticsStream(const void *buffer, size_t bytes);
+    /* PAL has room again, returns whether the framework is waiting for it */
+    bool OnWriteReady();
+    /* releases a blocking drain or write, e.g. on flush, standby or PAL error */
+    void AbortOffloadWaits();
     bool period_size_is_plausible_for_low_latency(int period_size);
     source_metadata_t btSourceMetadata;
     std::vector<playback_track_metadata_t> tracks;
@@ -593,10 +691,21 @@ public:
 protected:
     struct timespec writeAt;
     int get_compressed_buffer_size();
+    uint32_t GetCompressBitRate();
     int get_pcm_buffer_size();
+    int ReadDspFrames(uint64_t *dspFrames, int64_t *sampleNs);
+    bool CanKeepPalStreamWarm();
+    void ArmWarmIdleClose(int64_t idleUs);
+    void ReleaseWarmHandle(bool reused);
+    void WarmThreadLoop();
+    uint64_t ToPresentedFrames(uint64_t dspFrames);
+    ssize_t WriteOffload(struct pal_buffer *palBuffer);
+    void FillVolumePayload(float left, float right, struct pal_volume_payload *volume);
+    void ApplyVolume();
+    int ClosePalStream();
+    void AccountDroppedWrites();
     audio_format_t halInputFormat = AUDIO_FORMAT_DEFAULT;
     audio_format_t halOutputFormat = AUDIO_FORMAT_DEFAULT;
-    uint32_t convertBufSize;
     uint32_t fragments_ = 0;
     uint32_t fragment_size_ = 0;
     bool noHandsetSupport = false;
@@ -607,11 +716,58 @@ protected:
     std::shared_ptr<audio_stream_out>   stream_;
     uint64_t mBytesWritten; /* total bytes written, not cleared when entering standby */
     uint64_t mCachedPosition = 0; /* cache pcm offload position when entering standby */
+    PositionTracker positionTracker_;
+    /*
+     * Compress offload writes never block in PAL, a write PAL cannot take
+     * whole returns short. offloadWriteBlocked_ is set while a write may
+     * end short and the framework may wait for WRITE_READY, other
+     * WRITE_READY events are not forwarded. Under write_wait_mutex_.
+     */
+    bool offloadWriteBlocked_ = false;
+    std::atomic<uint64_t> offloadShortWrites_ = 0;
+    std::atomic<uint64_t> writeReadyForwarded_ = 0;
+    std::atomic<uint64_t> writeReadySuppressed_ = 0;
+    /*
+     * Warm PAL handle: opened ahead of the first write or kept opened but
+     * stopped across standby as decided by AudioDevice::standbyPolicy,
+     * closed by warmThread_ once it has been idle for the policy window.
+     * warmBytes_ is what the handle is charged against the policy budget.
+     */
+    std::mutex warm_mutex_;
+    std::condition_variable warm_cond_;
+    std::unique_ptr<std::thread> warmThread_;
+    bool warmDone_ = false;
+    bool warmOpenPending_ = false;
+    int64_t warmCloseAtUs_ = 0;
+    size_t warmBytes_ = 0;
+    static LatencyHistogram sFirstWriteUs[AUDIO_USECASE_MAX];
+    /*
+     * Volume is applied by AudioDevice::controlWorker. volumeTarget_ is the
+     * last requested left/right, volumeLevel_ the one last sent to PAL and
+     * the start of a ramp running until volumeRampEndUs_. All under
+     * volume_mutex_.
+     */
+    float volumeTarget_[2] = {0, 0};
+    float volumeLevel_[2] = {0, 0};
+    float volumeRampFrom_[2] = {0, 0};
+    bool volumeLevelValid_ = false;
+    int64_t volumeRampStartUs_ = 0;
+    int64_t volumeRampEndUs_ = 0;
+    int64_t volumeAppliedUs_ = 0;
+    /*
+     * Taken after stream_mutex_ to close pal_stream_handle_, and by
+     * ApplyVolume() while it uses the handle without stream_mutex_.
+     */
+    std::mutex handle_mutex_;
+    /* pal_stream_handle_ is set, for readers without stream_mutex_ */
+    std::atomic<bool> palOpened_ = false;
     offload_effects_start_output fnp_offload_effect_start_output_ = nullptr;
     offload_effects_stop_output fnp_offload_effect_stop_output_ = nullptr;
     visualizer_hal_start_output fnp_visualizer_start_output_ = nullptr;
     visualizer_hal_stop_output fnp_visualizer_stop_output_ = nullptr;
-    void *convertBuffer;
+    visualizer_hal_pause_output fnp_visualizer_pause_output_ = nullptr;
+    visualizer_hal_resume_output fnp_visualizer_resume_output_ = nullptr;
+    FormatConverter formatConverter;
     //Haptics Usecase
     struct pal_stream_attributes hapticsStreamAttributes;
     pal_stream_handle_t* pal_haptics_stream_handle;
@@ -619,6 +775,16 @@ protected:
     struct pal_device* hapticsDevice;
     uint8_t* hapticBuffer;
     size_t hapticsBufSize;
+    /*
+     * BT device of the current route, snapshot under stream_mutex_ by
+     * InvalidateBtEncoderLatency() together with a bump of btRouteGen.
+     * btLatencyCache packs BT_LATENCY_KEY(btRouteGen, bt_encoder_latency_gen_)
+     * of the query with its latency in ms, a value read for an older route
+     * or BT configuration never matches the current key.
+     */
+    std::atomic<int32_t> btRouteDevice = PAL_DEVICE_NONE;
+    std::atomic<uint32_t> btRouteGen = 0;
+    std::atomic<uint64_t> btLatencyCache = 0;
 
     int FillHalFnPtrs();
     friend class AudioDevice;
@@ -627,8 +793,8 @@ protected:
 class StreamInPrimary : public StreamPrimary{
 
 private:
-     struct pal_device* mPalInDevice;
-     pal_device_id_t* mPalInDeviceIds;
+     struct pal_device mPalInDevice[MAX_STREAM_DEVICES];
+     pal_device_id_t mPalInDeviceIds[MAX_STREAM_DEVICES];
      std::set<audio_devices_t> mAndroidInDevices;
      bool mInitialized;
     //Helper method to standby streams upon read failures and sleep for buffer duration.
@@ -665,14 +831,18 @@ public:
     bool isDeviceAvailable(pal_device_id_t deviceId);
     int RouteStream(const std::set<audio_devices_t>& new_devices, bool force_device_switch = false);
     int64_t GetSourceLatency(audio_input_flags_t halStreamFlags);
+    void UpdateCaptureLatency();
     uint64_t GetFramesRead(int64_t *time);
+    int Dump(int fd);
     int GetPalDeviceIds(pal_device_id_t *palDevIds, int *numPalDevs);
     sink_metadata_t btSinkMetadata;
     std::vector<record_track_metadata_t> tracks;
     int SetAggregateSinkMetadata(bool voice_active);
     static std::mutex sinkMetadata_mutex_;
 protected:
-    struct timespec readAt;
+    CapturePosition capturePosition_;
+    /* platform plus BT decoder latency, refreshed on start and device switch */
+    std::atomic<int64_t> captureLatencyUs_;
     uint32_t fragments_ = 0;
     uint32_t fragment_size_ = 0;
     int FillHalFnPtrs();
@@ -682,11 +852,11 @@ protected:
     friend class AudioDevice;
     uint64_t mBytesRead = 0; /* total bytes read, not cleared when entering standby */
     /**
-     * number of successful compress read calls
-     * correlate to number of PCM frames read in
-     * compress record usecase
+     * PCM frames encoded into the compress record data read so far,
+     * taken from the ADTS headers or one AAC frame per read otherwise
      * */
-    uint64_t mCompressReadCalls = 0;
+    uint64_t mCompressFramesRead = 0;
+    AdtsScanState mAdtsScanState;
     int32_t mCompressStreamAdjBitRate;
     bool mIsBitRateSet =false;
     bool mIsBitRateGet = false;
@@ -68,11 +68,14 @@ int AudioVoice::SetMode(const audio_mode_t mode) {
     return ret;
 }
 
-int AudioVoice::VoiceSetParameters(const char *kvpairs) {
+/*
+ * parms is parsed once by AudioDevice::SetParameters and owned by it, the
+ * kvpairs string is logged there
+ */
+int AudioVoice::VoiceSetParameters(struct str_parms *parms) {
     int value, i;
     char c_value[32];
     int ret = 0, err;
-    struct str_parms *parms;
     pal_param_payload *params = nullptr;
     uint32_t tty_mode;
     bool volume_boost;
@@ -80,11 +83,6 @@ int AudioVoice::VoiceSetParameters(const char *kvpairs) {
     bool hd_voice;
     bool hac;
 
-    parms = str_parms_create_str(kvpairs);
-    if (!parms)
-       return  -EINVAL;
-
-    AHAL_DBG("Enter params: %s", kvpairs);
     err = str_parms_get_int(parms, AUDIO_PARAMETER_KEY_VSID, &value);
     if (err >= 0) {
         uint32_t vsid = value;
@@ -304,7 +302,6 @@ int AudioVoice::VoiceSetParameters(const char *kvpairs) {
     }
 
 done:
-    str_parms_destroy(parms);
     AHAL_DBG("Exit ret: %d", ret);
     return ret;
 }
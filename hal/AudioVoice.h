@@ -89,7 +89,7 @@ public:
     audio_mode_t mode_;
     std::shared_ptr<StreamOutPrimary> stream_out_primary_;
     struct pal_volume_data *pal_vol_;
-    int VoiceSetParameters(const char *kvpairs);
+    int VoiceSetParameters(struct str_parms *parms);
     void VoiceGetParameters(struct str_parms *query, struct str_parms *reply);
     int RouteStream(const std::set<audio_devices_t>&);
     bool is_valid_call_state(int call_state);
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_TAG "AHAL: CapturePosition"
+#include "AudioCommon.h"
+#include "CapturePosition.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <log/log.h>
+
+CapturePosition::CapturePosition() :
+    frames_(0),
+    timeNs_(0),
+    valid_(false),
+    seq_(0),
+    pubFrames_(0),
+    pubTimeNs_(0),
+    restarts_(0),
+    maxLateNs_(0)
+{
+}
+
+void CapturePosition::Update(uint64_t frames, int64_t nowNs, uint32_t sampleRate)
+{
+    int64_t predictedNs = 0, lateNs = 0;
+
+    if (valid_ && sampleRate && frames >= frames_) {
+        predictedNs = timeNs_ + (int64_t)((frames - frames_) * 1000000000ULL / sampleRate);
+        lateNs = nowNs - predictedNs;
+    }
+
+    if (!valid_ || !sampleRate || frames < frames_ || lateNs > CAPTURE_POSITION_MAX_LATE_NS) {
+        /* first read, standby or a stall, start over from this read */
+        if (valid_) {
+            restarts_.fetch_add(1, std::memory_order_relaxed);
+            AHAL_VERBOSE("restart at %" PRIu64 " frames, %" PRId64 "ns late", frames, lateNs);
+        }
+        timeNs_ = nowNs;
+        valid_ = true;
+    } else if (lateNs <= 0) {
+        timeNs_ = nowNs;
+    } else {
+        timeNs_ = predictedNs + (lateNs >> CAPTURE_POSITION_FILTER_SHIFT);
+        if (lateNs > maxLateNs_.load(std::memory_order_relaxed))
+            maxLateNs_.store(lateNs, std::memory_order_relaxed);
+    }
+    frames_ = frames;
+
+    seq_.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    pubFrames_.store(frames_, std::memory_order_relaxed);
+    pubTimeNs_.store(timeNs_, std::memory_order_relaxed);
+    seq_.fetch_add(1, std::memory_order_release);
+}
+
+bool CapturePosition::Get(uint64_t *frames, int64_t *timeNs)
+{
+    uint32_t seq = 0;
+
+    do {
+        seq = seq_.load(std::memory_order_acquire);
+        *frames = pubFrames_.load(std::memory_order_relaxed);
+        *timeNs = pubTimeNs_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((seq & 1) || seq != seq_.load(std::memory_order_relaxed));
+
+    return seq != 0;
+}
+
+void CapturePosition::Dump(int fd)
+{
+    dprintf(fd, "    capture position: restarts %" PRIu64 ", max late %" PRId64 "us\n",
+            restarts_.load(std::memory_order_relaxed),
+            maxLateNs_.load(std::memory_order_relaxed) / 1000);
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ANDROID_HARDWARE_AHAL_CAPTURE_POSITION_H_
+#define ANDROID_HARDWARE_AHAL_CAPTURE_POSITION_H_
+
+#include <stdint.h>
+
+#include <atomic>
+
+/* a read completing later than the model by more than this restarts it */
+#define CAPTURE_POSITION_MAX_LATE_NS 20000000LL
+/* weight of a late read in the model, as a shift */
+#define CAPTURE_POSITION_FILTER_SHIFT 4
+
+/*
+ * Frames read vs. time model of a capture stream. Reads block until PAL
+ * hands over a period, so their completion times are the capture times
+ * plus scheduling delay. The model follows the frame count at the nominal
+ * rate, moves to any read that completes earlier than predicted and only
+ * slowly towards late ones, which keeps wakeup jitter out of the reported
+ * timestamps.
+ *
+ * Update() is called by the reading thread only. Get() may be called from
+ * any thread and does not block the reader.
+ */
+class CapturePosition {
+public:
+    CapturePosition();
+    void Update(uint64_t frames, int64_t nowNs, uint32_t sampleRate);
+    /* returns false until the first read */
+    bool Get(uint64_t *frames, int64_t *timeNs);
+    void Dump(int fd);
+private:
+    /* reader thread state */
+    uint64_t frames_;
+    int64_t timeNs_;
+    bool valid_;
+
+    /* published position, consistent when seq_ is even and unchanged */
+    std::atomic<uint32_t> seq_;
+    std::atomic<uint64_t> pubFrames_;
+    std::atomic<int64_t> pubTimeNs_;
+
+    std::atomic<uint64_t> restarts_;
+    std::atomic<int64_t> maxLateNs_;
+};
+
+#endif  // ANDROID_HARDWARE_AHAL_CAPTURE_POSITION_H_
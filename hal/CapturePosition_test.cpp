@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "CapturePosition.h"
+
+namespace {
+
+const uint32_t kRate = 48000;
+const uint64_t kPeriod = 960;                   /* 20 ms */
+const int64_t kPeriodNs = 20000000LL;
+const int64_t kMs = 1000000LL;
+
+struct Sample {
+    uint64_t frames;
+    int64_t timeNs;
+};
+
+Sample Get(CapturePosition &pos)
+{
+    Sample s = {};
+
+    EXPECT_TRUE(pos.Get(&s.frames, &s.timeNs));
+    return s;
+}
+
+}  // namespace
+
+TEST(CapturePositionTest, InvalidBeforeFirstRead)
+{
+    CapturePosition pos;
+    uint64_t frames = 0;
+    int64_t timeNs = 0;
+
+    EXPECT_FALSE(pos.Get(&frames, &timeNs));
+}
+
+TEST(CapturePositionTest, FirstReadAnchorsModel)
+{
+    CapturePosition pos;
+
+    pos.Update(kPeriod, 5 * kMs, kRate);
+    EXPECT_EQ(kPeriod, Get(pos).frames);
+    EXPECT_EQ(5 * kMs, Get(pos).timeNs);
+}
+
+TEST(CapturePositionTest, EarlyReadSnapsToReadTime)
+{
+    CapturePosition pos;
+
+    pos.Update(kPeriod, 100 * kMs, kRate);
+    /* predicted 120 ms, the read completed 2 ms earlier */
+    pos.Update(2 * kPeriod, 118 * kMs, kRate);
+    EXPECT_EQ(118 * kMs, Get(pos).timeNs);
+}
+
+TEST(CapturePositionTest, LateReadMovesModelSlowly)
+{
+    CapturePosition pos;
+
+    pos.Update(kPeriod, 100 * kMs, kRate);
+    pos.Update(2 * kPeriod, 120 * kMs + 8 * kMs, kRate);
+    EXPECT_EQ(120 * kMs + ((8 * kMs) >> CAPTURE_POSITION_FILTER_SHIFT), Get(pos).timeNs);
+}
+
+TEST(CapturePositionTest, FiltersWakeupJitter)
+{
+    CapturePosition pos;
+    int64_t last = 0, lastRead = 0;
+    double modelErr = 0, readErr = 0;
+
+    srand(1);
+    for (uint64_t i = 1; i <= 500; i++) {
+        /* reads complete up to 4 ms after the period boundary */
+        int64_t read = (int64_t)i * kPeriodNs + (rand() % 4000) * 1000LL;
+        pos.Update(i * kPeriod, read, kRate);
+
+        Sample s = Get(pos);
+        EXPECT_EQ(i * kPeriod, s.frames);
+        /* never reported later than the read that produced it */
+        EXPECT_LE(s.timeNs, read);
+        if (i > 1) {
+            modelErr += (double)(s.timeNs - last - kPeriodNs) * (s.timeNs - last - kPeriodNs);
+            readErr += (double)(read - lastRead - kPeriodNs) * (read - lastRead - kPeriodNs);
+        }
+        last = s.timeNs;
+        lastRead = read;
+    }
+    /* timestamp steps jitter far less than the raw read completions */
+    EXPECT_LT(modelErr, readErr / 4);
+}
+
+TEST(CapturePositionTest, RestartsOnStallAndStandby)
+{
+    CapturePosition pos;
+    int64_t late = CAPTURE_POSITION_MAX_LATE_NS + kMs;
+
+    pos.Update(kPeriod, 100 * kMs, kRate);
+    pos.Update(2 * kPeriod, 120 * kMs + late, kRate);
+    EXPECT_EQ(120 * kMs + late, Get(pos).timeNs);
+
+    /* frame count starts over after standby */
+    pos.Update(kPeriod, 500 * kMs, kRate);
+    EXPECT_EQ(kPeriod, Get(pos).frames);
+    EXPECT_EQ(500 * kMs, Get(pos).timeNs);
+
+    /* unknown rate cannot predict anything either */
+    pos.Update(2 * kPeriod, 530 * kMs, 0);
+    EXPECT_EQ(530 * kMs, Get(pos).timeNs);
+}
+
+TEST(CapturePositionTest, ReadersSeeConsistentPairs)
+{
+    CapturePosition pos;
+    std::atomic<bool> done(false);
+    std::thread reader([&] {
+        uint64_t frames = 0;
+        int64_t timeNs = 0;
+        while (!done.load()) {
+            if (!pos.Get(&frames, &timeNs))
+                continue;
+            /* on time reads keep time and frames on one line */
+            ASSERT_EQ((int64_t)(frames / kPeriod) * kPeriodNs, timeNs);
+        }
+    });
+
+    for (uint64_t i = 1; i <= 200000; i++)
+        pos.Update(i * kPeriod, (int64_t)i * kPeriodNs, kRate);
+    done.store(true);
+    reader.join();
+}
@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_TAG "AHAL: ControlWorker"
+#include "AudioCommon.h"
+#include "ControlWorker.h"
+#include "StreamStats.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include <log/log.h>
+
+/* pending requests are few, one per stream and kind */
+#define CONTROL_WORKER_INITIAL_TASKS 16
+
+ControlWorker::ControlWorker() :
+    done_(false),
+    running_(nullptr),
+    runningSeq_(0),
+    seq_(0),
+    posted_(0),
+    coalesced_(0),
+    executed_(0),
+    maxLateUs_(0)
+{
+    tasks_.reserve(CONTROL_WORKER_INITIAL_TASKS);
+}
+
+ControlWorker::~ControlWorker()
+{
+    if (!thread_)
+        return;
+
+    lock_.lock();
+    done_ = true;
+    cond_.notify_one();
+    lock_.unlock();
+    thread_->join();
+}
+
+uint64_t ControlWorker::Post(const void *owner, control_task_t type, std::function<void()> fn,
+                             int64_t delayUs)
+{
+    int64_t dueUs = StreamStats::NowUs() + (delayUs > 0 ? delayUs : 0);
+    uint64_t seq = 0;
+
+    lock_.lock();
+    if (!thread_)
+        thread_ = std::make_unique<std::thread>([this]() { ThreadLoop(); });
+
+    seq = ++seq_;
+    posted_++;
+    for (auto &task : tasks_) {
+        if (task.owner != owner || task.type != type)
+            continue;
+        /* keep the earlier due time, only the latest request is run */
+        if (dueUs < task.dueUs)
+            task.dueUs = dueUs;
+        task.seq = seq;
+        task.fn = std::move(fn);
+        coalesced_++;
+        cond_.notify_one();
+        lock_.unlock();
+        return seq;
+    }
+
+    tasks_.push_back({owner, type, dueUs, seq, std::move(fn)});
+    cond_.notify_one();
+    lock_.unlock();
+    return seq;
+}
+
+void ControlWorker::Cancel(const void *owner)
+{
+    std::unique_lock<std::mutex> l(lock_);
+    bool self = thread_ && std::this_thread::get_id() == thread_->get_id();
+
+    for (auto it = tasks_.begin(); it != tasks_.end();) {
+        if (it->owner == owner)
+            it = tasks_.erase(it);
+        else
+            ++it;
+    }
+    /* a request may cancel its own owner, do not wait for ourselves */
+    if (self || running_ != owner)
+        return;
+
+    /* a running request may post again for its owner, the worker drops that one */
+    cancelling_.push_back(owner);
+    while (running_ == owner)
+        idle_cond_.wait(l);
+    cancelling_.erase(std::find(cancelling_.begin(), cancelling_.end(), owner));
+}
+
+bool ControlWorker::Wait(uint64_t seq, int64_t timeoutUs)
+{
+    std::unique_lock<std::mutex> l(lock_);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(timeoutUs);
+    bool pending = false;
+
+    if (thread_ && std::this_thread::get_id() == thread_->get_id())
+        return false;
+
+    while (true) {
+        pending = runningSeq_ == seq;
+        for (auto &task : tasks_) {
+            if (task.seq == seq)
+                pending = true;
+        }
+        if (!pending)
+            return true;
+        if (timeoutUs <= 0)
+            idle_cond_.wait(l);
+        else if (idle_cond_.wait_until(l, deadline) == std::cv_status::timeout)
+            return false;
+    }
+}
+
+void ControlWorker::ThreadLoop()
+{
+    std::unique_lock<std::mutex> l(lock_);
+    std::function<void()> fn;
+    size_t next = 0;
+    int64_t nowUs = 0;
+
+    while (!done_) {
+        if (tasks_.empty()) {
+            cond_.wait(l);
+            continue;
+        }
+
+        next = 0;
+        for (size_t i = 1; i < tasks_.size(); i++) {
+            if (tasks_[i].dueUs < tasks_[next].dueUs)
+                next = i;
+        }
+        nowUs = StreamStats::NowUs();
+        if (tasks_[next].dueUs > nowUs) {
+            cond_.wait_for(l, std::chrono::microseconds(tasks_[next].dueUs - nowUs));
+            continue;
+        }
+
+        if (nowUs - tasks_[next].dueUs > maxLateUs_)
+            maxLateUs_ = nowUs - tasks_[next].dueUs;
+        running_ = tasks_[next].owner;
+        runningSeq_ = tasks_[next].seq;
+        fn = std::move(tasks_[next].fn);
+        tasks_.erase(tasks_.begin() + next);
+
+        l.unlock();
+        fn();
+        fn = nullptr;
+        l.lock();
+
+        executed_++;
+        if (std::find(cancelling_.begin(), cancelling_.end(), running_) != cancelling_.end()) {
+            for (auto it = tasks_.begin(); it != tasks_.end();) {
+                if (it->owner == running_)
+                    it = tasks_.erase(it);
+                else
+                    ++it;
+            }
+        }
+        running_ = nullptr;
+        runningSeq_ = 0;
+        idle_cond_.notify_all();
+    }
+}
+
+void ControlWorker::Dump(int fd)
+{
+    lock_.lock();
+    dprintf(fd, "Control worker: posted %" PRIu64 " coalesced %" PRIu64 " executed %" PRIu64
+            " pending %zu, max late %" PRId64 "us\n",
+            posted_, coalesced_, executed_, tasks_.size(), maxLateUs_);
+    lock_.unlock();
+}
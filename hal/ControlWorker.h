@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ANDROID_HARDWARE_AHAL_CONTROL_WORKER_H_
+#define ANDROID_HARDWARE_AHAL_CONTROL_WORKER_H_
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* kinds of control requests, one pending request per owner and kind */
+typedef enum {
+    CONTROL_TASK_VOLUME = 0,
+    CONTROL_TASK_ROUTE,
+} control_task_t;
+
+/*
+ * Runs stream control requests (volume, device switch) off the calling
+ * thread. A request posted while an earlier one of the same owner and kind
+ * is still pending replaces it, so a burst of requests reaches PAL as the
+ * latest one only. Owners must Cancel() before they go away.
+ */
+class ControlWorker {
+public:
+    ControlWorker();
+    ~ControlWorker();
+    /* runs fn no earlier than delayUs from now, returns the request sequence */
+    uint64_t Post(const void *owner, control_task_t type, std::function<void()> fn,
+                  int64_t delayUs = 0);
+    /* drops the pending requests of owner and waits for the one running */
+    void Cancel(const void *owner);
+    /*
+     * Waits until request seq has run or was replaced by a later one, at
+     * most timeoutUs if it is positive. Returns false on timeout.
+     */
+    bool Wait(uint64_t seq, int64_t timeoutUs);
+    void Dump(int fd);
+private:
+    struct control_task {
+        const void *owner;
+        control_task_t type;
+        int64_t dueUs;
+        uint64_t seq;
+        std::function<void()> fn;
+    };
+
+    void ThreadLoop();
+
+    std::mutex lock_;
+    std::condition_variable cond_;
+    std::condition_variable idle_cond_;
+    std::unique_ptr<std::thread> thread_;
+    bool done_;
+    std::vector<struct control_task> tasks_;
+    /* owners with a Cancel() waiting for their running request */
+    std::vector<const void *> cancelling_;
+    /* owner and sequence of the request being run, if any */
+    const void *running_;
+    uint64_t runningSeq_;
+    uint64_t seq_;
+    uint64_t posted_;
+    uint64_t coalesced_;
+    uint64_t executed_;
+    int64_t maxLateUs_;
+};
+
+#endif  // ANDROID_HARDWARE_AHAL_CONTROL_WORKER_H_
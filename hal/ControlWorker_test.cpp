@@ -0,0 +1,322 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ControlWorker.h"
+#include "StreamStats.h"
+
+namespace {
+
+const int64_t kMsUs = 1000;
+
+/* parks the worker thread until Open() so that later requests stay pending */
+class Gate {
+public:
+    Gate() : opened_(promise_.get_future().share()) {}
+    void Open() { promise_.set_value(); }
+    std::function<void()> Task()
+    {
+        std::shared_future<void> f = opened_;
+        return [f, this]() { entered_.store(true); f.wait(); };
+    }
+    void WaitEntered()
+    {
+        while (!entered_.load())
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+private:
+    std::promise<void> promise_;
+    std::shared_future<void> opened_;
+    std::atomic<bool> entered_{false};
+};
+
+/* records the order in which requests ran */
+class Log {
+public:
+    std::function<void()> Add(int id)
+    {
+        return [this, id]() {
+            std::lock_guard<std::mutex> l(lock_);
+            ids_.push_back(id);
+        };
+    }
+    std::vector<int> Ids()
+    {
+        std::lock_guard<std::mutex> l(lock_);
+        return ids_;
+    }
+private:
+    std::mutex lock_;
+    std::vector<int> ids_;
+};
+
+int owners[4];
+
+}  // namespace
+
+TEST(ControlWorkerTest, RunsPostedRequest)
+{
+    ControlWorker worker;
+    std::promise<void> ran;
+
+    worker.Post(&owners[0], CONTROL_TASK_VOLUME, [&ran]() { ran.set_value(); });
+    EXPECT_EQ(std::future_status::ready,
+              ran.get_future().wait_for(std::chrono::seconds(5)));
+}
+
+TEST(ControlWorkerTest, CoalescesPerOwnerAndType)
+{
+    ControlWorker worker;
+    Gate gate;
+    Log log;
+
+    worker.Post(&owners[3], CONTROL_TASK_VOLUME, gate.Task());
+    gate.WaitEntered();
+
+    /* a burst of volume changes only reaches PAL as the latest one */
+    for (int i = 0; i < 10; i++)
+        worker.Post(&owners[0], CONTROL_TASK_VOLUME, log.Add(i));
+    /* other kinds and other owners are kept */
+    worker.Post(&owners[0], CONTROL_TASK_ROUTE, log.Add(100));
+    worker.Post(&owners[1], CONTROL_TASK_VOLUME, log.Add(200));
+
+    gate.Open();
+    worker.Cancel(&owners[3]);
+    uint64_t last = worker.Post(&owners[2], CONTROL_TASK_VOLUME, []() {});
+    worker.Wait(last, 0);
+
+    std::vector<int> ids = log.Ids();
+    ASSERT_EQ(3u, ids.size());
+    EXPECT_EQ(9, ids[0]);
+    EXPECT_EQ(100, ids[1]);
+    EXPECT_EQ(200, ids[2]);
+}
+
+TEST(ControlWorkerTest, RunsByDueTime)
+{
+    ControlWorker worker;
+    Log log;
+    int64_t start = StreamStats::NowUs();
+
+    uint64_t late = worker.Post(&owners[0], CONTROL_TASK_VOLUME, log.Add(0), 60 * kMsUs);
+    worker.Post(&owners[1], CONTROL_TASK_VOLUME, log.Add(1), 20 * kMsUs);
+    worker.Wait(late, 0);
+
+    EXPECT_GE(StreamStats::NowUs() - start, 60 * kMsUs);
+    std::vector<int> ids = log.Ids();
+    ASSERT_EQ(2u, ids.size());
+    EXPECT_EQ(1, ids[0]);
+    EXPECT_EQ(0, ids[1]);
+}
+
+TEST(ControlWorkerTest, CoalescedRequestKeepsEarlierDueTime)
+{
+    ControlWorker worker;
+    Log log;
+    int64_t start = StreamStats::NowUs();
+
+    worker.Post(&owners[0], CONTROL_TASK_VOLUME, log.Add(0), 10 * kMsUs);
+    uint64_t seq = worker.Post(&owners[0], CONTROL_TASK_VOLUME, log.Add(1), 5000 * kMsUs);
+    worker.Wait(seq, 0);
+
+    /* replacing a request must not push it out */
+    EXPECT_LT(StreamStats::NowUs() - start, 2000 * kMsUs);
+    EXPECT_EQ(std::vector<int>({1}), log.Ids());
+}
+
+TEST(ControlWorkerTest, CancelDropsPendingRequests)
+{
+    ControlWorker worker;
+    Gate gate;
+    Log log;
+
+    worker.Post(&owners[3], CONTROL_TASK_VOLUME, gate.Task());
+    gate.WaitEntered();
+    worker.Post(&owners[0], CONTROL_TASK_VOLUME, log.Add(0));
+    worker.Post(&owners[0], CONTROL_TASK_ROUTE, log.Add(1));
+    uint64_t kept = worker.Post(&owners[1], CONTROL_TASK_VOLUME, log.Add(2));
+
+    worker.Cancel(&owners[0]);
+    gate.Open();
+    worker.Wait(kept, 0);
+    EXPECT_EQ(std::vector<int>({2}), log.Ids());
+}
+
+TEST(ControlWorkerTest, CancelWaitsForRunningRequest)
+{
+    ControlWorker worker;
+    std::atomic<bool> finished(false);
+    std::atomic<bool> started(false);
+
+    worker.Post(&owners[0], CONTROL_TASK_ROUTE, [&]() {
+        started.store(true);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        finished.store(true);
+    });
+    while (!started.load())
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+
+    /* the owner may be destroyed right after Cancel() returns */
+    worker.Cancel(&owners[0]);
+    EXPECT_TRUE(finished.load());
+}
+
+TEST(ControlWorkerTest, CancelDropsRepostFromRunningRequest)
+{
+    ControlWorker worker;
+    std::atomic<bool> started(false);
+    std::atomic<bool> reposted(false);
+    std::atomic<bool> repostRan(false);
+
+    worker.Post(&owners[0], CONTROL_TASK_ROUTE, [&]() {
+        started.store(true);
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        worker.Post(&owners[0], CONTROL_TASK_VOLUME, [&]() { repostRan.store(true); });
+        reposted.store(true);
+    });
+    while (!started.load())
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+
+    worker.Cancel(&owners[0]);
+    EXPECT_TRUE(reposted.load());
+
+    uint64_t last = worker.Post(&owners[1], CONTROL_TASK_VOLUME, []() {});
+    worker.Wait(last, 0);
+    EXPECT_FALSE(repostRan.load());
+}
+
+TEST(ControlWorkerTest, RequestMayCancelItsOwner)
+{
+    ControlWorker worker;
+    std::promise<void> ran;
+
+    worker.Post(&owners[0], CONTROL_TASK_ROUTE, [&]() {
+        worker.Cancel(&owners[0]);
+        ran.set_value();
+    });
+    EXPECT_EQ(std::future_status::ready,
+              ran.get_future().wait_for(std::chrono::seconds(5)));
+}
+
+TEST(ControlWorkerTest, WaitReturnsAfterRequestRan)
+{
+    ControlWorker worker;
+    std::atomic<bool> ran(false);
+
+    uint64_t seq = worker.Post(&owners[0], CONTROL_TASK_ROUTE, [&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        ran.store(true);
+    });
+    EXPECT_TRUE(worker.Wait(seq, 5000 * kMsUs));
+    EXPECT_TRUE(ran.load());
+
+    /* long done, nothing to wait for */
+    EXPECT_TRUE(worker.Wait(seq, 5000 * kMsUs));
+}
+
+TEST(ControlWorkerTest, WaitTimesOut)
+{
+    ControlWorker worker;
+    Gate gate;
+
+    worker.Post(&owners[3], CONTROL_TASK_VOLUME, gate.Task());
+    gate.WaitEntered();
+    uint64_t seq = worker.Post(&owners[0], CONTROL_TASK_ROUTE, []() {});
+
+    int64_t start = StreamStats::NowUs();
+    EXPECT_FALSE(worker.Wait(seq, 30 * kMsUs));
+    int64_t waited = StreamStats::NowUs() - start;
+    EXPECT_GE(waited, 30 * kMsUs);
+    EXPECT_LT(waited, 2000 * kMsUs);
+
+    gate.Open();
+    EXPECT_TRUE(worker.Wait(seq, 5000 * kMsUs));
+}
+
+TEST(ControlWorkerTest, WaitOnReplacedRequestDoesNotBlock)
+{
+    ControlWorker worker;
+    Gate gate;
+
+    worker.Post(&owners[3], CONTROL_TASK_VOLUME, gate.Task());
+    gate.WaitEntered();
+    uint64_t first = worker.Post(&owners[0], CONTROL_TASK_ROUTE, []() {});
+    uint64_t second = worker.Post(&owners[0], CONTROL_TASK_ROUTE, []() {});
+
+    /* the first routing request is superseded, its caller does not wait */
+    EXPECT_TRUE(worker.Wait(first, 10 * kMsUs));
+    EXPECT_FALSE(worker.Wait(second, 10 * kMsUs));
+    gate.Open();
+    EXPECT_TRUE(worker.Wait(second, 5000 * kMsUs));
+}
+
+TEST(ControlWorkerTest, WaitOnCancelledRequestDoesNotBlock)
+{
+    ControlWorker worker;
+    Gate gate;
+
+    worker.Post(&owners[3], CONTROL_TASK_VOLUME, gate.Task());
+    gate.WaitEntered();
+    uint64_t seq = worker.Post(&owners[0], CONTROL_TASK_ROUTE, []() {});
+    worker.Cancel(&owners[0]);
+    EXPECT_TRUE(worker.Wait(seq, 10 * kMsUs));
+    gate.Open();
+}
+
+TEST(ControlWorkerTest, WaitFromWorkerThreadFails)
+{
+    ControlWorker worker;
+    std::promise<bool> result;
+    Gate gate;
+
+    worker.Post(&owners[3], CONTROL_TASK_VOLUME, gate.Task());
+    gate.WaitEntered();
+    uint64_t pending = worker.Post(&owners[1], CONTROL_TASK_VOLUME, []() {});
+    worker.Post(&owners[0], CONTROL_TASK_ROUTE, [&]() {
+        /* the worker would wait for itself */
+        result.set_value(worker.Wait(pending, 5000 * kMsUs));
+    });
+
+    int64_t start = StreamStats::NowUs();
+    gate.Open();
+    std::future<bool> f = result.get_future();
+    ASSERT_EQ(std::future_status::ready, f.wait_for(std::chrono::seconds(5)));
+    EXPECT_FALSE(f.get());
+    EXPECT_LT(StreamStats::NowUs() - start, 2000 * kMsUs);
+}
@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_TAG "AHAL: FormatConverter"
+#include "AudioCommon.h"
+#include "FormatConverter.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <log/log.h>
+#include <audio_utils/format.h>
+#include <audio_utils/primitives.h>
+
+/* adapts an audio_utils primitive to the kernel signature */
+#define PRIMITIVE_KERNEL(name, dst_type, src_type, primitive)                  \
+    static void name(FormatConverter * /* conv */, void *dst,                 \
+                     const void *src, size_t samples) {                       \
+        primitive((dst_type *)dst, (const src_type *)src, samples);            \
+    }
+
+PRIMITIVE_KERNEL(convert_float_to_i16, int16_t, float, memcpy_to_i16_from_float)
+PRIMITIVE_KERNEL(convert_float_to_i32, int32_t, float, memcpy_to_i32_from_float)
+PRIMITIVE_KERNEL(convert_float_to_p24, uint8_t, float, memcpy_to_p24_from_float)
+PRIMITIVE_KERNEL(convert_float_to_q8_23, int32_t, float, memcpy_to_q8_23_from_float_with_clamp)
+PRIMITIVE_KERNEL(convert_p24_to_i32, int32_t, uint8_t, memcpy_to_i32_from_p24)
+PRIMITIVE_KERNEL(convert_i32_to_p24, uint8_t, int32_t, memcpy_to_p24_from_i32)
+PRIMITIVE_KERNEL(convert_q8_23_to_p24, uint8_t, int32_t, memcpy_to_p24_from_q8_23)
+PRIMITIVE_KERNEL(convert_i16_to_i32, int32_t, int16_t, memcpy_to_i32_from_i16)
+PRIMITIVE_KERNEL(convert_i32_to_i16, int16_t, int32_t, memcpy_to_i16_from_i32)
+PRIMITIVE_KERNEL(convert_i16_to_float, float, int16_t, memcpy_to_float_from_i16)
+PRIMITIVE_KERNEL(convert_i32_to_float, float, int32_t, memcpy_to_float_from_i32)
+PRIMITIVE_KERNEL(convert_p24_to_float, float, uint8_t, memcpy_to_float_from_p24)
+
+#undef PRIMITIVE_KERNEL
+
+FormatConverter::FormatConverter() :
+    kernel_(nullptr),
+    srcFormat_(AUDIO_FORMAT_DEFAULT),
+    dstFormat_(AUDIO_FORMAT_DEFAULT),
+    srcSampleSize_(0),
+    dstSampleSize_(0),
+    channels_(0),
+    chunkBuffer_(nullptr),
+    chunkBufferSize_(0),
+    ditherSeed_(1)
+{
+}
+
+FormatConverter::~FormatConverter()
+{
+    Reset();
+}
+
+void FormatConverter::Reset()
+{
+    if (chunkBuffer_) {
+        free(chunkBuffer_);
+        chunkBuffer_ = nullptr;
+    }
+    chunkBufferSize_ = 0;
+    kernel_ = nullptr;
+}
+
+/* float to 16 bit with triangular PDF dither of +/- 1 LSB */
+void FormatConverter::ConvertFloatToI16Dither(FormatConverter *conv, void *dst,
+                                              const void *src, size_t samples)
+{
+    int16_t *out = (int16_t *)dst;
+    const float *in = (const float *)src;
+    uint32_t seed = conv->ditherSeed_;
+    int32_t r1, r2;
+    float val;
+
+    for (size_t i = 0; i < samples; i++) {
+        seed = seed * 1664525 + 1013904223;
+        r1 = (int32_t)(seed >> 16);
+        seed = seed * 1664525 + 1013904223;
+        r2 = (int32_t)(seed >> 16);
+
+        val = in[i] * 32768.0f + (float)(r1 - r2) / 65536.0f;
+        if (val >= 32767.0f)
+            out[i] = INT16_MAX;
+        else if (val <= -32768.0f)
+            out[i] = INT16_MIN;
+        else
+            out[i] = (int16_t)lrintf(val);
+    }
+    conv->ditherSeed_ = seed;
+}
+
+void FormatConverter::ConvertGeneric(FormatConverter *conv, void *dst,
+                                     const void *src, size_t samples)
+{
+    memcpy_by_audio_format(dst, conv->dstFormat_, src, conv->srcFormat_, samples);
+}
+
+FormatConverter::kernel_t FormatConverter::SelectKernel(audio_format_t srcFormat,
+                                                        audio_format_t dstFormat,
+                                                        format_converter_dither_t dither)
+{
+    switch (srcFormat) {
+    case AUDIO_FORMAT_PCM_FLOAT:
+        if (dstFormat == AUDIO_FORMAT_PCM_16_BIT)
+            return dither == FORMAT_CONVERTER_DITHER_TPDF ?
+                    ConvertFloatToI16Dither : convert_float_to_i16;
+        if (dstFormat == AUDIO_FORMAT_PCM_32_BIT)
+            return convert_float_to_i32;
+        if (dstFormat == AUDIO_FORMAT_PCM_24_BIT_PACKED)
+            return convert_float_to_p24;
+        if (dstFormat == AUDIO_FORMAT_PCM_8_24_BIT)
+            return convert_float_to_q8_23;
+        break;
+    case AUDIO_FORMAT_PCM_24_BIT_PACKED:
+        if (dstFormat == AUDIO_FORMAT_PCM_32_BIT)
+            return convert_p24_to_i32;
+        if (dstFormat == AUDIO_FORMAT_PCM_FLOAT)
+            return convert_p24_to_float;
+        break;
+    case AUDIO_FORMAT_PCM_32_BIT:
+        if (dstFormat == AUDIO_FORMAT_PCM_24_BIT_PACKED)
+            return convert_i32_to_p24;
+        if (dstFormat == AUDIO_FORMAT_PCM_16_BIT)
+            return convert_i32_to_i16;
+        if (dstFormat == AUDIO_FORMAT_PCM_FLOAT)
+            return convert_i32_to_float;
+        break;
+    case AUDIO_FORMAT_PCM_8_24_BIT:
+        if (dstFormat == AUDIO_FORMAT_PCM_24_BIT_PACKED)
+            return convert_q8_23_to_p24;
+        break;
+    case AUDIO_FORMAT_PCM_16_BIT:
+        if (dstFormat == AUDIO_FORMAT_PCM_32_BIT)
+            return convert_i16_to_i32;
+        if (dstFormat == AUDIO_FORMAT_PCM_FLOAT)
+            return convert_i16_to_float;
+        break;
+    default:
+        break;
+    }
+
+    return ConvertGeneric;
+}
+
+int FormatConverter::Configure(audio_format_t srcFormat, audio_format_t dstFormat,
+                               uint32_t channels, size_t maxChunkBytes,
+                               format_converter_dither_t dither)
+{
+    size_t chunkSize = 0;
+    uint32_t dstFrameSize = 0;
+
+    Reset();
+    if (srcFormat == dstFormat)
+        return 0;
+
+    if (!audio_is_linear_pcm(srcFormat) || !audio_is_linear_pcm(dstFormat) ||
+        channels == 0) {
+        AHAL_ERR("unsupported conversion %#x -> %#x channels %u",
+                 srcFormat, dstFormat, channels);
+        return -EINVAL;
+    }
+
+    srcFormat_ = srcFormat;
+    dstFormat_ = dstFormat;
+    srcSampleSize_ = audio_bytes_per_sample(srcFormat);
+    dstSampleSize_ = audio_bytes_per_sample(dstFormat);
+    channels_ = channels;
+    dstFrameSize = dstSampleSize_ * channels_;
+
+    /* whole frames only, bounded so that the staging buffer stays cache resident */
+    chunkSize = maxChunkBytes < FORMAT_CONVERTER_MAX_CHUNK_BYTES ?
+                maxChunkBytes : FORMAT_CONVERTER_MAX_CHUNK_BYTES;
+    chunkSize -= chunkSize % dstFrameSize;
+    if (chunkSize == 0)
+        chunkSize = dstFrameSize;
+
+    chunkBuffer_ = (uint8_t *)calloc(1, chunkSize);
+    if (!chunkBuffer_) {
+        AHAL_ERR("Failed to allocate conversion buffer of %zu bytes", chunkSize);
+        return -ENOMEM;
+    }
+    chunkBufferSize_ = chunkSize;
+    kernel_ = SelectKernel(srcFormat, dstFormat, dither);
+
+    AHAL_DBG("format %#x -> %#x, channels %u, chunk %zu bytes, dither %d",
+             srcFormat, dstFormat, channels, chunkSize, dither);
+    return 0;
+}
+
+ssize_t FormatConverter::Process(const void *src, size_t srcBytes, const chunk_sink_t &sink)
+{
+    const uint8_t *in = (const uint8_t *)src;
+    size_t maxSamples = 0, chunkSamples = 0, chunkBytes = 0;
+    size_t samples = 0, consumed = 0;
+    ssize_t ret = 0;
+
+    if (!kernel_ || !chunkBuffer_) {
+        AHAL_ERR("converter not configured");
+        return -EINVAL;
+    }
+
+    maxSamples = chunkBufferSize_ / dstSampleSize_;
+    samples = srcBytes / srcSampleSize_;
+    samples -= samples % channels_;
+
+    while (samples > 0) {
+        chunkSamples = samples < maxSamples ? samples : maxSamples;
+        chunkBytes = chunkSamples * dstSampleSize_;
+        kernel_(this, chunkBuffer_, in, chunkSamples);
+
+        ret = sink(chunkBuffer_, chunkBytes);
+        if (ret < 0)
+            return consumed > 0 ? (ssize_t)consumed : ret;
+
+        consumed += ((size_t)ret / dstSampleSize_) * srcSampleSize_;
+        /* short write, let the caller come back with the remainder */
+        if ((size_t)ret < chunkBytes)
+            break;
+
+        in += chunkSamples * srcSampleSize_;
+        samples -= chunkSamples;
+    }
+
+    return consumed;
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ANDROID_HARDWARE_AHAL_FORMAT_CONVERTER_H_
+#define ANDROID_HARDWARE_AHAL_FORMAT_CONVERTER_H_
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <functional>
+
+#include <system/audio.h>
+
+/* upper bound of one converted chunk, keeps the staging buffer cache resident */
+#define FORMAT_CONVERTER_MAX_CHUNK_BYTES (32 * 1024)
+
+typedef enum {
+    FORMAT_CONVERTER_DITHER_NONE = 0,
+    FORMAT_CONVERTER_DITHER_TPDF,   /* triangular dither, float to 16 bit only */
+} format_converter_dither_t;
+
+/*
+ * PCM sample format conversion stage shared by the playback and capture
+ * paths. A kernel is picked per (source, destination) pair at Configure()
+ * time and data is converted through a preallocated staging buffer in
+ * chunks, so callers may hand over buffers of any size.
+ */
+class FormatConverter {
+public:
+    /* consumes one converted chunk, returns bytes consumed or -errno */
+    typedef std::function<ssize_t(const void *data, size_t bytes)> chunk_sink_t;
+
+    FormatConverter();
+    ~FormatConverter();
+    int Configure(audio_format_t srcFormat, audio_format_t dstFormat,
+                  uint32_t channels, size_t maxChunkBytes,
+                  format_converter_dither_t dither = FORMAT_CONVERTER_DITHER_NONE);
+    void Reset();
+    bool IsActive() { return kernel_ != nullptr; }
+    /* convert srcBytes and feed the sink chunk by chunk, returns source bytes consumed */
+    ssize_t Process(const void *src, size_t srcBytes, const chunk_sink_t &sink);
+private:
+    typedef void (*kernel_t)(FormatConverter *conv, void *dst, const void *src,
+                             size_t samples);
+
+    static void ConvertFloatToI16Dither(FormatConverter *conv, void *dst,
+                                        const void *src, size_t samples);
+    static void ConvertGeneric(FormatConverter *conv, void *dst,
+                               const void *src, size_t samples);
+    static kernel_t SelectKernel(audio_format_t srcFormat, audio_format_t dstFormat,
+                                 format_converter_dither_t dither);
+
+    kernel_t kernel_;
+    audio_format_t srcFormat_;
+    audio_format_t dstFormat_;
+    uint32_t srcSampleSize_;
+    uint32_t dstSampleSize_;
+    uint32_t channels_;
+    uint8_t *chunkBuffer_;
+    size_t chunkBufferSize_;
+    uint32_t ditherSeed_;
+};
+
+#endif  // ANDROID_HARDWARE_AHAL_FORMAT_CONVERTER_H_
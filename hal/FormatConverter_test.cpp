@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <audio_utils/format.h>
+
+#include "FormatConverter.h"
+
+namespace {
+
+struct FormatPair {
+    audio_format_t src;
+    audio_format_t dst;
+};
+
+const FormatPair kKernelPairs[] = {
+    {AUDIO_FORMAT_PCM_FLOAT, AUDIO_FORMAT_PCM_16_BIT},
+    {AUDIO_FORMAT_PCM_FLOAT, AUDIO_FORMAT_PCM_32_BIT},
+    {AUDIO_FORMAT_PCM_FLOAT, AUDIO_FORMAT_PCM_24_BIT_PACKED},
+    {AUDIO_FORMAT_PCM_FLOAT, AUDIO_FORMAT_PCM_8_24_BIT},
+    {AUDIO_FORMAT_PCM_24_BIT_PACKED, AUDIO_FORMAT_PCM_32_BIT},
+    {AUDIO_FORMAT_PCM_24_BIT_PACKED, AUDIO_FORMAT_PCM_FLOAT},
+    {AUDIO_FORMAT_PCM_32_BIT, AUDIO_FORMAT_PCM_24_BIT_PACKED},
+    {AUDIO_FORMAT_PCM_32_BIT, AUDIO_FORMAT_PCM_16_BIT},
+    {AUDIO_FORMAT_PCM_32_BIT, AUDIO_FORMAT_PCM_FLOAT},
+    {AUDIO_FORMAT_PCM_8_24_BIT, AUDIO_FORMAT_PCM_24_BIT_PACKED},
+    {AUDIO_FORMAT_PCM_16_BIT, AUDIO_FORMAT_PCM_32_BIT},
+    {AUDIO_FORMAT_PCM_16_BIT, AUDIO_FORMAT_PCM_FLOAT},
+    /* no dedicated kernel, goes through memcpy_by_audio_format */
+    {AUDIO_FORMAT_PCM_16_BIT, AUDIO_FORMAT_PCM_24_BIT_PACKED},
+};
+
+/* full scale ramp in the source format, including both extremes */
+std::vector<uint8_t> MakeSource(audio_format_t format, size_t samples)
+{
+    std::vector<float> ramp(samples);
+    std::vector<uint8_t> out(samples * audio_bytes_per_sample(format));
+
+    for (size_t i = 0; i < samples; i++)
+        ramp[i] = -1.0f + 2.0f * (float)i / (float)(samples - 1);
+    ramp[samples / 2] = 0.0f;
+
+    if (format == AUDIO_FORMAT_PCM_8_24_BIT) {
+        int32_t *q = (int32_t *)out.data();
+        for (size_t i = 0; i < samples; i++)
+            q[i] = (int32_t)(ramp[i] * 8388607.0f);
+    } else {
+        memcpy_by_audio_format(out.data(), format, ramp.data(),
+                               AUDIO_FORMAT_PCM_FLOAT, samples);
+    }
+    return out;
+}
+
+std::vector<uint8_t> Reference(const FormatPair &pair, const std::vector<uint8_t> &src)
+{
+    size_t samples = src.size() / audio_bytes_per_sample(pair.src);
+    std::vector<uint8_t> out(samples * audio_bytes_per_sample(pair.dst));
+
+    memcpy_by_audio_format(out.data(), pair.dst, src.data(), pair.src, samples);
+    return out;
+}
+
+/* collects everything handed to the sink, optionally cutting writes short */
+struct Sink {
+    std::vector<uint8_t> data;
+    std::vector<size_t> chunks;
+    size_t shortAt = SIZE_MAX;      /* call index that writes only half */
+    size_t failAt = SIZE_MAX;       /* call index that returns -EIO */
+
+    FormatConverter::chunk_sink_t Fn()
+    {
+        return [this](const void *buf, size_t bytes) -> ssize_t {
+            size_t call = chunks.size();
+            chunks.push_back(bytes);
+            if (call == failAt)
+                return -EIO;
+            if (call == shortAt)
+                bytes /= 2;
+            data.insert(data.end(), (const uint8_t *)buf, (const uint8_t *)buf + bytes);
+            return bytes;
+        };
+    }
+};
+
+}  // namespace
+
+TEST(FormatConverterTest, SameFormatIsPassthrough)
+{
+    FormatConverter conv;
+
+    EXPECT_EQ(0, conv.Configure(AUDIO_FORMAT_PCM_16_BIT, AUDIO_FORMAT_PCM_16_BIT, 2, 4096));
+    EXPECT_FALSE(conv.IsActive());
+}
+
+TEST(FormatConverterTest, RejectsInvalidConfig)
+{
+    FormatConverter conv;
+    Sink sink;
+    int16_t pcm[4] = {};
+
+    EXPECT_EQ(-EINVAL, conv.Configure(AUDIO_FORMAT_MP3, AUDIO_FORMAT_PCM_16_BIT, 2, 4096));
+    EXPECT_EQ(-EINVAL, conv.Configure(AUDIO_FORMAT_PCM_FLOAT, AUDIO_FORMAT_PCM_16_BIT, 0, 4096));
+    EXPECT_FALSE(conv.IsActive());
+    EXPECT_EQ(-EINVAL, conv.Process(pcm, sizeof(pcm), sink.Fn()));
+}
+
+TEST(FormatConverterTest, KernelsMatchReference)
+{
+    const size_t samples = 2 * 1001;
+
+    for (const FormatPair &pair : kKernelPairs) {
+        SCOPED_TRACE(testing::Message() << std::hex << pair.src << " -> " << pair.dst);
+        FormatConverter conv;
+        Sink sink;
+        std::vector<uint8_t> src = MakeSource(pair.src, samples);
+
+        ASSERT_EQ(0, conv.Configure(pair.src, pair.dst, 2, FORMAT_CONVERTER_MAX_CHUNK_BYTES));
+        ASSERT_TRUE(conv.IsActive());
+        EXPECT_EQ((ssize_t)src.size(), conv.Process(src.data(), src.size(), sink.Fn()));
+        EXPECT_EQ(Reference(pair, src), sink.data);
+    }
+}
+
+TEST(FormatConverterTest, SplitsIntoWholeFrameChunks)
+{
+    const uint32_t channels = 3;
+    const size_t frameBytes = channels * sizeof(int32_t);
+    FormatConverter conv;
+    Sink sink;
+    std::vector<uint8_t> src = MakeSource(AUDIO_FORMAT_PCM_FLOAT, channels * 100);
+
+    /* 100 bytes rounds down to 8 frames of 32 bit samples */
+    ASSERT_EQ(0, conv.Configure(AUDIO_FORMAT_PCM_FLOAT, AUDIO_FORMAT_PCM_32_BIT, channels, 100));
+    EXPECT_EQ((ssize_t)src.size(), conv.Process(src.data(), src.size(), sink.Fn()));
+
+    ASSERT_EQ(13u, sink.chunks.size());
+    for (size_t i = 0; i + 1 < sink.chunks.size(); i++)
+        EXPECT_EQ(8 * frameBytes, sink.chunks[i]);
+    EXPECT_EQ(4 * frameBytes, sink.chunks.back());
+    EXPECT_EQ(Reference({AUDIO_FORMAT_PCM_FLOAT, AUDIO_FORMAT_PCM_32_BIT}, src), sink.data);
+}
+
+TEST(FormatConverterTest, IgnoresTrailingPartialFrame)
+{
+    FormatConverter conv;
+    Sink sink;
+    std::vector<uint8_t> src = MakeSource(AUDIO_FORMAT_PCM_16_BIT, 2 * 10);
+
+    ASSERT_EQ(0, conv.Configure(AUDIO_FORMAT_PCM_16_BIT, AUDIO_FORMAT_PCM_32_BIT, 2, 4096));
+    /* nine whole frames plus one lone sample and one stray byte */
+    EXPECT_EQ(9 * 2 * 2, conv.Process(src.data(), src.size() - 3, sink.Fn()));
+    EXPECT_EQ(9 * 2 * 4u, sink.data.size());
+}
+
+TEST(FormatConverterTest, ShortWriteReportsSourceBytes)
+{
+    const size_t chunkBytes = 16 * 2 * sizeof(int16_t);
+    FormatConverter conv;
+    Sink sink;
+    std::vector<uint8_t> src = MakeSource(AUDIO_FORMAT_PCM_FLOAT, 2 * 64);
+
+    ASSERT_EQ(0, conv.Configure(AUDIO_FORMAT_PCM_FLOAT, AUDIO_FORMAT_PCM_16_BIT, 2, chunkBytes));
+
+    /* second chunk only half accepted: 16 + 8 frames of float consumed */
+    sink.shortAt = 1;
+    ssize_t consumed = conv.Process(src.data(), src.size(), sink.Fn());
+    EXPECT_EQ((ssize_t)(24 * 2 * sizeof(float)), consumed);
+    EXPECT_EQ(2u, sink.chunks.size());
+    EXPECT_EQ(24 * 2 * sizeof(int16_t), sink.data.size());
+
+    /* the caller resumes from the reported offset and the output stays contiguous */
+    sink.shortAt = SIZE_MAX;
+    EXPECT_EQ((ssize_t)src.size() - consumed,
+              conv.Process(src.data() + consumed, src.size() - consumed, sink.Fn()));
+    EXPECT_EQ(Reference({AUDIO_FORMAT_PCM_FLOAT, AUDIO_FORMAT_PCM_16_BIT}, src), sink.data);
+}
+
+TEST(FormatConverterTest, ShortWriteRoundsDownToWholeSamples)
+{
+    FormatConverter conv;
+    std::vector<uint8_t> src = MakeSource(AUDIO_FORMAT_PCM_16_BIT, 2 * 8);
+
+    ASSERT_EQ(0, conv.Configure(AUDIO_FORMAT_PCM_16_BIT, AUDIO_FORMAT_PCM_32_BIT, 2, 4096));
+    /* 7 bytes of 32 bit output is one whole sample, i.e. 2 source bytes */
+    EXPECT_EQ(2, conv.Process(src.data(), src.size(),
+                              [](const void *, size_t) -> ssize_t { return 7; }));
+}
+
+TEST(FormatConverterTest, SinkErrorAfterProgressReturnsConsumed)
+{
+    const size_t chunkBytes = 4 * 2 * sizeof(int32_t);
+    FormatConverter conv;
+    Sink sink;
+    std::vector<uint8_t> src = MakeSource(AUDIO_FORMAT_PCM_16_BIT, 2 * 16);
+
+    ASSERT_EQ(0, conv.Configure(AUDIO_FORMAT_PCM_16_BIT, AUDIO_FORMAT_PCM_32_BIT, 2, chunkBytes));
+
+    sink.failAt = 0;
+    EXPECT_EQ(-EIO, conv.Process(src.data(), src.size(), sink.Fn()));
+
+    sink.chunks.clear();
+    sink.failAt = 2;
+    EXPECT_EQ(2 * 4 * 2 * (ssize_t)sizeof(int16_t),
+              conv.Process(src.data(), src.size(), sink.Fn()));
+}
+
+TEST(FormatConverterTest, TpdfDitherStaysWithinOneLsb)
+{
+    const size_t samples = 4096;
+    FormatConverter plain, dithered;
+    Sink plainSink, ditheredSink;
+    std::vector<float> src(samples);
+    size_t changed = 0;
+
+    for (size_t i = 0; i < samples; i++)
+        src[i] = (float)((int)(i % 401) - 200) / 32768.0f + 0.3f / 32768.0f;
+    src[0] = 1.0f;
+    src[1] = -1.0f;
+    src[2] = 0.0f;
+
+    ASSERT_EQ(0, plain.Configure(AUDIO_FORMAT_PCM_FLOAT, AUDIO_FORMAT_PCM_16_BIT, 1, 65536));
+    ASSERT_EQ(0, dithered.Configure(AUDIO_FORMAT_PCM_FLOAT, AUDIO_FORMAT_PCM_16_BIT, 1, 65536,
+                                    FORMAT_CONVERTER_DITHER_TPDF));
+    ASSERT_EQ((ssize_t)(samples * sizeof(float)),
+              plain.Process(src.data(), samples * sizeof(float), plainSink.Fn()));
+    ASSERT_EQ((ssize_t)(samples * sizeof(float)),
+              dithered.Process(src.data(), samples * sizeof(float), ditheredSink.Fn()));
+
+    const int16_t *a = (const int16_t *)plainSink.data.data();
+    const int16_t *b = (const int16_t *)ditheredSink.data.data();
+    EXPECT_EQ(INT16_MAX, b[0]);
+    EXPECT_EQ(INT16_MIN, b[1]);
+    for (size_t i = 0; i < samples; i++) {
+        EXPECT_LE(abs(a[i] - b[i]), 1) << "sample " << i;
+        changed += a[i] != b[i];
+    }
+    /* 0.3 LSB offset: the dither must actually move some samples */
+    EXPECT_GT(changed, samples / 20);
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ANDROID_HARDWARE_AHAL_HAPTICS_DEINTERLEAVE_H_
+#define ANDROID_HARDWARE_AHAL_HAPTICS_DEINTERLEAVE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Deinterleave audio+haptics frames: audio samples are compacted in place at
+ * the head of src, haptic samples go to haptic. Audio destination never runs
+ * ahead of the source, so a forward element-wise copy is safe for the in-place
+ * part. Channel counts are compile time constants so the inner loops unroll.
+ */
+template <typename T, uint32_t AudioCh, uint32_t HapticCh>
+static inline void deinterleave_audio_haptics(T *audio, T *haptic, const T *src, size_t frames)
+{
+    for (size_t i = 0; i < frames; i++) {
+        for (uint32_t c = 0; c < AudioCh; c++)
+            *audio++ = *src++;
+        for (uint32_t c = 0; c < HapticCh; c++)
+            *haptic++ = *src++;
+    }
+}
+
+static inline void deinterleave_audio_haptics_generic(uint8_t *audio, uint8_t *haptic,
+                                                      const uint8_t *src, size_t frames,
+                                                      uint32_t audioFrameSize,
+                                                      uint32_t hapticsFrameSize)
+{
+    for (size_t i = 0; i < frames; i++) {
+        memmove(audio, src, audioFrameSize);
+        audio += audioFrameSize;
+        src += audioFrameSize;
+        memcpy(haptic, src, hapticsFrameSize);
+        haptic += hapticsFrameSize;
+        src += hapticsFrameSize;
+    }
+}
+
+#define DEINTERLEAVE_CASE(type, aud, hap)                                      \
+    if (audioChannels == (aud) && hapticsChannels == (hap)) {                  \
+        deinterleave_audio_haptics<type, aud, hap>((type *)audio,              \
+                (type *)haptic, (const type *)src, frames);                    \
+        return;                                                                \
+    }
+
+static inline void deinterleave_audio_haptics(uint8_t *audio, uint8_t *haptic,
+                                              const uint8_t *src, size_t frames,
+                                              uint8_t bytesPerSample,
+                                              uint8_t audioChannels,
+                                              uint8_t hapticsChannels)
+{
+    if (bytesPerSample == sizeof(int16_t)) {
+        DEINTERLEAVE_CASE(int16_t, 1, 1);
+        DEINTERLEAVE_CASE(int16_t, 2, 1);
+        DEINTERLEAVE_CASE(int16_t, 2, 2);
+    } else if (bytesPerSample == sizeof(int32_t)) {
+        DEINTERLEAVE_CASE(int32_t, 1, 1);
+        DEINTERLEAVE_CASE(int32_t, 2, 1);
+        DEINTERLEAVE_CASE(int32_t, 2, 2);
+    }
+
+    deinterleave_audio_haptics_generic(audio, haptic, src, frames,
+                                       audioChannels * bytesPerSample,
+                                       hapticsChannels * bytesPerSample);
+}
+
+#undef DEINTERLEAVE_CASE
+
+#endif  // ANDROID_HARDWARE_AHAL_HAPTICS_DEINTERLEAVE_H_
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "HapticsDeinterleave.h"
+
+namespace {
+
+struct Layout {
+    uint8_t bytesPerSample;
+    uint8_t audioChannels;
+    uint8_t hapticsChannels;
+};
+
+const Layout kLayouts[] = {
+    /* specialized */
+    {2, 1, 1}, {2, 2, 1}, {2, 2, 2},
+    {4, 1, 1}, {4, 2, 1}, {4, 2, 2},
+    /* generic fallback */
+    {2, 4, 2}, {3, 2, 1}, {4, 6, 1},
+};
+
+/* byte pattern unique per position so that any misplaced byte shows */
+std::vector<uint8_t> MakeInterleaved(size_t bytes)
+{
+    std::vector<uint8_t> data(bytes);
+
+    for (size_t i = 0; i < bytes; i++)
+        data[i] = (uint8_t)(i * 7 + (i >> 8));
+    return data;
+}
+
+/* the per frame copy the specialized loops replaced */
+void Reference(const Layout &l, const std::vector<uint8_t> &src, size_t frames,
+               std::vector<uint8_t> &audio, std::vector<uint8_t> &haptic)
+{
+    size_t audioFrame = l.audioChannels * l.bytesPerSample;
+    size_t hapticFrame = l.hapticsChannels * l.bytesPerSample;
+
+    audio.assign(frames * audioFrame, 0);
+    haptic.assign(frames * hapticFrame, 0);
+    for (size_t i = 0; i < frames; i++) {
+        const uint8_t *frame = src.data() + i * (audioFrame + hapticFrame);
+        memcpy(audio.data() + i * audioFrame, frame, audioFrame);
+        memcpy(haptic.data() + i * hapticFrame, frame + audioFrame, hapticFrame);
+    }
+}
+
+class HapticsDeinterleaveTest : public testing::TestWithParam<Layout> {};
+
+}  // namespace
+
+TEST_P(HapticsDeinterleaveTest, SeparateBuffersMatchReference)
+{
+    const Layout &l = GetParam();
+    const size_t frames = 257;
+    size_t frameSize = (l.audioChannels + l.hapticsChannels) * l.bytesPerSample;
+    std::vector<uint8_t> src = MakeInterleaved(frames * frameSize);
+    std::vector<uint8_t> audio(frames * l.audioChannels * l.bytesPerSample);
+    std::vector<uint8_t> haptic(frames * l.hapticsChannels * l.bytesPerSample);
+    std::vector<uint8_t> refAudio, refHaptic;
+
+    Reference(l, src, frames, refAudio, refHaptic);
+    deinterleave_audio_haptics(audio.data(), haptic.data(), src.data(), frames,
+                               l.bytesPerSample, l.audioChannels, l.hapticsChannels);
+    EXPECT_EQ(refAudio, audio);
+    EXPECT_EQ(refHaptic, haptic);
+}
+
+TEST_P(HapticsDeinterleaveTest, InPlaceCompactsAudioAtHead)
+{
+    const Layout &l = GetParam();
+    size_t frameSize = (l.audioChannels + l.hapticsChannels) * l.bytesPerSample;
+
+    for (size_t frames : {0, 1, 2, 3, 480}) {
+        SCOPED_TRACE(frames);
+        std::vector<uint8_t> src = MakeInterleaved(frames * frameSize);
+        std::vector<uint8_t> buffer = src;
+        std::vector<uint8_t> haptic(frames * l.hapticsChannels * l.bytesPerSample);
+        std::vector<uint8_t> refAudio, refHaptic;
+
+        Reference(l, src, frames, refAudio, refHaptic);
+        deinterleave_audio_haptics(buffer.data(), haptic.data(), buffer.data(), frames,
+                                   l.bytesPerSample, l.audioChannels, l.hapticsChannels);
+        EXPECT_EQ(refAudio, std::vector<uint8_t>(buffer.begin(),
+                                                 buffer.begin() + refAudio.size()));
+        EXPECT_EQ(refHaptic, haptic);
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Layouts, HapticsDeinterleaveTest, testing::ValuesIn(kLayouts),
+        [](const testing::TestParamInfo<Layout> &info) {
+            return "s" + std::to_string(info.param.bytesPerSample) +
+                   "_a" + std::to_string(info.param.audioChannels) +
+                   "_h" + std::to_string(info.param.hapticsChannels);
+        });
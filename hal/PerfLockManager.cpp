@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_TAG "AHAL: PerfLockManager"
+#include "AudioCommon.h"
+#include "PerfLockManager.h"
+#include "StreamStats.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+
+#include <log/log.h>
+
+PerfLockManager::PerfLockManager() :
+    done_(false),
+    refs_(0),
+    expired_(false),
+    releaseAtUs_(0),
+    acquire_(nullptr),
+    release_(nullptr),
+    handle_(0),
+    optsSize_(0),
+    held_(false),
+    heldSinceUs_(0),
+    requests_(0),
+    boosts_(0),
+    expiries_(0),
+    totalHeldUs_(0),
+    maxHeldUs_(0)
+{
+    memset(opts_, 0, sizeof(opts_));
+}
+
+PerfLockManager::~PerfLockManager()
+{
+    if (!thread_)
+        return;
+
+    lock_.lock();
+    done_ = true;
+    cond_.notify_one();
+    lock_.unlock();
+    thread_->join();
+}
+
+void PerfLockManager::Init(const int *opts, int size, perf_lock_acquire_t acquire,
+                           perf_lock_release_t release)
+{
+    if (thread_)
+        return;
+    if (!opts || size <= 0 || size > MAX_PERF_LOCK_OPTS || !acquire || !release) {
+        AHAL_ERR("invalid perf lock options, size %d", size);
+        return;
+    }
+
+    memcpy(opts_, opts, size * sizeof(int));
+    optsSize_ = size;
+    acquire_ = acquire;
+    release_ = release;
+    thread_ = std::make_unique<std::thread>([this]() { ThreadLoop(); });
+}
+
+void PerfLockManager::Acquire()
+{
+    lock_.lock();
+    requests_++;
+    if (++refs_ == 1) {
+        /* boost for at least the linger time, even if released before the thread runs */
+        releaseAtUs_ = StreamStats::NowUs() + PERF_LOCK_RELEASE_DELAY_MS * 1000LL;
+        cond_.notify_one();
+    }
+    lock_.unlock();
+}
+
+void PerfLockManager::Release()
+{
+    lock_.lock();
+    if (refs_ > 0)
+        refs_--;
+    if (refs_ == 0) {
+        /* an expired boost is not re-armed, the next Acquire boosts again */
+        expired_ = false;
+        if (held_) {
+            releaseAtUs_ = StreamStats::NowUs() + PERF_LOCK_RELEASE_DELAY_MS * 1000LL;
+            cond_.notify_one();
+        }
+    }
+    lock_.unlock();
+}
+
+void PerfLockManager::ThreadLoop()
+{
+    std::unique_lock<std::mutex> l(lock_);
+    const int64_t maxHeldUs = PERF_LOCK_MAX_DURATION_MS * 1000LL;
+    int64_t nowUs = 0, heldUs = 0, deadlineUs = 0;
+
+    while (!done_) {
+        nowUs = StreamStats::NowUs();
+        if (!held_) {
+            if (expired_ || (refs_ == 0 && nowUs >= releaseAtUs_)) {
+                cond_.wait(l);
+                continue;
+            }
+            l.unlock();
+            acquire_(&handle_, PERF_LOCK_MAX_DURATION_MS, opts_, optsSize_);
+            l.lock();
+            held_ = true;
+            heldSinceUs_ = nowUs;
+            boosts_++;
+            AHAL_DBG("(Acquired) perf_lock_handle: 0x%x, count: %d", handle_, refs_);
+            continue;
+        }
+
+        heldUs = nowUs - heldSinceUs_;
+        if (heldUs >= maxHeldUs || (refs_ == 0 && nowUs >= releaseAtUs_)) {
+            if (refs_ > 0) {
+                /* a user did not release in time, do not boost again until all are gone */
+                AHAL_INFO("perf lock still referenced %d times after %dms",
+                          refs_, PERF_LOCK_MAX_DURATION_MS);
+                expired_ = true;
+                expiries_++;
+            }
+            l.unlock();
+            release_(&handle_);
+            l.lock();
+            held_ = false;
+            totalHeldUs_ += heldUs;
+            if (heldUs > maxHeldUs_)
+                maxHeldUs_ = heldUs;
+            AHAL_DBG("Released perf lock after %" PRId64 "us", heldUs);
+            continue;
+        }
+
+        deadlineUs = heldSinceUs_ + maxHeldUs;
+        if (refs_ == 0 && releaseAtUs_ < deadlineUs)
+            deadlineUs = releaseAtUs_;
+        cond_.wait_for(l, std::chrono::microseconds(deadlineUs - nowUs));
+    }
+
+    if (held_) {
+        release_(&handle_);
+        held_ = false;
+    }
+}
+
+void PerfLockManager::Dump(int fd)
+{
+    uint64_t released = 0;
+
+    lock_.lock();
+    released = boosts_ - (held_ ? 1 : 0);
+    dprintf(fd, "Perf lock: requests %" PRIu64 " boosts %" PRIu64 " expired %" PRIu64
+            " held avg %" PRId64 "us max %" PRId64 "us, refs %d%s\n",
+            requests_, boosts_, expiries_,
+            released ? totalHeldUs_ / (int64_t)released : 0, maxHeldUs_,
+            refs_, held_ ? " (held)" : "");
+    lock_.unlock();
+}
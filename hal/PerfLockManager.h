@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ANDROID_HARDWARE_AHAL_PERF_LOCK_MANAGER_H_
+#define ANDROID_HARDWARE_AHAL_PERF_LOCK_MANAGER_H_
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#define MAX_PERF_LOCK_OPTS 20
+/* upper bound of one boost, the perf library drops it on its own after this */
+#define PERF_LOCK_MAX_DURATION_MS 1000
+/* keep the boost this long after the last user so back to back starts share it */
+#define PERF_LOCK_RELEASE_DELAY_MS 20
+
+/* vendor perf library entry points, see AudioExtn::audio_extn_perf_lock_acquire() */
+typedef void (*perf_lock_acquire_t)(int *handle, int duration, int *opts, int size);
+typedef void (*perf_lock_release_t)(int *handle);
+
+/*
+ * Reference counted perf boost for stream open/start. Acquire() and
+ * Release() only update the count, the calls into the vendor perf library
+ * are made from a worker thread so they never block the caller. Overlapping
+ * users share one boost, which is released by the worker once the last
+ * user is gone or PERF_LOCK_MAX_DURATION_MS has passed.
+ */
+class PerfLockManager {
+public:
+    PerfLockManager();
+    ~PerfLockManager();
+    void Init(const int *opts, int size, perf_lock_acquire_t acquire,
+              perf_lock_release_t release);
+    void Acquire();
+    void Release();
+    void Dump(int fd);
+private:
+    void ThreadLoop();
+
+    std::mutex lock_;
+    std::condition_variable cond_;
+    std::unique_ptr<std::thread> thread_;
+    bool done_;
+    int32_t refs_;
+    /* boost expired while still referenced, wait for refs_ to drop to 0 */
+    bool expired_;
+    /* keep boosting until then once refs_ is 0, set on first Acquire() and last Release() */
+    int64_t releaseAtUs_;
+    perf_lock_acquire_t acquire_;
+    perf_lock_release_t release_;
+    int handle_;
+    int opts_[MAX_PERF_LOCK_OPTS];
+    int optsSize_;
+    /* worker side state */
+    bool held_;
+    int64_t heldSinceUs_;
+    uint64_t requests_;
+    uint64_t boosts_;
+    uint64_t expiries_;
+    int64_t totalHeldUs_;
+    int64_t maxHeldUs_;
+};
+
+/* scope based boost on the device wide manager */
+class AutoPerfLock {
+public:
+    AutoPerfLock();
+    ~AutoPerfLock();
+private:
+    PerfLockManager *manager_;
+};
+
+#endif  // ANDROID_HARDWARE_AHAL_PERF_LOCK_MANAGER_H_
@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "PerfLockManager.h"
+#include "StreamStats.h"
+
+namespace {
+
+const int kOpts[] = {0x40400000, 0x1, 0x40C00000, 0x1};
+const int kOptsSize = sizeof(kOpts) / sizeof(kOpts[0]);
+
+/* stands in for the vendor perf library */
+std::atomic<int> gAcquires;
+std::atomic<int> gReleases;
+std::atomic<int64_t> gAcquiredAtUs;
+std::atomic<int64_t> gReleasedAtUs;
+std::atomic<int> gDuration;
+std::atomic<int> gOptsSize;
+
+void FakeAcquire(int *handle, int duration, int * /* opts */, int size)
+{
+    *handle = 0x1234;
+    gDuration.store(duration);
+    gOptsSize.store(size);
+    gAcquiredAtUs.store(StreamStats::NowUs());
+    gAcquires++;
+}
+
+void FakeRelease(int *handle)
+{
+    EXPECT_EQ(0x1234, *handle);
+    gReleasedAtUs.store(StreamStats::NowUs());
+    gReleases++;
+}
+
+/* polls for cond, returns false if it does not become true within timeoutMs */
+template <typename F>
+bool WaitFor(F cond, int timeoutMs)
+{
+    int64_t deadline = StreamStats::NowUs() + timeoutMs * 1000LL;
+
+    while (!cond()) {
+        if (StreamStats::NowUs() > deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+class PerfLockManagerTest : public testing::Test {
+protected:
+    void SetUp() override
+    {
+        gAcquires = 0;
+        gReleases = 0;
+        gAcquiredAtUs = 0;
+        gReleasedAtUs = 0;
+        manager.Init(kOpts, kOptsSize, FakeAcquire, FakeRelease);
+    }
+
+    PerfLockManager manager;
+};
+
+}  // namespace
+
+TEST_F(PerfLockManagerTest, BoostsUntilLingerAfterRelease)
+{
+    manager.Acquire();
+    ASSERT_TRUE(WaitFor([] { return gAcquires == 1; }, 1000));
+    EXPECT_EQ(PERF_LOCK_MAX_DURATION_MS, gDuration.load());
+    EXPECT_EQ(kOptsSize, gOptsSize.load());
+
+    int64_t releasedUs = StreamStats::NowUs();
+    manager.Release();
+    ASSERT_TRUE(WaitFor([] { return gReleases == 1; }, 1000));
+    EXPECT_GE(gReleasedAtUs - releasedUs, PERF_LOCK_RELEASE_DELAY_MS * 1000LL);
+    EXPECT_EQ(1, gAcquires.load());
+}
+
+TEST_F(PerfLockManagerTest, OverlappingUsersShareOneBoost)
+{
+    manager.Acquire();
+    manager.Acquire();
+    ASSERT_TRUE(WaitFor([] { return gAcquires == 1; }, 1000));
+    manager.Release();
+    std::this_thread::sleep_for(std::chrono::milliseconds(3 * PERF_LOCK_RELEASE_DELAY_MS));
+    EXPECT_EQ(0, gReleases.load());
+
+    manager.Release();
+    ASSERT_TRUE(WaitFor([] { return gReleases == 1; }, 1000));
+    EXPECT_EQ(1, gAcquires.load());
+}
+
+TEST_F(PerfLockManagerTest, BackToBackUsersShareLinger)
+{
+    manager.Acquire();
+    ASSERT_TRUE(WaitFor([] { return gAcquires == 1; }, 1000));
+    manager.Release();
+    std::this_thread::sleep_for(std::chrono::milliseconds(PERF_LOCK_RELEASE_DELAY_MS / 4));
+    manager.Acquire();
+    manager.Release();
+    ASSERT_TRUE(WaitFor([] { return gReleases == 1; }, 1000));
+    std::this_thread::sleep_for(std::chrono::milliseconds(2 * PERF_LOCK_RELEASE_DELAY_MS));
+    EXPECT_EQ(1, gAcquires.load());
+    EXPECT_EQ(1, gReleases.load());
+}
+
+TEST_F(PerfLockManagerTest, ShortUserStillGetsBoost)
+{
+    int64_t startUs = StreamStats::NowUs();
+
+    /* released before the worker even ran: the linger time is still boosted */
+    manager.Acquire();
+    manager.Release();
+    ASSERT_TRUE(WaitFor([] { return gReleases == 1; }, 1000));
+    EXPECT_EQ(1, gAcquires.load());
+    EXPECT_GE(gReleasedAtUs - startUs, PERF_LOCK_RELEASE_DELAY_MS * 1000LL);
+}
+
+TEST_F(PerfLockManagerTest, ExpiredBoostIsNotRenewed)
+{
+    manager.Acquire();
+    ASSERT_TRUE(WaitFor([] { return gAcquires == 1; }, 1000));
+
+    /* a user holding on past the maximum loses the boost */
+    ASSERT_TRUE(WaitFor([] { return gReleases == 1; }, 2 * PERF_LOCK_MAX_DURATION_MS));
+    EXPECT_GE(gReleasedAtUs - gAcquiredAtUs, PERF_LOCK_MAX_DURATION_MS * 1000LL);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5 * PERF_LOCK_RELEASE_DELAY_MS));
+    EXPECT_EQ(1, gAcquires.load());
+
+    /* and dropping the last reference does not re-arm it */
+    manager.Release();
+    std::this_thread::sleep_for(std::chrono::milliseconds(5 * PERF_LOCK_RELEASE_DELAY_MS));
+    EXPECT_EQ(1, gAcquires.load());
+
+    /* the next user boosts again */
+    manager.Acquire();
+    ASSERT_TRUE(WaitFor([] { return gAcquires == 2; }, 1000));
+    manager.Release();
+    ASSERT_TRUE(WaitFor([] { return gReleases == 2; }, 1000));
+}
+
+TEST(PerfLockManagerInitTest, DestructorReleasesHeldBoost)
+{
+    gAcquires = 0;
+    gReleases = 0;
+    {
+        PerfLockManager manager;
+        manager.Init(kOpts, kOptsSize, FakeAcquire, FakeRelease);
+        manager.Acquire();
+        ASSERT_TRUE(WaitFor([] { return gAcquires == 1; }, 1000));
+    }
+    EXPECT_EQ(1, gReleases.load());
+}
+
+TEST(PerfLockManagerInitTest, InvalidInitNeverBoosts)
+{
+    PerfLockManager manager;
+
+    gAcquires = 0;
+    manager.Init(kOpts, 0, FakeAcquire, FakeRelease);
+    manager.Init(kOpts, MAX_PERF_LOCK_OPTS + 1, FakeAcquire, FakeRelease);
+    manager.Init(kOpts, kOptsSize, nullptr, FakeRelease);
+    manager.Acquire();
+    std::this_thread::sleep_for(std::chrono::milliseconds(2 * PERF_LOCK_RELEASE_DELAY_MS));
+    manager.Release();
+    EXPECT_EQ(0, gAcquires.load());
+}
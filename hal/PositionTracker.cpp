@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_TAG "AHAL: PositionTracker"
+#include "AudioCommon.h"
+#include "PositionTracker.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <log/log.h>
+
+/* weight of a new rate measurement is 1 / POSITION_TRACKER_RATE_SMOOTHING */
+#define POSITION_TRACKER_RATE_SMOOTHING 8
+
+PositionTracker::PositionTracker() :
+    sampleRate_(0),
+    sampleIntervalNs_(POSITION_TRACKER_SAMPLE_INTERVAL_NS),
+    running_(false),
+    valid_(false),
+    stalled_(false),
+    anchorFrames_(0),
+    anchorNs_(0),
+    rate_(0),
+    lastReported_(0),
+    samples_(0),
+    modelQueries_(0),
+    stalls_(0)
+{
+}
+
+int64_t PositionTracker::NowNs()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void PositionTracker::Configure(uint32_t sampleRate, int64_t sampleIntervalNs)
+{
+    lock_.lock();
+    sampleRate_ = sampleRate;
+    sampleIntervalNs_ = sampleIntervalNs;
+    rate_ = sampleRate;
+    running_ = false;
+    valid_ = false;
+    stalled_ = false;
+    lastReported_ = 0;
+    lock_.unlock();
+    AHAL_VERBOSE("rate %u, sample interval %" PRId64 "ns", sampleRate, sampleIntervalNs);
+}
+
+void PositionTracker::Reset()
+{
+    lock_.lock();
+    valid_ = false;
+    stalled_ = false;
+    lastReported_ = 0;
+    lock_.unlock();
+}
+
+void PositionTracker::SetRunning(bool running)
+{
+    lock_.lock();
+    running_ = running;
+    valid_ = false;
+    stalled_ = false;
+    lock_.unlock();
+}
+
+bool PositionTracker::NeedsSample(int64_t nowNs)
+{
+    bool needed = false;
+
+    lock_.lock();
+    /* a stopped position does not move, one sample is enough */
+    needed = !valid_ || (running_ && nowNs - anchorNs_ >= sampleIntervalNs_);
+    lock_.unlock();
+    return needed;
+}
+
+void PositionTracker::AddSample(uint64_t frames, int64_t timeNs)
+{
+    double nominal = 0, bound = 0, measured = 0;
+    int64_t dt = 0;
+
+    lock_.lock();
+    samples_++;
+    nominal = sampleRate_;
+    dt = timeNs - anchorNs_;
+    /*
+     * Back to back samples carry mostly the jitter of the query itself,
+     * only fold in measurements spanning a reasonable part of the interval.
+     */
+    if (valid_ && running_ && frames >= anchorFrames_ && dt >= sampleIntervalNs_ / 2) {
+        measured = (double)(frames - anchorFrames_) * 1000000000.0 / dt;
+        if (measured * 2 < rate_) {
+            /* underrun or end of drain, stop extrapolating until it moves again */
+            if (!stalled_)
+                stalls_++;
+            stalled_ = true;
+        } else {
+            stalled_ = false;
+            bound = nominal * POSITION_TRACKER_MAX_DRIFT_PPM / 1000000.0;
+            if (measured > nominal + bound)
+                measured = nominal + bound;
+            else if (measured < nominal - bound)
+                measured = nominal - bound;
+            rate_ += (measured - rate_) / POSITION_TRACKER_RATE_SMOOTHING;
+        }
+    }
+
+    anchorFrames_ = frames;
+    anchorNs_ = timeNs;
+    valid_ = true;
+    lock_.unlock();
+}
+
+bool PositionTracker::GetPosition(int64_t nowNs, uint64_t *frames)
+{
+    uint64_t pos = 0;
+    int64_t dt = 0;
+
+    lock_.lock();
+    if (!valid_) {
+        lock_.unlock();
+        return false;
+    }
+
+    pos = anchorFrames_;
+    dt = nowNs - anchorNs_;
+    if (running_ && !stalled_ && dt > 0) {
+        /* never run ahead further than one interval on a missed sample */
+        if (dt > sampleIntervalNs_)
+            dt = sampleIntervalNs_;
+        pos += (uint64_t)(rate_ * dt / 1000000000.0);
+    }
+    if (pos < lastReported_)
+        pos = lastReported_;
+    lastReported_ = pos;
+    modelQueries_++;
+    lock_.unlock();
+
+    *frames = pos;
+    return true;
+}
+
+void PositionTracker::Dump(int fd)
+{
+    lock_.lock();
+    dprintf(fd, "    position: queries %" PRIu64 " dsp samples %" PRIu64
+            " stalls %" PRIu64 " rate %.2f (nominal %u) last %" PRIu64 "\n",
+            modelQueries_, samples_, stalls_, rate_, sampleRate_, lastReported_);
+    lock_.unlock();
+}
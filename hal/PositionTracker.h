@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ANDROID_HARDWARE_AHAL_POSITION_TRACKER_H_
+#define ANDROID_HARDWARE_AHAL_POSITION_TRACKER_H_
+
+#include <stdint.h>
+
+#include <mutex>
+
+/* minimum time between two DSP session time queries for one stream */
+#define POSITION_TRACKER_SAMPLE_INTERVAL_NS 20000000LL
+/* bound on the estimated rate deviation from the nominal sample rate */
+#define POSITION_TRACKER_MAX_DRIFT_PPM 20000
+
+/*
+ * Linear model of the DSP render position against CLOCK_MONOTONIC for
+ * offload streams. The DSP session time is sampled at most once per sample
+ * interval, positions in between are extrapolated with a drift corrected
+ * rate estimate. Reported positions never go backwards until Reset().
+ */
+class PositionTracker {
+public:
+    PositionTracker();
+    static int64_t NowNs();
+    /* sets the nominal rate and drops all state, the tracker starts stopped */
+    void Configure(uint32_t sampleRate, int64_t sampleIntervalNs);
+    /* drops the model, e.g. when the DSP position restarts after flush */
+    void Reset();
+    /* frames only advance while running, any transition forces a new sample */
+    void SetRunning(bool running);
+    bool NeedsSample(int64_t nowNs);
+    void AddSample(uint64_t frames, int64_t timeNs);
+    /* returns false if there is no sample to extrapolate from */
+    bool GetPosition(int64_t nowNs, uint64_t *frames);
+    void Dump(int fd);
+private:
+    std::mutex lock_;
+    uint32_t sampleRate_;
+    int64_t sampleIntervalNs_;
+    bool running_;
+    bool valid_;
+    bool stalled_;
+    uint64_t anchorFrames_;
+    int64_t anchorNs_;
+    double rate_; /* frames per second */
+    uint64_t lastReported_;
+    uint64_t samples_;
+    uint64_t modelQueries_;
+    uint64_t stalls_;
+};
+
+#endif  // ANDROID_HARDWARE_AHAL_POSITION_TRACKER_H_
@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+
+#include <gtest/gtest.h>
+
+#include "PositionTracker.h"
+
+namespace {
+
+const uint32_t kRate = 48000;
+const int64_t kInterval = POSITION_TRACKER_SAMPLE_INTERVAL_NS;
+const int64_t kMs = 1000000LL;
+
+uint64_t FramesAt(double rate, int64_t ns)
+{
+    return (uint64_t)(rate * ns / 1000000000.0);
+}
+
+class PositionTrackerTest : public testing::Test {
+protected:
+    void SetUp() override
+    {
+        tracker.Configure(kRate, kInterval);
+        tracker.SetRunning(true);
+    }
+
+    /* feeds one sample per interval of a DSP running at rate, returns the last time */
+    int64_t Feed(double rate, int count, int64_t startNs = 0)
+    {
+        int64_t t = startNs;
+
+        for (int i = 0; i < count; i++, t += kInterval) {
+            EXPECT_TRUE(tracker.NeedsSample(t));
+            tracker.AddSample(FramesAt(rate, t), t);
+        }
+        return t - kInterval;
+    }
+
+    uint64_t Position(int64_t nowNs)
+    {
+        uint64_t frames = 0;
+
+        EXPECT_TRUE(tracker.GetPosition(nowNs, &frames));
+        return frames;
+    }
+
+    PositionTracker tracker;
+};
+
+}  // namespace
+
+TEST_F(PositionTrackerTest, NoPositionBeforeFirstSample)
+{
+    uint64_t frames = 0;
+
+    EXPECT_TRUE(tracker.NeedsSample(0));
+    EXPECT_FALSE(tracker.GetPosition(0, &frames));
+}
+
+TEST_F(PositionTrackerTest, SamplesOncePerInterval)
+{
+    tracker.AddSample(0, 0);
+    EXPECT_FALSE(tracker.NeedsSample(kInterval - 1));
+    EXPECT_TRUE(tracker.NeedsSample(kInterval));
+}
+
+TEST_F(PositionTrackerTest, ExtrapolatesAtNominalRate)
+{
+    tracker.AddSample(1000, 0);
+    EXPECT_EQ(1000u, Position(0));
+    EXPECT_EQ(1000u + 480, Position(10 * kMs));
+    EXPECT_EQ(1000u + 960, Position(kInterval));
+}
+
+TEST_F(PositionTrackerTest, ExtrapolationCappedAtOneInterval)
+{
+    tracker.AddSample(1000, 0);
+    /* a missed sample must not let the estimate run away */
+    EXPECT_EQ(1000u + 960, Position(10 * kInterval));
+}
+
+TEST_F(PositionTrackerTest, StoppedPositionDoesNotMove)
+{
+    tracker.SetRunning(false);
+    EXPECT_TRUE(tracker.NeedsSample(0));
+    tracker.AddSample(5000, 0);
+    EXPECT_FALSE(tracker.NeedsSample(100 * kInterval));
+    EXPECT_EQ(5000u, Position(10 * kMs));
+
+    /* any transition invalidates the model */
+    tracker.SetRunning(true);
+    EXPECT_TRUE(tracker.NeedsSample(10 * kMs));
+}
+
+TEST_F(PositionTrackerTest, ConvergesOnDrift)
+{
+    const double rate = kRate * (1.0 + 5000e-6);
+    int64_t last = Feed(rate, 200);
+
+    /* halfway between samples the estimate follows the drifting clock */
+    int64_t now = last + kInterval / 2;
+    EXPECT_NEAR((double)FramesAt(rate, now), (double)Position(now), 1.0);
+}
+
+TEST_F(PositionTrackerTest, DriftEstimateIsBounded)
+{
+    const double bound = kRate * (1.0 + POSITION_TRACKER_MAX_DRIFT_PPM / 1000000.0);
+    int64_t last = Feed(kRate * 1.10, 200);
+    uint64_t anchor = FramesAt(kRate * 1.10, last);
+
+    EXPECT_LE(Position(last + kInterval) - anchor, FramesAt(bound, kInterval) + 1);
+    EXPECT_GE(Position(last + kInterval) - anchor, FramesAt(bound, kInterval) - 1);
+}
+
+TEST_F(PositionTrackerTest, IgnoresBackToBackSamplesForRate)
+{
+    int64_t last = Feed(kRate, 10);
+    uint64_t anchor = FramesAt(kRate, last);
+
+    /* 1 ms apart with 3 ms worth of frames: jitter, not a rate */
+    tracker.AddSample(anchor + 144, last + kMs);
+    EXPECT_EQ(anchor + 144 + 480, Position(last + kMs + 10 * kMs));
+}
+
+TEST_F(PositionTrackerTest, StallStopsExtrapolation)
+{
+    int64_t last = Feed(kRate, 10);
+    uint64_t anchor = FramesAt(kRate, last);
+
+    /* DSP position stuck, e.g. underrun or the tail of a drain */
+    tracker.AddSample(anchor, last + kInterval);
+    EXPECT_EQ(anchor, Position(last + kInterval + 10 * kMs));
+
+    /* moving again at the right rate resumes extrapolation */
+    tracker.AddSample(anchor + 960, last + 2 * kInterval);
+    EXPECT_EQ(anchor + 960 + 480, Position(last + 2 * kInterval + 10 * kMs));
+}
+
+TEST_F(PositionTrackerTest, PositionIsMonotonic)
+{
+    tracker.AddSample(1000, 0);
+    EXPECT_EQ(1000u + 960, Position(kInterval));
+
+    /* the next DSP sample lands behind the extrapolated position */
+    tracker.AddSample(1000 + 900, kInterval);
+    EXPECT_EQ(1000u + 960, Position(kInterval));
+    EXPECT_EQ(1000u + 960, Position(kInterval + kMs));
+    /* once the model overtakes the held value it is reported again */
+    EXPECT_NEAR(1000.0 + 900 + 480, (double)Position(kInterval + 10 * kMs), 5.0);
+
+    /* Reset() is the only way back, e.g. after a flush */
+    tracker.Reset();
+    tracker.AddSample(0, 2 * kInterval);
+    EXPECT_EQ(0u, Position(2 * kInterval));
+}
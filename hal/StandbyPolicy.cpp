@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_TAG "AHAL: StandbyPolicy"
+#include "AudioCommon.h"
+#include "AudioHalConfig.h"
+#include "StandbyPolicy.h"
+#include "StreamStats.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <log/log.h>
+
+StandbyPolicy::StandbyPolicy(const char * const *usecaseNames, int usecases) :
+    usecaseNames_(usecaseNames),
+    stats_(usecases > 0 ? usecases : 0),
+    warmBytes_(0)
+{
+}
+
+standby_action_t StandbyPolicy::OnStandby(int usecase, bool canKeep, size_t bufferBytes,
+                                          int64_t *idleUs)
+{
+    int64_t stopMs = AudioHalConfig::GetInt(HAL_CONFIG_OUTPUT_WARM_IDLE_MS);
+    int64_t parkMs = AudioHalConfig::GetInt(HAL_CONFIG_STANDBY_PARK_MS);
+    size_t budget = (size_t)AudioHalConfig::GetInt(HAL_CONFIG_STANDBY_PARK_BUDGET_KB) * 1024;
+    standby_action_t action = STANDBY_ACTION_CLOSE;
+    struct usecase_stats *st = NULL;
+
+    if (usecase < 0 || usecase >= (int)stats_.size())
+        return STANDBY_ACTION_CLOSE;
+
+    lock_.lock();
+    st = &stats_[usecase];
+    st->standbys++;
+    st->lastStandbyUs = StreamStats::NowUs();
+
+    if (!canKeep || stopMs <= 0 || warmBytes_ + bufferBytes > budget) {
+        st->closes++;
+        goto exit;
+    }
+
+    if (parkMs > stopMs && st->hot >= STANDBY_POLICY_HOT_REOPENS) {
+        action = STANDBY_ACTION_PARK;
+        *idleUs = parkMs * 1000;
+        st->parks++;
+    } else {
+        action = STANDBY_ACTION_STOP;
+        *idleUs = stopMs * 1000;
+        st->stops++;
+    }
+    warmBytes_ += bufferBytes;
+
+exit:
+    AHAL_DBG("usecase %s action %d, hot %d, warm bytes %zu",
+             usecaseNames_[usecase], action, st->hot, warmBytes_);
+    lock_.unlock();
+    return action;
+}
+
+bool StandbyPolicy::ReserveWarm(size_t bufferBytes)
+{
+    size_t budget = (size_t)AudioHalConfig::GetInt(HAL_CONFIG_STANDBY_PARK_BUDGET_KB) * 1024;
+    bool reserved = false;
+
+    lock_.lock();
+    if (warmBytes_ + bufferBytes <= budget) {
+        warmBytes_ += bufferBytes;
+        reserved = true;
+    }
+    lock_.unlock();
+    return reserved;
+}
+
+void StandbyPolicy::ReleaseWarm(int usecase, size_t bufferBytes, bool reused)
+{
+    lock_.lock();
+    warmBytes_ = warmBytes_ > bufferBytes ? warmBytes_ - bufferBytes : 0;
+    if (!reused && usecase >= 0 && usecase < (int)stats_.size())
+        stats_[usecase].expired++;
+    lock_.unlock();
+}
+
+void StandbyPolicy::OnOpen(int usecase, int64_t openUs)
+{
+    struct usecase_stats *st = NULL;
+
+    if (usecase < 0 || usecase >= (int)stats_.size())
+        return;
+
+    lock_.lock();
+    st = &stats_[usecase];
+    st->opens++;
+    if (st->lastStandbyUs)
+        st->reopens++;
+    st->openUs += openUs;
+    lock_.unlock();
+}
+
+void StandbyPolicy::OnStart(int usecase, bool reused)
+{
+    struct usecase_stats *st = NULL;
+    int64_t gapUs = 0;
+
+    if (usecase < 0 || usecase >= (int)stats_.size())
+        return;
+
+    lock_.lock();
+    st = &stats_[usecase];
+    if (st->lastStandbyUs) {
+        gapUs = StreamStats::NowUs() - st->lastStandbyUs;
+        if (gapUs < STANDBY_POLICY_REOPEN_WINDOW_US) {
+            if (st->hot < STANDBY_POLICY_MAX_HOT)
+                st->hot++;
+        } else {
+            st->hot /= 2;
+        }
+    }
+
+    if (reused) {
+        /* credit the average cost of the Open() that was skipped */
+        st->reused++;
+        if (st->opens)
+            st->savedUs += st->openUs / (int64_t)st->opens;
+    }
+    st->lastStandbyUs = 0;
+    lock_.unlock();
+}
+
+void StandbyPolicy::Dump(int fd)
+{
+    struct usecase_stats *st = NULL;
+
+    lock_.lock();
+    dprintf(fd, "Standby policy: warm handles hold %zu bytes of %d KB\n",
+            warmBytes_, AudioHalConfig::GetInt(HAL_CONFIG_STANDBY_PARK_BUDGET_KB));
+    for (size_t i = 0; i < stats_.size(); i++) {
+        st = &stats_[i];
+        if (!st->standbys && !st->opens)
+            continue;
+        dprintf(fd, "  %s: standby %" PRIu64 " (close %" PRIu64 " stop %" PRIu64
+                " park %" PRIu64 "), open %" PRIu64 " reopen %" PRIu64 " reused %" PRIu64
+                " expired %" PRIu64 ", avg open %" PRId64 "us, saved %" PRId64 "us\n",
+                usecaseNames_[i], st->standbys, st->closes, st->stops, st->parks,
+                st->opens, st->reopens, st->reused, st->expired,
+                st->opens ? st->openUs / (int64_t)st->opens : 0, st->savedUs);
+    }
+    lock_.unlock();
+}
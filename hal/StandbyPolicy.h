@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ANDROID_HARDWARE_AHAL_STANDBY_POLICY_H_
+#define ANDROID_HARDWARE_AHAL_STANDBY_POLICY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <mutex>
+#include <vector>
+
+/* a start within this time of the previous standby counts as a quick reopen */
+#define STANDBY_POLICY_REOPEN_WINDOW_US 10000000LL
+/* quick reopens in a row after which a usecase is parked for the long window */
+#define STANDBY_POLICY_HOT_REOPENS 3
+#define STANDBY_POLICY_MAX_HOT 8
+
+typedef enum {
+    STANDBY_ACTION_CLOSE = 0,   /* stop and close the PAL handle */
+    STANDBY_ACTION_STOP,        /* stop, close after vendor.audio.hal.output.warm_idle_ms */
+    STANDBY_ACTION_PARK,        /* stop, close after vendor.audio.hal.standby.park_ms */
+} standby_action_t;
+
+/*
+ * Decides per usecase what standby does with the PAL handle. Usecases that
+ * are restarted shortly after standby again and again are kept opened for
+ * longer. The buffers of all handles kept opened are bounded by
+ * vendor.audio.hal.standby.park_budget_kb.
+ */
+class StandbyPolicy {
+public:
+    /* usecaseNames has one entry per usecase, it is only used for logs and dump */
+    StandbyPolicy(const char * const *usecaseNames, int usecases);
+    /*
+     * Called when a stream goes to standby with an open handle. For any
+     * action other than close, bufferBytes is charged to the budget and
+     * idleUs is set to the time after which the handle is to be closed.
+     */
+    standby_action_t OnStandby(int usecase, bool canKeep, size_t bufferBytes,
+                               int64_t *idleUs);
+    /* charges a handle opened ahead of use to the budget */
+    bool ReserveWarm(size_t bufferBytes);
+    /* a kept handle was started again (reused) or closed once idle */
+    void ReleaseWarm(int usecase, size_t bufferBytes, bool reused);
+    /* records the cost of a PAL stream open */
+    void OnOpen(int usecase, int64_t openUs);
+    /* a stream was started, reused is set if its handle had been kept opened */
+    void OnStart(int usecase, bool reused);
+    void Dump(int fd);
+private:
+    struct usecase_stats {
+        uint64_t standbys;
+        uint64_t closes;
+        uint64_t stops;
+        uint64_t parks;
+        uint64_t opens;
+        uint64_t reopens;
+        uint64_t reused;
+        uint64_t expired;
+        int64_t openUs;
+        int64_t savedUs;
+        int64_t lastStandbyUs;
+        int hot;
+    };
+
+    std::mutex lock_;
+    const char * const *usecaseNames_;
+    std::vector<struct usecase_stats> stats_;
+    size_t warmBytes_;
+};
+
+#endif  // ANDROID_HARDWARE_AHAL_STANDBY_POLICY_H_
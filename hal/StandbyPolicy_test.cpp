@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "AudioHalConfig.h"
+#include "StandbyPolicy.h"
+
+namespace {
+
+const char * const kUsecaseNames[] = {"uc-deep-buffer", "uc-low-latency", "uc-offload"};
+const int kUsecases = sizeof(kUsecaseNames) / sizeof(kUsecaseNames[0]);
+const int64_t kMsUs = 1000;
+
+class StandbyPolicyTest : public testing::Test {
+protected:
+    StandbyPolicyTest() : policy(kUsecaseNames, kUsecases) {}
+
+    void SetUp() override
+    {
+        AudioHalConfig::Set(HAL_CONFIG_OUTPUT_WARM_IDLE_MS, 100);
+        AudioHalConfig::Set(HAL_CONFIG_STANDBY_PARK_MS, 5000);
+        AudioHalConfig::Set(HAL_CONFIG_STANDBY_PARK_BUDGET_KB, 4);
+    }
+
+    /* one standby with the handle kept, then a quick restart reusing it */
+    standby_action_t Cycle(int usecase, size_t bytes)
+    {
+        int64_t idleUs = 0;
+        standby_action_t action = policy.OnStandby(usecase, true, bytes, &idleUs);
+
+        if (action != STANDBY_ACTION_CLOSE)
+            policy.ReleaseWarm(usecase, bytes, true);
+        policy.OnStart(usecase, action != STANDBY_ACTION_CLOSE);
+        return action;
+    }
+
+    StandbyPolicy policy;
+};
+
+}  // namespace
+
+TEST_F(StandbyPolicyTest, ClosesWhenDisabled)
+{
+    int64_t idleUs = -1;
+
+    AudioHalConfig::Set(HAL_CONFIG_OUTPUT_WARM_IDLE_MS, 0);
+    EXPECT_EQ(STANDBY_ACTION_CLOSE, policy.OnStandby(0, true, 1024, &idleUs));
+    EXPECT_EQ(-1, idleUs);
+}
+
+TEST_F(StandbyPolicyTest, ClosesWhenStreamCannotKeepHandle)
+{
+    EXPECT_EQ(STANDBY_ACTION_CLOSE, policy.OnStandby(0, false, 1024, nullptr));
+}
+
+TEST_F(StandbyPolicyTest, StopsForWarmIdleTime)
+{
+    int64_t idleUs = 0;
+
+    EXPECT_EQ(STANDBY_ACTION_STOP, policy.OnStandby(0, true, 1024, &idleUs));
+    EXPECT_EQ(100 * kMsUs, idleUs);
+}
+
+TEST_F(StandbyPolicyTest, ParksUsecaseReopenedQuickly)
+{
+    int64_t idleUs = 0;
+
+    for (int i = 0; i < STANDBY_POLICY_HOT_REOPENS; i++)
+        EXPECT_EQ(STANDBY_ACTION_STOP, Cycle(1, 1024)) << "cycle " << i;
+
+    EXPECT_EQ(STANDBY_ACTION_PARK, policy.OnStandby(1, true, 1024, &idleUs));
+    EXPECT_EQ(5000 * kMsUs, idleUs);
+
+    /* other usecases are not affected */
+    EXPECT_EQ(STANDBY_ACTION_STOP, policy.OnStandby(0, true, 1024, &idleUs));
+    EXPECT_EQ(100 * kMsUs, idleUs);
+}
+
+TEST_F(StandbyPolicyTest, NoParkingUnlessLongerThanWarmIdle)
+{
+    int64_t idleUs = 0;
+
+    AudioHalConfig::Set(HAL_CONFIG_STANDBY_PARK_MS, 100);
+    for (int i = 0; i < 2 * STANDBY_POLICY_HOT_REOPENS; i++)
+        Cycle(1, 0);
+    EXPECT_EQ(STANDBY_ACTION_STOP, policy.OnStandby(1, true, 0, &idleUs));
+    EXPECT_EQ(100 * kMsUs, idleUs);
+}
+
+TEST_F(StandbyPolicyTest, KeptHandlesShareBudget)
+{
+    int64_t idleUs = 0;
+
+    EXPECT_EQ(STANDBY_ACTION_STOP, policy.OnStandby(0, true, 3 * 1024, &idleUs));
+    /* 3 KB + 2 KB exceeds the 4 KB budget */
+    EXPECT_EQ(STANDBY_ACTION_CLOSE, policy.OnStandby(1, true, 2 * 1024, &idleUs));
+    EXPECT_EQ(STANDBY_ACTION_STOP, policy.OnStandby(2, true, 1024, &idleUs));
+
+    /* closing an idle handle returns its share */
+    policy.ReleaseWarm(0, 3 * 1024, false);
+    EXPECT_EQ(STANDBY_ACTION_STOP, policy.OnStandby(1, true, 2 * 1024, &idleUs));
+}
+
+TEST_F(StandbyPolicyTest, ReserveWarmChargesBudget)
+{
+    int64_t idleUs = 0;
+
+    EXPECT_TRUE(policy.ReserveWarm(4 * 1024));
+    EXPECT_FALSE(policy.ReserveWarm(1));
+    EXPECT_EQ(STANDBY_ACTION_CLOSE, policy.OnStandby(0, true, 1, &idleUs));
+
+    policy.ReleaseWarm(0, 4 * 1024, true);
+    EXPECT_TRUE(policy.ReserveWarm(1024));
+
+    /* releasing more than was charged does not wrap around */
+    policy.ReleaseWarm(0, 64 * 1024, false);
+    EXPECT_TRUE(policy.ReserveWarm(4 * 1024));
+}
+
+TEST_F(StandbyPolicyTest, IgnoresUnknownUsecase)
+{
+    int64_t idleUs = 0;
+
+    EXPECT_EQ(STANDBY_ACTION_CLOSE, policy.OnStandby(-1, true, 0, &idleUs));
+    EXPECT_EQ(STANDBY_ACTION_CLOSE, policy.OnStandby(kUsecases, true, 0, &idleUs));
+    policy.OnOpen(kUsecases, 1000);
+    policy.OnStart(kUsecases, true);
+    policy.ReleaseWarm(kUsecases, 0, false);
+}
+
+TEST_F(StandbyPolicyTest, DumpListsActiveUsecasesByName)
+{
+    FILE *f = tmpfile();
+    char buf[4096] = {};
+
+    ASSERT_NE(nullptr, f);
+    policy.OnOpen(2, 3000);
+    Cycle(2, 1024);
+    policy.Dump(fileno(f));
+    rewind(f);
+    size_t len = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    ASSERT_GT(len, 0u);
+
+    std::string dump(buf);
+    EXPECT_NE(std::string::npos, dump.find("uc-offload"));
+    EXPECT_NE(std::string::npos, dump.find("reused 1"));
+    EXPECT_NE(std::string::npos, dump.find("saved 3000us"));
+    EXPECT_EQ(std::string::npos, dump.find("uc-deep-buffer"));
+}
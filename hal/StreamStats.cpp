@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_TAG "AHAL: StreamStats"
+#include "StreamStats.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <time.h>
+
+#define LATENCY_HISTOGRAM_MIN_US 125
+
+LatencyHistogram::LatencyHistogram() :
+    count_(0),
+    sum_(0),
+    max_(0)
+{
+    for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++)
+        buckets_[i].store(0, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::Record(int64_t us)
+{
+    int idx = 0;
+    int64_t bound = LATENCY_HISTOGRAM_MIN_US;
+    int64_t cur_max = 0;
+
+    if (us < 0)
+        us = 0;
+    while (idx < LATENCY_HISTOGRAM_BUCKETS - 1 && us >= bound) {
+        bound <<= 1;
+        idx++;
+    }
+
+    buckets_[idx].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(us, std::memory_order_relaxed);
+
+    cur_max = max_.load(std::memory_order_relaxed);
+    while (us > cur_max &&
+           !max_.compare_exchange_weak(cur_max, us, std::memory_order_relaxed));
+}
+
+void LatencyHistogram::Dump(int fd, const char *name)
+{
+    uint64_t count = count_.load(std::memory_order_relaxed);
+    uint64_t sum = sum_.load(std::memory_order_relaxed);
+    int64_t bound = LATENCY_HISTOGRAM_MIN_US;
+
+    dprintf(fd, "    %s: count %" PRIu64 " avg %" PRIu64 "us max %" PRId64 "us\n",
+            name, count, count ? sum / count : 0, max_.load(std::memory_order_relaxed));
+    if (!count)
+        return;
+
+    dprintf(fd, "     ");
+    for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        if (i < LATENCY_HISTOGRAM_BUCKETS - 1)
+            dprintf(fd, " <%" PRId64 "us:%" PRIu64, bound,
+                    buckets_[i].load(std::memory_order_relaxed));
+        else
+            dprintf(fd, " >=%" PRId64 "us:%" PRIu64, bound >> 1,
+                    buckets_[i].load(std::memory_order_relaxed));
+        bound <<= 1;
+    }
+    dprintf(fd, "\n");
+}
+
+StreamStats::StreamStats() :
+    ioCalls(0),
+    ioErrors(0),
+    ioDropped(0),
+    lastIoUs_(0),
+    periodUs_(0)
+{
+}
+
+int64_t StreamStats::NowUs()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+void StreamStats::OnIoEntry(int64_t nowUs)
+{
+    int64_t last = lastIoUs_.exchange(nowUs, std::memory_order_relaxed);
+    int64_t period = periodUs_.load(std::memory_order_relaxed);
+    int64_t delta = 0;
+
+    ioCalls.fetch_add(1, std::memory_order_relaxed);
+    if (!last || !period)
+        return;
+
+    delta = nowUs - last - period;
+    jitter.Record(delta < 0 ? -delta : delta);
+}
+
+void StreamStats::Dump(int fd)
+{
+    dprintf(fd, "    calls %" PRIu64 " errors %" PRIu64 " dropped %" PRIu64
+            " period %" PRId64 "us\n",
+            ioCalls.load(std::memory_order_relaxed),
+            ioErrors.load(std::memory_order_relaxed),
+            ioDropped.load(std::memory_order_relaxed),
+            periodUs_.load(std::memory_order_relaxed));
+    lockWait.Dump(fd, "stream lock wait");
+    palIo.Dump(fd, "pal io duration");
+    jitter.Dump(fd, "period jitter");
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ANDROID_HARDWARE_AHAL_STREAM_STATS_H_
+#define ANDROID_HARDWARE_AHAL_STREAM_STATS_H_
+
+#include <stdint.h>
+
+#include <atomic>
+
+/* bucket upper bounds are 125us << i, the last bucket is open ended */
+#define LATENCY_HISTOGRAM_BUCKETS 12
+
+/*
+ * Histogram of durations in microseconds. Record() only does relaxed atomic
+ * increments so it can be called from the data path while dump reads it
+ * from another thread.
+ */
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+    void Record(int64_t us);
+    void Dump(int fd, const char *name);
+    uint64_t Count() { return count_.load(std::memory_order_relaxed); }
+private:
+    std::atomic<uint64_t> buckets_[LATENCY_HISTOGRAM_BUCKETS];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<int64_t> max_;
+};
+
+/* per stream data path timing, dumped through dumpsys media.audio_flinger */
+class StreamStats {
+public:
+    StreamStats();
+    static int64_t NowUs();
+    /* expected time between two write/read calls, 0 disables jitter tracking */
+    void SetPeriodUs(int64_t us) { periodUs_.store(us, std::memory_order_relaxed); }
+    /* called on entry of every write/read, records deviation from the period */
+    void OnIoEntry(int64_t nowUs);
+    /* forget the last call time, e.g. across standby */
+    void ResetInterval() { lastIoUs_.store(0, std::memory_order_relaxed); }
+    void Dump(int fd);
+
+    LatencyHistogram lockWait;
+    LatencyHistogram palIo;
+    LatencyHistogram jitter;
+    std::atomic<uint64_t> ioCalls;
+    std::atomic<uint64_t> ioErrors;
+    /* buffers dropped because a device switch held the stream too long */
+    std::atomic<uint64_t> ioDropped;
+private:
+    std::atomic<int64_t> lastIoUs_;
+    std::atomic<int64_t> periodUs_;
+};
+
+#endif  // ANDROID_HARDWARE_AHAL_STREAM_STATS_H_
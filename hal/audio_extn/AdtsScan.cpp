@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "AdtsScan.h"
+
+#include <algorithm>
+
+/**
+ * Walks the ADTS headers of a compress capture buffer in place and adds up
+ * the PCM samples at sampleRate of the access units that start in it.
+ * HE-AAC headers carry the core rate, so the SBR doubling falls out of the
+ * rate ratio. Returns false if a header does not carry the ADTS sync.
+ **/
+bool countAdtsSamples(const uint8_t *data, size_t size, uint32_t sampleRate,
+                      AdtsScanState &state, uint64_t &samples) {
+    static const uint32_t kAdtsSampleRates[] = {
+        96000, 88200, 64000, 48000, 44100, 32000, 24000,
+        22050, 16000, 12000, 11025, 8000,  7350};
+    const uint8_t *h = state.header;
+    size_t pos = 0, n = 0;
+    uint32_t freqIndex = 0, frameLen = 0, blocks = 0;
+
+    samples = 0;
+    while (pos < size) {
+        if (state.skip) {
+            n = std::min((size_t)state.skip, size - pos);
+            pos += n;
+            state.skip -= n;
+            continue;
+        }
+
+        while (state.headerLen < kAdtsHeaderSize && pos < size)
+            state.header[state.headerLen++] = data[pos++];
+        if (state.headerLen < kAdtsHeaderSize)
+            break;
+        state.headerLen = 0;
+
+        /* 12 bit sync word and layer 0 */
+        if (h[0] != 0xFF || (h[1] & 0xF6) != 0xF0)
+            return false;
+        freqIndex = (h[2] >> 2) & 0x0F;
+        frameLen = ((h[3] & 0x03) << 11) | (h[4] << 3) | (h[5] >> 5);
+        if (freqIndex >= sizeof(kAdtsSampleRates) / sizeof(kAdtsSampleRates[0]) ||
+            frameLen < kAdtsHeaderSize)
+            return false;
+
+        blocks = (h[6] & 0x03) + 1;
+        samples += (uint64_t)blocks * kAdtsSamplesPerFrame * sampleRate /
+                   kAdtsSampleRates[freqIndex];
+        state.skip = frameLen - kAdtsHeaderSize;
+    }
+
+    return true;
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ANDROID_HARDWARE_AHAL_ADTS_SCAN_H_
+#define ANDROID_HARDWARE_AHAL_ADTS_SCAN_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+static const uint32_t kAdtsHeaderSize = 7;
+// PCM samples per raw data block at the rate signalled in the header
+static const uint32_t kAdtsSamplesPerFrame = 1024;
+
+// ADTS framing carried from one compress read to the next
+struct AdtsScanState {
+    // bytes of the current frame still to come
+    uint32_t skip = 0;
+    // header split across reads
+    uint8_t header[kAdtsHeaderSize];
+    uint32_t headerLen = 0;
+    // no sync found, frames are counted one per read
+    bool lost = false;
+};
+
+bool countAdtsSamples(const uint8_t *data, size_t size, uint32_t sampleRate,
+                      AdtsScanState &state, uint64_t &samples);
+
+#endif  // ANDROID_HARDWARE_AHAL_ADTS_SCAN_H_
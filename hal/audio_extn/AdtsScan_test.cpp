@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "AdtsScan.h"
+
+namespace {
+
+const uint32_t kFreqIndex48k = 3;
+const uint32_t kFreqIndex44k1 = 4;
+const uint32_t kFreqIndex24k = 6;
+const uint32_t kFreqIndex22k05 = 7;
+
+/* one ADTS frame with a payload of payloadLen bytes */
+void AppendFrame(std::vector<uint8_t> &out, uint32_t freqIndex, size_t payloadLen,
+                 uint32_t blocks = 1)
+{
+    uint32_t frameLen = kAdtsHeaderSize + payloadLen;
+    const uint32_t profile = 1;     /* AAC LC, HE-AAC signals its core the same way */
+    const uint32_t channels = 2;
+
+    out.push_back(0xFF);
+    out.push_back(0xF1);
+    out.push_back((profile << 6) | (freqIndex << 2) | (channels >> 2));
+    out.push_back(((channels & 3) << 6) | ((frameLen >> 11) & 0x03));
+    out.push_back((frameLen >> 3) & 0xFF);
+    out.push_back(((frameLen & 0x07) << 5) | 0x1F);
+    out.push_back(0xFC | ((blocks - 1) & 0x03));
+    for (size_t i = 0; i < payloadLen; i++)
+        out.push_back((uint8_t)(i * 13));
+}
+
+/* feeds data in reads of readSize bytes, returns the total or -1 on lost sync */
+int64_t CountInReads(const std::vector<uint8_t> &data, size_t readSize, uint32_t sampleRate)
+{
+    AdtsScanState state;
+    uint64_t samples = 0, total = 0;
+
+    for (size_t pos = 0; pos < data.size(); pos += readSize) {
+        size_t len = std::min(readSize, data.size() - pos);
+        if (!countAdtsSamples(data.data() + pos, len, sampleRate, state, samples))
+            return -1;
+        total += samples;
+    }
+    return total;
+}
+
+}  // namespace
+
+TEST(AdtsScanTest, CountsWholeFrames)
+{
+    std::vector<uint8_t> data;
+
+    for (int i = 0; i < 5; i++)
+        AppendFrame(data, kFreqIndex48k, 300 + 17 * i);
+    EXPECT_EQ(5 * 1024, CountInReads(data, data.size(), 48000));
+}
+
+TEST(AdtsScanTest, CountsMultipleRawDataBlocks)
+{
+    std::vector<uint8_t> data;
+
+    AppendFrame(data, kFreqIndex48k, 900, 4);
+    EXPECT_EQ(4 * 1024, CountInReads(data, data.size(), 48000));
+}
+
+TEST(AdtsScanTest, HeAacCoreRateDoublesSamples)
+{
+    std::vector<uint8_t> data;
+
+    /* SBR streams signal half the output rate in the header */
+    AppendFrame(data, kFreqIndex24k, 200);
+    AppendFrame(data, kFreqIndex24k, 210);
+    EXPECT_EQ(2 * 2048, CountInReads(data, data.size(), 48000));
+
+    data.clear();
+    AppendFrame(data, kFreqIndex22k05, 200);
+    EXPECT_EQ(2048, CountInReads(data, data.size(), 44100));
+
+    data.clear();
+    AppendFrame(data, kFreqIndex44k1, 200);
+    EXPECT_EQ(1024, CountInReads(data, data.size(), 44100));
+}
+
+TEST(AdtsScanTest, SamplesCountInReadThatCompletesHeader)
+{
+    std::vector<uint8_t> data;
+
+    AppendFrame(data, kFreqIndex48k, 100);
+    AppendFrame(data, kFreqIndex48k, 100);
+
+    /* cut the second header at every possible point */
+    for (size_t cut = 1; cut < kAdtsHeaderSize; cut++) {
+        SCOPED_TRACE(cut);
+        AdtsScanState state;
+        uint64_t samples = 0;
+        size_t first = kAdtsHeaderSize + 100 + cut;
+
+        ASSERT_TRUE(countAdtsSamples(data.data(), first, 48000, state, samples));
+        EXPECT_EQ(1024u, samples);
+        EXPECT_EQ(cut, state.headerLen);
+        ASSERT_TRUE(countAdtsSamples(data.data() + first, data.size() - first, 48000,
+                                     state, samples));
+        EXPECT_EQ(1024u, samples);
+        EXPECT_EQ(0u, state.skip);
+        EXPECT_EQ(0u, state.headerLen);
+    }
+}
+
+TEST(AdtsScanTest, AnyReadSizeGivesSameTotal)
+{
+    std::vector<uint8_t> data;
+
+    for (int i = 0; i < 40; i++)
+        AppendFrame(data, i % 3 ? kFreqIndex48k : kFreqIndex24k, 150 + (i * 37) % 400);
+    int64_t expected = 40 * 1024 + 14 * 1024;
+
+    for (size_t readSize : {1, 2, 6, 7, 8, 100, 157, 512, 4096, 65536})
+        EXPECT_EQ(expected, CountInReads(data, readSize, 48000)) << "read size " << readSize;
+}
+
+TEST(AdtsScanTest, EmptyReadKeepsState)
+{
+    AdtsScanState state;
+    uint64_t samples = 1;
+
+    EXPECT_TRUE(countAdtsSamples(nullptr, 0, 48000, state, samples));
+    EXPECT_EQ(0u, samples);
+    EXPECT_EQ(0u, state.skip);
+    EXPECT_EQ(0u, state.headerLen);
+}
+
+TEST(AdtsScanTest, RejectsLostSync)
+{
+    std::vector<uint8_t> data;
+
+    AppendFrame(data, kFreqIndex48k, 100);
+    /* payload length off by one: the next header starts inside the frame */
+    data[4] = ((kAdtsHeaderSize + 99) >> 3) & 0xFF;
+    data[5] = (((kAdtsHeaderSize + 99) & 0x07) << 5) | 0x1F;
+    AppendFrame(data, kFreqIndex48k, 100);
+    EXPECT_EQ(-1, CountInReads(data, data.size(), 48000));
+
+    /* raw AAC, no ADTS header at all */
+    std::vector<uint8_t> raw(512, 0x21);
+    EXPECT_EQ(-1, CountInReads(raw, raw.size(), 48000));
+}
+
+TEST(AdtsScanTest, RejectsInvalidHeaderFields)
+{
+    std::vector<uint8_t> data;
+
+    /* reserved sampling frequency index */
+    AppendFrame(data, 13, 100);
+    EXPECT_EQ(-1, CountInReads(data, data.size(), 48000));
+
+    /* frame length shorter than its own header */
+    data.clear();
+    AppendFrame(data, kFreqIndex48k, 0);
+    data[4] = 0;
+    data[5] = (3 << 5) | 0x1F;
+    EXPECT_EQ(-1, CountInReads(data, data.size(), 48000));
+}
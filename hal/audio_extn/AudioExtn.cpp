@@ -34,6 +34,7 @@
 #define LOG_TAG "AHAL: AudioExtn"
 #include <dlfcn.h>
 #include <unistd.h>
+#include <algorithm>
 #include "AudioExtn.h"
 #include "AudioDevice.h"
 #include "PalApi.h"
@@ -81,6 +82,7 @@ static void *batt_listener_lib_handle;
 static bool audio_extn_kpi_optimize_feature_enabled = false;
 //TODO make this mutex part of class
 std::mutex reconfig_wait_mutex_;
+std::atomic<uint32_t> bt_encoder_latency_gen_ = 1;
 std::mutex AudioExtn::sLock;
 
 std::atomic<bool> AudioExtn::sServicesRegistered = false;
@@ -99,6 +101,13 @@ int AudioExtn::audio_extn_parse_compress_metadata(struct audio_config *config_,
    *ch = 0;
    uint16_t flac_sample_size = ((config_->offload_info.bit_width == 32) ? 24:config_->offload_info.bit_width);
 
+   /* sent again for each gapless track, sizes the next compress session */
+   ret = str_parms_get_str(parms, AUDIO_OFFLOAD_CODEC_AVG_BIT_RATE, value, sizeof(value));
+   if (ret >= 0) {
+        config_->offload_info.bit_rate = atoi(value);
+        AHAL_DBG("avg bit rate %u", config_->offload_info.bit_rate);
+   }
+
    if (config_->offload_info.format == AUDIO_FORMAT_FLAC) {
         ret = str_parms_get_str(parms, AUDIO_OFFLOAD_CODEC_FLAC_MIN_BLK_SIZE, value, sizeof(value));
         if (ret >= 0) {
@@ -543,6 +552,7 @@ static int reconfig_cb (tSESSION_TYPE session_type, int state)
     AHAL_DBG("reconfig_cb enter with state %s for %s", reconfigStateName.at(state).c_str(),
         deviceNameLUT.at(SessionTypePalDevMap.at(session_type)).c_str());
     if (session_type == LE_AUDIO_HARDWARE_OFFLOAD_ENCODING_DATAPATH) {
+        bt_encoder_latency_gen_++;
 
         /* If reconfiguration is in progress state, we do a2dp suspend.
          * If reconfiguration is in complete state, we do a2dp resume.
@@ -561,6 +571,8 @@ static int reconfig_cb (tSESSION_TYPE session_type, int state)
             ret = pal_set_param(PAL_PARAM_ID_BT_A2DP_SUSPENDED, (void *)&param_bt_a2dp,
                                 sizeof(pal_param_bta2dp_t));
         }
+        /* latency of the new configuration is only known once suspend is done */
+        bt_encoder_latency_gen_++;
     } else if (session_type == LE_AUDIO_HARDWARE_OFFLOAD_DECODING_DATAPATH) {
         if ((tRECONFIG_STATE)state == SESSION_SUSPEND) {
             std::unique_lock<std::mutex> guard(reconfig_wait_mutex_);
@@ -1059,4 +1071,10 @@ bool CompressCapture::getAACMaxBufferSize(struct audio_config *config,
     return false;
 }
 
+bool CompressCapture::isAdtsFormat(audio_format_t format) {
+    return format == AUDIO_FORMAT_AAC_ADTS_LC ||
+           format == AUDIO_FORMAT_AAC_ADTS_HE_V1 ||
+           format == AUDIO_FORMAT_AAC_ADTS_HE_V2;
+}
+
 // END: compress_capture =======================================================
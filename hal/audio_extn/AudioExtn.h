@@ -38,6 +38,7 @@
 #include <atomic>
 #include <unordered_map>
 #include "PalDefs.h"
+#include "AdtsScan.h"
 #include "audio_defs.h"
 #include <log/log.h>
 #include "battery_listener.h"
@@ -50,6 +51,8 @@ typedef bool (*batt_prop_is_charging_t)();
 typedef bool (*audio_device_cmp_fn_t)(audio_devices_t);
 
 extern std::mutex reconfig_wait_mutex_;
+/* bumped whenever the BT encoder setup may have changed, see StreamOutPrimary::GetBtEncoderLatency */
+extern std::atomic<uint32_t> bt_encoder_latency_gen_;
 class AudioDevice;
 //HFP
 typedef int audio_usecase_t;
@@ -132,6 +135,8 @@ class CompressCapture {
     static bool getAACMaxBufferSize(struct audio_config *config,
                                     uint32_t &maxBufSize);
 
+    static bool isAdtsFormat(audio_format_t format);
+
     CompressCapture() = delete;
     ~CompressCapture() = delete;
 
@@ -83,7 +83,7 @@ static struct fm_module fm = {
 int32_t fm_set_volume(float value, bool persist=false)
 {
     int32_t ret = 0;
-    struct pal_volume_data *pal_volume = NULL;
+    struct pal_volume_payload volume = {};
 
     AHAL_DBG("Enter: volume = %f, persist: %d", value, persist);
 
@@ -110,20 +110,14 @@ int32_t fm_set_volume(float value, bool persist=false)
 
     AHAL_DBG("Setting FM volume to %f", value);
 
-    pal_volume = (struct pal_volume_data *) malloc(sizeof(struct pal_volume_data) + sizeof(struct pal_channel_vol_kv));
+    volume.no_of_volpair = 1;
+    volume.volume_pair[0].channel_mask = 0x03;
+    volume.volume_pair[0].vol = value;
 
-    if (!pal_volume)
-       return -ENOMEM;
-
-    pal_volume->no_of_volpair = 1;
-    pal_volume->volume_pair[0].channel_mask = 0x03;
-    pal_volume->volume_pair[0].vol = value;
-
-    ret = pal_stream_set_volume(fm.stream_handle, pal_volume);
+    ret = pal_stream_set_volume(fm.stream_handle, pal_volume(&volume));
     if (ret)
         AHAL_ERR("set volume failed: %d", ret);
 
-    free(pal_volume);
     AHAL_DBG("exit");
     return ret;
 }
@@ -84,7 +84,7 @@ static struct hfp_module hfpmod = {
 static int32_t hfp_set_volume(float value)
 {
     int32_t vol, ret = 0;
-    struct pal_volume_data *pal_volume = NULL;
+    struct pal_volume_payload volume = {};
 
     AHAL_VERBOSE("entry");
     AHAL_DBG("(%f)\n", value);
@@ -107,20 +107,13 @@ static int32_t hfp_set_volume(float value)
 
     AHAL_DBG("Setting HFP volume to %d \n", vol);
 
-    pal_volume = (struct pal_volume_data *)malloc(sizeof(struct pal_volume_data)
-            +sizeof(struct pal_channel_vol_kv));
-
-    if (!pal_volume)
-       return -ENOMEM;
-
-    pal_volume->no_of_volpair = 1;
-    pal_volume->volume_pair[0].channel_mask = 0x03;
-    pal_volume->volume_pair[0].vol = value;
-    ret = pal_stream_set_volume(hfpmod.rx_stream_handle, pal_volume);
+    volume.no_of_volpair = 1;
+    volume.volume_pair[0].channel_mask = 0x03;
+    volume.volume_pair[0].vol = value;
+    ret = pal_stream_set_volume(hfpmod.rx_stream_handle, pal_volume(&volume));
     if (ret)
         AHAL_ERR("set volume failed: %d \n", ret);
 
-    free(pal_volume);
     AHAL_VERBOSE("exit");
     return ret;
 }
@@ -132,7 +125,7 @@ static int32_t hfp_set_volume(float value)
 static int hfp_set_mic_volume(float value)
 {
     int volume, ret = 0;
-    struct pal_volume_data *pal_volume = NULL;
+    struct pal_volume_payload mic_volume = {};
 
     AHAL_DBG("enter, value=%f", value);
 
@@ -153,25 +146,14 @@ static int hfp_set_mic_volume(float value)
 
     volume = (int)(value * PLAYBACK_VOLUME_MAX);
 
-    pal_volume = (struct pal_volume_data *)malloc(sizeof(struct pal_volume_data)
-            +sizeof(struct pal_channel_vol_kv));
-    if (!pal_volume) {
-        AHAL_ERR("Failed to allocate memory for pal_volume");
-        return -ENOMEM;
-    }
-    pal_volume->no_of_volpair = 1;
-    pal_volume->volume_pair[0].channel_mask = 0x03;
-    pal_volume->volume_pair[0].vol = value;
-    if (pal_stream_set_volume(hfpmod.tx_stream_handle, pal_volume) < 0) {
+    mic_volume.no_of_volpair = 1;
+    mic_volume.volume_pair[0].channel_mask = 0x03;
+    mic_volume.volume_pair[0].vol = value;
+    if (pal_stream_set_volume(hfpmod.tx_stream_handle, pal_volume(&mic_volume)) < 0) {
         AHAL_ERR("Couldn't set HFP Volume: [%d]", volume);
-        free(pal_volume);
-        pal_volume = NULL;
         return -EINVAL;
     }
 
-    free(pal_volume);
-    pal_volume = NULL;
-
     return ret;
 }
 
@@ -69,6 +69,8 @@
 #include <pthread.h>
 #include <unistd.h>
 
+#include <atomic>
+
 #include "AudioCommon.h"
 #include <cutils/list.h>
 
@@ -199,6 +201,7 @@ do {\
 #define SVA_PARAM_CHANNEL_INDEX "st_channel_index"
 #define MAX_STR_LENGTH_FFV_PARAMS 30
 #define MAX_FFV_SESSION_ID 100
+#define ST_SES_SNAPSHOT_MAX 16
 
 /*
  * Current proprietary API version used by AHAL. Queried by STHAL
@@ -225,6 +228,22 @@ struct sound_trigger_audio_device {
 
 static struct sound_trigger_audio_device *st_dev;
 
+/*
+ * Copy of the capture_handle -> session mapping in st_ses_list for the LAB
+ * read path, which looks it up on every period. It is rebuilt under
+ * st_dev->lock whenever the list changes and read without the lock: seq is
+ * odd while an update is in progress and readers retry if it moved.
+ * count is -1 when the list does not fit, readers then walk the list.
+ */
+struct st_ses_snapshot {
+    std::atomic<uint32_t> seq;
+    std::atomic<int> count;
+    std::atomic<int> capture_handle[ST_SES_SNAPSHOT_MAX];
+    std::atomic<void *> p_ses[ST_SES_SNAPSHOT_MAX];
+};
+
+static struct st_ses_snapshot st_ses_snapshot;
+
 #if LINUX_ENABLED
 static void get_library_path(char *lib_path)
 {
@@ -264,6 +283,67 @@ get_sound_trigger_info(int capture_handle)
     return NULL;
 }
 
+/* called with st_dev->lock held */
+static void publish_st_ses_snapshot()
+{
+    struct sound_trigger_info *st_ses_info = NULL;
+    struct listnode *node;
+    uint32_t seq = st_ses_snapshot.seq.load(std::memory_order_relaxed);
+    int count = 0;
+
+    st_ses_snapshot.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    list_for_each(node, &st_dev->st_ses_list) {
+        st_ses_info = node_to_item(node, struct sound_trigger_info, list);
+        if (count == ST_SES_SNAPSHOT_MAX) {
+            AHAL_INFO("more than %d st sessions, lookups fall back to the list",
+                      ST_SES_SNAPSHOT_MAX);
+            count = -1;
+            break;
+        }
+        st_ses_snapshot.capture_handle[count].store(st_ses_info->st_ses.capture_handle,
+                                                    std::memory_order_relaxed);
+        st_ses_snapshot.p_ses[count].store(st_ses_info->st_ses.p_ses,
+                                           std::memory_order_relaxed);
+        count++;
+    }
+    st_ses_snapshot.count.store(count, std::memory_order_relaxed);
+
+    st_ses_snapshot.seq.store(seq + 2, std::memory_order_release);
+}
+
+/*
+ * Lockless lookup in the snapshot. Returns false if the snapshot cannot
+ * answer and the caller has to walk st_ses_list under the lock.
+ */
+static bool lookup_st_ses_snapshot(int capture_handle, bool *found, void **p_ses)
+{
+    uint32_t seq = 0;
+    int count = 0;
+
+    do {
+        seq = st_ses_snapshot.seq.load(std::memory_order_acquire);
+        if (seq & 1)
+            continue;
+
+        count = st_ses_snapshot.count.load(std::memory_order_relaxed);
+        *found = false;
+        *p_ses = NULL;
+        for (int i = 0; i < count; i++) {
+            if (st_ses_snapshot.capture_handle[i].load(std::memory_order_relaxed) ==
+                    capture_handle) {
+                *p_ses = st_ses_snapshot.p_ses[i].load(std::memory_order_relaxed);
+                *found = true;
+                break;
+            }
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((seq & 1) || st_ses_snapshot.seq.load(std::memory_order_relaxed) != seq);
+
+    return count >= 0;
+}
+
 extern "C" int check_init_audio_extension()
 {
     return AudioExtn::audio_extn_hidl_init();
@@ -329,6 +409,8 @@ extern "C" void audio_hw_call_back(sound_trigger_event_type_t event,
         AHAL_INFO("Unknown event %d", event);
         break;
     }
+    if (!status)
+        publish_st_ses_snapshot();
     pthread_mutex_unlock(&st_dev->lock);
 
 }
@@ -338,6 +420,7 @@ void* audio_extn_sound_trigger_check_and_get_session(StreamInPrimary *in_stream)
     struct sound_trigger_info *st_ses_info = nullptr;
     struct listnode *node = nullptr;
     void *handle = nullptr;
+    bool found = false;
 
     AHAL_VERBOSE("Enter");
     if (!st_dev || !in_stream) {
@@ -345,6 +428,13 @@ void* audio_extn_sound_trigger_check_and_get_session(StreamInPrimary *in_stream)
         goto exit;
     }
 
+    if (lookup_st_ses_snapshot(in_stream->GetHandle(), &found, &handle)) {
+        in_stream->is_st_session = found;
+        if (found)
+            AHAL_DBG("capture_handle %d is sound trigger", in_stream->GetHandle());
+        goto exit;
+    }
+
     pthread_mutex_lock(&st_dev->lock);
     in_stream->is_st_session = false;
     AHAL_VERBOSE("list %d capture_handle %d",
@@ -372,6 +462,7 @@ bool audio_extn_sound_trigger_check_session_activity(StreamInPrimary *in_stream)
     struct sound_trigger_info *st_ses_info = nullptr;
     struct listnode *node = nullptr;
     bool st_session_available = false;
+    void *p_ses = nullptr;
 
     AHAL_VERBOSE("Enter");
     if (!st_dev || !in_stream) {
@@ -379,6 +470,9 @@ bool audio_extn_sound_trigger_check_session_activity(StreamInPrimary *in_stream)
         goto exit;
     }
 
+    if (lookup_st_ses_snapshot(in_stream->GetHandle(), &st_session_available, &p_ses))
+        goto exit;
+
     pthread_mutex_lock(&st_dev->lock);
     AHAL_VERBOSE("list %d capture_handle %d",
           list_empty(&st_dev->st_ses_list), in_stream->GetHandle());
@@ -447,6 +541,7 @@ int audio_extn_sound_trigger_init(std::shared_ptr<AudioDevice> adev)
     st_dev->adev = adev;
     st_dev->st_ec_ref_enabled = false;
     list_init(&st_dev->st_ses_list);
+    publish_st_ses_snapshot();
 
     return 0;
 
@@ -473,6 +568,7 @@ void audio_extn_sound_trigger_deinit(std::shared_ptr<AudioDevice> adev)
                 free(st_ses_info);
             }
         }
+        publish_st_ses_snapshot();
     }
 
     if (st_dev && (st_dev->adev == adev) && st_dev->lib_handle) {
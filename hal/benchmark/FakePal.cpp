@@ -0,0 +1,695 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Stand-in for libar-pal that keeps no hardware state: streams are paced by
+ * a clock derived from their media config and the buffer size the HAL asks
+ * for, and latency, jitter and errors are injected on request through
+ * fake_pal_set_config(). Installed as libar-pal.so in its own directory, so
+ * only processes started with that directory in LD_LIBRARY_PATH load it.
+ */
+
+#define LOG_TAG "AHAL: FakePal"
+
+#include "FakePal.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <log/log.h>
+
+#include "PalApi.h"
+
+#define FAKE_PAL_DEFAULT_BIT_RATE 128000
+#define FAKE_PAL_DEFAULT_PERIOD_US 20000
+#define FAKE_PAL_DEFAULT_PERIODS 4
+#define FAKE_PAL_DEFAULT_FRAGMENT_SIZE (32 * 1024)
+
+namespace {
+
+struct FakeStream {
+    std::mutex lock;
+    std::condition_variable cond;
+    std::thread dsp;
+
+    pal_stream_callback cb = nullptr;
+    uint64_t cookie = 0;
+    bool compressed = false;
+    bool realtime = false;
+    /* bytes per second the DSP clock moves, speed included */
+    uint64_t byteRate = 0;
+    /* bytes per second of media, for timestamps */
+    uint64_t mediaByteRate = 0;
+    size_t fragment = 0;
+    size_t capacity = 0;
+
+    bool started = false;
+    bool paused = false;
+    bool exit = false;
+    /* bumped by flush, stop and pause to abandon a fragment in flight */
+    uint64_t epoch = 0;
+
+    /* pcm: clock start and bytes moved since */
+    bool clockRunning = false;
+    int64_t clockStartUs = 0;
+    uint64_t ioBytes = 0;
+
+    /* compressed: bytes queued on the DSP and pending events */
+    size_t fill = 0;
+    uint64_t consumed = 0;
+    bool wantWriteReady = false;
+    uint32_t drainEvent = 0;
+};
+
+struct fake_pal_config DefaultConfig()
+{
+    struct fake_pal_config config;
+
+    memset(&config, 0, sizeof(config));
+    config.ioError = -EIO;
+    config.speed = 1;
+    config.offloadBitrate = FAKE_PAL_DEFAULT_BIT_RATE;
+    return config;
+}
+
+/* config and stats, taken under a stream lock but never around one */
+std::mutex gLock;
+struct fake_pal_config gConfig = DefaultConfig();
+struct fake_pal_stats gStats;
+uint64_t gIoCalls;
+uint64_t gOpenCalls;
+uint64_t gWriteCalls;
+std::minstd_rand gRandom;
+
+int64_t NowUs()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+void SleepUs(int64_t us)
+{
+    if (us > 0)
+        std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+/* per call I/O latency, called with gLock held */
+int64_t IoDelayUsLocked()
+{
+    int64_t us = gConfig.ioLatencyUs;
+
+    if (gConfig.ioJitterUs > 0)
+        us += (int64_t)(gRandom() % (2 * gConfig.ioJitterUs + 1)) - gConfig.ioJitterUs;
+    return us;
+}
+
+FakeStream *ToStream(pal_stream_handle_t *handle)
+{
+    return reinterpret_cast<FakeStream *>(handle);
+}
+
+bool HasRoom(const FakeStream *s)
+{
+    return !s->realtime || s->capacity - s->fill >= std::min(s->fragment, s->capacity);
+}
+
+bool DspHasWork(const FakeStream *s)
+{
+    return s->exit || (s->started && !s->paused && s->fill) ||
+           (s->wantWriteReady && HasRoom(s)) || (s->drainEvent && !s->fill);
+}
+
+/*
+ * Consumes compressed data one fragment at a time and raises WRITE_READY
+ * once room frees up after a short write, and DRAIN_READY once empty.
+ */
+void DspLoop(FakeStream *s)
+{
+    std::unique_lock<std::mutex> guard(s->lock);
+    std::vector<uint32_t> events;
+
+    while (!s->exit) {
+        s->cond.wait(guard, [s]() { return DspHasWork(s); });
+        if (s->exit)
+            break;
+
+        if (s->started && !s->paused && s->fill) {
+            size_t chunk = s->realtime ? std::min(s->fill, s->fragment) : s->fill;
+            uint64_t epoch = s->epoch;
+
+            if (s->realtime) {
+                s->cond.wait_for(guard,
+                        std::chrono::microseconds(chunk * 1000000LL / s->byteRate),
+                        [s, epoch]() { return s->exit || s->epoch != epoch; });
+                if (s->exit || s->epoch != epoch)
+                    continue;
+            }
+            s->fill -= chunk;
+            s->consumed += chunk;
+            gLock.lock();
+            gStats.offloadMediaUs += chunk * 1000000LL / s->mediaByteRate;
+            gLock.unlock();
+        }
+
+        if (s->wantWriteReady && HasRoom(s)) {
+            s->wantWriteReady = false;
+            events.push_back(PAL_STREAM_CBK_EVENT_WRITE_READY);
+        }
+        if (s->drainEvent && !s->fill) {
+            events.push_back(s->drainEvent);
+            s->drainEvent = 0;
+        }
+        if (events.empty() || !s->cb)
+            continue;
+
+        guard.unlock();
+        for (uint32_t event : events) {
+            gLock.lock();
+            if (event == PAL_STREAM_CBK_EVENT_WRITE_READY)
+                gStats.writeReadyEvents++;
+            else
+                gStats.drainReadyEvents++;
+            gLock.unlock();
+            s->cb(reinterpret_cast<pal_stream_handle_t *>(s), event, nullptr, 0, s->cookie);
+        }
+        events.clear();
+        guard.lock();
+    }
+}
+
+/* blocks a pcm write or read until the DSP clock makes room or data */
+void PaceLocked(FakeStream *s, size_t bytes, bool output, std::unique_lock<std::mutex> &guard)
+{
+    int64_t now = NowUs();
+    uint64_t moved;
+    int64_t waitUs = 0;
+
+    if (!s->clockRunning) {
+        s->clockRunning = true;
+        s->clockStartUs = now;
+        s->ioBytes = 0;
+    }
+    moved = (uint64_t)(now - s->clockStartUs) * s->byteRate / 1000000LL;
+
+    if (output) {
+        /* underrun, the clock restarts from what was written */
+        if (moved > s->ioBytes) {
+            s->clockStartUs = now - (int64_t)(s->ioBytes * 1000000LL / s->byteRate);
+            moved = s->ioBytes;
+        }
+        if (s->ioBytes + bytes > moved + s->capacity)
+            waitUs = (s->ioBytes + bytes - s->capacity - moved) * 1000000LL / s->byteRate;
+    } else {
+        /* overrun, the oldest data is lost */
+        if (moved > s->ioBytes + s->capacity)
+            s->ioBytes = moved - s->capacity;
+        if (s->ioBytes + bytes > moved)
+            waitUs = (s->ioBytes + bytes - moved) * 1000000LL / s->byteRate;
+    }
+    s->ioBytes += bytes;
+
+    guard.unlock();
+    SleepUs(waitUs);
+    guard.lock();
+}
+
+/* latency and error injection shared by reads and writes */
+int BeginIo(int64_t *delayUs)
+{
+    std::lock_guard<std::mutex> guard(gLock);
+
+    *delayUs = IoDelayUsLocked();
+    if (gConfig.ioErrorEvery && ++gIoCalls % gConfig.ioErrorEvery == 0) {
+        gStats.ioErrors++;
+        return gConfig.ioError ? gConfig.ioError : -EIO;
+    }
+    return 0;
+}
+
+void EndIo(int64_t startUs)
+{
+    std::lock_guard<std::mutex> guard(gLock);
+
+    gStats.ioUs += NowUs() - startUs;
+}
+
+}  // namespace
+
+extern "C" {
+
+void fake_pal_get_config(struct fake_pal_config *config)
+{
+    std::lock_guard<std::mutex> guard(gLock);
+
+    *config = gConfig;
+}
+
+void fake_pal_set_config(const struct fake_pal_config *config)
+{
+    std::lock_guard<std::mutex> guard(gLock);
+
+    gConfig = *config;
+    if (!gConfig.speed)
+        gConfig.speed = 1;
+    if (!gConfig.offloadBitrate)
+        gConfig.offloadBitrate = FAKE_PAL_DEFAULT_BIT_RATE;
+    gIoCalls = 0;
+    gOpenCalls = 0;
+    gWriteCalls = 0;
+}
+
+void fake_pal_get_stats(struct fake_pal_stats *stats)
+{
+    std::lock_guard<std::mutex> guard(gLock);
+
+    *stats = gStats;
+}
+
+void fake_pal_reset_stats(void)
+{
+    std::lock_guard<std::mutex> guard(gLock);
+
+    memset(&gStats, 0, sizeof(gStats));
+}
+
+int32_t pal_init(void)
+{
+    ALOGI("fake PAL, no audio reaches the hardware");
+    return 0;
+}
+
+void pal_deinit(void)
+{
+}
+
+int32_t pal_register_global_callback(pal_global_callback cb, uint64_t cookie)
+{
+    return 0;
+}
+
+int32_t pal_stream_open(struct pal_stream_attributes *attributes,
+                        uint32_t no_of_devices, struct pal_device *devices,
+                        uint32_t no_of_modifiers, struct modifier_kv *modifiers,
+                        pal_stream_callback cb, uint64_t cookie,
+                        pal_stream_handle_t **stream_handle)
+{
+    struct pal_media_config *media;
+    FakeStream *s;
+    int64_t delayUs;
+    uint32_t speed;
+    uint32_t bitrate;
+    bool realtime;
+
+    if (!attributes || !stream_handle)
+        return -EINVAL;
+
+    gLock.lock();
+    delayUs = gConfig.openLatencyUs;
+    if (gConfig.openErrorEvery && ++gOpenCalls % gConfig.openErrorEvery == 0) {
+        gLock.unlock();
+        SleepUs(delayUs);
+        return -EINVAL;
+    }
+    speed = gConfig.speed;
+    bitrate = gConfig.offloadBitrate;
+    realtime = gConfig.realtime;
+    gStats.opens++;
+    gLock.unlock();
+    SleepUs(delayUs);
+
+    s = new FakeStream();
+    s->cb = cb;
+    s->cookie = cookie;
+    s->realtime = realtime;
+    s->compressed = attributes->type == PAL_STREAM_COMPRESSED;
+    media = attributes->direction == PAL_AUDIO_INPUT ? &attributes->in_media_config :
+                                                       &attributes->out_media_config;
+    if (s->compressed) {
+        s->mediaByteRate = bitrate / 8;
+        s->fragment = FAKE_PAL_DEFAULT_FRAGMENT_SIZE;
+    } else {
+        s->mediaByteRate = (uint64_t)media->sample_rate * media->ch_info.channels *
+                           (media->bit_width ? media->bit_width : 16) / 8;
+        s->fragment = s->mediaByteRate * FAKE_PAL_DEFAULT_PERIOD_US / 1000000LL;
+    }
+    if (!s->mediaByteRate)
+        s->mediaByteRate = 48000 * 2 * 2;
+    if (!s->fragment)
+        s->fragment = FAKE_PAL_DEFAULT_FRAGMENT_SIZE;
+    s->byteRate = s->mediaByteRate * speed;
+    s->capacity = s->fragment * FAKE_PAL_DEFAULT_PERIODS;
+
+    if (s->compressed && attributes->direction == PAL_AUDIO_OUTPUT)
+        s->dsp = std::thread(DspLoop, s);
+
+    *stream_handle = reinterpret_cast<pal_stream_handle_t *>(s);
+    return 0;
+}
+
+int32_t pal_stream_close(pal_stream_handle_t *stream_handle)
+{
+    FakeStream *s = ToStream(stream_handle);
+
+    if (!s)
+        return -EINVAL;
+
+    s->lock.lock();
+    s->exit = true;
+    s->cond.notify_all();
+    s->lock.unlock();
+    if (s->dsp.joinable())
+        s->dsp.join();
+    delete s;
+
+    gLock.lock();
+    gStats.closes++;
+    gLock.unlock();
+    return 0;
+}
+
+int32_t pal_stream_start(pal_stream_handle_t *stream_handle)
+{
+    FakeStream *s = ToStream(stream_handle);
+    int64_t delayUs;
+
+    if (!s)
+        return -EINVAL;
+
+    gLock.lock();
+    delayUs = gConfig.startLatencyUs;
+    gStats.starts++;
+    gLock.unlock();
+    SleepUs(delayUs);
+
+    std::lock_guard<std::mutex> guard(s->lock);
+    s->started = true;
+    s->paused = false;
+    s->clockRunning = false;
+    s->cond.notify_all();
+    return 0;
+}
+
+int32_t pal_stream_stop(pal_stream_handle_t *stream_handle)
+{
+    FakeStream *s = ToStream(stream_handle);
+
+    if (!s)
+        return -EINVAL;
+
+    std::lock_guard<std::mutex> guard(s->lock);
+    s->started = false;
+    s->clockRunning = false;
+    s->fill = 0;
+    s->wantWriteReady = false;
+    s->drainEvent = 0;
+    s->epoch++;
+    s->cond.notify_all();
+    return 0;
+}
+
+int32_t pal_stream_pause(pal_stream_handle_t *stream_handle)
+{
+    FakeStream *s = ToStream(stream_handle);
+
+    if (!s)
+        return -EINVAL;
+
+    std::lock_guard<std::mutex> guard(s->lock);
+    s->paused = true;
+    s->epoch++;
+    s->cond.notify_all();
+    return 0;
+}
+
+int32_t pal_stream_resume(pal_stream_handle_t *stream_handle)
+{
+    FakeStream *s = ToStream(stream_handle);
+
+    if (!s)
+        return -EINVAL;
+
+    std::lock_guard<std::mutex> guard(s->lock);
+    s->paused = false;
+    s->clockRunning = false;
+    s->cond.notify_all();
+    return 0;
+}
+
+int32_t pal_stream_flush(pal_stream_handle_t *stream_handle)
+{
+    FakeStream *s = ToStream(stream_handle);
+
+    if (!s)
+        return -EINVAL;
+
+    std::lock_guard<std::mutex> guard(s->lock);
+    s->fill = 0;
+    s->epoch++;
+    s->cond.notify_all();
+    return 0;
+}
+
+int32_t pal_stream_drain(pal_stream_handle_t *stream_handle, pal_drain_type_t type)
+{
+    FakeStream *s = ToStream(stream_handle);
+
+    if (!s)
+        return -EINVAL;
+    if (!s->compressed)
+        return 0;
+
+    std::lock_guard<std::mutex> guard(s->lock);
+    s->drainEvent = type == PAL_DRAIN_PARTIAL ? PAL_STREAM_CBK_EVENT_PARTIAL_DRAIN_READY :
+                                                PAL_STREAM_CBK_EVENT_DRAIN_READY;
+    s->cond.notify_all();
+    return 0;
+}
+
+int32_t pal_stream_set_buffer_size(pal_stream_handle_t *stream_handle,
+                                   pal_buffer_config_t *in_buff_cfg,
+                                   pal_buffer_config_t *out_buff_cfg)
+{
+    FakeStream *s = ToStream(stream_handle);
+    pal_buffer_config_t *cfg = out_buff_cfg ? out_buff_cfg : in_buff_cfg;
+
+    if (!s)
+        return -EINVAL;
+    if (!cfg || !cfg->buf_size || !cfg->buf_count)
+        return 0;
+
+    std::lock_guard<std::mutex> guard(s->lock);
+    s->fragment = cfg->buf_size;
+    s->capacity = cfg->buf_size * cfg->buf_count;
+    return 0;
+}
+
+ssize_t pal_stream_write(pal_stream_handle_t *stream_handle, struct pal_buffer *buf)
+{
+    FakeStream *s = ToStream(stream_handle);
+    int64_t startUs = NowUs();
+    int64_t delayUs = 0;
+    size_t accepted;
+    bool shortWrite;
+    int ret;
+
+    if (!s || !buf)
+        return -EINVAL;
+
+    ret = BeginIo(&delayUs);
+    SleepUs(delayUs);
+    if (ret) {
+        EndIo(startUs);
+        return ret;
+    }
+
+    gLock.lock();
+    gStats.writes++;
+    shortWrite = gConfig.shortWriteEvery && ++gWriteCalls % gConfig.shortWriteEvery == 0;
+    gLock.unlock();
+
+    std::unique_lock<std::mutex> guard(s->lock);
+    accepted = shortWrite ? buf->size / 2 : buf->size;
+    if (s->compressed) {
+        if (s->realtime)
+            accepted = std::min(accepted, s->capacity - std::min(s->fill, s->capacity));
+        s->fill += accepted;
+        if (accepted < buf->size)
+            s->wantWriteReady = true;
+        s->cond.notify_all();
+    } else if (s->realtime) {
+        PaceLocked(s, accepted, true, guard);
+    }
+    guard.unlock();
+
+    gLock.lock();
+    if (accepted < buf->size)
+        gStats.shortWrites++;
+    gLock.unlock();
+    EndIo(startUs);
+    return accepted;
+}
+
+ssize_t pal_stream_read(pal_stream_handle_t *stream_handle, struct pal_buffer *buf)
+{
+    FakeStream *s = ToStream(stream_handle);
+    int64_t startUs = NowUs();
+    int64_t delayUs = 0;
+    int ret;
+
+    if (!s || !buf)
+        return -EINVAL;
+
+    ret = BeginIo(&delayUs);
+    SleepUs(delayUs);
+    if (ret) {
+        EndIo(startUs);
+        return ret;
+    }
+
+    gLock.lock();
+    gStats.reads++;
+    gLock.unlock();
+
+    std::unique_lock<std::mutex> guard(s->lock);
+    if (s->realtime)
+        PaceLocked(s, buf->size, false, guard);
+    guard.unlock();
+
+    if (buf->buffer)
+        memset(buf->buffer, 0, buf->size);
+    EndIo(startUs);
+    return buf->size;
+}
+
+int32_t pal_get_timestamp(pal_stream_handle_t *stream_handle, struct pal_session_time *stime)
+{
+    FakeStream *s = ToStream(stream_handle);
+    uint64_t playedUs;
+
+    if (!s || !stime)
+        return -EINVAL;
+
+    std::lock_guard<std::mutex> guard(s->lock);
+    if (s->compressed)
+        playedUs = s->consumed * 1000000ULL / s->mediaByteRate;
+    else
+        playedUs = s->ioBytes * 1000000ULL / s->mediaByteRate;
+    memset(stime, 0, sizeof(*stime));
+    stime->session_time.value_lsw = (uint32_t)playedUs;
+    stime->session_time.value_msw = (uint32_t)(playedUs >> 32);
+    return 0;
+}
+
+int32_t pal_stream_set_device(pal_stream_handle_t *stream_handle,
+                              uint32_t no_of_devices, struct pal_device *devices)
+{
+    int64_t delayUs;
+
+    if (!stream_handle)
+        return -EINVAL;
+
+    gLock.lock();
+    delayUs = gConfig.routeLatencyUs;
+    gStats.routes++;
+    gLock.unlock();
+    SleepUs(delayUs);
+    return 0;
+}
+
+int32_t pal_stream_get_param(pal_stream_handle_t *stream_handle, uint32_t param_id,
+                             pal_param_payload **param_payload)
+{
+    return -ENOSYS;
+}
+
+int32_t pal_stream_set_param(pal_stream_handle_t *stream_handle, uint32_t param_id,
+                             pal_param_payload *param_payload)
+{
+    return stream_handle ? 0 : -EINVAL;
+}
+
+int32_t pal_stream_set_volume(pal_stream_handle_t *stream_handle,
+                              struct pal_volume_data *volume)
+{
+    return stream_handle ? 0 : -EINVAL;
+}
+
+int32_t pal_stream_set_mute(pal_stream_handle_t *stream_handle, bool state)
+{
+    return stream_handle ? 0 : -EINVAL;
+}
+
+int32_t pal_add_remove_effect(pal_stream_handle_t *stream_handle,
+                              pal_audio_effect_t effect, bool enable)
+{
+    return stream_handle ? 0 : -EINVAL;
+}
+
+int32_t pal_stream_create_mmap_buffer(pal_stream_handle_t *stream_handle,
+                                      int32_t min_size_frames,
+                                      struct pal_mmap_buffer *info)
+{
+    return -ENOSYS;
+}
+
+int32_t pal_stream_get_mmap_position(pal_stream_handle_t *stream_handle,
+                                     struct pal_mmap_position *position)
+{
+    return -ENOSYS;
+}
+
+int32_t pal_set_param(uint32_t param_id, void *param_payload, size_t payload_size)
+{
+    return 0;
+}
+
+/*
+ * Nothing to report: the HAL checks the returned size or pre-fills the
+ * payload, and treats a failed query as a failed route or open.
+ */
+int32_t pal_get_param(uint32_t param_id, void **param_payload, size_t *payload_size,
+                      void *query)
+{
+    if (payload_size)
+        *payload_size = 0;
+    return 0;
+}
+
+}  // extern "C"
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ANDROID_HARDWARE_AHAL_FAKE_PAL_H_
+#define ANDROID_HARDWARE_AHAL_FAKE_PAL_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Behaviour of the fake PAL, applies to calls made after it is set. All
+ * times are in microseconds, a count of 0 disables the injection.
+ */
+struct fake_pal_config {
+    int64_t ioLatencyUs;        /* added to every pal_stream_write/read */
+    int64_t ioJitterUs;         /* uniform +/- spread of the above */
+    int64_t openLatencyUs;      /* pal_stream_open */
+    int64_t startLatencyUs;     /* pal_stream_start */
+    int64_t routeLatencyUs;     /* pal_stream_set_device */
+    uint32_t ioErrorEvery;      /* fail every n-th read/write with ioError */
+    int32_t ioError;
+    uint32_t openErrorEvery;    /* fail every n-th pal_stream_open with -EINVAL */
+    uint32_t shortWriteEvery;   /* accept half of every n-th write */
+    /*
+     * Pace I/O with a DSP clock: PCM writes block while the buffer set by
+     * pal_stream_set_buffer_size is full, reads block until the data was
+     * captured, compressed data is consumed at offloadBitrate and room is
+     * signalled with PAL_STREAM_CBK_EVENT_WRITE_READY.
+     */
+    uint32_t realtime;
+    uint32_t speed;             /* DSP clock runs this many times faster */
+    uint32_t offloadBitrate;    /* bits per second */
+};
+
+struct fake_pal_stats {
+    uint64_t opens;
+    uint64_t closes;
+    uint64_t starts;
+    uint64_t writes;
+    uint64_t reads;
+    uint64_t ioErrors;
+    uint64_t shortWrites;
+    uint64_t routes;
+    uint64_t writeReadyEvents;
+    uint64_t drainReadyEvents;
+    /* wall time spent inside pal_stream_write/read */
+    int64_t ioUs;
+    /* media time consumed from compressed streams */
+    int64_t offloadMediaUs;
+};
+
+void fake_pal_get_config(struct fake_pal_config *config);
+void fake_pal_set_config(const struct fake_pal_config *config);
+void fake_pal_get_stats(struct fake_pal_stats *stats);
+void fake_pal_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // ANDROID_HARDWARE_AHAL_FAKE_PAL_H_
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "FakePalHal.h"
+
+#include <dlfcn.h>
+
+#include <hardware/hardware.h>
+
+#ifndef FAKE_PAL_LIBRARY
+#if defined(__LP64__)
+#define FAKE_PAL_LIBRARY "/vendor/lib64/fakepal/libar-pal.so"
+#else
+#define FAKE_PAL_LIBRARY "/vendor/lib/fakepal/libar-pal.so"
+#endif
+#endif
+
+static struct fake_pal_api sApi;
+static audio_hw_device_t *sDev;
+
+audio_hw_device_t *OpenHalOverFakePal(struct fake_pal_api *api)
+{
+    const hw_module_t *module = nullptr;
+    void *lib = nullptr;
+
+    if (sDev)
+        goto done;
+
+    lib = dlopen(FAKE_PAL_LIBRARY, RTLD_NOW | RTLD_GLOBAL);
+    if (!lib)
+        return nullptr;
+    sApi.get_config = (void (*)(struct fake_pal_config *))dlsym(lib, "fake_pal_get_config");
+    sApi.set_config = (void (*)(const struct fake_pal_config *))dlsym(lib, "fake_pal_set_config");
+    sApi.get_stats = (void (*)(struct fake_pal_stats *))dlsym(lib, "fake_pal_get_stats");
+    sApi.reset_stats = (void (*)(void))dlsym(lib, "fake_pal_reset_stats");
+    if (!sApi.get_config || !sApi.set_config || !sApi.get_stats || !sApi.reset_stats)
+        return nullptr;
+
+    if (hw_get_module_by_class(AUDIO_HARDWARE_MODULE_ID, AUDIO_HARDWARE_MODULE_ID_PRIMARY,
+                               &module) ||
+        audio_hw_device_open(module, &sDev)) {
+        sDev = nullptr;
+        return nullptr;
+    }
+
+done:
+    *api = sApi;
+    return sDev;
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ANDROID_HARDWARE_AHAL_FAKE_PAL_HAL_H_
+#define ANDROID_HARDWARE_AHAL_FAKE_PAL_HAL_H_
+
+#include <hardware/audio.h>
+
+#include "FakePal.h"
+
+/* control entry points of the fake PAL, see FakePal.h */
+struct fake_pal_api {
+    void (*get_config)(struct fake_pal_config *config);
+    void (*set_config)(const struct fake_pal_config *config);
+    void (*get_stats)(struct fake_pal_stats *stats);
+    void (*reset_stats)(void);
+};
+
+/*
+ * Loads the fake PAL by path ahead of the primary HAL, so that the HAL's
+ * libar-pal.so dependency resolves to it, then opens the HAL. The device is
+ * opened once per process and stays open. Returns nullptr if either is not
+ * installed.
+ */
+audio_hw_device_t *OpenHalOverFakePal(struct fake_pal_api *api);
+
+#endif  // ANDROID_HARDWARE_AHAL_FAKE_PAL_HAL_H_
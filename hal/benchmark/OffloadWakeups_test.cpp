@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Plays compressed audio through the primary HAL on top of the fake PAL and
+ * checks the non-blocking offload contract: short writes are reported, each
+ * one is followed by exactly one WRITE_READY, drains complete, and the
+ * framework is woken about once per fragment rather than once per write.
+ *
+ * The fake PAL is loaded by path before the HAL, so the HAL's libar-pal.so
+ * dependency resolves to it and no audio reaches the hardware.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <hardware/audio.h>
+#include <system/audio.h>
+
+#include "FakePalHal.h"
+
+namespace {
+
+const uint32_t kBitRate = 128000;
+/* media plays this many times faster than real time */
+const uint32_t kSpeed = 60;
+const int kCallbackTimeoutMs = 2000;
+
+struct fake_pal_api gFake;
+struct fake_pal_config gDefaultConfig;
+audio_hw_device_t *gDev;
+
+/* stands in for the audioserver offload thread */
+struct offload_client {
+    std::mutex lock;
+    std::condition_variable cond;
+    bool writeReady = false;
+    bool drainReady = false;
+    bool error = false;
+    uint64_t writeReadies = 0;
+    uint64_t drainReadies = 0;
+};
+
+int ClientCallback(stream_callback_event_t event, void * /* param */, void *cookie)
+{
+    struct offload_client *client = (struct offload_client *)cookie;
+    std::lock_guard<std::mutex> guard(client->lock);
+
+    if (event == STREAM_CBK_EVENT_WRITE_READY) {
+        client->writeReady = true;
+        client->writeReadies++;
+    } else if (event == STREAM_CBK_EVENT_DRAIN_READY) {
+        client->drainReady = true;
+        client->drainReadies++;
+    } else {
+        client->error = true;
+    }
+    client->cond.notify_all();
+    return 0;
+}
+
+bool WaitCallback(struct offload_client *client, bool *flag, int timeoutMs)
+{
+    std::unique_lock<std::mutex> guard(client->lock);
+    bool ret;
+
+    ret = client->cond.wait_for(guard, std::chrono::milliseconds(timeoutMs),
+                                [client, flag]() { return *flag || client->error; });
+    ret = ret && *flag;
+    *flag = false;
+    return ret;
+}
+
+std::string Dump(const struct audio_stream *stream)
+{
+    std::string text;
+    FILE *f = tmpfile();
+    char line[512];
+
+    if (!f)
+        return text;
+    stream->dump(stream, fileno(f));
+    rewind(f);
+    while (fgets(line, sizeof(line), f))
+        text += line;
+    fclose(f);
+    return text;
+}
+
+/* the first number following key in the dump, 0 if missing */
+uint64_t DumpValue(const std::string &dump, const char *key)
+{
+    size_t pos = dump.find(key);
+
+    if (pos == std::string::npos)
+        return 0;
+    return strtoull(dump.c_str() + pos + strlen(key), nullptr, 10);
+}
+
+class OffloadWakeupsTest : public testing::Test {
+protected:
+    static void SetUpTestSuite()
+    {
+        gDev = OpenHalOverFakePal(&gFake);
+        if (gDev)
+            gFake.get_config(&gDefaultConfig);
+    }
+
+    void SetUp() override
+    {
+        if (!gDev)
+            GTEST_SKIP() << "needs the primary HAL and the fake PAL";
+        Configure(true, 0);
+    }
+
+    void TearDown() override
+    {
+        if (out) {
+            out->common.standby(&out->common);
+            gDev->close_output_stream(gDev, out);
+        }
+        if (gDev)
+            gFake.set_config(&gDefaultConfig);
+    }
+
+    void Configure(bool realtime, uint32_t shortWriteEvery)
+    {
+        struct fake_pal_config config = gDefaultConfig;
+
+        config.realtime = realtime;
+        config.speed = kSpeed;
+        config.offloadBitrate = kBitRate;
+        config.shortWriteEvery = shortWriteEvery;
+        gFake.set_config(&config);
+        gFake.reset_stats();
+    }
+
+    void OpenMp3()
+    {
+        struct audio_config config = AUDIO_CONFIG_INITIALIZER;
+        audio_output_flags_t flags = (audio_output_flags_t)(AUDIO_OUTPUT_FLAG_DIRECT |
+                AUDIO_OUTPUT_FLAG_COMPRESS_OFFLOAD | AUDIO_OUTPUT_FLAG_NON_BLOCKING);
+
+        config.sample_rate = 44100;
+        config.channel_mask = AUDIO_CHANNEL_OUT_STEREO;
+        config.format = AUDIO_FORMAT_MP3;
+        config.offload_info.sample_rate = config.sample_rate;
+        config.offload_info.channel_mask = config.channel_mask;
+        config.offload_info.format = config.format;
+        config.offload_info.stream_type = AUDIO_STREAM_MUSIC;
+        config.offload_info.bit_rate = kBitRate;
+        config.offload_info.duration_us = 10 * 60 * 1000000LL;
+        config.offload_info.bit_width = 16;
+        config.offload_info.usage = AUDIO_USAGE_MEDIA;
+
+        ASSERT_EQ(0, gDev->open_output_stream(gDev, 100, AUDIO_DEVICE_OUT_SPEAKER, flags,
+                                              &config, &out, ""));
+        ASSERT_NE(nullptr, out);
+        ASSERT_EQ(0, out->set_callback(out, ClientCallback, &client));
+        buffer.assign(out->common.get_buffer_size(&out->common), 0);
+        ASSERT_FALSE(buffer.empty());
+    }
+
+    /*
+     * Writes like audioserver does until mediaUs were played, or for writes
+     * buffers when mediaUs is 0. Returns false if a short write was not
+     * followed by WRITE_READY.
+     */
+    bool Play(int64_t mediaUs, int writes)
+    {
+        struct fake_pal_stats stats;
+        size_t done;
+        ssize_t ret;
+
+        for (int i = 0; mediaUs || i < writes; i++) {
+            for (done = 0; done < buffer.size(); done += ret) {
+                ret = out->write(out, buffer.data() + done, buffer.size() - done);
+                if (ret < 0)
+                    return false;
+                submitted += ret;
+                if (done + ret == buffer.size())
+                    break;
+                shortWrites++;
+                if (!WaitCallback(&client, &client.writeReady, kCallbackTimeoutMs))
+                    return false;
+            }
+            gFake.get_stats(&stats);
+            if (mediaUs && stats.offloadMediaUs >= mediaUs)
+                break;
+        }
+        return true;
+    }
+
+    struct audio_stream_out *out = nullptr;
+    struct offload_client client;
+    std::vector<uint8_t> buffer;
+    uint64_t submitted = 0;
+    uint64_t shortWrites = 0;
+};
+
+}  // namespace
+
+TEST_F(OffloadWakeupsTest, Mp3WakesAboutOncePerFragment)
+{
+    struct fake_pal_stats stats;
+    uint64_t expected;
+    double perMinute;
+
+    ASSERT_NO_FATAL_FAILURE(OpenMp3());
+    ASSERT_TRUE(Play(5 * 60 * 1000000LL, 0));
+    gFake.get_stats(&stats);
+
+    expected = DumpValue(Dump(&out->common), "expected ");
+    ASSERT_GT(expected, 0u);
+    perMinute = client.writeReadies * 60e6 / stats.offloadMediaUs;
+    EXPECT_NEAR((double)expected, perMinute, expected / 5.0 + 1);
+    /* one WRITE_READY per short write, none spurious */
+    EXPECT_EQ(shortWrites, client.writeReadies);
+    EXPECT_LE(client.writeReadies, stats.writeReadyEvents);
+}
+
+TEST_F(OffloadWakeupsTest, ShortWritesAreAccountedNotDropped)
+{
+    Configure(false, 2);
+    ASSERT_NO_FATAL_FAILURE(OpenMp3());
+    ASSERT_TRUE(Play(0, 50));
+
+    EXPECT_GT(shortWrites, 0u);
+    EXPECT_EQ(shortWrites, client.writeReadies);
+    EXPECT_EQ(submitted, 50 * buffer.size());
+    EXPECT_EQ(submitted, DumpValue(Dump(&out->common), "bytes written "));
+}
+
+TEST_F(OffloadWakeupsTest, DrainReportsReadyOnceEmpty)
+{
+    struct fake_pal_stats stats;
+
+    ASSERT_NO_FATAL_FAILURE(OpenMp3());
+    ASSERT_TRUE(Play(10 * 1000000LL, 0));
+
+    ASSERT_EQ(0, out->drain(out, AUDIO_DRAIN_EARLY_NOTIFY));
+    EXPECT_TRUE(WaitCallback(&client, &client.drainReady, kCallbackTimeoutMs));
+    ASSERT_TRUE(Play(0, 4));
+    ASSERT_EQ(0, out->drain(out, AUDIO_DRAIN_ALL));
+    EXPECT_TRUE(WaitCallback(&client, &client.drainReady, kCallbackTimeoutMs));
+    EXPECT_EQ(2u, client.drainReadies);
+
+    gFake.get_stats(&stats);
+    EXPECT_EQ(2u, stats.drainReadyEvents);
+}
@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Switches the devices of open streams through create_audio_patch like
+ * audiopolicy does and counts heap allocations on the control worker,
+ * which runs RouteStream. The caller side copies the patch ports and is
+ * not counted; no other HAL thread is busy while a route runs.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <new>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <hardware/audio.h>
+#include <system/audio.h>
+
+#include "FakePalHal.h"
+
+namespace {
+
+const int kSwitches = 20;
+
+std::atomic<uint64_t> gAllocs;
+thread_local uint64_t tAllocs;
+
+void *CountedAlloc(size_t size)
+{
+    gAllocs.fetch_add(1, std::memory_order_relaxed);
+    tAllocs++;
+    return malloc(size ? size : 1);
+}
+
+}  // namespace
+
+void *operator new(size_t size)
+{
+    void *p = CountedAlloc(size);
+
+    if (!p)
+        abort();
+    return p;
+}
+
+void *operator new[](size_t size)
+{
+    void *p = CountedAlloc(size);
+
+    if (!p)
+        abort();
+    return p;
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return CountedAlloc(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return CountedAlloc(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    free(p);
+}
+
+namespace {
+
+struct fake_pal_api gFake;
+audio_hw_device_t *gDev;
+
+class RouteAllocationsTest : public testing::Test {
+protected:
+    static void SetUpTestSuite() { gDev = OpenHalOverFakePal(&gFake); }
+
+    void SetUp() override
+    {
+        if (!gDev)
+            GTEST_SKIP() << "needs the primary HAL and the fake PAL";
+        gFake.reset_stats();
+        memset(&source, 0, sizeof(source));
+        memset(&sink, 0, sizeof(sink));
+        source.role = AUDIO_PORT_ROLE_SOURCE;
+        sink.role = AUDIO_PORT_ROLE_SINK;
+    }
+
+    void TearDown() override
+    {
+        if (patch != AUDIO_PATCH_HANDLE_NONE)
+            gDev->release_audio_patch(gDev, patch);
+        if (out) {
+            out->common.standby(&out->common);
+            gDev->close_output_stream(gDev, out);
+        }
+        if (in) {
+            in->common.standby(&in->common);
+            gDev->close_input_stream(gDev, in);
+        }
+    }
+
+    /* moves the patch to device, returns the allocations made off this thread */
+    uint64_t Switch(struct audio_port_config *port, audio_devices_t device)
+    {
+        uint64_t total = gAllocs.load();
+        uint64_t mine = tAllocs;
+
+        port->ext.device.type = device;
+        EXPECT_EQ(0, gDev->create_audio_patch(gDev, 1, &source, 1, &sink, &patch));
+        return (gAllocs.load() - total) - (tAllocs - mine);
+    }
+
+    struct audio_stream_out *out = nullptr;
+    struct audio_stream_in *in = nullptr;
+    struct audio_port_config source;
+    struct audio_port_config sink;
+    audio_patch_handle_t patch = AUDIO_PATCH_HANDLE_NONE;
+};
+
+}  // namespace
+
+TEST_F(RouteAllocationsTest, OutputDeviceSwitchAllocatesNothing)
+{
+    struct audio_config config = AUDIO_CONFIG_INITIALIZER;
+    struct fake_pal_stats stats;
+    std::vector<uint8_t> buffer;
+    uint64_t allocs = 0;
+
+    config.sample_rate = 48000;
+    config.channel_mask = AUDIO_CHANNEL_OUT_STEREO;
+    config.format = AUDIO_FORMAT_PCM_16_BIT;
+    ASSERT_EQ(0, gDev->open_output_stream(gDev, 300, AUDIO_DEVICE_OUT_SPEAKER,
+                                          AUDIO_OUTPUT_FLAG_DEEP_BUFFER, &config, &out, ""));
+    buffer.assign(out->common.get_buffer_size(&out->common), 0);
+    for (int i = 0; i < 4; i++)
+        ASSERT_GT(out->write(out, buffer.data(), buffer.size()), 0);
+
+    source.type = AUDIO_PORT_TYPE_MIX;
+    source.ext.mix.handle = 300;
+    source.ext.mix.usecase.stream = AUDIO_STREAM_MUSIC;
+    sink.type = AUDIO_PORT_TYPE_DEVICE;
+
+    /* the first switches size the route state */
+    Switch(&sink, AUDIO_DEVICE_OUT_SPEAKER);
+    Switch(&sink, AUDIO_DEVICE_OUT_EARPIECE);
+    Switch(&sink, AUDIO_DEVICE_OUT_SPEAKER);
+    gFake.reset_stats();
+
+    for (int i = 0; i < kSwitches; i++)
+        allocs += Switch(&sink, i & 1 ? AUDIO_DEVICE_OUT_SPEAKER : AUDIO_DEVICE_OUT_EARPIECE);
+
+    EXPECT_EQ(0u, allocs);
+    gFake.get_stats(&stats);
+    EXPECT_EQ((uint64_t)kSwitches, stats.routes);
+}
+
+TEST_F(RouteAllocationsTest, InputDeviceSwitchAllocatesNothing)
+{
+    struct audio_config config = AUDIO_CONFIG_INITIALIZER;
+    struct fake_pal_stats stats;
+    std::vector<uint8_t> buffer;
+    uint64_t allocs = 0;
+
+    config.sample_rate = 48000;
+    config.channel_mask = AUDIO_CHANNEL_IN_STEREO;
+    config.format = AUDIO_FORMAT_PCM_16_BIT;
+    ASSERT_EQ(0, gDev->open_input_stream(gDev, 301, AUDIO_DEVICE_IN_BUILTIN_MIC, &config, &in,
+                                         AUDIO_INPUT_FLAG_NONE, "", AUDIO_SOURCE_MIC));
+    buffer.assign(in->common.get_buffer_size(&in->common), 0);
+    for (int i = 0; i < 4; i++)
+        ASSERT_GT(in->read(in, buffer.data(), buffer.size()), 0);
+
+    source.type = AUDIO_PORT_TYPE_DEVICE;
+    sink.type = AUDIO_PORT_TYPE_MIX;
+    sink.ext.mix.handle = 301;
+    sink.ext.mix.usecase.source = AUDIO_SOURCE_MIC;
+
+    Switch(&source, AUDIO_DEVICE_IN_BUILTIN_MIC);
+    Switch(&source, AUDIO_DEVICE_IN_BACK_MIC);
+    Switch(&source, AUDIO_DEVICE_IN_BUILTIN_MIC);
+    gFake.reset_stats();
+
+    for (int i = 0; i < kSwitches; i++)
+        allocs += Switch(&source, i & 1 ? AUDIO_DEVICE_IN_BUILTIN_MIC : AUDIO_DEVICE_IN_BACK_MIC);
+
+    EXPECT_EQ(0u, allocs);
+    gFake.get_stats(&stats);
+    EXPECT_EQ((uint64_t)kSwitches, stats.routes);
+}
@@ -0,0 +1,673 @@
+/*
+ * Copyright (c) 2026, Paranoid Android. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Paranoid Android nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Drives the primary audio HAL the way audioserver does, on top of the fake
+ * PAL: adev_open, then for every usecase open a stream, push or pull audio
+ * through out_write / in_read and close it again. Reports per call CPU and
+ * wall time, the share of it spent in the HAL rather than in PAL, heap
+ * allocations, stream lock waits and call jitter, so HAL changes can be
+ * compared without hardware in the loop.
+ *
+ * Needs the fake PAL ahead of the real one and the audio HAL service
+ * stopped:
+ *   LD_LIBRARY_PATH=/vendor/lib64/fakepal audio_hal_benchmark [options]
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <hardware/audio.h>
+#include <hardware/hardware.h>
+#include <system/audio.h>
+
+#include "FakePal.h"
+
+#define BENCHMARK_DEFAULT_CALLS 1000
+#define BENCHMARK_DEFAULT_OFFLOAD_SECONDS 60
+#define BENCHMARK_OFFLOAD_BIT_RATE 128000
+#define BENCHMARK_CALLBACK_TIMEOUT_MS 2000
+
+/* every operator new in the process, the HAL's included */
+static std::atomic<uint64_t> gAllocs;
+static std::atomic<uint64_t> gAllocBytes;
+
+static void *CountedAlloc(size_t size)
+{
+    gAllocs.fetch_add(1, std::memory_order_relaxed);
+    gAllocBytes.fetch_add(size, std::memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+
+void *operator new(size_t size)
+{
+    void *p = CountedAlloc(size);
+
+    if (!p)
+        abort();
+    return p;
+}
+
+void *operator new[](size_t size)
+{
+    void *p = CountedAlloc(size);
+
+    if (!p)
+        abort();
+    return p;
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return CountedAlloc(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return CountedAlloc(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    free(p);
+}
+
+struct scenario {
+    const char *usecase;
+    bool output;
+    audio_output_flags_t outFlags;
+    audio_input_flags_t inFlags;
+    audio_source_t source;
+    audio_format_t format;
+    uint32_t sampleRate;
+    audio_channel_mask_t channelMask;
+};
+
+/* one stream per usecase GetOutputUseCase / GetInputUseCase can reach */
+static const struct scenario scenarios[] = {
+    {"deep-buffer-playback", true, AUDIO_OUTPUT_FLAG_DEEP_BUFFER, AUDIO_INPUT_FLAG_NONE,
+     AUDIO_SOURCE_DEFAULT, AUDIO_FORMAT_PCM_16_BIT, 48000, AUDIO_CHANNEL_OUT_STEREO},
+    {"low-latency-playback", true,
+     (audio_output_flags_t)(AUDIO_OUTPUT_FLAG_PRIMARY | AUDIO_OUTPUT_FLAG_FAST),
+     AUDIO_INPUT_FLAG_NONE, AUDIO_SOURCE_DEFAULT, AUDIO_FORMAT_PCM_16_BIT, 48000,
+     AUDIO_CHANNEL_OUT_STEREO},
+    {"audio-ull-playback", true,
+     (audio_output_flags_t)(AUDIO_OUTPUT_FLAG_FAST | AUDIO_OUTPUT_FLAG_RAW),
+     AUDIO_INPUT_FLAG_NONE, AUDIO_SOURCE_DEFAULT, AUDIO_FORMAT_PCM_16_BIT, 48000,
+     AUDIO_CHANNEL_OUT_STEREO},
+    {"spatial-audio-playback", true, AUDIO_OUTPUT_FLAG_SPATIALIZER, AUDIO_INPUT_FLAG_NONE,
+     AUDIO_SOURCE_DEFAULT, AUDIO_FORMAT_PCM_16_BIT, 48000, AUDIO_CHANNEL_OUT_STEREO},
+    {"audio-with-haptics-playback", true, AUDIO_OUTPUT_FLAG_NONE, AUDIO_INPUT_FLAG_NONE,
+     AUDIO_SOURCE_DEFAULT, AUDIO_FORMAT_PCM_16_BIT, 48000,
+     (audio_channel_mask_t)(AUDIO_CHANNEL_OUT_STEREO | AUDIO_CHANNEL_OUT_HAPTIC_A)},
+    {"compress-offload-playback", true,
+     (audio_output_flags_t)(AUDIO_OUTPUT_FLAG_DIRECT | AUDIO_OUTPUT_FLAG_COMPRESS_OFFLOAD |
+                            AUDIO_OUTPUT_FLAG_NON_BLOCKING),
+     AUDIO_INPUT_FLAG_NONE, AUDIO_SOURCE_DEFAULT, AUDIO_FORMAT_MP3, 44100,
+     AUDIO_CHANNEL_OUT_STEREO},
+    {"compress-offload-playback2", true, AUDIO_OUTPUT_FLAG_DIRECT, AUDIO_INPUT_FLAG_NONE,
+     AUDIO_SOURCE_DEFAULT, AUDIO_FORMAT_PCM_16_BIT, 48000, AUDIO_CHANNEL_OUT_STEREO},
+    {"audio-playback-voip", true, AUDIO_OUTPUT_FLAG_VOIP_RX, AUDIO_INPUT_FLAG_NONE,
+     AUDIO_SOURCE_DEFAULT, AUDIO_FORMAT_PCM_16_BIT, 48000, AUDIO_CHANNEL_OUT_MONO},
+    {"audio-record", false, AUDIO_OUTPUT_FLAG_NONE, AUDIO_INPUT_FLAG_NONE,
+     AUDIO_SOURCE_MIC, AUDIO_FORMAT_PCM_16_BIT, 48000, AUDIO_CHANNEL_IN_STEREO},
+    {"low-latency-record", false, AUDIO_OUTPUT_FLAG_NONE, AUDIO_INPUT_FLAG_FAST,
+     AUDIO_SOURCE_MIC, AUDIO_FORMAT_PCM_16_BIT, 48000, AUDIO_CHANNEL_IN_STEREO},
+    {"audio-record-voip", false, AUDIO_OUTPUT_FLAG_NONE, AUDIO_INPUT_FLAG_VOIP_TX,
+     AUDIO_SOURCE_VOICE_COMMUNICATION, AUDIO_FORMAT_PCM_16_BIT, 48000,
+     AUDIO_CHANNEL_IN_MONO},
+    {"audio-record-compress", false, AUDIO_OUTPUT_FLAG_NONE, AUDIO_INPUT_FLAG_DIRECT,
+     AUDIO_SOURCE_MIC, AUDIO_FORMAT_AAC_ADTS_LC, 48000, AUDIO_CHANNEL_IN_STEREO},
+};
+
+struct options {
+    std::vector<std::string> usecases;
+    uint32_t calls = BENCHMARK_DEFAULT_CALLS;
+    uint32_t offloadSeconds = BENCHMARK_DEFAULT_OFFLOAD_SECONDS;
+    bool dump = false;
+    struct fake_pal_config pal;
+};
+
+class Samples {
+  public:
+    void Add(int64_t v) { values_.push_back(v); }
+    size_t Count() const { return values_.size(); }
+    int64_t Percentile(int p)
+    {
+        if (values_.empty())
+            return 0;
+        std::sort(values_.begin(), values_.end());
+        return values_[(values_.size() - 1) * p / 100];
+    }
+    void Reserve(size_t n) { values_.reserve(n); }
+
+  private:
+    std::vector<int64_t> values_;
+};
+
+struct result {
+    std::string landed;
+    int64_t openUs = 0;
+    uint64_t openAllocs = 0;
+    uint64_t errors = 0;
+    Samples wallUs;
+    Samples cpuUs;
+    Samples halUs;
+    Samples jitterUs;
+    uint64_t allocs = 0;
+    uint64_t allocBytes = 0;
+    uint64_t lockWaits = 0;
+    uint64_t lockWaitAvgUs = 0;
+    int64_t lockWaitMaxUs = 0;
+    /* compressed playback only */
+    uint64_t callbacks = 0;
+    int64_t mediaUs = 0;
+    uint64_t expectedWakeupsPerMin = 0;
+    int64_t drainUs = 0;
+};
+
+struct offload_waiter {
+    std::mutex lock;
+    std::condition_variable cond;
+    bool writeReady = false;
+    bool drainReady = false;
+    bool error = false;
+    uint64_t callbacks = 0;
+};
+
+static int64_t NowUs(clockid_t clock)
+{
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+    return (int64_t)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static int64_t PalIoUs()
+{
+    struct fake_pal_stats stats;
+
+    fake_pal_get_stats(&stats);
+    return stats.ioUs;
+}
+
+static int OffloadCallback(stream_callback_event_t event, void *param, void *cookie)
+{
+    struct offload_waiter *waiter = (struct offload_waiter *)cookie;
+    std::lock_guard<std::mutex> guard(waiter->lock);
+
+    waiter->callbacks++;
+    if (event == STREAM_CBK_EVENT_WRITE_READY)
+        waiter->writeReady = true;
+    else if (event == STREAM_CBK_EVENT_DRAIN_READY)
+        waiter->drainReady = true;
+    else
+        waiter->error = true;
+    waiter->cond.notify_all();
+    return 0;
+}
+
+static bool WaitCallback(struct offload_waiter *waiter, bool *flag, int timeoutMs)
+{
+    std::unique_lock<std::mutex> guard(waiter->lock);
+    bool ret;
+
+    ret = waiter->cond.wait_for(guard, std::chrono::milliseconds(timeoutMs),
+                                [waiter, flag]() { return *flag || waiter->error; });
+    ret = ret && *flag;
+    *flag = false;
+    return ret;
+}
+
+/* picks the usecase and stream stats out of a stream dump */
+static void ParseDump(const struct audio_stream *stream, struct result *r, bool print)
+{
+    FILE *f = tmpfile();
+    char line[512];
+    char name[128];
+    uint64_t count, avg, expected;
+    int64_t max;
+    const char *p;
+
+    if (!f)
+        return;
+
+    stream->dump(stream, fileno(f));
+    rewind(f);
+    while (fgets(line, sizeof(line), f)) {
+        if (print)
+            fputs(line, stdout);
+        if ((p = strstr(line, " usecase ")) && r->landed.empty() &&
+            sscanf(p, " usecase %127s", name) == 1)
+            r->landed = name;
+        else if ((p = strstr(line, "stream lock wait:")) &&
+                 sscanf(p, "stream lock wait: count %" SCNu64 " avg %" SCNu64 "us max %" SCNd64,
+                        &count, &avg, &max) == 3) {
+            r->lockWaits = count;
+            r->lockWaitAvgUs = avg;
+            r->lockWaitMaxUs = max;
+        } else if ((p = strstr(line, "expected ")) &&
+                   sscanf(p, "expected %" SCNu64 " wakeups/min", &expected) == 1)
+            r->expectedWakeupsPerMin = expected;
+    }
+    fclose(f);
+}
+
+/* one call into the HAL, attributed to the calling thread */
+class CallSample {
+  public:
+    CallSample() :
+        wallUs_(NowUs(CLOCK_MONOTONIC)), cpuUs_(NowUs(CLOCK_THREAD_CPUTIME_ID)),
+        palUs_(PalIoUs()), allocs_(gAllocs.load()), allocBytes_(gAllocBytes.load()) {}
+
+    void Finish(struct result *r)
+    {
+        int64_t wallUs = NowUs(CLOCK_MONOTONIC) - wallUs_;
+
+        r->wallUs.Add(wallUs);
+        r->cpuUs.Add(NowUs(CLOCK_THREAD_CPUTIME_ID) - cpuUs_);
+        r->halUs.Add(std::max<int64_t>(wallUs - (PalIoUs() - palUs_), 0));
+        r->allocs += gAllocs.load() - allocs_;
+        r->allocBytes += gAllocBytes.load() - allocBytes_;
+    }
+
+  private:
+    int64_t wallUs_;
+    int64_t cpuUs_;
+    int64_t palUs_;
+    uint64_t allocs_;
+    uint64_t allocBytes_;
+};
+
+/* jitter is the spread of call to call intervals around their median */
+static void RecordJitter(const std::vector<int64_t> &startsUs, struct result *r)
+{
+    std::vector<int64_t> intervals;
+    int64_t median;
+
+    for (size_t i = 1; i < startsUs.size(); i++)
+        intervals.push_back(startsUs[i] - startsUs[i - 1]);
+    if (intervals.empty())
+        return;
+
+    std::vector<int64_t> sorted(intervals);
+    std::sort(sorted.begin(), sorted.end());
+    median = sorted[sorted.size() / 2];
+    for (int64_t interval : intervals)
+        r->jitterUs.Add(interval > median ? interval - median : median - interval);
+}
+
+static int RunOutput(audio_hw_device_t *dev, const struct scenario *sc, audio_io_handle_t handle,
+                     const struct options *opts, struct result *r)
+{
+    struct audio_config config = AUDIO_CONFIG_INITIALIZER;
+    struct audio_stream_out *out = nullptr;
+    struct offload_waiter waiter;
+    struct fake_pal_stats stats;
+    std::vector<int64_t> startsUs;
+    std::vector<uint8_t> buffer;
+    bool offload = sc->outFlags & AUDIO_OUTPUT_FLAG_COMPRESS_OFFLOAD;
+    bool nonBlocking = sc->outFlags & AUDIO_OUTPUT_FLAG_NON_BLOCKING;
+    int64_t targetMediaUs = 0;
+    int64_t startUs;
+    uint64_t allocs;
+    size_t bytes, done;
+    ssize_t written;
+    int ret;
+
+    config.sample_rate = sc->sampleRate;
+    config.channel_mask = sc->channelMask;
+    config.format = sc->format;
+    if (offload) {
+        config.offload_info.sample_rate = sc->sampleRate;
+        config.offload_info.channel_mask = sc->channelMask;
+        config.offload_info.format = sc->format;
+        config.offload_info.stream_type = AUDIO_STREAM_MUSIC;
+        config.offload_info.bit_rate = BENCHMARK_OFFLOAD_BIT_RATE;
+        config.offload_info.duration_us = (int64_t)opts->offloadSeconds * 1000000LL;
+        config.offload_info.bit_width = 16;
+        config.offload_info.usage = AUDIO_USAGE_MEDIA;
+    }
+
+    startUs = NowUs(CLOCK_MONOTONIC);
+    allocs = gAllocs.load();
+    ret = dev->open_output_stream(dev, handle, AUDIO_DEVICE_OUT_SPEAKER, sc->outFlags,
+                                  &config, &out, "");
+    /* like audioserver, retry once with the config the HAL suggested */
+    if (ret == -EINVAL && !out)
+        ret = dev->open_output_stream(dev, handle, AUDIO_DEVICE_OUT_SPEAKER, sc->outFlags,
+                                      &config, &out, "");
+    r->openUs = NowUs(CLOCK_MONOTONIC) - startUs;
+    r->openAllocs = gAllocs.load() - allocs;
+    if (ret || !out) {
+        fprintf(stderr, "%s: open_output_stream failed %d\n", sc->usecase, ret);
+        return ret ? ret : -EINVAL;
+    }
+
+    if (nonBlocking && out->set_callback(out, OffloadCallback, &waiter)) {
+        fprintf(stderr, "%s: set_callback failed, writes block\n", sc->usecase);
+        nonBlocking = false;
+    }
+    if (offload && opts->pal.realtime)
+        targetMediaUs = (int64_t)opts->offloadSeconds * 1000000LL;
+
+    bytes = out->common.get_buffer_size(&out->common);
+    buffer.assign(bytes, 0);
+    startsUs.reserve(opts->calls);
+    fake_pal_reset_stats();
+
+    for (uint32_t i = 0; targetMediaUs || i < opts->calls; i++) {
+        startsUs.push_back(NowUs(CLOCK_MONOTONIC));
+        for (done = 0; done < bytes; done += written) {
+            CallSample sample;
+
+            written = out->write(out, buffer.data() + done, bytes - done);
+            sample.Finish(r);
+            if (written < 0) {
+                r->errors++;
+                break;
+            }
+            if (done + written == bytes)
+                break;
+            /* compressed data that did not fit, sleep until the DSP has room */
+            if (!nonBlocking && !written)
+                break;
+            if (nonBlocking &&
+                !WaitCallback(&waiter, &waiter.writeReady, BENCHMARK_CALLBACK_TIMEOUT_MS)) {
+                fprintf(stderr, "%s: no WRITE_READY after a short write\n", sc->usecase);
+                r->errors++;
+                break;
+            }
+        }
+        if (targetMediaUs) {
+            fake_pal_get_stats(&stats);
+            if (stats.offloadMediaUs >= targetMediaUs || r->errors)
+                break;
+        }
+    }
+
+    if (targetMediaUs) {
+        /* wakeups while streaming, the drain below is one more */
+        fake_pal_get_stats(&stats);
+        r->mediaUs = stats.offloadMediaUs;
+        waiter.lock.lock();
+        r->callbacks = waiter.callbacks;
+        waiter.lock.unlock();
+    }
+    if (offload) {
+        startUs = NowUs(CLOCK_MONOTONIC);
+        if (!out->drain(out, AUDIO_DRAIN_ALL) && nonBlocking &&
+            !WaitCallback(&waiter, &waiter.drainReady, BENCHMARK_CALLBACK_TIMEOUT_MS * 10))
+            fprintf(stderr, "%s: no DRAIN_READY\n", sc->usecase);
+        r->drainUs = NowUs(CLOCK_MONOTONIC) - startUs;
+    }
+
+    RecordJitter(startsUs, r);
+    ParseDump(&out->common, r, opts->dump);
+    out->common.standby(&out->common);
+    dev->close_output_stream(dev, out);
+    return 0;
+}
+
+static int RunInput(audio_hw_device_t *dev, const struct scenario *sc, audio_io_handle_t handle,
+                    const struct options *opts, struct result *r)
+{
+    struct audio_config config = AUDIO_CONFIG_INITIALIZER;
+    struct audio_stream_in *in = nullptr;
+    std::vector<int64_t> startsUs;
+    std::vector<uint8_t> buffer;
+    int64_t startUs;
+    uint64_t allocs;
+    ssize_t ret;
+    int err;
+
+    config.sample_rate = sc->sampleRate;
+    config.channel_mask = sc->channelMask;
+    config.format = sc->format;
+
+    startUs = NowUs(CLOCK_MONOTONIC);
+    allocs = gAllocs.load();
+    err = dev->open_input_stream(dev, handle, AUDIO_DEVICE_IN_BUILTIN_MIC, &config, &in,
+                                 sc->inFlags, "", sc->source);
+    if (err == -EINVAL && !in)
+        err = dev->open_input_stream(dev, handle, AUDIO_DEVICE_IN_BUILTIN_MIC, &config, &in,
+                                     sc->inFlags, "", sc->source);
+    r->openUs = NowUs(CLOCK_MONOTONIC) - startUs;
+    r->openAllocs = gAllocs.load() - allocs;
+    if (err || !in) {
+        fprintf(stderr, "%s: open_input_stream failed %d\n", sc->usecase, err);
+        return err ? err : -EINVAL;
+    }
+
+    buffer.assign(in->common.get_buffer_size(&in->common), 0);
+    startsUs.reserve(opts->calls);
+    fake_pal_reset_stats();
+
+    for (uint32_t i = 0; i < opts->calls; i++) {
+        CallSample sample;
+
+        startsUs.push_back(NowUs(CLOCK_MONOTONIC));
+        ret = in->read(in, buffer.data(), buffer.size());
+        sample.Finish(r);
+        if (ret < 0)
+            r->errors++;
+    }
+
+    RecordJitter(startsUs, r);
+    ParseDump(&in->common, r, opts->dump);
+    in->common.standby(&in->common);
+    dev->close_input_stream(dev, in);
+    return 0;
+}
+
+static void PrintHeader()
+{
+    printf("%-28s %8s %7s %6s %5s %15s %15s %15s %9s %15s %9s\n",
+           "usecase", "open us", "allocs", "calls", "errs", "wall p50/p99",
+           "cpu p50/p99", "hal p50/p99", "alloc/c", "lock n/avg/max", "jit p99");
+}
+
+static void PrintResult(const struct scenario *sc, struct result *r)
+{
+    size_t calls = r->wallUs.Count();
+    char wall[32], cpu[32], hal[32], lock[48];
+
+    snprintf(wall, sizeof(wall), "%" PRId64 "/%" PRId64,
+             r->wallUs.Percentile(50), r->wallUs.Percentile(99));
+    snprintf(cpu, sizeof(cpu), "%" PRId64 "/%" PRId64,
+             r->cpuUs.Percentile(50), r->cpuUs.Percentile(99));
+    snprintf(hal, sizeof(hal), "%" PRId64 "/%" PRId64,
+             r->halUs.Percentile(50), r->halUs.Percentile(99));
+    snprintf(lock, sizeof(lock), "%" PRIu64 "/%" PRIu64 "/%" PRId64,
+             r->lockWaits, r->lockWaitAvgUs, r->lockWaitMaxUs);
+    printf("%-28s %8" PRId64 " %7" PRIu64 " %6zu %5" PRIu64 " %15s %15s %15s %9.2f %15s %9" PRId64
+           "\n", sc->usecase, r->openUs, r->openAllocs, calls, r->errors, wall, cpu, hal,
+           calls ? (double)r->allocs / calls : 0.0, lock, r->jitterUs.Percentile(99));
+    if (!r->landed.empty() && r->landed != sc->usecase)
+        printf("    landed on usecase %s\n", r->landed.c_str());
+    if (r->mediaUs > 0)
+        printf("    offload: %.1fs of media, %" PRIu64 " callbacks, %.1f wakeups/min"
+               " (HAL expects %" PRIu64 "), drain %" PRId64 "us\n",
+               r->mediaUs / 1e6, r->callbacks, r->callbacks * 60e6 / r->mediaUs,
+               r->expectedWakeupsPerMin, r->drainUs);
+}
+
+static bool Selected(const struct options *opts, const char *usecase)
+{
+    if (opts->usecases.empty())
+        return true;
+    return std::find(opts->usecases.begin(), opts->usecases.end(), usecase) !=
+           opts->usecases.end();
+}
+
+static void Usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -u <usecase>  run only this usecase, may be repeated\n"
+            "  -n <calls>    reads or writes per usecase (default %d)\n"
+            "  -l <us>       fake PAL latency per read or write\n"
+            "  -j <us>       fake PAL jitter, +/- on top of the latency\n"
+            "  -e <n>        fail every n-th PAL read or write with -EIO\n"
+            "  -s <n>        accept half of every n-th PAL write\n"
+            "  -o <us>       fake PAL latency of pal_stream_open and pal_stream_start\n"
+            "  -r            pace PAL at the stream rate, offload runs -t seconds of media\n"
+            "  -x <factor>   run the paced PAL clock this many times faster\n"
+            "  -t <seconds>  compressed playback length with -r (default %d)\n"
+            "  -d            print each stream dump\n",
+            name, BENCHMARK_DEFAULT_CALLS, BENCHMARK_DEFAULT_OFFLOAD_SECONDS);
+}
+
+int main(int argc, char **argv)
+{
+    struct options opts;
+    const hw_module_t *module = nullptr;
+    audio_hw_device_t *dev = nullptr;
+    audio_io_handle_t handle = 1000;
+    int64_t startUs, cpuUs;
+    uint64_t allocs;
+    int opt;
+    int ret;
+
+    fake_pal_get_config(&opts.pal);
+    opts.pal.offloadBitrate = BENCHMARK_OFFLOAD_BIT_RATE;
+    while ((opt = getopt(argc, argv, "u:n:l:j:e:s:o:rx:t:dh")) != -1) {
+        switch (opt) {
+        case 'u':
+            opts.usecases.push_back(optarg);
+            break;
+        case 'n':
+            opts.calls = strtoul(optarg, nullptr, 0);
+            break;
+        case 'l':
+            opts.pal.ioLatencyUs = strtoll(optarg, nullptr, 0);
+            break;
+        case 'j':
+            opts.pal.ioJitterUs = strtoll(optarg, nullptr, 0);
+            break;
+        case 'e':
+            opts.pal.ioErrorEvery = strtoul(optarg, nullptr, 0);
+            opts.pal.ioError = -EIO;
+            break;
+        case 's':
+            opts.pal.shortWriteEvery = strtoul(optarg, nullptr, 0);
+            break;
+        case 'o':
+            opts.pal.openLatencyUs = strtoll(optarg, nullptr, 0);
+            opts.pal.startLatencyUs = opts.pal.openLatencyUs;
+            break;
+        case 'r':
+            opts.pal.realtime = 1;
+            break;
+        case 'x':
+            opts.pal.speed = strtoul(optarg, nullptr, 0);
+            break;
+        case 't':
+            opts.offloadSeconds = strtoul(optarg, nullptr, 0);
+            break;
+        case 'd':
+            opts.dump = true;
+            break;
+        default:
+            Usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    fake_pal_set_config(&opts.pal);
+
+    ret = hw_get_module_by_class(AUDIO_HARDWARE_MODULE_ID, AUDIO_HARDWARE_MODULE_ID_PRIMARY,
+                                 &module);
+    if (ret) {
+        fprintf(stderr, "no primary audio HAL: %d\n", ret);
+        return 1;
+    }
+
+    startUs = NowUs(CLOCK_MONOTONIC);
+    cpuUs = NowUs(CLOCK_THREAD_CPUTIME_ID);
+    allocs = gAllocs.load();
+    ret = audio_hw_device_open(module, &dev);
+    if (ret || !dev) {
+        fprintf(stderr, "adev_open failed: %d\n", ret);
+        return 1;
+    }
+    printf("adev_open: %" PRId64 "us wall, %" PRId64 "us cpu, %" PRIu64 " allocations\n",
+           NowUs(CLOCK_MONOTONIC) - startUs, NowUs(CLOCK_THREAD_CPUTIME_ID) - cpuUs,
+           gAllocs.load() - allocs);
+    if (dev->init_check(dev))
+        fprintf(stderr, "init_check failed, results may not mean much\n");
+
+    PrintHeader();
+    for (const struct scenario &sc : scenarios) {
+        struct result r;
+
+        if (!Selected(&opts, sc.usecase))
+            continue;
+        r.wallUs.Reserve(opts.calls);
+        r.cpuUs.Reserve(opts.calls);
+        r.halUs.Reserve(opts.calls);
+        if (sc.output)
+            ret = RunOutput(dev, &sc, handle++, &opts, &r);
+        else
+            ret = RunInput(dev, &sc, handle++, &opts, &r);
+        if (!ret)
+            PrintResult(&sc, &r);
+    }
+
+    audio_hw_device_close(dev);
+    return 0;
+}